@@ -93,6 +93,18 @@ int AudioOutOutput(const void *buff)
     return 0;
 }
 
+/**
+ * Samples queued in the output port and not heard yet, -1 without open port
+ */
+int AudioGetRestSamples()
+{
+    if (audio_port_number < 0) {
+        return -1;
+    }
+
+    return sceAudioOutGetRestSample(audio_port_number);
+}
+
 char *AudioFormatToString(enum audio_format format)
 {
     switch (format)
@@ -19,6 +19,7 @@ int AudioInitOutput(int samplerate, int nb_channels, int nb_samples);
 int AudioChangeOutputConfig(int samplerate, int nb_channels, int nb_samples);
 int AudioFreeOutput();
 int AudioOutOutput(const void *buff);
+int AudioGetRestSamples();
 int AudioSetVolumeOutput(int volume);
 
 char *AudioFormatToString(enum audio_format format);
@@ -0,0 +1,174 @@
+#include "station_list.hpp"
+
+#include <stdio.h>
+
+#include <imgui_vita.h>
+
+#include "../logo/logo_cache.hpp"
+#include "../network/prober.hpp"
+
+/**
+ * Move to the first station with the next (or previous) initial after the focused one
+ *
+ * @param direction is 1 for the next letter, -1 for the previous one
+ */
+void station_list_jump(station_list *sl, const playlist *list, int direction)
+{
+	if (!station_list_update(sl, list) || sl->row_count == 0) {
+		return;
+	}
+
+	int row = sl->focused_row >= 0 && sl->focused_row < sl->row_count ? sl->focused_row : 0;
+	if (sl->rows[row] < 0 && row + 1 < sl->row_count) {
+		// Header, use the station below it
+		row++;
+	}
+
+	int letter = station_list_letter(&list->entries[sl->rows[row]]);
+	for (int i = 1; i < STATION_LIST_LETTERS; i++) {
+		int next = (letter + direction * i + STATION_LIST_LETTERS) % STATION_LIST_LETTERS;
+		if (sl->first_row[next] >= 0) {
+			sl->scroll_row = sl->first_row[next];
+			sl->focus_row = sl->scroll_row;
+			sl->jump_letter = next ? 'A' + next - 1 : '#';
+			sl->jump_time = ImGui::GetTime();
+			return;
+		}
+	}
+}
+
+static void station_list_draw_header(const char *name)
+{
+	ImDrawList *draw_list = ImGui::GetWindowDrawList();
+	ImVec2 pos = ImGui::GetCursorScreenPos();
+	float width = ImGui::GetContentRegionAvail().x;
+
+	draw_list->AddRectFilled(pos, ImVec2(pos.x + width, pos.y + STATION_LIST_ROW_HEIGHT), IM_COL32(40, 40, 40, 255));
+	draw_list->AddText(ImVec2(pos.x + 8, pos.y + (STATION_LIST_ROW_HEIGHT - ImGui::GetFontSize()) / 2), IM_COL32(255, 200, 80, 255), name);
+
+	// Same height as a station so the clipper can compute row positions
+	ImGui::Dummy(ImVec2(width, STATION_LIST_ROW_HEIGHT));
+}
+
+/**
+ * Last check of the station on the right of its row: time to first audio byte, or down
+ */
+static void station_list_draw_status(const playlist_entry *entry)
+{
+	prober_result result;
+	if (!prober_lookup(entry->url, &result)) {
+		return;
+	}
+
+	char text[32];
+	ImU32 color = IM_COL32(255, 60, 60, 255);
+	if (result.status == PROBER_STATUS_UP) {
+		if (result.bitrate) {
+			snprintf(text, sizeof(text), "%u kbps %u ms", result.bitrate, result.first_byte_ms);
+		} else {
+			snprintf(text, sizeof(text), "%u ms", result.first_byte_ms);
+		}
+		color = result.first_byte_ms > PROBER_SLOW_MS ? IM_COL32(255, 170, 40, 255) : IM_COL32(80, 220, 80, 255);
+	} else {
+		snprintf(text, sizeof(text), "down");
+	}
+
+	ImVec2 max = ImGui::GetItemRectMax();
+	ImVec2 size = ImGui::CalcTextSize(text);
+	ImGui::GetWindowDrawList()->AddText(ImVec2(max.x - size.x - 8, max.y - (STATION_LIST_ROW_HEIGHT + size.y) / 2), color, text);
+}
+
+static void station_list_draw_letter(const station_list *sl)
+{
+	double age = ImGui::GetTime() - sl->jump_time;
+	if (!sl->jump_letter || age >= STATION_LIST_LETTER_TIME) {
+		return;
+	}
+
+	ImDrawList *draw_list = ImGui::GetWindowDrawList();
+	ImVec2 pos = ImGui::GetWindowPos();
+	ImVec2 size = ImGui::GetWindowSize();
+	ImVec2 center(pos.x + size.x / 2, pos.y + size.y / 2);
+	float alpha = 1.0f - (float)(age / STATION_LIST_LETTER_TIME);
+	char text[2] = { sl->jump_letter, '\0' };
+
+	draw_list->AddRectFilled(ImVec2(center.x - 50, center.y - 50), ImVec2(center.x + 50, center.y + 50), IM_COL32(0, 0, 0, (int)(200 * alpha)), 8.0f);
+	draw_list->AddText(ImGui::GetFont(), 64.0f, ImVec2(center.x - 20, center.y - 32), IM_COL32(255, 255, 255, (int)(255 * alpha)), text);
+}
+
+/**
+ * Draw the visible rows in a child window filling the rest of the current window
+ *
+ * @param current is the index of the station playing, highlighted
+ * @return the index of the station pressed, -1 if none
+ */
+int station_list_draw(station_list *sl, const playlist *list, int current)
+{
+	if (!station_list_update(sl, list)) {
+		return -1;
+	}
+
+	int pressed = -1;
+	float row_height = STATION_LIST_ROW_HEIGHT + ImGui::GetStyle().ItemSpacing.y;
+
+	ImGui::BeginChild("Stations");
+
+	if (sl->scroll_row >= 0) {
+		ImGui::SetScrollY(station_list_scroll_y(sl->scroll_row, row_height, ImGui::GetWindowHeight()));
+		sl->scroll_row = -1;
+	}
+
+	ImGuiListClipper clipper;
+	clipper.Begin(sl->row_count, row_height);
+	while (clipper.Step()) {
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+			int index = sl->rows[row];
+			if (index < 0) {
+				station_list_draw_header(list->groups[-index - 2]);
+				continue;
+			}
+
+			const playlist_entry *entry = &list->entries[index];
+
+			// Focus can only be given to an item being submitted, wait for the scroll to reach it
+			if (row == sl->focus_row) {
+				ImGui::SetKeyboardFocusHere();
+				sl->focus_row = -1;
+			}
+
+			// Several stations can have the same name
+			ImGui::PushID(index);
+			if (index == current) {
+				ImGui::PushStyleColor(ImGuiCol_Button, ImGui::GetStyle().Colors[ImGuiCol_ButtonActive]);
+			}
+
+			if (ImGui::Button(entry->title ? entry->title : entry->url, ImVec2(-1, STATION_LIST_ROW_HEIGHT))) {
+				pressed = index;
+			}
+
+			// Only visible rows get here, so only their logos are requested
+			if (entry->logo_url) {
+				ImVec2 min = ImGui::GetItemRectMin();
+				logo_cache_draw(ImGui::GetWindowDrawList(), entry->logo_url, ImVec2(min.x + 2, min.y + 2),
+					ImVec2(min.x + STATION_LIST_ROW_HEIGHT - 2, min.y + STATION_LIST_ROW_HEIGHT - 2));
+			}
+			station_list_draw_status(entry);
+
+			if (index == current) {
+				ImGui::PopStyleColor();
+			}
+
+			if (ImGui::IsItemFocused()) {
+				sl->focused_row = row;
+			}
+			ImGui::PopID();
+		}
+	}
+	clipper.End();
+
+	station_list_draw_letter(sl);
+
+	ImGui::EndChild();
+
+	return pressed;
+}
@@ -0,0 +1,48 @@
+#ifndef __STATION_LIST_HPP__
+#define __STATION_LIST_HPP__
+
+#include "../playlist/playlist.hpp"
+
+#define STATION_LIST_ROW_HEIGHT 30
+#define STATION_LIST_LETTERS 27 // '#' then A to Z
+#define STATION_LIST_LETTER_TIME 0.5 // seconds the jump letter stays on screen
+
+/**
+ * Rows of the station menu: stations, with a header when the group changes
+ *
+ * Only the visible rows are submitted to ImGui, the list costs the same with 10 or 100000 stations.
+ * A filter, like search results, limits the rows to some stations.
+ */
+struct station_list {
+	int *rows; // entry index, or -(group + 2) for a group header
+	int *entry_rows; // row of each entry, -1 if filtered out
+	int row_count;
+	int built_count; // playlist count the rows were built for
+
+	const int *filter; // entry indexes to show instead of the whole playlist, NULL if none
+	int filter_count;
+
+	int first_row[STATION_LIST_LETTERS]; // first row of each initial, -1 if none
+	int scroll_row; // row to bring to the middle on next draw, -1 if none
+	int focus_row; // row to focus once it is visible, -1 if none
+	int focused_row; // row with the gamepad focus
+
+	char jump_letter;
+	double jump_time;
+};
+
+// Rows and their positions, in station_list_rows.cpp, independent from ImGui
+void station_list_init(station_list *sl);
+void station_list_free(station_list *sl);
+int station_list_letter(const playlist_entry *entry);
+int station_list_build(station_list *sl, const playlist *list);
+bool station_list_update(station_list *sl, const playlist *list);
+void station_list_set_filter(station_list *sl, const int *indexes, int count);
+void station_list_show(station_list *sl, const playlist *list, int index);
+float station_list_scroll_y(int row, float row_height, float window_height);
+
+// Drawing, in station_list.cpp
+void station_list_jump(station_list *sl, const playlist *list, int direction);
+int station_list_draw(station_list *sl, const playlist *list, int current);
+
+#endif
@@ -0,0 +1,146 @@
+#include "station_list.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <psp2/kernel/clib.h>
+
+#define printf sceClibPrintf
+
+void station_list_init(station_list *sl)
+{
+	memset(sl, 0, sizeof(station_list));
+	sl->built_count = -1;
+	sl->scroll_row = -1;
+	sl->focus_row = -1;
+	sl->focused_row = -1;
+}
+
+void station_list_free(station_list *sl)
+{
+	free(sl->rows);
+	free(sl->entry_rows);
+	station_list_init(sl);
+}
+
+int station_list_letter(const playlist_entry *entry)
+{
+	const char *name = entry->title ? entry->title : entry->url;
+	char c = name[0];
+
+	if (c >= 'a' && c <= 'z') {
+		return c - 'a' + 1;
+	}
+
+	if (c >= 'A' && c <= 'Z') {
+		return c - 'A' + 1;
+	}
+
+	// Digits, punctuation and non ASCII names
+	return 0;
+}
+
+int station_list_build(station_list *sl, const playlist *list)
+{
+	free(sl->rows);
+	free(sl->entry_rows);
+	sl->rows = NULL;
+	sl->entry_rows = NULL;
+	sl->row_count = 0;
+	sl->focused_row = -1;
+	sl->built_count = list->count;
+
+	for (int letter = 0; letter < STATION_LIST_LETTERS; letter++) {
+		sl->first_row[letter] = -1;
+	}
+
+	int count = sl->filter ? sl->filter_count : list->count;
+	int header_count = 0;
+	int group = PLAYLIST_NO_GROUP;
+	for (int i = 0; i < count; i++) {
+		const playlist_entry *entry = &list->entries[sl->filter ? sl->filter[i] : i];
+		if (entry->group != group && entry->group != PLAYLIST_NO_GROUP) {
+			header_count++;
+		}
+		group = entry->group;
+	}
+
+	sl->rows = (int*)malloc(sizeof(int) * (count + header_count + 1));
+	sl->entry_rows = (int*)malloc(sizeof(int) * (list->count + 1));
+	if (!sl->rows || !sl->entry_rows) {
+		printf("Station list: error allocating %i rows\n", count + header_count);
+		free(sl->rows);
+		free(sl->entry_rows);
+		sl->rows = NULL;
+		sl->entry_rows = NULL;
+		return -1;
+	}
+
+	memset(sl->entry_rows, 0xFF, sizeof(int) * list->count);
+
+	group = PLAYLIST_NO_GROUP;
+	for (int k = 0; k < count; k++) {
+		int i = sl->filter ? sl->filter[k] : k;
+		const playlist_entry *entry = &list->entries[i];
+
+		// Playlists usually list a group in one block, a header starts each block
+		if (entry->group != group && entry->group != PLAYLIST_NO_GROUP) {
+			sl->rows[sl->row_count++] = -(entry->group + 2);
+		}
+		group = entry->group;
+
+		int letter = station_list_letter(entry);
+		if (sl->first_row[letter] < 0) {
+			sl->first_row[letter] = sl->row_count;
+		}
+
+		sl->entry_rows[i] = sl->row_count;
+		sl->rows[sl->row_count++] = i;
+	}
+
+	return 0;
+}
+
+bool station_list_update(station_list *sl, const playlist *list)
+{
+	if (sl->built_count != list->count && station_list_build(sl, list)) {
+		return false;
+	}
+
+	return sl->rows != NULL;
+}
+
+/**
+ * Only show some stations, in the given order
+ *
+ * @param indexes must stay valid until the filter is replaced, NULL shows every station
+ */
+void station_list_set_filter(station_list *sl, const int *indexes, int count)
+{
+	sl->filter = indexes;
+	sl->filter_count = indexes ? count : 0;
+	sl->built_count = -1;
+	sl->scroll_row = 0;
+	sl->focus_row = 0;
+}
+
+/**
+ * Scroll to a station and give it the gamepad focus on next draw
+ */
+void station_list_show(station_list *sl, const playlist *list, int index)
+{
+	if (!station_list_update(sl, list) || index < 0 || index >= list->count || sl->entry_rows[index] < 0) {
+		return;
+	}
+
+	sl->scroll_row = sl->entry_rows[index];
+	sl->focus_row = sl->scroll_row;
+}
+
+/**
+ * Scroll position that brings a row to the middle of the list window
+ */
+float station_list_scroll_y(int row, float row_height, float window_height)
+{
+	return row * row_height - (window_height - row_height) / 2;
+}
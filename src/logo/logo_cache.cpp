@@ -0,0 +1,654 @@
+#include "logo_cache.hpp"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <curl/curl.h>
+#include <jpeglib.h>
+#include <png.h>
+#include <vitaGL.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#include "../trace/trace.hpp"
+#include "../utils.hpp"
+
+#define printf sceClibPrintf
+
+enum logo_state {
+	LOGO_STATE_EMPTY,
+	LOGO_STATE_QUEUED, // waiting for the fetcher
+	LOGO_STATE_LOADING, // owned by the fetcher
+	LOGO_STATE_DECODED, // pixels waiting for the upload
+	LOGO_STATE_LOADED, // texture ready
+	LOGO_STATE_FAILED, // no usable image
+};
+
+struct logo_slot {
+	volatile logo_state state;
+	uint64_t hash;
+	char *url; // until the fetcher is done with it
+	unsigned int last_used; // frame of the last draw
+	uint32_t *pixels; // RGBA thumbnail until uploaded
+	int width;
+	int height;
+	GLuint texture;
+};
+
+/**
+ * Thumbnail file: header, then width * height RGBA pixels
+ *
+ * A header with no size marks a logo which could not be fetched or decoded.
+ */
+struct logo_file_header {
+	uint32_t magic;
+	uint16_t width;
+	uint16_t height;
+};
+
+struct logo_download {
+	unsigned char *data;
+	size_t size;
+	size_t capacity;
+};
+
+struct logo_jpeg_error {
+	jpeg_error_mgr manager;
+	jmp_buf jump;
+};
+
+// Slot states are changed under the mutex, the UI thread never touches a slot being loaded
+static logo_slot slots[LOGO_CACHE_SLOTS];
+static size_t texture_bytes = 0;
+static unsigned int frame = 0;
+static SceUID logo_mutex = -1;
+static SceUID fetcher_thread_id = -1;
+static volatile bool fetcher_running = false;
+
+static void logo_cache_path(char *path, size_t size, uint64_t hash)
+{
+	snprintf(path, size, "%s/%08X%08X.logo", LOGO_CACHE_DIRECTORY, (unsigned int)(hash >> 32), (unsigned int)hash);
+}
+
+static size_t logo_download_callback(char *data, size_t size, size_t nmemb, void *userdata)
+{
+	logo_download *download = (logo_download*)userdata;
+	size_t length = size * nmemb;
+
+	if (download->size + length > LOGO_DOWNLOAD_MAX) {
+		printf("Logo: image larger than %u KB\n", LOGO_DOWNLOAD_MAX / 1024);
+		return 0;
+	}
+
+	if (download->size + length > download->capacity) {
+		size_t capacity = download->capacity ? download->capacity : 16 * 1024;
+		while (capacity < download->size + length) {
+			capacity *= 2;
+		}
+
+		unsigned char *buffer = (unsigned char*)realloc(download->data, capacity);
+		if (!buffer) {
+			return 0;
+		}
+		download->data = buffer;
+		download->capacity = capacity;
+	}
+
+	memcpy(download->data + download->size, data, length);
+	download->size += length;
+
+	return length;
+}
+
+static int logo_progress_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+{
+	// Abort on exit instead of waiting for the timeout
+	return fetcher_running ? 0 : 1;
+}
+
+static int logo_cache_fetch(const char *url, logo_download *download)
+{
+	CURL *curl = curl_easy_init();
+	if (!curl) {
+		return -1;
+	}
+
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 8L);
+	curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT, 20L);
+	curl_easy_setopt(curl, CURLOPT_USERAGENT, "VitaWebradios/2.0");
+
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, logo_download_callback);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, download);
+	curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, logo_progress_callback);
+	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+	// HTTPS (disable checks)
+	curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+	curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+
+	CURLcode res = curl_easy_perform(curl);
+	curl_easy_cleanup(curl);
+
+	if (res != CURLE_OK) {
+		printf("Logo: cannot fetch %s (%s)\n", url, curl_easy_strerror(res));
+		return -1;
+	}
+
+	return 0;
+}
+
+static uint32_t *logo_decode_png(const unsigned char *data, size_t size, int *width, int *height)
+{
+	png_image image;
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+
+	if (!png_image_begin_read_from_memory(&image, data, size)) {
+		return NULL;
+	}
+
+	if (image.width > LOGO_DECODE_MAX || image.height > LOGO_DECODE_MAX) {
+		printf("Logo: PNG too large (%ux%u)\n", image.width, image.height);
+		png_image_free(&image);
+		return NULL;
+	}
+
+	image.format = PNG_FORMAT_RGBA;
+	uint32_t *pixels = (uint32_t*)malloc(PNG_IMAGE_SIZE(image));
+	if (!pixels) {
+		png_image_free(&image);
+		return NULL;
+	}
+
+	if (!png_image_finish_read(&image, NULL, pixels, 0, NULL)) {
+		free(pixels);
+		return NULL;
+	}
+
+	*width = image.width;
+	*height = image.height;
+
+	return pixels;
+}
+
+static void logo_jpeg_error_exit(j_common_ptr info)
+{
+	longjmp(((logo_jpeg_error*)info->err)->jump, 1);
+}
+
+static uint32_t *logo_decode_jpeg(const unsigned char *data, size_t size, int *width, int *height)
+{
+	jpeg_decompress_struct info;
+	logo_jpeg_error error;
+	uint32_t *volatile pixels = NULL;
+
+	info.err = jpeg_std_error(&error.manager);
+	error.manager.error_exit = logo_jpeg_error_exit;
+	if (setjmp(error.jump)) {
+		jpeg_destroy_decompress(&info);
+		free(pixels);
+		return NULL;
+	}
+
+	jpeg_create_decompress(&info);
+	jpeg_mem_src(&info, (unsigned char*)data, size);
+	jpeg_read_header(&info, TRUE);
+
+	// The decoder downscales by 1/2, 1/4 or 1/8 for almost free, the box filter does the rest
+	info.out_color_space = JCS_RGB;
+	info.scale_num = 1;
+	info.scale_denom = 1;
+	while (info.scale_denom < 8 && info.image_width / (info.scale_denom * 2) >= LOGO_SIZE
+		&& info.image_height / (info.scale_denom * 2) >= LOGO_SIZE) {
+		info.scale_denom *= 2;
+	}
+
+	jpeg_start_decompress(&info);
+
+	if (info.output_width > LOGO_DECODE_MAX || info.output_height > LOGO_DECODE_MAX) {
+		printf("Logo: JPEG too large (%ux%u)\n", info.output_width, info.output_height);
+		jpeg_destroy_decompress(&info);
+		return NULL;
+	}
+
+	pixels = (uint32_t*)malloc(sizeof(uint32_t) * info.output_width * info.output_height);
+	if (!pixels) {
+		jpeg_destroy_decompress(&info);
+		return NULL;
+	}
+
+	JSAMPARRAY row = (*info.mem->alloc_sarray)((j_common_ptr)&info, JPOOL_IMAGE, info.output_width * info.output_components, 1);
+	while (info.output_scanline < info.output_height) {
+		uint32_t *line = pixels + info.output_scanline * info.output_width;
+		jpeg_read_scanlines(&info, row, 1);
+
+		const JSAMPLE *rgb = row[0];
+		for (unsigned int x = 0; x < info.output_width; x++, rgb += 3) {
+			line[x] = 0xFF000000 | (rgb[2] << 16) | (rgb[1] << 8) | rgb[0];
+		}
+	}
+
+	*width = info.output_width;
+	*height = info.output_height;
+
+	jpeg_finish_decompress(&info);
+	jpeg_destroy_decompress(&info);
+
+	return pixels;
+}
+
+/**
+ * Box filter down to the thumbnail size, keeping the aspect ratio
+ *
+ * Colors are weighted by alpha so transparent borders do not darken the edges.
+ */
+static uint32_t *logo_downscale(const uint32_t *pixels, int width, int height, int *thumb_width, int *thumb_height)
+{
+	int tw = width;
+	int th = height;
+	if (width >= height && width > LOGO_SIZE) {
+		tw = LOGO_SIZE;
+		th = height * LOGO_SIZE / width;
+	} else if (height > width && height > LOGO_SIZE) {
+		th = LOGO_SIZE;
+		tw = width * LOGO_SIZE / height;
+	}
+	tw = tw > 0 ? tw : 1;
+	th = th > 0 ? th : 1;
+
+	uint32_t *thumb = (uint32_t*)malloc(sizeof(uint32_t) * tw * th);
+	if (!thumb) {
+		return NULL;
+	}
+
+	for (int y = 0; y < th; y++) {
+		int y0 = y * height / th;
+		int y1 = (y + 1) * height / th;
+
+		for (int x = 0; x < tw; x++) {
+			int x0 = x * width / tw;
+			int x1 = (x + 1) * width / tw;
+			uint32_t r = 0, g = 0, b = 0, a = 0;
+
+			for (int sy = y0; sy < y1; sy++) {
+				const uint32_t *line = pixels + sy * width;
+				for (int sx = x0; sx < x1; sx++) {
+					uint32_t pixel = line[sx];
+					uint32_t alpha = pixel >> 24;
+					r += (pixel & 0xFF) * alpha;
+					g += (pixel >> 8 & 0xFF) * alpha;
+					b += (pixel >> 16 & 0xFF) * alpha;
+					a += alpha;
+				}
+			}
+
+			uint32_t count = (y1 - y0) * (x1 - x0);
+			thumb[y * tw + x] = a ? (a / count) << 24 | (b / a) << 16 | (g / a) << 8 | (r / a) : 0;
+		}
+	}
+
+	*thumb_width = tw;
+	*thumb_height = th;
+
+	return thumb;
+}
+
+static uint32_t *logo_decode(const logo_download *download, int *width, int *height)
+{
+	uint32_t *pixels = NULL;
+	int image_width = 0;
+	int image_height = 0;
+
+	if (download->size > 8 && !memcmp(download->data, "\x89PNG", 4)) {
+		pixels = logo_decode_png(download->data, download->size, &image_width, &image_height);
+	} else if (download->size > 2 && download->data[0] == 0xFF && download->data[1] == 0xD8) {
+		pixels = logo_decode_jpeg(download->data, download->size, &image_width, &image_height);
+	} else {
+		printf("Logo: unsupported image format\n");
+	}
+
+	if (!pixels) {
+		return NULL;
+	}
+
+	uint32_t *thumb = logo_downscale(pixels, image_width, image_height, width, height);
+	free(pixels);
+
+	return thumb;
+}
+
+/**
+ * @return 0 with the thumbnail pixels, 1 if the logo is known to be unusable, -1 if not cached
+ */
+static int logo_cache_read(const char *path, logo_slot *slot)
+{
+	SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+	if (fd < 0) {
+		return -1;
+	}
+
+	logo_file_header header;
+	int ret = -1;
+	if (sceIoRead(fd, &header, sizeof(header)) == sizeof(header) && header.magic == LOGO_CACHE_MAGIC
+		&& header.width <= LOGO_SIZE && header.height <= LOGO_SIZE) {
+		if (!header.width || !header.height) {
+			ret = 1;
+		} else {
+			int size = sizeof(uint32_t) * header.width * header.height;
+			slot->pixels = (uint32_t*)malloc(size);
+			if (slot->pixels && sceIoRead(fd, slot->pixels, size) == size) {
+				slot->width = header.width;
+				slot->height = header.height;
+				ret = 0;
+			} else {
+				free(slot->pixels);
+				slot->pixels = NULL;
+			}
+		}
+	}
+
+	sceIoClose(fd);
+
+	return ret;
+}
+
+static void logo_cache_write(const char *path, const logo_slot *slot)
+{
+	SceUID fd = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+	if (fd < 0) {
+		printf("Logo: cannot create %s (0x%X)\n", path, fd);
+		return;
+	}
+
+	logo_file_header header;
+	header.magic = LOGO_CACHE_MAGIC;
+	header.width = slot->pixels ? slot->width : 0;
+	header.height = slot->pixels ? slot->height : 0;
+
+	sceIoWrite(fd, &header, sizeof(header));
+	if (slot->pixels) {
+		sceIoWrite(fd, slot->pixels, sizeof(uint32_t) * slot->width * slot->height);
+	}
+
+	sceIoClose(fd);
+}
+
+/**
+ * Read the thumbnail from the memory card, or fetch, decode and store it
+ */
+static int logo_cache_load(logo_slot *slot)
+{
+	char path[64];
+	logo_cache_path(path, sizeof(path), slot->hash);
+
+	int ret = logo_cache_read(path, slot);
+	if (ret >= 0) {
+		return ret == 0 ? 0 : -1;
+	}
+
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+
+	logo_download download;
+	memset(&download, 0, sizeof(download));
+	if (logo_cache_fetch(slot->url, &download)) {
+		// Maybe a network error, try again on next launch
+		free(download.data);
+		return -1;
+	}
+
+	slot->pixels = logo_decode(&download, &slot->width, &slot->height);
+	logo_cache_write(path, slot);
+
+	unsigned int elapsed = (unsigned int)(sceKernelGetProcessTimeWide() - start);
+	printf("Logo: %s %u KB %ix%i in %u ms\n", slot->url, download.size / 1024, slot->width, slot->height, elapsed / 1000);
+
+	free(download.data);
+
+	return slot->pixels ? 0 : -1;
+}
+
+static int logo_fetcher_thread(SceSize args, void *argp)
+{
+	TRACE_THREAD("logoThread");
+
+	while (fetcher_running) {
+		// Most recently drawn request first, rows scrolled past are dropped by the UI thread
+		logo_slot *slot = NULL;
+
+		TRACE_LOCK(logo_mutex, "logo_mutex");
+		for (int i = 0; i < LOGO_CACHE_SLOTS; i++) {
+			if (slots[i].state == LOGO_STATE_QUEUED && (!slot || slots[i].last_used > slot->last_used)) {
+				slot = &slots[i];
+			}
+		}
+		if (slot) {
+			slot->state = LOGO_STATE_LOADING;
+		}
+		sceKernelUnlockMutex(logo_mutex, 1);
+
+		if (!slot) {
+			sceKernelDelayThread(50000);
+			continue;
+		}
+
+		TRACE_BEGIN("logo");
+		int ret = logo_cache_load(slot);
+		TRACE_END("logo");
+
+		TRACE_LOCK(logo_mutex, "logo_mutex");
+		free(slot->url);
+		slot->url = NULL;
+		slot->state = ret ? LOGO_STATE_FAILED : LOGO_STATE_DECODED;
+		sceKernelUnlockMutex(logo_mutex, 1);
+	}
+
+	return 0;
+}
+
+int logo_cache_init(void)
+{
+	memset(slots, 0, sizeof(slots));
+	texture_bytes = 0;
+
+	logo_mutex = sceKernelCreateMutex("logo_mutex", 0, 0, NULL);
+	if (logo_mutex < 0) {
+		printf("Logo: error creating mutex\n");
+		return -1;
+	}
+
+	sceIoMkdir(LOGO_CACHE_DIRECTORY, 0777);
+
+	// Lowest priority, logos come after the stream
+	fetcher_running = true;
+	fetcher_thread_id = sceKernelCreateThread("logoThread", logo_fetcher_thread, 0x10000100 + 20, 0x8000, 0, 0, NULL);
+	if (fetcher_thread_id < 0) {
+		printf("Logo: error creating thread with id %i\n", fetcher_thread_id);
+		fetcher_running = false;
+		sceKernelDeleteMutex(logo_mutex);
+		logo_mutex = -1;
+		return -1;
+	}
+
+	sceKernelStartThread(fetcher_thread_id, 0, NULL);
+
+	return 0;
+}
+
+static void logo_cache_release(logo_slot *slot)
+{
+	if (slot->state == LOGO_STATE_LOADED) {
+		glDeleteTextures(1, &slot->texture);
+		texture_bytes -= sizeof(uint32_t) * slot->width * slot->height;
+	}
+
+	free(slot->url);
+	free(slot->pixels);
+	memset(slot, 0, sizeof(logo_slot));
+}
+
+void logo_cache_term(void)
+{
+	if (fetcher_thread_id < 0) {
+		return;
+	}
+
+	fetcher_running = false;
+
+	SceUInt timeout = 5000000;
+	sceKernelWaitThreadEnd(fetcher_thread_id, NULL, &timeout);
+	sceKernelDeleteThread(fetcher_thread_id);
+	fetcher_thread_id = -1;
+
+	for (int i = 0; i < LOGO_CACHE_SLOTS; i++) {
+		logo_cache_release(&slots[i]);
+	}
+
+	sceKernelDeleteMutex(logo_mutex);
+	logo_mutex = -1;
+}
+
+/**
+ * Least recently drawn slot the UI thread can take, not drawn in this frame
+ */
+static logo_slot *logo_cache_evictable(bool loaded_only)
+{
+	logo_slot *slot = NULL;
+
+	for (int i = 0; i < LOGO_CACHE_SLOTS; i++) {
+		logo_state state = slots[i].state;
+		if (!loaded_only && state == LOGO_STATE_EMPTY) {
+			return &slots[i];
+		}
+
+		bool evictable = loaded_only ? state == LOGO_STATE_LOADED
+			: state == LOGO_STATE_QUEUED || state == LOGO_STATE_LOADED || state == LOGO_STATE_FAILED;
+
+		if (evictable && slots[i].last_used != frame && (!slot || slots[i].last_used < slot->last_used)) {
+			slot = &slots[i];
+		}
+	}
+
+	return slot;
+}
+
+static void logo_cache_upload(logo_slot *slot)
+{
+	size_t size = sizeof(uint32_t) * slot->width * slot->height;
+
+	// Make room in the budget, a logo drawn this frame is never evicted
+	while (texture_bytes + size > LOGO_CACHE_BUDGET) {
+		logo_slot *victim = logo_cache_evictable(true);
+		if (!victim) {
+			return;
+		}
+		logo_cache_release(victim);
+	}
+
+	glGenTextures(1, &slot->texture);
+	glBindTexture(GL_TEXTURE_2D, slot->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, slot->width, slot->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, slot->pixels);
+
+	free(slot->pixels);
+	slot->pixels = NULL;
+	texture_bytes += size;
+	slot->state = LOGO_STATE_LOADED;
+}
+
+/**
+ * Upload a few decoded logos and drop the requests which are no longer drawn
+ *
+ * Call it once per frame from the UI thread, before drawing.
+ */
+void logo_cache_update(void)
+{
+	if (logo_mutex < 0) {
+		return;
+	}
+
+	frame++;
+
+	TRACE_LOCK(logo_mutex, "logo_mutex");
+	for (int i = 0; i < LOGO_CACHE_SLOTS; i++) {
+		if (slots[i].state == LOGO_STATE_QUEUED && frame - slots[i].last_used > LOGO_REQUEST_FRAMES) {
+			logo_cache_release(&slots[i]);
+		}
+	}
+	sceKernelUnlockMutex(logo_mutex, 1);
+
+	// The fetcher does not touch decoded slots
+	int uploads = 0;
+	for (int i = 0; i < LOGO_CACHE_SLOTS && uploads < LOGO_UPLOADS_PER_FRAME; i++) {
+		if (slots[i].state == LOGO_STATE_DECODED) {
+			logo_cache_upload(&slots[i]);
+			uploads++;
+		}
+	}
+}
+
+static logo_slot *logo_cache_request(const char *url)
+{
+	uint64_t hash = Utils_Hash(url);
+
+	for (int i = 0; i < LOGO_CACHE_SLOTS; i++) {
+		if (slots[i].hash == hash && slots[i].state != LOGO_STATE_EMPTY) {
+			slots[i].last_used = frame;
+			return &slots[i];
+		}
+	}
+
+	TRACE_LOCK(logo_mutex, "logo_mutex");
+	logo_slot *slot = logo_cache_evictable(false);
+	if (slot) {
+		logo_cache_release(slot);
+		slot->url = strdup(url);
+		if (slot->url) {
+			slot->hash = hash;
+			slot->last_used = frame;
+			slot->state = LOGO_STATE_QUEUED;
+		}
+	}
+	sceKernelUnlockMutex(logo_mutex, 1);
+
+	return slot;
+}
+
+/**
+ * Draw the logo fitted and centered in a box, or request it
+ *
+ * @return false if the logo is not loaded yet or not available
+ */
+bool logo_cache_draw(ImDrawList *draw_list, const char *url, const ImVec2 &min, const ImVec2 &max)
+{
+	if (!url || !url[0] || logo_mutex < 0) {
+		return false;
+	}
+
+	logo_slot *slot = logo_cache_request(url);
+	if (!slot || slot->state != LOGO_STATE_LOADED) {
+		return false;
+	}
+
+	float scale_x = (max.x - min.x) / slot->width;
+	float scale_y = (max.y - min.y) / slot->height;
+	float scale = scale_x < scale_y ? scale_x : scale_y;
+	float width = slot->width * scale;
+	float height = slot->height * scale;
+	ImVec2 origin(min.x + (max.x - min.x - width) / 2, min.y + (max.y - min.y - height) / 2);
+
+	draw_list->AddImage((ImTextureID)(uintptr_t)slot->texture, origin, ImVec2(origin.x + width, origin.y + height));
+
+	return true;
+}
@@ -0,0 +1,28 @@
+#ifndef __LOGO_CACHE_HPP__
+#define __LOGO_CACHE_HPP__
+
+#include <imgui_vita.h>
+
+#define LOGO_CACHE_DIRECTORY "ux0:/data/webradio/logos"
+#define LOGO_CACHE_MAGIC 0x4F474C57 // "WLGO"
+#define LOGO_SIZE 64 // thumbnails fit in a LOGO_SIZE square
+#define LOGO_CACHE_SLOTS 256
+#define LOGO_CACHE_BUDGET (2 * 1024 * 1024) // bytes of textures kept in memory
+#define LOGO_DOWNLOAD_MAX (1024 * 1024) // larger images are not fetched
+#define LOGO_DECODE_MAX 1024 // larger PNG images are not decoded, JPEG ones are scaled down while decoding
+#define LOGO_UPLOADS_PER_FRAME 4
+#define LOGO_REQUEST_FRAMES 30 // a request not renewed for this many frames is dropped
+
+/**
+ * Station logos, fetched and decoded by a background thread
+ *
+ * Thumbnails are kept on the memory card once decoded, the next launch only reads them back.
+ * Textures live in memory until the budget is reached, the least recently drawn ones go first.
+ * Drawing never waits: a missing logo is requested and drawn on a later frame.
+ */
+int logo_cache_init(void);
+void logo_cache_term(void);
+void logo_cache_update(void);
+bool logo_cache_draw(ImDrawList *draw_list, const char *url, const ImVec2 &min, const ImVec2 &max);
+
+#endif
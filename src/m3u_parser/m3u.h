@@ -1,23 +0,0 @@
-
-#include <psp2/types.h>
-
-struct m3u_entry {
-    struct m3u_entry *previous;
-    struct m3u_entry *next;
-    char *url;
-    char *logo_url;
-    char *title;
-};
-
-struct m3u_file {
-    const char *filepath;
-    char *playlist_name;
-    int nb_entries;
-    struct m3u_entry *first_entry;
-    struct m3u_entry *last_entry;
-};
-
-int m3u_parse(const char *filepath, struct m3u_file **m3ufile_p);
-void m3u_file_free(struct m3u_file *m3ufile);
-void m3u_add_entry(struct m3u_file *m3ufile, char *url, char *logo_url, char *title);
-int m3u_write(struct m3u_file *m3ufile);
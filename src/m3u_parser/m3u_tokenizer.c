@@ -0,0 +1,399 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <psp2/kernel/clib.h>
+
+#include "m3u_tokenizer.h"
+
+#define printf sceClibPrintf
+
+static int m3u_reserve(char **buffer, size_t *capacity, size_t size)
+{
+    if (size <= *capacity) {
+        return 0;
+    }
+
+    size_t new_capacity = *capacity ? *capacity * 2 : 256;
+    while (new_capacity < size) {
+        new_capacity *= 2;
+    }
+
+    char *new_buffer = realloc(*buffer, new_capacity);
+    if (!new_buffer) {
+        printf("M3U: cannot allocate a line of %i bytes\n", size);
+        return -1;
+    }
+
+    *buffer = new_buffer;
+    *capacity = new_capacity;
+    return 0;
+}
+
+static void m3u_error(struct m3u_tokenizer *tokenizer, const char *message)
+{
+    tokenizer->errors++;
+
+    if (tokenizer->callbacks.error) {
+        tokenizer->callbacks.error(tokenizer->user, tokenizer->line, message);
+    } else {
+        printf("M3U: line %i: %s\n", tokenizer->line, message);
+    }
+}
+
+static void m3u_item_reset(struct m3u_item *item)
+{
+    memset(item, 0, sizeof(struct m3u_item));
+    item->duration = -1;
+}
+
+static int m3u_span_equals(const char *data, size_t length, const char *str)
+{
+    return strlen(str) == length && !memcmp(data, str, length);
+}
+
+static int m3u_starts_with(const char *line, size_t length, const char *prefix, size_t prefix_length)
+{
+    return length >= prefix_length && !memcmp(line, prefix, prefix_length);
+}
+
+/**
+ * Keep an attribute of the #EXTINF line
+ *
+ * @return -1 if the attribute array is full, the known attributes are still kept
+ */
+static int m3u_store_attribute(struct m3u_tokenizer *tokenizer, const char *name, size_t name_length, const char *value, size_t value_length)
+{
+    struct m3u_item *item = &tokenizer->item;
+    struct m3u_span span = { value, value_length };
+
+    if (m3u_span_equals(name, name_length, "tvg-id")) {
+        item->tvg_id = span;
+    } else if (m3u_span_equals(name, name_length, "tvg-name")) {
+        item->tvg_name = span;
+    } else if (m3u_span_equals(name, name_length, "tvg-logo")) {
+        item->tvg_logo = span;
+    } else if (m3u_span_equals(name, name_length, "group-title")) {
+        // An empty group-title does not hide the #EXTGRP before the line
+        if (value_length) {
+            item->group_title = span;
+        }
+    } else if (m3u_span_equals(name, name_length, M3U_ATTRIBUTE_CODEC)) {
+        item->codec = span;
+    } else if (m3u_span_equals(name, name_length, M3U_ATTRIBUTE_BITRATE)) {
+        item->bitrate = span;
+    } else if (m3u_span_equals(name, name_length, M3U_ATTRIBUTE_TAGS)) {
+        item->tags = span;
+    }
+
+    if (item->attribute_count == M3U_MAX_ATTRIBUTES) {
+        return -1;
+    }
+
+    struct m3u_attribute *attribute = &item->attributes[item->attribute_count++];
+    attribute->name.data = name;
+    attribute->name.length = name_length;
+    attribute->value = span;
+    return 0;
+}
+
+/**
+ * Parse `<duration> key="value" key=value ...,title`, the part after "#EXTINF:"
+ */
+static int m3u_parse_extinf(struct m3u_tokenizer *tokenizer, const char *line, size_t length)
+{
+    if (tokenizer->has_info) {
+        m3u_error(tokenizer, "#EXTINF without URL before it");
+    }
+
+    // The fields must outlive the line, which can be in the chunk or the carry buffer
+    if (m3u_reserve(&tokenizer->info, &tokenizer->info_capacity, length + 1)) {
+        return -1;
+    }
+    memcpy(tokenizer->info, line, length);
+
+    struct m3u_item *item = &tokenizer->item;
+    struct m3u_span group = item->group_title; // from a #EXTGRP before this line
+    m3u_item_reset(item);
+    item->group_title = group;
+    tokenizer->has_info = 1;
+
+    const char *p = tokenizer->info;
+    const char *end = p + length;
+    int dropped = 0; // attributes beyond M3U_MAX_ATTRIBUTES
+
+    int sign = 1;
+    if (p < end && *p == '-') {
+        sign = -1;
+        p++;
+    }
+
+    const char *digits = p;
+    int duration = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        duration = duration * 10 + (*p - '0');
+        p++;
+    }
+
+    if (p == digits) {
+        m3u_error(tokenizer, "#EXTINF without duration");
+    } else {
+        item->duration = sign * duration;
+    }
+
+    // Some playlists give a decimal duration
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+
+    while (1) {
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+
+        if (p >= end) {
+            m3u_error(tokenizer, "#EXTINF without comma before the title");
+            break;
+        }
+
+        if (*p == ',') {
+            p++;
+            while (p < end && (*p == ' ' || *p == '\t')) {
+                p++;
+            }
+            item->title.data = p;
+            item->title.length = end - p;
+            break;
+        }
+
+        const char *name = p;
+        while (p < end && *p != '=' && *p != ' ' && *p != '\t' && *p != ',') {
+            p++;
+        }
+        size_t name_length = p - name;
+
+        if (p >= end || *p != '=') {
+            m3u_error(tokenizer, "attribute without value");
+            if (name_length == 0) {
+                // Stray character, avoid looping on it
+                p++;
+            }
+            continue;
+        }
+        p++;
+
+        const char *value = p;
+        size_t value_length = 0;
+        if (p < end && *p == '"') {
+            // Quoted values can contain spaces and commas
+            value = ++p;
+            const char *quote = memchr(p, '"', end - p);
+            if (!quote) {
+                m3u_error(tokenizer, "attribute value without closing quote");
+                quote = end;
+            }
+            value_length = quote - value;
+            p = quote < end ? quote + 1 : end;
+        } else {
+            while (p < end && *p != ' ' && *p != '\t' && *p != ',') {
+                p++;
+            }
+            value_length = p - value;
+        }
+
+        if (m3u_store_attribute(tokenizer, name, name_length, value, value_length)) {
+            dropped++;
+        }
+    }
+
+    if (dropped) {
+        m3u_error(tokenizer, "too many attributes, ignoring the last ones");
+    }
+
+    return 0;
+}
+
+static int m3u_process_line(struct m3u_tokenizer *tokenizer, const char *line, size_t length)
+{
+    tokenizer->line++;
+
+    if (tokenizer->line == 1 && m3u_starts_with(line, length, "\xEF\xBB\xBF", 3)) {
+        // UTF-8 byte order mark
+        line += 3;
+        length -= 3;
+    }
+
+    while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == ' ' || line[length - 1] == '\t')) {
+        length--;
+    }
+    while (length > 0 && (*line == ' ' || *line == '\t')) {
+        line++;
+        length--;
+    }
+
+    if (length == 0) {
+        return 0;
+    }
+
+    if (line[0] == '#') {
+        if (m3u_starts_with(line, length, "#EXTINF:", 8)) {
+            return m3u_parse_extinf(tokenizer, line + 8, length - 8);
+        }
+
+        if (m3u_starts_with(line, length, "#PLAYLIST:", 10)) {
+            if (tokenizer->callbacks.playlist_name) {
+                struct m3u_span name = { line + 10, length - 10 };
+                tokenizer->callbacks.playlist_name(tokenizer->user, name);
+            }
+        } else if (m3u_starts_with(line, length, "#EXTGRP:", 8)) {
+            if (tokenizer->item.group_title.length) {
+                // group-title of #EXTINF wins
+                return 0;
+            }
+
+            if (m3u_reserve(&tokenizer->group, &tokenizer->group_capacity, length - 8 + 1)) {
+                return -1;
+            }
+            memcpy(tokenizer->group, line + 8, length - 8);
+            tokenizer->item.group_title.data = tokenizer->group;
+            tokenizer->item.group_title.length = length - 8;
+        } else if (tokenizer->callbacks.directive) {
+            struct m3u_span directive = { line, length };
+            tokenizer->callbacks.directive(tokenizer->user, directive);
+        }
+
+        return 0;
+    }
+
+    tokenizer->item.url.data = line;
+    tokenizer->item.url.length = length;
+    tokenizer->item.line = tokenizer->line;
+    tokenizer->callbacks.item(tokenizer->user, &tokenizer->item);
+
+    m3u_item_reset(&tokenizer->item);
+    tokenizer->has_info = 0;
+
+    return 0;
+}
+
+static int m3u_carry_append(struct m3u_tokenizer *tokenizer, const char *data, size_t size)
+{
+    if (m3u_reserve(&tokenizer->carry, &tokenizer->carry_capacity, tokenizer->carry_length + size)) {
+        return -1;
+    }
+
+    memcpy(tokenizer->carry + tokenizer->carry_length, data, size);
+    tokenizer->carry_length += size;
+    return 0;
+}
+
+void m3u_tokenizer_init(struct m3u_tokenizer *tokenizer, const struct m3u_tokenizer_callbacks *callbacks, void *user)
+{
+    memset(tokenizer, 0, sizeof(struct m3u_tokenizer));
+    tokenizer->callbacks = *callbacks;
+    tokenizer->user = user;
+    m3u_item_reset(&tokenizer->item);
+}
+
+/**
+ * Parse the next part of the playlist, items are given to the callback as soon as their URL line ends
+ *
+ * @return 0 on success, -1 on allocation error. Malformed lines are reported and skipped.
+ */
+int m3u_tokenizer_feed(struct m3u_tokenizer *tokenizer, const char *data, size_t size)
+{
+    const char *p = data;
+    const char *end = data + size;
+    tokenizer->bytes += size;
+
+    if (tokenizer->carry_length > 0) {
+        // Complete the line started in the previous chunk
+        const char *newline = memchr(p, '\n', size);
+        if (!newline) {
+            return m3u_carry_append(tokenizer, p, size);
+        }
+
+        if (m3u_carry_append(tokenizer, p, newline - p)
+            || m3u_process_line(tokenizer, tokenizer->carry, tokenizer->carry_length)) {
+            return -1;
+        }
+
+        tokenizer->carry_length = 0;
+        p = newline + 1;
+    }
+
+    while (p < end) {
+        const char *newline = memchr(p, '\n', end - p);
+        if (!newline) {
+            return m3u_carry_append(tokenizer, p, end - p);
+        }
+
+        if (m3u_process_line(tokenizer, p, newline - p)) {
+            return -1;
+        }
+
+        p = newline + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Parse the last line if the input does not end with a newline
+ */
+int m3u_tokenizer_finish(struct m3u_tokenizer *tokenizer)
+{
+    if (tokenizer->carry_length > 0) {
+        if (m3u_process_line(tokenizer, tokenizer->carry, tokenizer->carry_length)) {
+            return -1;
+        }
+        tokenizer->carry_length = 0;
+    }
+
+    if (tokenizer->has_info) {
+        m3u_error(tokenizer, "#EXTINF without URL at the end of the playlist");
+        tokenizer->has_info = 0;
+    }
+
+    return 0;
+}
+
+void m3u_tokenizer_free(struct m3u_tokenizer *tokenizer)
+{
+    free(tokenizer->carry);
+    free(tokenizer->info);
+    free(tokenizer->group);
+    tokenizer->carry = NULL;
+    tokenizer->info = NULL;
+    tokenizer->group = NULL;
+}
+
+/**
+ * Write a code point up to U+10FFFF as UTF-8
+ *
+ * @return the number of bytes written
+ */
+int m3u_encode_utf8(unsigned long code, char *out)
+{
+    if (code < 0x80) {
+        out[0] = code;
+        return 1;
+    } else if (code < 0x800) {
+        out[0] = 0xC0 | (code >> 6);
+        out[1] = 0x80 | (code & 0x3F);
+        return 2;
+    } else if (code < 0x10000) {
+        out[0] = 0xE0 | (code >> 12);
+        out[1] = 0x80 | ((code >> 6) & 0x3F);
+        out[2] = 0x80 | (code & 0x3F);
+        return 3;
+    }
+
+    out[0] = 0xF0 | (code >> 18);
+    out[1] = 0x80 | ((code >> 12) & 0x3F);
+    out[2] = 0x80 | ((code >> 6) & 0x3F);
+    out[3] = 0x80 | (code & 0x3F);
+    return 4;
+}
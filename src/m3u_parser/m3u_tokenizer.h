@@ -0,0 +1,85 @@
+#ifndef __M3U_TOKENIZER_H__
+#define __M3U_TOKENIZER_H__
+
+#include <stddef.h>
+
+#define M3U_MAX_ATTRIBUTES 16
+
+// Format hints kept from imported playlists, written back as #EXTINF attributes
+#define M3U_ATTRIBUTE_CODEC "radio-codec"
+#define M3U_ATTRIBUTE_BITRATE "radio-bitrate"
+#define M3U_ATTRIBUTE_TAGS "radio-tags"
+
+/**
+ * Part of the input, not NUL terminated, only valid during the callback
+ */
+struct m3u_span {
+    const char *data;
+    size_t length;
+};
+
+struct m3u_attribute {
+    struct m3u_span name;
+    struct m3u_span value;
+};
+
+/**
+ * One playlist entry: a URL line with the #EXTINF line before it
+ */
+struct m3u_item {
+    struct m3u_span url;
+    struct m3u_span title; // after the comma of #EXTINF
+    int duration; // -1 for live streams
+    struct m3u_span tvg_id;
+    struct m3u_span tvg_name;
+    struct m3u_span tvg_logo;
+    struct m3u_span group_title; // group-title attribute, or #EXTGRP
+    struct m3u_span codec; // "MP3", "AAC+"...
+    struct m3u_span bitrate; // kbps, in decimal
+    struct m3u_span tags; // comma separated
+    struct m3u_attribute attributes[M3U_MAX_ATTRIBUTES]; // every attribute, known ones included
+    int attribute_count;
+    int line; // line number of the URL
+};
+
+struct m3u_tokenizer_callbacks {
+    void (*item)(void *user, const struct m3u_item *item);
+    void (*playlist_name)(void *user, struct m3u_span name); // optional
+    void (*error)(void *user, int line, const char *message); // optional, printed if NULL
+    void (*directive)(void *user, struct m3u_span line); // optional, other lines starting with #
+};
+
+/**
+ * Incremental M3U parser, the input can be split anywhere and lines have no length limit
+ *
+ * Lines are parsed in place, they are only copied when they cross two chunks.
+ */
+struct m3u_tokenizer {
+    struct m3u_tokenizer_callbacks callbacks;
+    void *user;
+
+    char *carry; // start of a line cut by the end of a chunk
+    size_t carry_length;
+    size_t carry_capacity;
+
+    char *info; // copy of the pending #EXTINF line, fields of item point into it
+    size_t info_capacity;
+    int has_info;
+    char *group; // copy of the pending #EXTGRP value
+    size_t group_capacity;
+    struct m3u_item item;
+
+    int line;
+    int errors; // malformed lines
+    size_t bytes; // fed so far
+};
+
+void m3u_tokenizer_init(struct m3u_tokenizer *tokenizer, const struct m3u_tokenizer_callbacks *callbacks, void *user);
+int m3u_tokenizer_feed(struct m3u_tokenizer *tokenizer, const char *data, size_t size);
+int m3u_tokenizer_finish(struct m3u_tokenizer *tokenizer);
+void m3u_tokenizer_free(struct m3u_tokenizer *tokenizer);
+
+// Shared by the tokenizers of formats with character escapes, out needs 4 bytes
+int m3u_encode_utf8(unsigned long code, char *out);
+
+#endif
@@ -29,14 +29,31 @@
 #include <psp2/sysmodule.h>
 
 #include "gui/gui.hpp"
+#include "gui/station_list.hpp"
+#include "logo/logo_cache.hpp"
+#include "metrics/metrics.hpp"
+#include "network/prober.hpp"
+#include "network/resolver.hpp"
+#include "playlist/playlist.hpp"
+#include "playlist/playlist_cache.hpp"
+#include "playlist/playlist_import.hpp"
+#include "playlist/playlist_journal.hpp"
+#include "playlist/playlist_search.hpp"
+#include "recorder/recorder.hpp"
+#include "scheduler/scheduler.hpp"
+#include "timeshift/timeshift.hpp"
+#include "trace/trace.hpp"
 #include "utils.hpp"
+#include "visualizer/analyser.hpp"
+#include "visualizer/geometry.hpp"
 #include "visualizer/neon_fft.hpp"
+#include "visualizer/smoother.hpp"
+#include "visualizer/spectrogram.hpp"
 
 extern "C" {
 	#include "audio/audio.h"
 	#include "audio/mp3.h"
 	#include "audio/aac.h"
-	#include "m3u_parser/m3u.h"
 
 	int _newlib_heap_size_user = 54 * 1024 * 1024;
 }
@@ -53,9 +70,17 @@ enum player_view {
 	PLAYER_VIEW_SETTINGS,
 	PLAYER_VIEW_VISUALIZER_BARS,
 	PLAYER_VIEW_VISUALIZER_CIRCLES,
+	PLAYER_VIEW_VISUALIZER_MIRRORED,
+	PLAYER_VIEW_VISUALIZER_SPECTROGRAM,
 	PLAYER_VIEW_BLACKSCREEN,
 };
 
+static inline bool is_visualizer_view(player_view view)
+{
+	return view == PLAYER_VIEW_VISUALIZER_BARS || view == PLAYER_VIEW_VISUALIZER_CIRCLES || view == PLAYER_VIEW_VISUALIZER_MIRRORED
+		|| view == PLAYER_VIEW_VISUALIZER_SPECTROGRAM;
+}
+
 enum player_state {
 	PLAYER_STATE_WAITING,
 	PLAYER_STATE_NEW,
@@ -76,6 +101,7 @@ struct player {
 	bool new_song_title;
 
 	audio_format audio_type;
+	audio_format codec_hint; // from the playlist, used when the server does not say
 	int samplerate;
 	int nb_channels;
 	int nb_samples;
@@ -85,8 +111,18 @@ struct player {
 	int icy_count;
 	int icy_part_length;
 
-	neon_fft_config *visualizer_config;
-	bool visualizer_rebuild;
+	bool visualizer_rebuild; // FFT settings changed
+	int bar_count;
+	int fft_size;
+	int hop_size;
+	const fft_backend *backend; // FFT implementation
+	bool mid_side; // mirrored view shows mid/side instead of left/right
+	float db_floor; // empty band
+	float db_ceiling; // full band
+	bool peaks; // peak markers over the bars
+	int visualizer_fps; // frame rate cap of the visualizers
+
+	bool timeshift; // keep the stream on disk to pause and rewind
 };
 
 static struct player player;
@@ -100,12 +136,17 @@ static volatile int read_pos = 0;
 #define ICY_METADATA_MAX 512
 
 static char icy_metadata[ICY_METADATA_MAX];
+static size_t icy_metadata_position; // recorder stream position of the block, for the split
 static volatile int icy_metadata_ready = 0;
 
+// Connection being established by network_thread
+static const char *connecting_url = NULL;
+static bool stream_connected = false;
+static struct resolver_probe resolver_probe;
+
 // Mutex
 static int audio_mutex;
 static int icy_meta_mutex;
-static int visualizer_mutex;
 
 
 int progress_callback(void *clientp,
@@ -114,6 +155,11 @@ int progress_callback(void *clientp,
                       curl_off_t ultotal,
                       curl_off_t ulnow)
 {
+	if (!stream_connected) {
+		// Still following redirects or fetching a playlist wrapper
+		return (player.state == PLAYER_STATE_NEW && player.url == connecting_url) ? 0 : 1;
+	}
+
     if (player.state != PLAYER_STATE_PLAYING) {
 		// stop curl
         return 1;
@@ -122,28 +168,76 @@ int progress_callback(void *clientp,
     return 0;
 }
 
+/**
+ * Add bytes to stream_buffer, audio_mutex must be locked
+ *
+ * @return the number of bytes added, less than size if the buffer is full
+ */
+static size_t stream_buffer_push(const unsigned char *data, size_t size)
+{
+	size_t free_size = (read_pos - write_pos - 1 + STREAM_BUFFER_SIZE) % STREAM_BUFFER_SIZE;
+	if (size > free_size) {
+		size = free_size;
+	}
+
+	size_t first = STREAM_BUFFER_SIZE - write_pos;
+	if (first > size) {
+		first = size;
+	}
+
+	memcpy(&stream_buffer[write_pos], data, first);
+	memcpy(stream_buffer, data + first, size - first);
+	write_pos = (write_pos + size) % STREAM_BUFFER_SIZE;
+
+	return size;
+}
+
+static size_t stream_buffer_used()
+{
+	return (write_pos - read_pos + STREAM_BUFFER_SIZE) % STREAM_BUFFER_SIZE;
+}
+
+/**
+ * Timeshift sink: stream read back from disk, only a little ahead of the decoder
+ */
+static size_t timeshift_feed(const unsigned char *data, size_t size)
+{
+	size_t accepted = 0;
+
+	TRACE_LOCK(audio_mutex, "audio_mutex");
+
+	size_t buffered = stream_buffer_used();
+	if (buffered < TIMESHIFT_FEED_AHEAD) {
+		accepted = stream_buffer_push(data, size < TIMESHIFT_FEED_AHEAD - buffered ? size : TIMESHIFT_FEED_AHEAD - buffered);
+	}
+
+	sceKernelUnlockMutex(audio_mutex, 1);
+
+	return accepted;
+}
+
 size_t stream_callback(void *ptr, size_t size, size_t nmemb, void *userdata)
 {
 	size_t bytes = size * nmemb;
     unsigned char *data = (unsigned char *)ptr;
 	size_t i = 0;
 
-	if (!player.icy_metadata_enabled) {
-		sceKernelLockMutex(audio_mutex, 1, NULL);
+	TRACE_SCOPE("network callback");
+	metrics_add_network(bytes);
 
-		while (i < bytes) {
-
-			int next = (write_pos + 1) % STREAM_BUFFER_SIZE;
+	if (resolver_probe.type != RESOLVER_PLAYLIST_NONE) {
+		// Playlist wrapper, keep it for the resolver
+		return resolver_probe_append(&resolver_probe, ptr, bytes);
+	}
 
-			// Full buffer
-			if (next == read_pos) {
-				break;
-			}
+	if (!player.icy_metadata_enabled) {
+		recorder_tee(data, bytes);
+		timeshift_tee(data, bytes);
 
-			stream_buffer[write_pos] = data[i];
-			write_pos = next;
+		TRACE_LOCK(audio_mutex, "audio_mutex");
 
-			i++;
+		if (timeshift_is_live()) {
+			stream_buffer_push(data, bytes);
 		}
 
 		sceKernelUnlockMutex(audio_mutex, 1);
@@ -152,32 +246,37 @@ size_t stream_callback(void *ptr, size_t size, size_t nmemb, void *userdata)
 		while (i < bytes) {
 			// Audio
 			if (player.icy_metaint > 0 && player.icy_count > 0) {
-				sceKernelLockMutex(audio_mutex, 1, NULL);
+				size_t audio_size = bytes - i;
+				if (audio_size > (size_t)player.icy_count) {
+					audio_size = player.icy_count;
+				}
 
-				while (i < bytes && player.icy_count > 0) {
-					int next = (write_pos + 1) % STREAM_BUFFER_SIZE;
-					if (next != read_pos) {
-						stream_buffer[write_pos] = data[i];
-						write_pos = next;
-					}
+				recorder_tee(&data[i], audio_size);
+				timeshift_tee(&data[i], audio_size);
+
+				TRACE_LOCK(audio_mutex, "audio_mutex");
 
-					player.icy_count--;
-					i++;
+				if (timeshift_is_live()) {
+					stream_buffer_push(&data[i], audio_size);
 				}
 	
 				sceKernelUnlockMutex(audio_mutex, 1);
+
+				player.icy_count -= audio_size;
+				i += audio_size;
 			}
 	
 			// Metadata
 			if (i < bytes && player.icy_count == 0 && player.icy_metaint > 0) {
 				int meta_len = int(data[i]) * 16;
 				i++;
-	
+
 				if (meta_len > 0 && meta_len < ICY_METADATA_MAX) {
-					sceKernelLockMutex(icy_meta_mutex, 1, NULL);
+					TRACE_LOCK(icy_meta_mutex, "icy_meta_mutex");
 	
 					memcpy(icy_metadata, &data[i], meta_len);
 					icy_metadata[meta_len] = 0;
+					icy_metadata_position = recorder_position();
 					icy_metadata_ready = 1;
 	
 					sceKernelUnlockMutex(icy_meta_mutex, 1);
@@ -196,6 +295,16 @@ size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata)
 {
     size_t len = size * nitems;
 
+	if (!strncasecmp(buffer, "HTTP/", 5) || !strncasecmp(buffer, "ICY ", 4)) {
+		// Status line of a new response (the first one or after a redirect)
+		const char *code = (const char*)memchr(buffer, ' ', len);
+		resolver_probe_reset(&resolver_probe);
+		resolver_probe.status_code = code ? atoi(code + 1) : 0;
+
+		player.audio_type = AUDIO_FORMAT_UNKNOWN;
+		player.icy_metadata_enabled = false;
+	}
+
     if (!strncasecmp(buffer, "icy-metaint:", 12)) {
         int metaint = atoi(buffer + 12);
         printf("ICY metaint = %d\n", metaint);
@@ -208,12 +317,19 @@ size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata)
     if (!strncasecmp(buffer, "content-type:", 13)) {
         printf("%.*s", (int)len, buffer);
 
-		if (strstr(buffer, "audio/mpeg")) {
+		snprintf(resolver_probe.content_type, sizeof(resolver_probe.content_type), "%.*s", (int)len - 13, buffer + 13);
+
+		if (resolver_detect_playlist(resolver_probe.content_type, NULL) != RESOLVER_PLAYLIST_NONE) {
+			printf("Playlist wrapper detected\n");
+		} else if (strstr(buffer, "audio/mpeg")) {
 			player.audio_type = AUDIO_FORMAT_MP3;
 		} else if (strstr(buffer, "audio/aac")) {
 			player.audio_type = AUDIO_FORMAT_AAC;
 		} else if (strstr(buffer, "audio/ogg")) {
 			player.audio_type = AUDIO_FORMAT_OGG;
+		} else if (player.codec_hint != AUDIO_FORMAT_UNKNOWN) {
+			printf("Audio type unknown, the playlist says %s\n", AudioFormatToString(player.codec_hint));
+			player.audio_type = player.codec_hint;
 		} else {
 			printf("Audio type unknown, suppose MP3\n");
 			player.audio_type = AUDIO_FORMAT_MP3;
@@ -222,67 +338,163 @@ size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata)
 		printf("Audio type detected: %i\n", player.audio_type);
     }
 
+	if (len <= 2 && (buffer[0] == '\r' || buffer[0] == '\n')) {
+		// End of headers
+		if (resolver_probe.status_code >= 300 && resolver_probe.status_code < 400) {
+			// Redirect, curl follows it
+			return len;
+		}
+
+		char *effective_url = NULL;
+		curl_easy_getinfo((CURL*)userdata, CURLINFO_EFFECTIVE_URL, &effective_url);
+
+		resolver_probe.type = resolver_detect_playlist(resolver_probe.content_type, effective_url);
+		if (resolver_probe.type != RESOLVER_PLAYLIST_NONE) {
+			player.audio_type = AUDIO_FORMAT_UNKNOWN;
+			return len;
+		}
+
+		if (player.audio_type == AUDIO_FORMAT_UNKNOWN && player.codec_hint != AUDIO_FORMAT_UNKNOWN) {
+			// No content type at all, trust the playlist
+			player.audio_type = player.codec_hint;
+		}
+
+		if (player.state == PLAYER_STATE_NEW && player.url == connecting_url) {
+			// We reached the media endpoint, next connections can start there
+			if (effective_url && strcmp(effective_url, connecting_url)) {
+				resolver_store(connecting_url, effective_url);
+			}
+
+			stream_connected = true;
+			player.state = PLAYER_STATE_PLAYING;
+
+			if (player.timeshift) {
+				timeshift_start(player.audio_type == AUDIO_FORMAT_AAC);
+			}
+		}
+	}
+
     return len;
 }
 
 int network_thread(unsigned int args, void *argp)
 {
+	char stream_url[RESOLVER_URL_MAX];
+	char base_url[RESOLVER_URL_MAX];
+
+	TRACE_THREAD("httpThread");
+
 	while (player.state != PLAYER_STATE_STOPPING) {
 		// Wait for a new station
 		while (player.state != PLAYER_STATE_NEW) {
 			sceKernelDelayThread(100000);
 		}
-		
-		// Init buffer
-		sceKernelLockMutex(audio_mutex, 1, NULL);
-		read_pos = 0;
-		write_pos = 0;
-		sceKernelUnlockMutex(audio_mutex, 1);
 
-		player.audio_type = AUDIO_FORMAT_UNKNOWN;
-		player.song_title = nullptr;
-		player.icy_metadata_enabled = false;
+		connecting_url = player.url;
 
-		printf("CURL: %s\n", player.url);
+		// Repeat connects start directly at the media endpoint
+		bool cached = resolver_lookup(connecting_url, stream_url, sizeof(stream_url));
+		if (cached) {
+			printf("Resolver: using cached %s\n", stream_url);
+		} else {
+			snprintf(stream_url, sizeof(stream_url), "%s", connecting_url);
+		}
 
-		CURL *curl = curl_easy_init();
-	
-		curl_easy_setopt(curl, CURLOPT_URL, player.url);
+		int depth = 0;
+		while (true) {
+			// Init buffer
+			TRACE_LOCK(audio_mutex, "audio_mutex");
+			read_pos = 0;
+			write_pos = 0;
+			sceKernelUnlockMutex(audio_mutex, 1);
+
+			player.audio_type = AUDIO_FORMAT_UNKNOWN;
+			player.song_title = nullptr;
+			player.icy_metadata_enabled = false;
+			stream_connected = false;
+			resolver_probe_reset(&resolver_probe);
+
+			printf("CURL: %s\n", stream_url);
+
+			CURL *curl = curl_easy_init();
 	
-		// Headers
-		struct curl_slist *headers = NULL;
-		headers = curl_slist_append(headers, "User-Agent: VitaWebradios/2.0");
-		headers = curl_slist_append(headers, "Icy-MetaData: 1");
-		headers = curl_slist_append(headers, "Accept: */*");
-		headers = curl_slist_append(headers, "Connection: keep-alive");
-		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+			curl_easy_setopt(curl, CURLOPT_URL, stream_url);
+			curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+			curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 8L);
+			curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
 	
-		// Headers callback
-		curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
-		curl_easy_setopt(curl, CURLOPT_HEADERDATA, NULL);
+			// Headers
+			struct curl_slist *headers = NULL;
+			headers = curl_slist_append(headers, "User-Agent: VitaWebradios/2.0");
+			headers = curl_slist_append(headers, "Icy-MetaData: 1");
+			headers = curl_slist_append(headers, "Accept: */*");
+			headers = curl_slist_append(headers, "Connection: keep-alive");
+			curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 	
-		// Stream callback
-		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, stream_callback);
-		curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 16 * 1024);
-		curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+			// Headers callback
+			curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+			curl_easy_setopt(curl, CURLOPT_HEADERDATA, curl);
 	
-		// Progress callback
-		curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_callback);
-		curl_easy_setopt(curl, CURLOPT_XFERINFODATA, NULL);
-		curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+			// Stream callback
+			curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, stream_callback);
+			curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 16 * 1024);
+			curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
 	
-		// HTTPS (disable checks)
-		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+			// Progress callback
+			curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_callback);
+			curl_easy_setopt(curl, CURLOPT_XFERINFODATA, NULL);
+			curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
 	
-		player.state = PLAYER_STATE_PLAYING;
+			// HTTPS (disable checks)
+			curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+			curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
 	
-		curl_easy_perform(curl);	// Blocking
+			CURLcode res = curl_easy_perform(curl);	// Blocking
 	
-		printf("CURL: ending stream\n");
+			printf("CURL: ending stream\n");
+
+			char *effective_url = NULL;
+			curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective_url);
+			snprintf(base_url, sizeof(base_url), "%s", effective_url ? effective_url : stream_url);
 
-		curl_slist_free_all(headers);
-		curl_easy_cleanup(curl);
+			curl_slist_free_all(headers);
+			curl_easy_cleanup(curl);
+
+			if (stream_connected) {
+				// A recording or a timeshift only covers one connection
+				recorder_stop();
+				timeshift_stop();
+			}
+
+			if (stream_connected || player.state != PLAYER_STATE_NEW || player.url != connecting_url) {
+				// Stream ended, stopped or replaced by another station
+				break;
+			}
+
+			if (resolver_probe.type != RESOLVER_PLAYLIST_NONE && depth < RESOLVER_MAX_DEPTH) {
+				// Follow the playlist wrapper
+				if (!resolver_probe_next_url(&resolver_probe, base_url, stream_url, sizeof(stream_url))) {
+					depth++;
+					continue;
+				}
+			}
+
+			if (cached) {
+				// The cached endpoint is gone, resolve again from the station URL
+				printf("Resolver: cached URL failed, resolving %s again\n", connecting_url);
+				resolver_forget(connecting_url);
+				snprintf(stream_url, sizeof(stream_url), "%s", connecting_url);
+				cached = false;
+				depth = 0;
+				continue;
+			}
+
+			printf("CURL: cannot play %s (%s)\n", connecting_url, curl_easy_strerror(res));
+			player.state = PLAYER_STATE_WAITING;
+			break;
+		}
+
+		resolver_probe_free(&resolver_probe);
 	}
 
     return 0;
@@ -291,6 +503,24 @@ int network_thread(unsigned int args, void *argp)
 #define AUDIO_CHUNK 4096
 #define BUFFER_LENGTH 8192
 
+/**
+ * Predict when the block just given to the output port is heard, in process time
+ *
+ * Called right after AudioOutOutput: the block ends once everything queued in the port has been played.
+ *
+ * @param grain is the number of samples per channel of each output block
+ */
+static SceUInt64 playout_time(int samplerate, int grain)
+{
+	int rest = AudioGetRestSamples();
+	if (rest < 0) {
+		// The port is double buffered: the previous block is playing, this one is next
+		rest = 2 * grain;
+	}
+
+	return sceKernelGetProcessTimeWide() + (SceUInt64)rest * 1000000 / (samplerate > 0 ? samplerate : 44100);
+}
+
 int audio_thread(unsigned int args, void *argp)
 {
     unsigned char audio_chunk[AUDIO_CHUNK] = {0};
@@ -304,6 +534,8 @@ int audio_thread(unsigned int args, void *argp)
 	bool aac_initialized_step2 = false;
 	const char *current_url = NULL;
 
+	TRACE_THREAD("audioThread");
+
 	// Main audio loop
     while (player.state != PLAYER_STATE_STOPPING) {
 
@@ -326,13 +558,21 @@ int audio_thread(unsigned int args, void *argp)
 				return 1;
 			}
 
+			bool starving = true;
+
 			while (player.state == PLAYER_STATE_PLAYING) {
 				int count = 0;
 
-				sceKernelLockMutex(audio_mutex, 1, NULL);
+				if (timeshift_is_paused()) {
+					sceKernelDelayThread(10000);
+					continue;
+				}
+
+				TRACE_LOCK(audio_mutex, "audio_mutex");
 
 				if (current_url != player.url) {
 					// We have a new webradio
+					sceKernelUnlockMutex(audio_mutex, 1);
 					break;
 				}
 
@@ -346,9 +586,23 @@ int audio_thread(unsigned int args, void *argp)
 					}
 				}
 
+				metrics_add_consumed(count, stream_buffer_used());
+
 				sceKernelUnlockMutex(audio_mutex, 1);
 
+				unsigned int decode_start = metrics_now();
+				TRACE_BEGIN("mp3 decode");
 				ret = MP3_Decode(NULL, 0, outbuffer, BUFFER_LENGTH, &outsize);
+				TRACE_END("mp3 decode");
+
+				if (outsize > 0) {
+					metrics_add_timing(METRICS_TIMING_DECODE, metrics_now() - decode_start);
+					starving = false;
+				} else if (count == 0 && !starving) {
+					// Nothing left to decode, the output will run dry
+					starving = true;
+					metrics_add_underrun();
+				}
 	
 				if (ret == -11) {
 					printf("MP3 init ---\n");
@@ -368,12 +622,10 @@ int audio_thread(unsigned int args, void *argp)
 						continue;
 					}
 	
-					sceKernelLockMutex(visualizer_mutex, 1, NULL);
 					player.samplerate = samplerate;
 					player.nb_channels = channels;
 					player.nb_samples = nsamples;
-					player.visualizer_rebuild = true;
-					sceKernelUnlockMutex(visualizer_mutex, 1);
+					analyser_set_format(samplerate, channels);
 	
 					AudioInitOutput(samplerate, channels, nsamples);
 					printf("Playing %s %s sample_rate %i channels %i\n", player.title, player.url, samplerate, channels);
@@ -381,11 +633,11 @@ int audio_thread(unsigned int args, void *argp)
 
 				if (outsize > 0 && ret != -11) {
 					// Only play music if there is some music data
-					sceKernelLockMutex(visualizer_mutex, 1, NULL);
-					neon_fft_fill_buffer(player.visualizer_config, (int16_t*)outbuffer, outsize / (2 * channels));
-					sceKernelUnlockMutex(visualizer_mutex, 1);
-	
+					TRACE_BEGIN("audio output");
 					AudioOutOutput(outbuffer);
+					TRACE_END("audio output");
+
+					analyser_push((int16_t*)outbuffer, outsize / (2 * channels), playout_time(samplerate, player.nb_samples));
 				}
 
 				sceKernelDelayThread(1000);
@@ -404,6 +656,7 @@ int audio_thread(unsigned int args, void *argp)
 			printf("New AAC detected\n");
 			aac_initialized = false;
 			aac_initialized_step2 = false;
+			bool starving = true;
 
 			while (player.state == PLAYER_STATE_PLAYING) {
 				int count = 0;
@@ -413,7 +666,12 @@ int audio_thread(unsigned int args, void *argp)
 					break;
 				}
 
-				sceKernelLockMutex(audio_mutex, 1, NULL);
+				if (timeshift_is_paused()) {
+					sceKernelDelayThread(10000);
+					continue;
+				}
+
+				TRACE_LOCK(audio_mutex, "audio_mutex");
 
 				while (read_pos != write_pos && count < AUDIO_CHUNK && player.state == PLAYER_STATE_PLAYING) {
 					// Read one byte from stream to the chunk
@@ -440,6 +698,8 @@ int audio_thread(unsigned int args, void *argp)
 						continue;
 					}
 
+					metrics_add_consumed(count, stream_buffer_used());
+
 					sceKernelUnlockMutex(audio_mutex, 1);
 
 					if (!aac_initialized) {
@@ -452,16 +712,21 @@ int audio_thread(unsigned int args, void *argp)
 					// We have a complete frame and FAAD2 is initialized, let's decode and play
 					NeAACDecFrameInfo aac_frame_info;
 					void *output_buffer = NULL;
-					if (aac_initialized && !AAC_Decode(audio_chunk, count, &aac_frame_info, &output_buffer) && aac_frame_info.samples > 0) {
+					unsigned int decode_start = metrics_now();
+					TRACE_BEGIN("aac decode");
+					int decode_ret = aac_initialized ? AAC_Decode(audio_chunk, count, &aac_frame_info, &output_buffer) : -1;
+					TRACE_END("aac decode");
+					if (!decode_ret && aac_frame_info.samples > 0) {
+						metrics_add_timing(METRICS_TIMING_DECODE, metrics_now() - decode_start);
+						starving = false;
+
 						if (!aac_initialized_step2 || aac_frame_info.samplerate != player.samplerate || aac_frame_info.channels != player.nb_channels) {
 							samplerate = aac_frame_info.samplerate;
 							player.samplerate = aac_frame_info.samplerate;
 							player.nb_channels = aac_frame_info.channels;
 							player.nb_samples = 1024; // AAC works with 1024 samples per channel
 
-							sceKernelLockMutex(visualizer_mutex, 1, NULL);
-							player.visualizer_rebuild = true;
-							sceKernelUnlockMutex(visualizer_mutex, 1);
+							analyser_set_format(aac_frame_info.samplerate, aac_frame_info.channels);
 
 							aac_initialized_step2 = true;
 
@@ -472,19 +737,32 @@ int audio_thread(unsigned int args, void *argp)
 						}
 
 						if (aac_initialized_step2) {
-							sceKernelLockMutex(visualizer_mutex, 1, NULL);
-							neon_fft_fill_buffer(player.visualizer_config, (int16_t*)output_buffer, 1024);
-							sceKernelUnlockMutex(visualizer_mutex, 1);
+							TRACE_BEGIN("audio output");
 							AudioOutOutput(output_buffer);
+							TRACE_END("audio output");
+
+							analyser_push((int16_t*)output_buffer, 1024, playout_time(samplerate, 1024));
 						}
 					}
 
-					sceKernelLockMutex(audio_mutex, 1, NULL);
+					TRACE_LOCK(audio_mutex, "audio_mutex");
 
 					count = 0;
 				}
 
+				bool empty = read_pos == write_pos;
+
 				sceKernelUnlockMutex(audio_mutex, 1);
+
+				if (empty && aac_initialized_step2) {
+					if (!starving) {
+						// Nothing left to decode, the output will run dry
+						starving = true;
+						metrics_add_underrun();
+					}
+
+					sceKernelDelayThread(1000);
+				}
 			}
 
 			AAC_Free();
@@ -501,12 +779,126 @@ audio_thread_end:
 	return 0;
 }
 
+static_assert(sizeof(geometry_vertex) == sizeof(ImDrawVert) && sizeof(ImDrawIdx) == sizeof(uint16_t), "geometry must match ImGui buffers");
+
+/**
+ * Reserve space in the window draw list, the geometry builder writes into it directly
+ */
+static geometry_target geometry_reserve(ImDrawList *draw_list, int vertices, int indices)
+{
+	draw_list->PrimReserve(indices, vertices);
+
+	ImVec2 white_pixel = ImGui::GetFontTexUvWhitePixel();
+	geometry_target target;
+	target.vertices = (geometry_vertex*)draw_list->_VtxWritePtr;
+	target.indices = draw_list->_IdxWritePtr;
+	target.base_index = draw_list->_VtxCurrentIdx;
+	target.u = white_pixel.x;
+	target.v = white_pixel.y;
+
+	draw_list->_VtxWritePtr += vertices;
+	draw_list->_IdxWritePtr += indices;
+	draw_list->_VtxCurrentIdx += vertices;
+
+	return target;
+}
+
+static void play_station(const playlist *list, int index)
+{
+	const playlist_entry *entry = &list->entries[index];
+
+	printf("Playing %s %s\n", entry->title, entry->url);
+	player.url = entry->url;
+	player.title = entry->title;
+	player.codec_hint = (audio_format)entry->codec;
+	player.state = PLAYER_STATE_NEW;
+}
+
+static bool hide_down_stations = false;
+static bool fastest_stations_first = false;
+static int *ranked_stations = NULL;
+
+/**
+ * Show some stations, all of them if indexes is NULL, without the ones found down or fastest first if asked
+ */
+static void set_station_filter(station_list *rows, const playlist *list, const int *indexes, int count)
+{
+	if (!hide_down_stations && !fastest_stations_first) {
+		station_list_set_filter(rows, indexes, count);
+		return;
+	}
+
+	// The list keeps a pointer to the filter, which must outlive this call
+	int *ranked = (int*)realloc(ranked_stations, sizeof(int) * (list->count ? list->count : 1));
+	if (!ranked) {
+		station_list_set_filter(rows, indexes, count);
+		return;
+	}
+	ranked_stations = ranked;
+
+	int ranked_count = prober_rank(list, indexes, count, hide_down_stations, fastest_stations_first, ranked_stations);
+	if (ranked_count < 0) {
+		station_list_set_filter(rows, indexes, count);
+		return;
+	}
+
+	station_list_set_filter(rows, ranked_stations, ranked_count);
+}
+
+/**
+ * Everything drawn without input which can change between two frames
+ */
+static unsigned int ui_signature()
+{
+	return player.state | player.view << 4 | icy_metadata_ready << 8 | player.new_song_title << 9
+		| recorder_is_recording() << 10 | timeshift_is_paused() << 11;
+}
+
+static scheduler_mode ui_scheduler_mode()
+{
+	if (player.view == PLAYER_VIEW_BLACKSCREEN) {
+		return SCHEDULER_MODE_IDLE;
+	}
+
+	if (is_visualizer_view(player.view) && player.state == PLAYER_STATE_PLAYING) {
+		return SCHEDULER_MODE_ANIMATED;
+	}
+
+	return SCHEDULER_MODE_STATIC;
+}
+
+/**
+ * Show where playback is compared to the live stream
+ */
+static void draw_timeshift_status()
+{
+	if (!timeshift_is_active()) {
+		return;
+	}
+
+	if (timeshift_is_paused()) {
+		ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.2f, 1.0f), "[PAUSED -%i:%02i]", timeshift_delay() / 60, timeshift_delay() % 60);
+	} else if (!timeshift_is_live()) {
+		ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.2f, 1.0f), "[-%i:%02i]", timeshift_delay() / 60, timeshift_delay() % 60);
+	} else {
+		ImGui::TextColored(ImVec4(0.2f, 1.0f, 0.2f, 1.0f), "[LIVE]");
+	}
+}
+
 void parse_icy_metadata()
 {
     if (!icy_metadata_ready)
         return;
 
-    char *title = strstr(icy_metadata, "StreamTitle='");
+    // The network thread may overwrite the block, keep it with its position
+    char metadata[ICY_METADATA_MAX];
+    TRACE_LOCK(icy_meta_mutex, "icy_meta_mutex");
+    memcpy(metadata, icy_metadata, sizeof(metadata));
+    size_t position = icy_metadata_position;
+    icy_metadata_ready = 0;
+    sceKernelUnlockMutex(icy_meta_mutex, 1);
+
+    char *title = strstr(metadata, "StreamTitle='");
     if (title) {
         title += strlen("StreamTitle='");
         char *end = strchr(title, '\'');
@@ -522,14 +914,16 @@ void parse_icy_metadata()
 			player.song_title = (char*)malloc(end - title + 1);
 			memcpy(player.song_title, title, title_size);
 			player.new_song_title = true;
+
+			recorder_split(player.song_title, position);
         }
     }
-
-    icy_metadata_ready = 0;
 }
 
 int main(void)
 {
+	TRACE_THREAD("mainThread");
+
 	vglInitExtended(0, 960, 544, 0x1000000, SCE_GXM_MULTISAMPLE_4X);
 
 	// Setup ImGui binding
@@ -549,22 +943,34 @@ int main(void)
 	ImGui_ImplVitaGL_MouseStickUsage(false);
 
 	// Get or write playlist
-	struct m3u_file *m3ufile = NULL;
-	if (m3u_parse("ux0:/data/webradio/playlist.m3u", &m3ufile)) {
-		m3u_file_free(m3ufile);
-		m3ufile = NULL;
-		
-		// Playlist missing, creating default playlist
-		sceIoMkdir("ux0:/data", 0777);
-		sceIoMkdir("ux0:/data/webradio", 0777);
-
-		// Copying playlist to correct location
-		copyfile("ux0:/data/webradio/playlist.m3u", "default_playlist.m3u");
-		if (m3u_parse("ux0:/data/webradio/playlist.m3u", &m3ufile)) {
-			printf("Error on parsing default playlist !");
+	static playlist stations;
+	static playlist_journal journal;
+	playlist_init(&stations);
+	playlist_journal_init(&journal, PLAYLIST_JOURNAL_FILE, PLAYLIST_FILE);
+
+	bool cache_loaded = !playlist_cache_load(&stations, PLAYLIST_FILE, PLAYLIST_CACHE_FILE);
+	if (!cache_loaded) {
+		if (playlist_load_m3u(&stations, PLAYLIST_FILE)) {
+			// Playlist missing, creating default playlist
+			sceIoMkdir("ux0:/data", 0777);
+			sceIoMkdir("ux0:/data/webradio", 0777);
+
+			// Copying playlist to correct location
+			copyfile(PLAYLIST_FILE, "default_playlist.m3u");
+			if (playlist_load_m3u(&stations, PLAYLIST_FILE)) {
+				printf("Error on parsing default playlist !");
+			}
 		}
 	}
 
+	// Changes made since the m3u or its cache were written
+	playlist_journal_replay(&journal, &stations);
+
+	if (!cache_loaded) {
+		// Next launch skips the text parsing
+		playlist_cache_save(&stations, PLAYLIST_FILE, PLAYLIST_CACHE_FILE);
+	}
+
 	sceSysmoduleLoadModule(SCE_SYSMODULE_NET);
 
 	SceNetInitParam net_init_param;
@@ -598,13 +1004,29 @@ int main(void)
 		return 1;
 	}
 
-	visualizer_mutex = sceKernelCreateMutex("visualizerMutex", 0, 0, NULL);
-	if (visualizer_mutex < 0) {
-		printf("Error creating mutex\n");
-		return 1;
+	Utils_InitPowerTick();
+
+	metrics_init();
+
+	if (analyser_init()) {
+		printf("Visualizer is not available\n");
 	}
 
-	Utils_InitPowerTick();
+	if (spectrogram_init()) {
+		printf("Spectrogram is not available\n");
+	}
+
+	if (recorder_init()) {
+		printf("Recording is not available\n");
+	}
+
+	if (logo_cache_init()) {
+		printf("Station logos are not available\n");
+	}
+
+	if (prober_init()) {
+		printf("Station checks are not available\n");
+	}
 
 	SceCtrlData ctrl_peek, ctrl_press;
 
@@ -626,16 +1048,33 @@ int main(void)
 
 	player.player_thread_id = thid;
 	player.state = PLAYER_STATE_WAITING;
-	player.visualizer_config = nullptr;
-	player.visualizer_rebuild = false;
+	player.visualizer_rebuild = true;
+	player.bar_count = 16;
+	player.fft_size = 2048;
+	player.hop_size = 512;
+	player.backend = FFT_BACKEND_DEFAULT;
+	player.mid_side = false;
+	player.db_floor = 60.0f;
+	player.db_ceiling = 160.0f;
+	player.peaks = true;
+	player.visualizer_fps = 60;
 	player.song_title = nullptr;
 	player.new_song_title = false;
 	player.url = NULL;
 	player.title = NULL;
+	player.codec_hint = AUDIO_FORMAT_UNKNOWN;
+	player.timeshift = false;
 	sceKernelStartThread(player.player_thread_id, 0, 0);
 	sceKernelStartThread(player.http_thread_id, 0, 0);
 
-	struct m3u_entry *current_entry = NULL;
+	int current_station = -1;
+	static station_list station_rows;
+	station_list_init(&station_rows);
+	static playlist_search station_search;
+	playlist_search_init(&station_search);
+	char search_query[PLAYLIST_SEARCH_QUERY_MAX] = "";
+	bool station_rows_visible = false;
+	bool station_probe_running = false;
  
 	// Init native dialog
 	gui_init_ime();
@@ -644,28 +1083,54 @@ int main(void)
 	bool done = false;
 	static bool show_main_widget = true;
 	static bool show_visualization = false;
+	bool timeshift_ready = false;
+	bool show_metrics = false;
+	bool log_metrics = false;
 	int title_show_start_time = 0;
+	unsigned int spectrogram_sequence = 0;
+	unsigned int beat_count = 0;
+	double beat_time = 0.0;
+
+	// Left or mid, right or side
+	static band_smoother band_levels[2];
+	smoother_init(&band_levels[0], player.db_floor, player.db_ceiling);
+	smoother_init(&band_levels[1], player.db_floor, player.db_ceiling);
 
 	static ImGuiWindowFlags flags = (ImGuiWindowFlags)(ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoTitleBar);
+	scheduler_set_rate(player.visualizer_fps);
+
 	while (!done) {
-		ImGui_ImplVitaGL_NewFrame();
+		// Sleep while nothing changes on screen, the black screen only draws for buttons
+		bool draw = scheduler_wait_frame(ui_scheduler_mode(), ui_signature);
 
+		// Song titles and recording splits follow the stream even without frames
 		parse_icy_metadata();
+		if (!draw) {
+			continue;
+		}
 
-		if (player.visualizer_rebuild) {
-			sceKernelLockMutex(visualizer_mutex, 1, NULL);
-	
-			if (player.visualizer_config) {
-				neon_fft_free(player.visualizer_config);
-				player.visualizer_config = nullptr;
-			}
+		unsigned int frame_start = metrics_now();
+		TRACE_BEGIN("frame");
+
+		ImGui_ImplVitaGL_NewFrame();
 
-			player.visualizer_config = neon_fft_init(player.nb_samples, player.samplerate, player.nb_channels, 16);
-			sceKernelUnlockMutex(visualizer_mutex, 1);
+		logo_cache_update();
 
+		if (player.visualizer_rebuild) {
+			analyser_configure(player.fft_size, player.hop_size, player.bar_count, player.backend);
 			player.visualizer_rebuild = false;
 		}
 
+		analyser_set_enabled(is_visualizer_view(player.view));
+		if (player.view == PLAYER_VIEW_VISUALIZER_MIRRORED) {
+			analyser_set_mode(player.mid_side ? NEON_FFT_MODE_MID_SIDE : NEON_FFT_MODE_STEREO);
+		} else {
+			analyser_set_mode(NEON_FFT_MODE_MONO);
+		}
+
+		bool station_rows_were_visible = station_rows_visible;
+		station_rows_visible = false;
+
 		if (player.view == PLAYER_VIEW_MENU || player.view == PLAYER_VIEW_SETTINGS) {
 			ImGui::GetIO().MouseDrawCursor = false;
 			
@@ -688,6 +1153,16 @@ int main(void)
 					player.view = PLAYER_VIEW_VISUALIZER_CIRCLES;
 				}
 
+				ImGui::SameLine();
+				if (ImGui::Button("Mirrored", ImVec2(0, 30))) {
+					player.view = PLAYER_VIEW_VISUALIZER_MIRRORED;
+				}
+
+				ImGui::SameLine();
+				if (ImGui::Button("Spectrogram", ImVec2(0, 30))) {
+					player.view = PLAYER_VIEW_VISUALIZER_SPECTROGRAM;
+				}
+
 				ImGui::SameLine();
 				if (ImGui::Button("About", ImVec2(0, 30))) {
 					player.view = PLAYER_VIEW_SETTINGS;
@@ -698,11 +1173,110 @@ int main(void)
 				if (player.view == PLAYER_VIEW_SETTINGS) {
 					ImGui::Text("Add your webradios to ux0:/data/webradio/playlist.m3u or with Add button");
 					ImGui::Text("circle : change menu");
-					ImGui::Text("square : stop audio");
+					ImGui::Text("square : stop audio, or pause/resume with timeshift");
 					ImGui::Text("cross/touch : play selected radio");
 					ImGui::Text("triangle : black screen and lock buttons");
 					ImGui::Text("L trigger : previous radio");
 					ImGui::Text("R trigger : next radio");
+					ImGui::Text("select : start/stop recording to %s", RECORDER_DIRECTORY);
+					ImGui::Text("left/right : rewind/forward 1 minute with timeshift (visualizer)");
+					ImGui::Text("left/right : previous/next first letter (webradios list)");
+
+					ImGui::Separator();
+
+					if (ImGui::Checkbox("Timeshift: keep the last minutes of the stream to pause and rewind", &player.timeshift)) {
+						if (player.timeshift && !timeshift_ready) {
+							timeshift_ready = !timeshift_init(timeshift_feed);
+							player.timeshift = timeshift_ready;
+						}
+
+						if (player.timeshift && player.state == PLAYER_STATE_PLAYING) {
+							timeshift_start(player.audio_type == AUDIO_FORMAT_AAC);
+						} else if (!player.timeshift) {
+							timeshift_stop();
+						}
+					}
+
+					ImGui::Text("Visualizer bars:");
+					for (int bar_count = 16; bar_count <= 256; bar_count *= 2) {
+						char label[16];
+						snprintf(label, sizeof(label), "%i##bars", bar_count);
+						ImGui::SameLine();
+						if (ImGui::RadioButton(label, player.bar_count == bar_count) && player.bar_count != bar_count) {
+							player.bar_count = bar_count;
+							player.visualizer_rebuild = true;
+						}
+					}
+
+					ImGui::Text("FFT size:");
+					for (int fft_size = NEON_FFT_MIN_SIZE; fft_size <= NEON_FFT_MAX_SIZE; fft_size *= 2) {
+						char label[16];
+						snprintf(label, sizeof(label), "%i##fft", fft_size);
+						ImGui::SameLine();
+						if (ImGui::RadioButton(label, player.fft_size == fft_size) && player.fft_size != fft_size) {
+							player.fft_size = fft_size;
+							player.visualizer_rebuild = true;
+						}
+					}
+
+					ImGui::Text("FFT hop:");
+					for (int hop_size = 256; hop_size <= 2048; hop_size *= 2) {
+						char label[16];
+						snprintf(label, sizeof(label), "%i##hop", hop_size);
+						ImGui::SameLine();
+						if (ImGui::RadioButton(label, player.hop_size == hop_size) && player.hop_size != hop_size) {
+							player.hop_size = hop_size;
+							player.visualizer_rebuild = true;
+						}
+					}
+
+					// Compare backends with the FFT timings of the performance overlay
+					const fft_backend *backends[] = { &fft_backend_ne10, &fft_backend_scalar };
+					ImGui::Text("FFT backend:");
+					for (const fft_backend *backend : backends) {
+						ImGui::SameLine();
+						if (ImGui::RadioButton(backend->name, player.backend == backend) && player.backend != backend) {
+							player.backend = backend;
+							player.visualizer_rebuild = true;
+						}
+					}
+
+					ImGui::Checkbox("Mirrored view: mid/side instead of left/right", &player.mid_side);
+					ImGui::Checkbox("Peak markers", &player.peaks);
+
+					ImGui::Text("Visualizer rate:");
+					const int rates[] = { 60, 30, 20 };
+					for (int fps : rates) {
+						char label[16];
+						snprintf(label, sizeof(label), "%i fps##rate", fps);
+						ImGui::SameLine();
+						if (ImGui::RadioButton(label, player.visualizer_fps == fps)) {
+							player.visualizer_fps = fps;
+							scheduler_set_rate(fps);
+						}
+					}
+
+					// Keep at least 10 dB between an empty and a full band
+					if (ImGui::SliderFloat("Visualizer floor", &player.db_floor, 0.0f, 150.0f, "%.0f dB")) {
+						if (player.db_ceiling < player.db_floor + 10.0f) {
+							player.db_ceiling = player.db_floor + 10.0f;
+						}
+					}
+					if (ImGui::SliderFloat("Visualizer ceiling", &player.db_ceiling, 10.0f, 160.0f, "%.0f dB")) {
+						if (player.db_floor > player.db_ceiling - 10.0f) {
+							player.db_floor = player.db_ceiling - 10.0f;
+						}
+					}
+
+					ImGui::Checkbox("Performance overlay", &show_metrics);
+					if (ImGui::Checkbox("Log performance metrics to " METRICS_CSV_FILE, &log_metrics)) {
+						metrics_set_csv(log_metrics);
+					}
+#ifdef WEBRADIO_TRACE
+					if (ImGui::Button("Dump trace to " TRACE_FILE)) {
+						TRACE_DUMP();
+					}
+#endif
 				} else {
 					if (player.song_title && player.title && player.state == PLAYER_STATE_PLAYING) {
 						ImGui::Text("Playing \"%s\" from %s", player.song_title, player.title);
@@ -716,6 +1290,16 @@ int main(void)
 						ImGui::Text("Standby");
 					}
 	
+					if (recorder_is_recording()) {
+						ImGui::SameLine();
+						ImGui::TextColored(ImVec4(1.0f, 0.2f, 0.2f, 1.0f), "[REC]");
+					}
+
+					if (timeshift_is_active()) {
+						ImGui::SameLine();
+						draw_timeshift_status();
+					}
+
 					ImGui::Separator();
 
 					if (ImGui::Button("Add", ImVec2(0, 30))) {
@@ -729,82 +1313,193 @@ int main(void)
 							char *webradio_title = gui_open_text_dialog(title, initial_text);
 
 							printf("Adding new entry with URL %s\n", url);
-							m3u_add_entry(m3ufile, url, NULL, webradio_title);
-							m3u_write(m3ufile);
+							int index = playlist_journal_add(&journal, &stations, url, webradio_title, NULL, NULL);
+							if (index >= 0) {
+								// Show the new station, the index can move search results
+								search_query[0] = '\0';
+								set_station_filter(&station_rows, &stations, NULL, stations.count);
+								playlist_search_update(&station_search, &stations);
+								current_station = index;
+								play_station(&stations, current_station);
+							}
 
-							current_entry = m3ufile->last_entry;
-							player.url = current_entry->url;
-							player.title = current_entry->title;
-							player.state = PLAYER_STATE_NEW;
+							free(webradio_title);
 						}
+
+						free(url);
 					}
 
-					m3u_entry *drawEntry = m3ufile->first_entry;
-					while (drawEntry) {
-						const char *button_text = NULL;
-						if (drawEntry->title) {
-							button_text = drawEntry->title;
-						} else if (drawEntry->url) {
-							button_text = drawEntry->url;
+					ImGui::SameLine();
+					if (ImGui::Button("Import", ImVec2(0, 30))) {
+						char *path = gui_open_text_dialog("Import a PLS, XSPF, M3U or Radio-Browser JSON file", PLAYLIST_IMPORT_DIRECTORY);
+						int first = stations.count;
+						if (path && strlen(path) > 0 && playlist_import(&stations, path) > 0) {
+							// Many stations at once, rewrite the m3u rather than journaling each one
+							playlist_journal_compact(&journal, &stations);
+							search_query[0] = '\0';
+							playlist_search_update(&station_search, &stations);
+							set_station_filter(&station_rows, &stations, NULL, stations.count);
+							station_list_show(&station_rows, &stations, first);
+						}
+
+						free(path);
+					}
+
+					ImGui::SameLine();
+					if (ImGui::Button("Search", ImVec2(0, 30))) {
+						char *query = gui_open_text_dialog("Search webradios", search_query);
+						snprintf(search_query, sizeof(search_query), "%s", query ? query : "");
+						free(query);
+
+						if (search_query[0] && playlist_search_query(&station_search, &stations, search_query) >= 0) {
+							set_station_filter(&station_rows, &stations, station_search.results, station_search.result_count);
 						} else {
-							button_text = "Unknown";
+							search_query[0] = '\0';
+							set_station_filter(&station_rows, &stations, NULL, stations.count);
+							station_list_show(&station_rows, &stations, current_station);
 						}
-	
-						if (ImGui::Button(button_text, ImVec2(960, 30))) {
-							current_entry = drawEntry;
-							printf("Playing %s %s\n", current_entry->title, current_entry->url);
-							player.url = current_entry->url;
-							player.title = current_entry->title;
-							player.state = PLAYER_STATE_NEW;
-							// Show visualization
-							player.view = PLAYER_VIEW_VISUALIZER_BARS;
+					}
+
+					ImGui::SameLine();
+					if (prober_is_running()) {
+						int checked = 0;
+						int total = 0;
+						prober_progress(&checked, &total);
+						ImGui::Text("Checking stations %i/%i", checked, total);
+					} else if (ImGui::Button("Check stations", ImVec2(0, 30))) {
+						station_probe_running = !prober_start(&stations);
+					}
+
+					if (search_query[0]) {
+						ImGui::SameLine();
+						if (ImGui::Button("Show all", ImVec2(0, 30))) {
+							search_query[0] = '\0';
+							set_station_filter(&station_rows, &stations, NULL, stations.count);
+							station_list_show(&station_rows, &stations, current_station);
+						} else {
+							ImGui::SameLine();
+							ImGui::Text("%i results for \"%s\" in %.1f ms", station_search.result_count, search_query, station_search.query_time / 1000.0f);
 						}
-						drawEntry = drawEntry->next;
+					}
+
+					// Rank again with new settings or once a check is done
+					bool rank_stations = ImGui::Checkbox("Hide down stations", &hide_down_stations);
+					ImGui::SameLine();
+					rank_stations |= ImGui::Checkbox("Fastest first", &fastest_stations_first);
+					if (station_probe_running && !prober_is_running()) {
+						station_probe_running = false;
+						rank_stations = true;
+					}
+
+					if (rank_stations) {
+						if (search_query[0]) {
+							set_station_filter(&station_rows, &stations, station_search.results, station_search.result_count);
+						} else {
+							set_station_filter(&station_rows, &stations, NULL, stations.count);
+						}
+					}
+
+					if (!station_rows_were_visible) {
+						// List just opened, bring the station playing into view
+						station_list_show(&station_rows, &stations, current_station);
+					}
+					station_rows_visible = true;
+
+					int pressed = station_list_draw(&station_rows, &stations, current_station);
+					if (pressed >= 0) {
+						current_station = pressed;
+						play_station(&stations, current_station);
+						// Show visualization
+						player.view = PLAYER_VIEW_VISUALIZER_BARS;
 					}
 				}
 
 				ImGui::End();
 			}
-		} else if (player.view == PLAYER_VIEW_VISUALIZER_BARS || player.view == PLAYER_VIEW_VISUALIZER_CIRCLES) {
+		} else if (is_visualizer_view(player.view)) {
 			ImGui::SetNextWindowPos(ImVec2(0, 0));
 	    	ImGui::SetNextWindowSize(ImVec2(960, 544));
 
 			if (ImGui::Begin("Vita Webradio Visualizer", &show_visualization, flags)) {
-				sceKernelLockMutex(visualizer_mutex, 1, NULL);
-				if (player.state == PLAYER_STATE_PLAYING && player.visualizer_config && player.visualizer_config->visualizer_data) {
-					spectrum_analyser(player.visualizer_config);
-
-					if (player.view == PLAYER_VIEW_VISUALIZER_BARS) {
-						int bar_length = 960 / player.visualizer_config->bar_count;
-						for (int i = 0; i < player.visualizer_config->bar_count; i++) {
-							float y_upper = 540.0 - (player.visualizer_config->visualizer_data[i] - 60.0) * 5.0f;
-							if (y_upper <= 0.0 || y_upper > 544.0) {
-								continue;
-							}
+				const analyser_frame *frame = analyser_get_frame();
+				if (frame->beat_count != beat_count) {
+					beat_count = frame->beat_count;
+					beat_time = ImGui::GetTime();
+				}
 
-							ImGui::GetWindowDrawList()->AddRectFilledMultiColor(
-								ImVec2((float)(i+1) * bar_length - 1, y_upper),
-								ImVec2((float)i * bar_length, 540.0),
-								IM_COL32(255 - (int)(y_upper / 3.0), 200, 0, 255),
-								IM_COL32(255 - (int)(y_upper / 3.0), 200, 0, 255),
-								IM_COL32(0, 200, 0, 255),
-								IM_COL32(0, 200, 0, 255));
+				// 1 on an onset, back to 0 after 150 ms
+				float beat_pulse = 1.0f - (float)(ImGui::GetTime() - beat_time) / 0.15f;
+				if (beat_pulse < 0.0f) {
+					beat_pulse = 0.0f;
+				}
+
+				// Decays follow the real time between frames, not the frame rate
+				float elapsed = ImGui::GetIO().DeltaTime;
+				smoother_set_range(&band_levels[0], player.db_floor, player.db_ceiling);
+				smoother_update(&band_levels[0], frame->bands, frame->bar_count, elapsed);
+				if (frame->mode != NEON_FFT_MODE_MONO) {
+					smoother_set_range(&band_levels[1], player.db_floor, player.db_ceiling);
+					smoother_update(&band_levels[1], frame->secondary, frame->bar_count, elapsed);
+				}
+
+				if (player.state == PLAYER_STATE_PLAYING) {
+					ImDrawList *draw_list = ImGui::GetWindowDrawList();
+					geometry_bars_style style;
+					style.bottom = 540.0f;
+					style.height = 500.0f;
+					style.fade_channel = 0;
+
+					// Bars, then peak markers on top of them
+					int bar_sets = player.peaks ? 2 : 1;
+
+					if (player.view == PLAYER_VIEW_VISUALIZER_BARS && frame->bar_count > 0) {
+						style.origin = 0.0f;
+						style.step = 960 / frame->bar_count;
+						style.height *= 1.0f + 0.15f * beat_pulse;
+
+						geometry_target target = geometry_reserve(draw_list, bar_sets * frame->bar_count * GEOMETRY_BAR_VERTICES, bar_sets * frame->bar_count * GEOMETRY_BAR_INDICES);
+						geometry_build_bars(&target, band_levels[0].level, frame->bar_count, &style);
+						if (player.peaks) {
+							geometry_advance(&target, frame->bar_count * GEOMETRY_BAR_VERTICES, frame->bar_count * GEOMETRY_BAR_INDICES);
+							geometry_build_peaks(&target, band_levels[0].peak, frame->bar_count, &style);
 						}
-					} else { // PLAYER_VIEW_VISUALIZER_CIRCLES
-						for (int i = 0; i < player.visualizer_config->bar_count / 2; i++) {
-							float value = (player.visualizer_config->visualizer_data[i*2] + player.visualizer_config->visualizer_data[i*2+1]) / 2.0;
-							if (value < 0.0) {
-								value = 0.0;
+					} else if (player.view == PLAYER_VIEW_VISUALIZER_MIRRORED && frame->bar_count > 0 && frame->mode != NEON_FFT_MODE_MONO) {
+						// Left (or mid) grows to the left from the center, right (or side) to the right
+						geometry_target target = geometry_reserve(draw_list, 2 * bar_sets * frame->bar_count * GEOMETRY_BAR_VERTICES, 2 * bar_sets * frame->bar_count * GEOMETRY_BAR_INDICES);
+
+						for (int side = 0; side < 2; side++) {
+							style.origin = 480.0f;
+							style.step = (side ? 480.0f : -480.0f) / frame->bar_count;
+							style.fade_channel = side ? 2 : 0;
+							geometry_build_bars(&target, band_levels[side].level, frame->bar_count, &style);
+							geometry_advance(&target, frame->bar_count * GEOMETRY_BAR_VERTICES, frame->bar_count * GEOMETRY_BAR_INDICES);
+
+							if (player.peaks) {
+								geometry_build_peaks(&target, band_levels[side].peak, frame->bar_count, &style);
+								geometry_advance(&target, frame->bar_count * GEOMETRY_BAR_VERTICES, frame->bar_count * GEOMETRY_BAR_INDICES);
 							}
+						}
 
-							ImGui::GetWindowDrawList()->AddCircle(
-								ImVec2(960.0 / 2.0, 544.0 / 2.0),
-								value * 1.5,
-								IM_COL32(255 - i * 2 * 255 / player.visualizer_config->bar_count, 200, 0, 255),
-								24,
-								4.0
-							);
+						// Correlation meter: -1 out of phase, 0 unrelated channels, 1 mono
+						float correlation_x = 480.0f + frame->correlation * 150.0f;
+						draw_list->AddRectFilled(ImVec2(330.0f, 500.0f), ImVec2(630.0f, 508.0f), IM_COL32(60, 60, 60, 255));
+						draw_list->AddRectFilled(ImVec2(correlation_x - 3.0f, 496.0f), ImVec2(correlation_x + 3.0f, 512.0f),
+							frame->correlation < 0.0f ? IM_COL32(255, 60, 60, 255) : IM_COL32(0, 200, 0, 255));
+						draw_list->AddText(ImVec2(300.0f, 496.0f), IM_COL32(255, 255, 255, 255), frame->mode == NEON_FFT_MODE_MID_SIDE ? "M" : "L");
+						draw_list->AddText(ImVec2(650.0f, 496.0f), IM_COL32(255, 255, 255, 255), frame->mode == NEON_FFT_MODE_MID_SIDE ? "S" : "R");
+					} else if (player.view == PLAYER_VIEW_VISUALIZER_CIRCLES && frame->bar_count > 0) {
+						int rings = frame->bar_count / 2;
+						geometry_target target = geometry_reserve(draw_list, rings * GEOMETRY_RING_VERTICES, rings * GEOMETRY_RING_INDICES);
+						geometry_build_rings(&target, band_levels[0].level, frame->bar_count, 960.0f / 2.0f, 544.0f / 2.0f,
+							260.0f * (1.0f + 0.2f * beat_pulse), 4.0f + 4.0f * beat_pulse);
+					} else if (player.view == PLAYER_VIEW_VISUALIZER_SPECTROGRAM && frame->bar_count > 0) {
+						// One new column per analysis, the texture keeps the history
+						if (frame->sequence != spectrogram_sequence) {
+							spectrogram_push(frame->bands, frame->bar_count);
+							spectrogram_sequence = frame->sequence;
 						}
+
+						spectrogram_draw(draw_list, ImVec2(0.0f, 0.0f), ImVec2(960.0f, 544.0f));
 					}
 	
 					if (player.new_song_title) {
@@ -813,7 +1508,11 @@ int main(void)
 					}
 	
 					if (ImGui::GetTime() - title_show_start_time < 10.0) {
-						// Show song title and format info for 10 seconds
+						// Show station logo, song title and format info for 10 seconds
+						if (current_station >= 0 && current_station < stations.count) {
+							logo_cache_draw(draw_list, stations.entries[current_station].logo_url, ImVec2(872.0f, 16.0f), ImVec2(944.0f, 88.0f));
+						}
+
 						if (player.song_title) {
 							ImGui::Text("%s", player.song_title);
 						}
@@ -821,13 +1520,25 @@ int main(void)
 						if (player.audio_type && player.samplerate && player.nb_channels) {
 							ImGui::Text("%s %iHz %i channels", AudioFormatToString(player.audio_type), player.samplerate, player.nb_channels);
 						}
+
+						if (frame->bpm > 0.0f) {
+							ImGui::Text("%.0f BPM", frame->bpm);
+						}
+
+						if (recorder_is_recording()) {
+							ImGui::TextColored(ImVec4(1.0f, 0.2f, 0.2f, 1.0f), "[REC]");
+						}
+					}
+
+					if (!timeshift_is_live()) {
+						// Always show how far behind live playback is
+						draw_timeshift_status();
 					}
 				} else if (player.state == PLAYER_STATE_WAITING) {
 					ImGui::Text("Standby");
 				} else if (player.state == PLAYER_STATE_NEW) {
 					ImGui::Text("Connecting...");
 				}
-				sceKernelUnlockMutex(visualizer_mutex, 1);
 				ImGui::End();
 			}
 		}
@@ -853,9 +1564,15 @@ int main(void)
 		} else if (ctrl_press.buttons & SCE_CTRL_CIRCLE) {
 			switch (player.view)
 			{
-			case PLAYER_VIEW_VISUALIZER_CIRCLES:
+			case PLAYER_VIEW_VISUALIZER_SPECTROGRAM:
 				player.view = PLAYER_VIEW_MENU;
 				break;
+			case PLAYER_VIEW_VISUALIZER_MIRRORED:
+				player.view = PLAYER_VIEW_VISUALIZER_SPECTROGRAM;
+				break;
+			case PLAYER_VIEW_VISUALIZER_CIRCLES:
+				player.view = PLAYER_VIEW_VISUALIZER_MIRRORED;
+				break;
 			case PLAYER_VIEW_VISUALIZER_BARS:
 				player.view = PLAYER_VIEW_VISUALIZER_CIRCLES;
 				break;
@@ -864,30 +1581,50 @@ int main(void)
 				break;
 			}
 			player.new_song_title = true; // Show title again
+		} else if (ctrl_press.buttons & SCE_CTRL_SELECT) {
+			if (recorder_is_recording()) {
+				recorder_stop();
+			} else if (player.state == PLAYER_STATE_PLAYING && player.audio_type != AUDIO_FORMAT_UNKNOWN) {
+				const char *extension = player.audio_type == AUDIO_FORMAT_AAC ? ".aac" : player.audio_type == AUDIO_FORMAT_OGG ? ".ogg" : ".mp3";
+				recorder_start(player.title, player.song_title, extension);
+			}
 		} else if (ctrl_press.buttons & SCE_CTRL_SQUARE) {
-			player.state = PLAYER_STATE_WAITING;
+			if (!timeshift_is_active()) {
+				player.state = PLAYER_STATE_WAITING;
+			} else if (timeshift_is_paused()) {
+				timeshift_resume();
+			} else {
+				// Keep downloading to disk, drop what the decoder has not played yet
+				TRACE_LOCK(audio_mutex, "audio_mutex");
+				timeshift_pause(stream_buffer_used());
+				read_pos = write_pos;
+				sceKernelUnlockMutex(audio_mutex, 1);
+			}
+		} else if ((ctrl_press.buttons & (SCE_CTRL_LEFT | SCE_CTRL_RIGHT)) && timeshift_is_active()
+			&& is_visualizer_view(player.view)) {
+			TRACE_LOCK(audio_mutex, "audio_mutex");
+			if (timeshift_seek(ctrl_press.buttons & SCE_CTRL_LEFT ? -60 : 60)) {
+				read_pos = write_pos;
+			}
+			sceKernelUnlockMutex(audio_mutex, 1);
+		} else if ((ctrl_press.buttons & (SCE_CTRL_LEFT | SCE_CTRL_RIGHT)) && player.view == PLAYER_VIEW_MENU) {
+			station_list_jump(&station_rows, &stations, ctrl_press.buttons & SCE_CTRL_LEFT ? -1 : 1);
 		} else if (ctrl_press.buttons & SCE_CTRL_RTRIGGER) {
-			if (current_entry && current_entry->next) {
-				current_entry = current_entry->next;
-			} else if (m3ufile->first_entry) {
-				current_entry = m3ufile->first_entry;
+			if (stations.count > 0) {
+				current_station = (current_station + 1) % stations.count;
+				play_station(&stations, current_station);
+				station_list_show(&station_rows, &stations, current_station);
 			}
-
-			printf("Playing %s %s\n", current_entry->title, current_entry->url);
-			player.url = current_entry->url;
-			player.title = current_entry->title;
-			player.state = PLAYER_STATE_NEW;
 		} else if (ctrl_press.buttons & SCE_CTRL_LTRIGGER) {
-			if (current_entry && current_entry->previous) {
-				current_entry = current_entry->previous;
-			} else if (m3ufile->last_entry) {
-				current_entry = m3ufile->last_entry;
+			if (stations.count > 0) {
+				current_station = current_station > 0 ? current_station - 1 : stations.count - 1;
+				play_station(&stations, current_station);
+				station_list_show(&station_rows, &stations, current_station);
 			}
+		}
 
-			printf("Playing %s %s\n", current_entry->title, current_entry->url);
-			player.url = current_entry->url;
-			player.title = current_entry->title;
-			player.state = PLAYER_STATE_NEW;
+		if (show_metrics && player.view != PLAYER_VIEW_BLACKSCREEN) {
+			metrics_draw_overlay();
 		}
 
 		// Rendering
@@ -896,7 +1633,11 @@ int main(void)
 		glClear(GL_COLOR_BUFFER_BIT);
 		ImGui::Render();
 		ImGui_ImplVitaGL_RenderDrawData(ImGui::GetDrawData());
+		metrics_add_timing(METRICS_TIMING_FRAME, metrics_now() - frame_start);
+		TRACE_END("frame");
+		TRACE_BEGIN("swap");
 		vglSwapBuffers(GL_FALSE);
+		TRACE_END("swap");
 	}
 
 	player.state = PLAYER_STATE_STOPPING;
@@ -920,9 +1661,16 @@ int main(void)
 	sceKernelDeleteThread(player.player_thread_id);
     sceKernelDeleteThread(player.http_thread_id);
 
+	recorder_term();
+	timeshift_term();
+	prober_term();
+	logo_cache_term();
+	spectrogram_term();
+	analyser_term();
+	metrics_term();
+
 	sceKernelDeleteMutex(audio_mutex);
 	sceKernelDeleteMutex(icy_meta_mutex);
-	sceKernelDeleteMutex(visualizer_mutex);
 
 	// Cleanup
 	ImGui::DestroyContext();
@@ -932,7 +1680,12 @@ int main(void)
 	sceNetTerm();
 	sceSysmoduleUnloadModule(SCE_SYSMODULE_NET);
 
-	m3u_file_free(m3ufile);
+	station_list_free(&station_rows);
+	free(ranked_stations);
+	playlist_search_free(&station_search);
+	playlist_journal_wait();
+	playlist_cache_wait();
+	playlist_free(&stations);
 
 	return 0;
 }
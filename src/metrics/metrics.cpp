@@ -0,0 +1,260 @@
+#include "metrics.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+
+#include <imgui_vita.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/threadmgr.h>
+
+#define printf sceClibPrintf
+
+// Written by audio, network and UI threads with atomic adds, read by the metrics thread
+static volatile unsigned int network_bytes = 0;
+static volatile unsigned int consumed_bytes = 0;
+static volatile unsigned int buffered_bytes = 0;
+static volatile unsigned int underruns = 0;
+static volatile unsigned int ui_idle = 0;
+
+// Histograms are double buffered: writers use the current one while the other is summarized
+static volatile unsigned int histograms[2][METRICS_TIMING_COUNT][METRICS_HISTOGRAM_SIZE];
+static volatile int histogram_current = 0;
+
+// Last snapshot, published with a sequence counter
+static metrics_snapshot snapshot;
+static volatile unsigned int snapshot_sequence = 0;
+
+static volatile bool running = false;
+static volatile bool csv_enabled = false;
+static SceUID metrics_thread_id = -1;
+
+static int metrics_bucket(unsigned int microseconds)
+{
+	if (microseconds < 4) {
+		return microseconds;
+	}
+
+	int log = 31 - __builtin_clz(microseconds);
+	int bucket = log * 4 + ((microseconds >> (log - 2)) & 0x03) - 4;
+
+	return bucket < METRICS_HISTOGRAM_SIZE ? bucket : METRICS_HISTOGRAM_SIZE - 1;
+}
+
+static unsigned int metrics_bucket_value(int bucket)
+{
+	if (bucket < 4) {
+		return bucket;
+	}
+
+	int log = (bucket + 4) / 4;
+	return (4 + (bucket + 4) % 4) << (log - 2);
+}
+
+static unsigned int metrics_percentile(const unsigned int *histogram, unsigned int total, unsigned int percent)
+{
+	unsigned int target = (total * percent + 99) / 100;
+	unsigned int count = 0;
+
+	for (int i = 0; i < METRICS_HISTOGRAM_SIZE; i++) {
+		count += histogram[i];
+		if (count >= target && count > 0) {
+			return metrics_bucket_value(i);
+		}
+	}
+
+	return 0;
+}
+
+static void metrics_publish(const metrics_snapshot *data)
+{
+	__atomic_add_fetch(&snapshot_sequence, 1, __ATOMIC_RELEASE);
+	memcpy(&snapshot, data, sizeof(metrics_snapshot));
+	__atomic_add_fetch(&snapshot_sequence, 1, __ATOMIC_RELEASE);
+}
+
+static void metrics_write_csv(SceUID *fd, const metrics_snapshot *data)
+{
+	char line[256];
+
+	if (*fd < 0) {
+		*fd = sceIoOpen(METRICS_CSV_FILE, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_APPEND, 0777);
+		if (*fd < 0) {
+			printf("Metrics: cannot open %s (0x%X)\n", METRICS_CSV_FILE, *fd);
+			csv_enabled = false;
+			return;
+		}
+
+		int length = snprintf(line, sizeof(line), "time_s,network_kbps,ring_fill_ms,underruns,decode_p50_us,decode_p99_us,fft_p50_us,fft_p99_us,frame_p50_us,frame_p99_us,heap_kb,ui_idle_pct\n");
+		sceIoWrite(*fd, line, length);
+	}
+
+	int length = snprintf(line, sizeof(line), "%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+		data->time, data->network_kbps, data->ring_fill_ms, data->underruns,
+		data->p50[METRICS_TIMING_DECODE], data->p99[METRICS_TIMING_DECODE],
+		data->p50[METRICS_TIMING_FFT], data->p99[METRICS_TIMING_FFT],
+		data->p50[METRICS_TIMING_FRAME], data->p99[METRICS_TIMING_FRAME],
+		data->heap_used / 1024, data->ui_idle_percent);
+	sceIoWrite(*fd, line, length);
+}
+
+static int metrics_thread(SceSize args, void *argp)
+{
+	SceUID csv_fd = -1;
+	unsigned int seconds = 0;
+	unsigned int consumed_rate = 0;
+	unsigned int histogram[METRICS_HISTOGRAM_SIZE];
+
+	while (running) {
+		sceKernelDelayThread(METRICS_PERIOD);
+		seconds++;
+
+		metrics_snapshot data;
+		memset(&data, 0, sizeof(data));
+		data.time = seconds;
+		data.network_kbps = __atomic_exchange_n(&network_bytes, 0, __ATOMIC_RELAXED) * 8 / 1000;
+		data.underruns = underruns;
+		data.ui_idle_percent = __atomic_exchange_n(&ui_idle, 0, __ATOMIC_RELAXED) / (METRICS_PERIOD / 100);
+
+		// Ring fill converted to time with the bytes the decoder consumed this period
+		unsigned int consumed = __atomic_exchange_n(&consumed_bytes, 0, __ATOMIC_RELAXED);
+		if (consumed > 0) {
+			consumed_rate = consumed;
+		}
+		data.ring_fill_ms = consumed_rate ? (unsigned long long)buffered_bytes * 1000 / consumed_rate : 0;
+
+		// Swap histograms, writers move to the cleared one
+		int previous = histogram_current;
+		__atomic_store_n(&histogram_current, 1 - previous, __ATOMIC_RELEASE);
+
+		for (int timing = 0; timing < METRICS_TIMING_COUNT; timing++) {
+			unsigned int total = 0;
+			for (int i = 0; i < METRICS_HISTOGRAM_SIZE; i++) {
+				histogram[i] = __atomic_exchange_n(&histograms[previous][timing][i], 0, __ATOMIC_RELAXED);
+				total += histogram[i];
+			}
+
+			data.count[timing] = total;
+			data.p50[timing] = metrics_percentile(histogram, total, 50);
+			data.p99[timing] = metrics_percentile(histogram, total, 99);
+		}
+
+		struct mallinfo info = mallinfo();
+		data.heap_used = info.uordblks;
+
+		metrics_publish(&data);
+
+		if (csv_enabled) {
+			metrics_write_csv(&csv_fd, &data);
+		} else if (csv_fd >= 0) {
+			sceIoClose(csv_fd);
+			csv_fd = -1;
+		}
+	}
+
+	if (csv_fd >= 0) {
+		sceIoClose(csv_fd);
+	}
+
+	return 0;
+}
+
+int metrics_init(void)
+{
+	running = true;
+	metrics_thread_id = sceKernelCreateThread("metricsThread", metrics_thread, 0x10000100 + 20, 0x4000, 0, 0, NULL);
+	if (metrics_thread_id < 0) {
+		printf("Metrics: error creating thread with id %i\n", metrics_thread_id);
+		running = false;
+		return -1;
+	}
+
+	sceKernelStartThread(metrics_thread_id, 0, NULL);
+
+	return 0;
+}
+
+void metrics_term(void)
+{
+	if (metrics_thread_id < 0) {
+		return;
+	}
+
+	running = false;
+
+	SceUInt timeout = 2 * METRICS_PERIOD;
+	sceKernelWaitThreadEnd(metrics_thread_id, NULL, &timeout);
+	sceKernelDeleteThread(metrics_thread_id);
+	metrics_thread_id = -1;
+}
+
+void metrics_add_network(size_t bytes)
+{
+	__atomic_fetch_add(&network_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+/**
+ * @param bytes were taken from the stream buffer by the decoder
+ * @param buffered is what remains in the stream buffer
+ */
+void metrics_add_consumed(size_t bytes, size_t buffered)
+{
+	__atomic_fetch_add(&consumed_bytes, bytes, __ATOMIC_RELAXED);
+	buffered_bytes = buffered;
+}
+
+void metrics_add_timing(metrics_timing timing, unsigned int microseconds)
+{
+	int current = __atomic_load_n(&histogram_current, __ATOMIC_ACQUIRE);
+	__atomic_fetch_add(&histograms[current][timing][metrics_bucket(microseconds)], 1, __ATOMIC_RELAXED);
+}
+
+void metrics_add_underrun(void)
+{
+	__atomic_fetch_add(&underruns, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @param microseconds the UI thread slept instead of drawing, left to the other threads
+ */
+void metrics_add_idle(unsigned int microseconds)
+{
+	__atomic_fetch_add(&ui_idle, microseconds, __ATOMIC_RELAXED);
+}
+
+void metrics_get_snapshot(metrics_snapshot *data)
+{
+	unsigned int sequence = 0;
+
+	do {
+		sequence = __atomic_load_n(&snapshot_sequence, __ATOMIC_ACQUIRE);
+		memcpy(data, &snapshot, sizeof(metrics_snapshot));
+	} while ((sequence & 1) || sequence != __atomic_load_n(&snapshot_sequence, __ATOMIC_ACQUIRE));
+}
+
+void metrics_set_csv(bool enabled)
+{
+	csv_enabled = enabled;
+}
+
+void metrics_draw_overlay(void)
+{
+	metrics_snapshot data;
+	metrics_get_snapshot(&data);
+
+	ImGui::SetNextWindowPos(ImVec2(700, 40));
+	ImGui::SetNextWindowBgAlpha(0.6f);
+	if (ImGui::Begin("Metrics", NULL, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoInputs
+		| ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing)) {
+		ImGui::Text("net     %u kbps", data.network_kbps);
+		ImGui::Text("buffer  %u ms", data.ring_fill_ms);
+		ImGui::Text("underrun %u", data.underruns);
+		ImGui::Text("decode  %u/%u us", data.p50[METRICS_TIMING_DECODE], data.p99[METRICS_TIMING_DECODE]);
+		ImGui::Text("fft     %u/%u us", data.p50[METRICS_TIMING_FFT], data.p99[METRICS_TIMING_FFT]);
+		ImGui::Text("frame   %u/%u us", data.p50[METRICS_TIMING_FRAME], data.p99[METRICS_TIMING_FRAME]);
+		ImGui::Text("heap    %u KB", data.heap_used / 1024);
+		ImGui::Text("ui idle %u %%", data.ui_idle_percent);
+	}
+	ImGui::End();
+}
@@ -0,0 +1,50 @@
+#ifndef __METRICS_HPP__
+#define __METRICS_HPP__
+
+#include <stddef.h>
+
+#include <psp2/kernel/processmgr.h>
+
+#define METRICS_CSV_FILE "ux0:/data/webradio/metrics.csv"
+#define METRICS_PERIOD (1000 * 1000) // snapshot every second
+#define METRICS_HISTOGRAM_SIZE 64 // 4 buckets per power of two, up to ~130ms
+
+enum metrics_timing {
+	METRICS_TIMING_DECODE, // one decoded frame
+	METRICS_TIMING_FFT, // one spectrum analysis
+	METRICS_TIMING_FRAME, // CPU time of one UI frame
+	METRICS_TIMING_COUNT,
+};
+
+struct metrics_snapshot {
+	unsigned int time; // seconds since metrics_init
+	unsigned int network_kbps;
+	unsigned int ring_fill_ms; // stream buffer fill at the current decoding rate
+	unsigned int underruns; // since metrics_init
+	unsigned int count[METRICS_TIMING_COUNT];
+	unsigned int p50[METRICS_TIMING_COUNT]; // microseconds
+	unsigned int p99[METRICS_TIMING_COUNT]; // microseconds
+	unsigned int heap_used; // bytes
+	unsigned int ui_idle_percent; // main thread time spent waiting for the next frame
+};
+
+int metrics_init(void);
+void metrics_term(void);
+
+// Lock-free, callable from any thread
+static inline unsigned int metrics_now(void)
+{
+	return sceKernelGetProcessTimeLow();
+}
+
+void metrics_add_network(size_t bytes);
+void metrics_add_consumed(size_t bytes, size_t buffered);
+void metrics_add_timing(metrics_timing timing, unsigned int microseconds);
+void metrics_add_underrun(void);
+void metrics_add_idle(unsigned int microseconds);
+
+void metrics_get_snapshot(metrics_snapshot *snapshot);
+void metrics_set_csv(bool enabled);
+void metrics_draw_overlay(void);
+
+#endif
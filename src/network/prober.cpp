@@ -0,0 +1,591 @@
+#include "prober.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include <curl/curl.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#include "resolver.hpp"
+#include "../trace/trace.hpp"
+#include "../utils.hpp"
+
+extern "C" {
+	#include "../audio/audio.h"
+}
+
+#define printf sceClibPrintf
+
+struct prober_file_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+	uint32_t reserved;
+};
+
+/**
+ * One station being checked, reused for the next one when done
+ */
+struct prober_job {
+	CURL *curl;
+	int target;
+	int depth; // playlist wrappers followed
+	SceUInt64 start;
+	bool body_started;
+	size_t audio_bytes;
+	resolver_probe probe;
+	prober_result result;
+	char url[RESOLVER_URL_MAX];
+};
+
+// Results sorted by hash, shared with the UI thread under the mutex
+static prober_result *results = NULL;
+static int result_count = 0;
+static SceUID prober_mutex = -1;
+
+// Stations of the current check, copied so the playlist can change meanwhile
+static char *target_urls = NULL;
+static uint32_t *target_offsets = NULL;
+static int target_count = 0;
+static volatile int checked_count = 0;
+
+static volatile bool prober_running = false;
+static volatile bool prober_stopping = false;
+static SceUID prober_thread_id = -1;
+
+static int prober_compare_results(const void *a, const void *b)
+{
+	uint64_t hash_a = ((const prober_result*)a)->hash;
+	uint64_t hash_b = ((const prober_result*)b)->hash;
+
+	return hash_a < hash_b ? -1 : hash_a > hash_b;
+}
+
+static prober_result *prober_find(uint64_t hash)
+{
+	prober_result key;
+	key.hash = hash;
+
+	return (prober_result*)bsearch(&key, results, result_count, sizeof(prober_result), prober_compare_results);
+}
+
+static int prober_load(void)
+{
+	SceUID fd = sceIoOpen(PROBER_FILE, SCE_O_RDONLY, 0);
+	if (fd < 0) {
+		return -1;
+	}
+
+	prober_file_header header;
+	if (sceIoRead(fd, &header, sizeof(header)) != sizeof(header) || header.magic != PROBER_MAGIC || header.version != PROBER_VERSION) {
+		printf("Prober: %s is invalid\n", PROBER_FILE);
+		sceIoClose(fd);
+		return -1;
+	}
+
+	int size = sizeof(prober_result) * header.count;
+	results = (prober_result*)malloc(size ? size : sizeof(prober_result));
+	if (!results || sceIoRead(fd, results, size) != size) {
+		printf("Prober: %s is truncated\n", PROBER_FILE);
+		free(results);
+		results = NULL;
+		sceIoClose(fd);
+		return -1;
+	}
+
+	sceIoClose(fd);
+	result_count = header.count;
+
+	return 0;
+}
+
+static void prober_save(void)
+{
+	TRACE_LOCK(prober_mutex, "prober_mutex");
+
+	size_t size = sizeof(prober_file_header) + sizeof(prober_result) * result_count;
+	char *data = (char*)malloc(size);
+	if (data) {
+		prober_file_header *header = (prober_file_header*)data;
+		memset(header, 0, sizeof(prober_file_header));
+		header->magic = PROBER_MAGIC;
+		header->version = PROBER_VERSION;
+		header->count = result_count;
+		memcpy(header + 1, results, sizeof(prober_result) * result_count);
+	}
+
+	sceKernelUnlockMutex(prober_mutex, 1);
+
+	if (!data) {
+		printf("Prober: error allocating %u bytes\n", size);
+		return;
+	}
+
+	playlist_replace_file(PROBER_FILE, data, size);
+	free(data);
+}
+
+int prober_init(void)
+{
+	prober_mutex = sceKernelCreateMutex("prober_mutex", 0, 0, NULL);
+	if (prober_mutex < 0) {
+		printf("Prober: error creating mutex\n");
+		return -1;
+	}
+
+	if (!prober_load()) {
+		printf("Prober: %i previous results\n", result_count);
+	}
+
+	return 0;
+}
+
+/**
+ * Wait for a finished check, or stop the current one
+ */
+static void prober_wait(void)
+{
+	if (prober_thread_id < 0) {
+		return;
+	}
+
+	prober_stopping = true;
+	sceKernelWaitThreadEnd(prober_thread_id, NULL, NULL);
+	sceKernelDeleteThread(prober_thread_id);
+	prober_thread_id = -1;
+	prober_stopping = false;
+
+	free(target_urls);
+	free(target_offsets);
+	target_urls = NULL;
+	target_offsets = NULL;
+}
+
+void prober_term(void)
+{
+	prober_wait();
+
+	if (prober_mutex >= 0) {
+		sceKernelDeleteMutex(prober_mutex);
+		prober_mutex = -1;
+	}
+
+	free(results);
+	results = NULL;
+	result_count = 0;
+}
+
+static audio_format prober_audio_type(const char *content_type)
+{
+	if (strcasestr(content_type, "audio/mpeg")) {
+		return AUDIO_FORMAT_MP3;
+	}
+
+	if (strcasestr(content_type, "audio/aac")) {
+		return AUDIO_FORMAT_AAC;
+	}
+
+	if (strcasestr(content_type, "audio/ogg") || strcasestr(content_type, "application/ogg")) {
+		return AUDIO_FORMAT_OGG;
+	}
+
+	return AUDIO_FORMAT_UNKNOWN;
+}
+
+static size_t prober_header_callback(char *buffer, size_t size, size_t nitems, void *userdata)
+{
+	prober_job *job = (prober_job*)userdata;
+	size_t len = size * nitems;
+
+	if (!strncasecmp(buffer, "HTTP/", 5) || !strncasecmp(buffer, "ICY ", 4)) {
+		// Status line of a new response (the first one or after a redirect)
+		const char *code = (const char*)memchr(buffer, ' ', len);
+		resolver_probe_reset(&job->probe);
+		job->probe.status_code = code ? atoi(code + 1) : 0;
+		job->result.bitrate = 0;
+	} else if (!strncasecmp(buffer, "content-type:", 13)) {
+		snprintf(job->probe.content_type, sizeof(job->probe.content_type), "%.*s", (int)len - 13, buffer + 13);
+	} else if (!strncasecmp(buffer, "icy-br:", 7)) {
+		// Sometimes a list, like "128,128"
+		job->result.bitrate = atoi(buffer + 7);
+	}
+
+	return len;
+}
+
+static size_t prober_write_callback(char *data, size_t size, size_t nmemb, void *userdata)
+{
+	prober_job *job = (prober_job*)userdata;
+	size_t length = size * nmemb;
+
+	if (!job->body_started) {
+		job->body_started = true;
+
+		char *effective_url = NULL;
+		curl_easy_getinfo(job->curl, CURLINFO_EFFECTIVE_URL, &effective_url);
+		job->probe.type = resolver_detect_playlist(job->probe.content_type, effective_url);
+		if (job->probe.type == RESOLVER_PLAYLIST_NONE) {
+			job->result.first_byte_ms = (uint32_t)((sceKernelGetProcessTimeWide() - job->start) / 1000);
+			job->result.audio_type = prober_audio_type(job->probe.content_type);
+		}
+	}
+
+	if (job->probe.type != RESOLVER_PLAYLIST_NONE) {
+		resolver_probe_append(&job->probe, data, length);
+		return length;
+	}
+
+	job->audio_bytes += length;
+
+	// Enough to know the stream plays, stop it there
+	return job->audio_bytes >= PROBER_AUDIO_BYTES ? 0 : length;
+}
+
+static void prober_job_connect(prober_job *job, CURLM *multi)
+{
+	job->body_started = false;
+	job->audio_bytes = 0;
+	resolver_probe_reset(&job->probe);
+
+	curl_easy_setopt(job->curl, CURLOPT_URL, job->url);
+	curl_multi_add_handle(multi, job->curl);
+}
+
+static void prober_job_start(prober_job *job, CURLM *multi, int target)
+{
+	const char *url = target_urls + target_offsets[target];
+
+	job->target = target;
+	job->depth = 0;
+	job->start = sceKernelGetProcessTimeWide();
+	memset(&job->result, 0, sizeof(prober_result));
+	job->result.hash = Utils_Hash(url);
+	snprintf(job->url, sizeof(job->url), "%s", url);
+
+	prober_job_connect(job, multi);
+}
+
+/**
+ * @return true if the job continues with the stream behind a playlist wrapper
+ */
+static bool prober_job_done(prober_job *job, CURLM *multi, CURLcode res)
+{
+	curl_multi_remove_handle(multi, job->curl);
+
+	double connect_time = 0.0;
+	curl_easy_getinfo(job->curl, CURLINFO_CONNECT_TIME, &connect_time);
+	job->result.connect_ms = (uint32_t)(connect_time * 1000.0);
+
+	if (res == CURLE_OK && job->probe.type != RESOLVER_PLAYLIST_NONE && job->depth < RESOLVER_MAX_DEPTH) {
+		char *effective_url = NULL;
+		curl_easy_getinfo(job->curl, CURLINFO_EFFECTIVE_URL, &effective_url);
+
+		char base_url[RESOLVER_URL_MAX];
+		snprintf(base_url, sizeof(base_url), "%s", effective_url ? effective_url : job->url);
+		if (!resolver_probe_next_url(&job->probe, base_url, job->url, sizeof(job->url))) {
+			job->depth++;
+			prober_job_connect(job, multi);
+			return true;
+		}
+	}
+
+	// The write callback stops the transfer once enough audio came
+	bool up = job->audio_bytes >= PROBER_AUDIO_BYTES || (res == CURLE_OK && job->audio_bytes > 0);
+	if (strcasestr(job->probe.content_type, "text/html")) {
+		// Web page of a station gone offline
+		up = false;
+	}
+	job->result.status = up ? PROBER_STATUS_UP : PROBER_STATUS_DOWN;
+	job->result.time = (uint32_t)time(NULL);
+
+	TRACE_LOCK(prober_mutex, "prober_mutex");
+	prober_result *result = prober_find(job->result.hash);
+	if (result) {
+		*result = job->result;
+	}
+	sceKernelUnlockMutex(prober_mutex, 1);
+
+	__atomic_add_fetch(&checked_count, 1, __ATOMIC_RELEASE);
+
+	return false;
+}
+
+static int prober_thread(SceSize args, void *argp)
+{
+	TRACE_THREAD("proberThread");
+
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+	prober_job *jobs = (prober_job*)calloc(PROBER_CONCURRENCY, sizeof(prober_job));
+	CURLM *multi = curl_multi_init();
+	if (!jobs || !multi) {
+		printf("Prober: error allocating jobs\n");
+		free(jobs);
+		prober_running = false;
+		return 0;
+	}
+
+	for (int i = 0; i < PROBER_CONCURRENCY; i++) {
+		prober_job *job = &jobs[i];
+		job->target = -1;
+		job->curl = curl_easy_init();
+
+		curl_easy_setopt(job->curl, CURLOPT_FOLLOWLOCATION, 1L);
+		curl_easy_setopt(job->curl, CURLOPT_MAXREDIRS, 8L);
+		curl_easy_setopt(job->curl, CURLOPT_FAILONERROR, 1L);
+		curl_easy_setopt(job->curl, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt(job->curl, CURLOPT_CONNECTTIMEOUT, (long)PROBER_CONNECT_TIMEOUT);
+		curl_easy_setopt(job->curl, CURLOPT_TIMEOUT, (long)PROBER_TIMEOUT);
+		curl_easy_setopt(job->curl, CURLOPT_USERAGENT, "VitaWebradios/2.0");
+		curl_easy_setopt(job->curl, CURLOPT_PRIVATE, job);
+
+		curl_easy_setopt(job->curl, CURLOPT_HEADERFUNCTION, prober_header_callback);
+		curl_easy_setopt(job->curl, CURLOPT_HEADERDATA, job);
+		curl_easy_setopt(job->curl, CURLOPT_WRITEFUNCTION, prober_write_callback);
+		curl_easy_setopt(job->curl, CURLOPT_WRITEDATA, job);
+
+		// HTTPS (disable checks)
+		curl_easy_setopt(job->curl, CURLOPT_SSL_VERIFYPEER, 0L);
+		curl_easy_setopt(job->curl, CURLOPT_SSL_VERIFYHOST, 0L);
+	}
+
+	int next = 0;
+	int active = 0;
+	while (!prober_stopping && (next < target_count || active > 0)) {
+		// Keep every job busy until the list is done
+		for (int i = 0; i < PROBER_CONCURRENCY && next < target_count; i++) {
+			if (jobs[i].target < 0) {
+				prober_job_start(&jobs[i], multi, next++);
+				active++;
+			}
+		}
+
+		int running_handles = 0;
+		curl_multi_perform(multi, &running_handles);
+
+		int queued = 0;
+		CURLMsg *message = NULL;
+		while ((message = curl_multi_info_read(multi, &queued))) {
+			if (message->msg != CURLMSG_DONE) {
+				continue;
+			}
+
+			prober_job *job = NULL;
+			curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char**)&job);
+			if (!prober_job_done(job, multi, message->data.result)) {
+				job->target = -1;
+				active--;
+			}
+		}
+
+		curl_multi_wait(multi, NULL, 0, 100, NULL);
+	}
+
+	for (int i = 0; i < PROBER_CONCURRENCY; i++) {
+		if (jobs[i].target >= 0) {
+			curl_multi_remove_handle(multi, jobs[i].curl);
+		}
+		curl_easy_cleanup(jobs[i].curl);
+		resolver_probe_free(&jobs[i].probe);
+	}
+	curl_multi_cleanup(multi);
+	free(jobs);
+
+	prober_save();
+
+	unsigned int elapsed = (unsigned int)(sceKernelGetProcessTimeWide() - start);
+	printf("Prober: %i of %i stations checked in %u s\n", checked_count, target_count, elapsed / 1000000);
+
+	prober_running = false;
+
+	return 0;
+}
+
+/**
+ * Check every station of the list in the background, a few at a time
+ *
+ * Previous results stay visible until their station is checked again.
+ */
+int prober_start(const playlist *list)
+{
+	if (prober_running || prober_mutex < 0) {
+		return -1;
+	}
+
+	prober_wait();
+
+	size_t urls_size = 0;
+	for (int i = 0; i < list->count; i++) {
+		urls_size += strlen(list->entries[i].url) + 1;
+	}
+
+	target_urls = (char*)malloc(urls_size ? urls_size : 1);
+	target_offsets = (uint32_t*)malloc(sizeof(uint32_t) * (list->count ? list->count : 1));
+	prober_result *merged = (prober_result*)malloc(sizeof(prober_result) * (result_count + list->count + 1));
+	if (!target_urls || !target_offsets || !merged) {
+		printf("Prober: error allocating %i stations\n", list->count);
+		free(target_urls);
+		free(target_offsets);
+		free(merged);
+		target_urls = NULL;
+		target_offsets = NULL;
+		return -1;
+	}
+
+	// Previous results, then an unknown result for every new station
+	TRACE_LOCK(prober_mutex, "prober_mutex");
+
+	memcpy(merged, results, sizeof(prober_result) * result_count);
+	int merged_count = result_count;
+	size_t offset = 0;
+	for (int i = 0; i < list->count; i++) {
+		const char *url = list->entries[i].url;
+		size_t length = strlen(url) + 1;
+		memcpy(target_urls + offset, url, length);
+		target_offsets[i] = offset;
+		offset += length;
+
+		uint64_t hash = Utils_Hash(url);
+		if (!prober_find(hash)) {
+			memset(&merged[merged_count], 0, sizeof(prober_result));
+			merged[merged_count++].hash = hash;
+		}
+	}
+
+	qsort(merged, merged_count, sizeof(prober_result), prober_compare_results);
+
+	// Stations listed twice were added twice
+	int unique_count = 0;
+	for (int i = 0; i < merged_count; i++) {
+		if (unique_count == 0 || merged[unique_count - 1].hash != merged[i].hash) {
+			merged[unique_count++] = merged[i];
+		}
+	}
+
+	free(results);
+	results = merged;
+	result_count = unique_count;
+
+	sceKernelUnlockMutex(prober_mutex, 1);
+
+	target_count = list->count;
+	checked_count = 0;
+	prober_running = true;
+
+	// Lowest priority, checks must not slow down the stream playing
+	prober_thread_id = sceKernelCreateThread("proberThread", prober_thread, 0x10000100 + 20, 0x10000, 0, 0, NULL);
+	if (prober_thread_id < 0) {
+		printf("Prober: error creating thread with id %i\n", prober_thread_id);
+		prober_thread_id = -1;
+		prober_running = false;
+		return -1;
+	}
+
+	sceKernelStartThread(prober_thread_id, 0, NULL);
+
+	return 0;
+}
+
+bool prober_is_running(void)
+{
+	return prober_running;
+}
+
+void prober_progress(int *checked, int *total)
+{
+	*checked = __atomic_load_n(&checked_count, __ATOMIC_ACQUIRE);
+	*total = target_count;
+}
+
+/**
+ * @return false if the station was never checked
+ */
+bool prober_lookup(const char *url, prober_result *result)
+{
+	if (prober_mutex < 0) {
+		return false;
+	}
+
+	TRACE_LOCK(prober_mutex, "prober_mutex");
+	const prober_result *found = prober_find(Utils_Hash(url));
+	if (found) {
+		*result = *found;
+	}
+	sceKernelUnlockMutex(prober_mutex, 1);
+
+	return found && found->status != PROBER_STATUS_UNKNOWN;
+}
+
+struct prober_rank_item {
+	int index;
+	uint32_t key;
+};
+
+static int prober_compare_rank(const void *a, const void *b)
+{
+	const prober_rank_item *item_a = (const prober_rank_item*)a;
+	const prober_rank_item *item_b = (const prober_rank_item*)b;
+
+	if (item_a->key != item_b->key) {
+		return item_a->key < item_b->key ? -1 : 1;
+	}
+
+	// Playlist order between equals
+	return item_a->index - item_b->index;
+}
+
+/**
+ * Drop the stations found down and sort the others by time to first audio byte
+ *
+ * Unchecked stations come after the ones found up, the ones found down last.
+ * @param indexes are the stations to rank, NULL for the whole list
+ * @param ranked receives the kept indexes, room for count of them
+ * @return the number of indexes in ranked
+ */
+int prober_rank(const playlist *list, const int *indexes, int count, bool hide_down, bool fastest_first, int *ranked)
+{
+	prober_rank_item *items = (prober_rank_item*)malloc(sizeof(prober_rank_item) * (count ? count : 1));
+	if (!items) {
+		printf("Prober: error allocating %i ranks\n", count);
+		return -1;
+	}
+
+	int kept = 0;
+	for (int i = 0; i < count; i++) {
+		int index = indexes ? indexes[i] : i;
+		prober_result result;
+		prober_rank_item *item = &items[kept];
+		item->index = index;
+		item->key = 0xFFFFFFFE;
+
+		if (prober_lookup(list->entries[index].url, &result)) {
+			if (result.status == PROBER_STATUS_DOWN) {
+				if (hide_down) {
+					continue;
+				}
+				item->key = 0xFFFFFFFF;
+			} else {
+				item->key = result.first_byte_ms;
+			}
+		}
+
+		kept++;
+	}
+
+	if (fastest_first) {
+		qsort(items, kept, sizeof(prober_rank_item), prober_compare_rank);
+	}
+
+	for (int i = 0; i < kept; i++) {
+		ranked[i] = items[i].index;
+	}
+
+	free(items);
+
+	return kept;
+}
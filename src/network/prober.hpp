@@ -0,0 +1,44 @@
+#ifndef __PROBER_HPP__
+#define __PROBER_HPP__
+
+#include <stdint.h>
+
+#include "../playlist/playlist.hpp"
+
+#define PROBER_FILE "ux0:/data/webradio/probe.dat"
+#define PROBER_MAGIC 0x42525057 // "WPRB"
+#define PROBER_VERSION 1
+#define PROBER_CONCURRENCY 8 // stations checked at once
+#define PROBER_CONNECT_TIMEOUT 5 // seconds
+#define PROBER_TIMEOUT 10 // seconds for a whole check, playlist wrappers included
+#define PROBER_AUDIO_BYTES 4096 // audio received before a station counts as up
+#define PROBER_SLOW_MS 2000 // first audio byte later than this is shown as slow
+
+enum prober_status {
+	PROBER_STATUS_UNKNOWN,
+	PROBER_STATUS_UP,
+	PROBER_STATUS_DOWN,
+};
+
+/**
+ * Last check of a station, found by a hash of its URL so results survive playlist edits
+ */
+struct prober_result {
+	uint64_t hash;
+	uint32_t time; // seconds since the epoch
+	uint32_t connect_ms;
+	uint32_t first_byte_ms; // first audio byte, wrappers and redirects included
+	uint16_t bitrate; // kbps, from icy-br, 0 if unknown
+	uint8_t status;
+	uint8_t audio_type; // audio_format guessed from the content type
+};
+
+int prober_init(void);
+void prober_term(void);
+int prober_start(const playlist *list);
+bool prober_is_running(void);
+void prober_progress(int *checked, int *total);
+bool prober_lookup(const char *url, prober_result *result);
+int prober_rank(const playlist *list, const int *indexes, int count, bool hide_down, bool fastest_first, int *ranked);
+
+#endif
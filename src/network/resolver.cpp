@@ -0,0 +1,307 @@
+#include "resolver.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/processmgr.h>
+
+extern "C" {
+	#include "../m3u_parser/m3u_tokenizer.h"
+	#include "../pls_parser/pls_tokenizer.h"
+}
+
+#define printf sceClibPrintf
+
+struct resolver_cache_entry {
+	char url[RESOLVER_URL_MAX];
+	char resolved[RESOLVER_URL_MAX];
+	SceInt64 expires;
+};
+
+// Only used from the network thread, no locking needed
+static resolver_cache_entry resolver_cache[RESOLVER_CACHE_SIZE];
+
+static resolver_cache_entry *resolver_cache_find(const char *url)
+{
+	for (int i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+		if (resolver_cache[i].expires && !strcmp(resolver_cache[i].url, url)) {
+			return &resolver_cache[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Get the final stream URL of a station if it has been resolved recently
+ *
+ * @return true if resolved has been filled with a cached URL
+ */
+bool resolver_lookup(const char *url, char *resolved, size_t resolved_size)
+{
+	if (!url) {
+		return false;
+	}
+
+	resolver_cache_entry *entry = resolver_cache_find(url);
+	if (!entry) {
+		return false;
+	}
+
+	if (entry->expires < sceKernelGetProcessTimeWide()) {
+		printf("Resolver: cache expired for %s\n", url);
+		entry->expires = 0;
+		return false;
+	}
+
+	strncpy(resolved, entry->resolved, resolved_size - 1);
+	resolved[resolved_size - 1] = '\0';
+	return true;
+}
+
+void resolver_store(const char *url, const char *resolved)
+{
+	if (!url || !resolved || strlen(url) >= RESOLVER_URL_MAX || strlen(resolved) >= RESOLVER_URL_MAX) {
+		return;
+	}
+
+	resolver_cache_entry *entry = resolver_cache_find(url);
+	if (entry && !strcmp(entry->resolved, resolved)) {
+		// Same endpoint, keep the original expiration so it gets checked again
+		return;
+	}
+
+	if (!entry) {
+		// Reuse a free slot or evict the entry closest to expiration
+		entry = &resolver_cache[0];
+		for (int i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+			if (resolver_cache[i].expires < entry->expires) {
+				entry = &resolver_cache[i];
+			}
+		}
+	}
+
+	strcpy(entry->url, url);
+	strcpy(entry->resolved, resolved);
+	entry->expires = sceKernelGetProcessTimeWide() + RESOLVER_CACHE_TTL;
+
+	printf("Resolver: %s -> %s\n", url, resolved);
+}
+
+void resolver_forget(const char *url)
+{
+	if (!url) {
+		return;
+	}
+
+	resolver_cache_entry *entry = resolver_cache_find(url);
+	if (entry) {
+		entry->expires = 0;
+	}
+}
+
+static bool url_has_extension(const char *url, const char *extension)
+{
+	size_t length = strcspn(url, "?#");
+	size_t extension_length = strlen(extension);
+
+	return length > extension_length && !strncasecmp(url + length - extension_length, extension, extension_length);
+}
+
+/**
+ * Tell if a response is a playlist wrapper instead of audio data
+ *
+ * @param content_type is the value of the Content-Type header, can be NULL
+ * @param url is the effective URL of the response, can be NULL
+ */
+resolver_playlist_type resolver_detect_playlist(const char *content_type, const char *url)
+{
+	if (content_type && content_type[0]) {
+		if (strcasestr(content_type, "mpegurl")) {
+			// audio/x-mpegurl, audio/mpegurl, application/vnd.apple.mpegurl...
+			return RESOLVER_PLAYLIST_M3U;
+		}
+
+		if (strcasestr(content_type, "scpls")) {
+			return RESOLVER_PLAYLIST_PLS;
+		}
+
+		if (strcasestr(content_type, "audio/")) {
+			return RESOLVER_PLAYLIST_NONE;
+		}
+	}
+
+	// Unknown or generic content type, rely on the file extension
+	if (url) {
+		if (url_has_extension(url, ".m3u") || url_has_extension(url, ".m3u8")) {
+			return RESOLVER_PLAYLIST_M3U;
+		}
+
+		if (url_has_extension(url, ".pls")) {
+			return RESOLVER_PLAYLIST_PLS;
+		}
+	}
+
+	return RESOLVER_PLAYLIST_NONE;
+}
+
+void resolver_probe_reset(resolver_probe *probe)
+{
+	probe->status_code = 0;
+	probe->content_type[0] = '\0';
+	probe->type = RESOLVER_PLAYLIST_NONE;
+	probe->body_size = 0;
+}
+
+void resolver_probe_free(resolver_probe *probe)
+{
+	if (probe->body) {
+		free(probe->body);
+		probe->body = NULL;
+	}
+
+	resolver_probe_reset(probe);
+}
+
+/**
+ * Keep the body of a playlist wrapper
+ *
+ * @return the number of bytes consumed, less than size if the wrapper is too big
+ */
+size_t resolver_probe_append(resolver_probe *probe, const void *data, size_t size)
+{
+	if (!probe->body) {
+		probe->body = (char*)malloc(RESOLVER_BODY_MAX);
+		if (!probe->body) {
+			printf("Resolver: error allocating playlist body\n");
+			return 0;
+		}
+	}
+
+	if (probe->body_size + size > RESOLVER_BODY_MAX) {
+		printf("Resolver: playlist bigger than %i bytes, truncating\n", RESOLVER_BODY_MAX);
+		size = RESOLVER_BODY_MAX - probe->body_size;
+	}
+
+	memcpy(probe->body + probe->body_size, data, size);
+	probe->body_size += size;
+
+	return size;
+}
+
+/**
+ * Resolve a playlist entry which may be relative to the playlist URL
+ */
+static void resolver_join_url(const char *base_url, const char *url, char *out, size_t out_size)
+{
+	const char *scheme_end = strstr(base_url, "://");
+
+	if (strstr(url, "://") || !scheme_end) {
+		snprintf(out, out_size, "%s", url);
+		return;
+	}
+
+	if (url[0] == '/' && url[1] == '/') {
+		// Scheme relative
+		snprintf(out, out_size, "%.*s:%s", (int)(scheme_end - base_url), base_url, url);
+		return;
+	}
+
+	const char *host = scheme_end + 3;
+	const char *path = host + strcspn(host, "/?#");
+
+	if (url[0] == '/') {
+		// Host relative
+		snprintf(out, out_size, "%.*s%s", (int)(path - base_url), base_url, url);
+		return;
+	}
+
+	// Relative to the directory of the playlist
+	const char *directory_end = path;
+	const char *path_end = path + strcspn(path, "?#");
+	for (const char *c = path; c < path_end; c++) {
+		if (*c == '/') {
+			directory_end = c;
+		}
+	}
+
+	snprintf(out, out_size, "%.*s/%s", (int)(directory_end - base_url), base_url, url);
+}
+
+// First entry of a playlist wrapper, filled by the tokenizer callback
+struct resolver_first_entry {
+	const char *base_url;
+	char *url;
+	size_t url_size;
+	bool found;
+};
+
+static void resolver_on_item(void *user, const m3u_item *item)
+{
+	resolver_first_entry *first = (resolver_first_entry*)user;
+	if (first->found || item->url.length == 0) {
+		return;
+	}
+
+	char url[RESOLVER_URL_MAX];
+	snprintf(url, sizeof(url), "%.*s", (int)item->url.length, item->url.data);
+	resolver_join_url(first->base_url, url, first->url, first->url_size);
+	first->found = true;
+}
+
+/**
+ * Parse the playlist wrapper kept by the probe and extract the first stream URL
+ *
+ * @param base_url is the effective URL of the playlist, used for relative entries
+ * @return 0 if next_url has been filled
+ */
+int resolver_probe_next_url(resolver_probe *probe, const char *base_url, char *next_url, size_t next_url_size)
+{
+	if (probe->type == RESOLVER_PLAYLIST_NONE || !probe->body || probe->body_size == 0) {
+		return -1;
+	}
+
+	resolver_first_entry first = { base_url, next_url, next_url_size, false };
+	m3u_tokenizer_callbacks callbacks = { resolver_on_item, NULL, NULL, NULL };
+	int ret = 0;
+	if (probe->type == RESOLVER_PLAYLIST_PLS) {
+		pls_tokenizer tokenizer;
+		pls_tokenizer_init(&tokenizer, &callbacks, &first);
+		if (pls_tokenizer_feed(&tokenizer, probe->body, probe->body_size) || pls_tokenizer_finish(&tokenizer)) {
+			ret = -1;
+		}
+		pls_tokenizer_free(&tokenizer);
+	} else {
+		// HLS media playlists list short segments, not a continuous stream
+		const char *body_end = probe->body + probe->body_size;
+		for (const char *c = probe->body; c + 21 <= body_end; c++) {
+			if (*c == '#' && !strncmp(c, "#EXT-X-TARGETDURATION", 21)) {
+				printf("Resolver: HLS segmented streams are not supported\n");
+				return -1;
+			}
+		}
+
+		m3u_tokenizer tokenizer;
+		m3u_tokenizer_init(&tokenizer, &callbacks, &first);
+		if (m3u_tokenizer_feed(&tokenizer, probe->body, probe->body_size) || m3u_tokenizer_finish(&tokenizer)) {
+			ret = -1;
+		}
+		m3u_tokenizer_free(&tokenizer);
+	}
+
+	if (ret) {
+		printf("Resolver: error parsing playlist\n");
+		return -1;
+	}
+
+	if (!first.found) {
+		printf("Resolver: playlist without entry\n");
+		return -1;
+	}
+
+	printf("Resolver: playlist entry %s\n", next_url);
+	return 0;
+}
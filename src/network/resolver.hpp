@@ -0,0 +1,41 @@
+#ifndef __RESOLVER_HPP__
+#define __RESOLVER_HPP__
+
+#include <stddef.h>
+
+#define RESOLVER_URL_MAX 1024
+#define RESOLVER_MAX_DEPTH 4 // nested playlists followed before giving up
+#define RESOLVER_BODY_MAX (64 * 1024) // playlist wrappers are small, never buffer more
+#define RESOLVER_CACHE_SIZE 16
+#define RESOLVER_CACHE_TTL (10 * 60 * 1000 * 1000LL) // 10 minutes in microseconds
+
+enum resolver_playlist_type {
+	RESOLVER_PLAYLIST_NONE,
+	RESOLVER_PLAYLIST_M3U,
+	RESOLVER_PLAYLIST_PLS,
+};
+
+/**
+ * State of one connection attempt: HTTP status and content type of the
+ * current response, and the playlist body if the response is a wrapper
+ */
+struct resolver_probe {
+	int status_code;
+	char content_type[64];
+	resolver_playlist_type type;
+	char *body;
+	size_t body_size;
+};
+
+bool resolver_lookup(const char *url, char *resolved, size_t resolved_size);
+void resolver_store(const char *url, const char *resolved);
+void resolver_forget(const char *url);
+
+resolver_playlist_type resolver_detect_playlist(const char *content_type, const char *url);
+
+void resolver_probe_reset(resolver_probe *probe);
+void resolver_probe_free(resolver_probe *probe);
+size_t resolver_probe_append(resolver_probe *probe, const void *data, size_t size);
+int resolver_probe_next_url(resolver_probe *probe, const char *base_url, char *next_url, size_t next_url_size);
+
+#endif
@@ -0,0 +1,693 @@
+#include "playlist.hpp"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/processmgr.h>
+
+extern "C" {
+	#include "../audio/audio.h"
+	#include "../m3u_parser/m3u_tokenizer.h"
+}
+
+#define printf sceClibPrintf
+
+struct playlist_block {
+	playlist_block *next;
+	size_t used;
+	size_t size;
+	// data follows
+};
+
+static char *playlist_arena_alloc(playlist *list, size_t size)
+{
+	playlist_block *block = list->blocks;
+
+	if (!block || block->size - block->used < size) {
+		size_t block_size = size > PLAYLIST_BLOCK_SIZE ? size : PLAYLIST_BLOCK_SIZE;
+		playlist_block *new_block = (playlist_block*)malloc(sizeof(playlist_block) + block_size);
+		if (!new_block) {
+			printf("Playlist: error allocating %u bytes\n", block_size);
+			return NULL;
+		}
+
+		new_block->used = 0;
+		new_block->size = block_size;
+		list->arena_size += block_size;
+
+		if (block && size > PLAYLIST_BLOCK_SIZE) {
+			// Oversized string, keep filling the current block afterwards
+			new_block->next = block->next;
+			block->next = new_block;
+		} else {
+			new_block->next = block;
+			list->blocks = new_block;
+		}
+
+		block = new_block;
+	}
+
+	char *data = (char*)(block + 1) + block->used;
+	block->used += size;
+
+	return data;
+}
+
+/**
+ * Copy a string into the arena, it stays valid until playlist_free
+ *
+ * @param str does not need to be NUL terminated
+ * @return NULL if str is empty or on allocation error
+ */
+const char *playlist_copy_string(playlist *list, const char *str, size_t length)
+{
+	if (!str || length == 0) {
+		return NULL;
+	}
+
+	char *copy = playlist_arena_alloc(list, length + 1);
+	if (!copy) {
+		return NULL;
+	}
+
+	memcpy(copy, str, length);
+	copy[length] = '\0';
+
+	return copy;
+}
+
+void playlist_init(playlist *list)
+{
+	memset(list, 0, sizeof(playlist));
+}
+
+void playlist_free(playlist *list)
+{
+	unsigned int generation = list->generation;
+
+	playlist_block *block = list->blocks;
+	while (block) {
+		playlist_block *next = block->next;
+		free(block);
+		block = next;
+	}
+
+	free(list->entries);
+	free(list->groups);
+	free(list->group_slots);
+	playlist_init(list);
+
+	// Indexes built on the previous entries must not match the next ones
+	list->generation = generation + 1;
+}
+
+static uint32_t playlist_hash(const char *str, size_t length)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+static int playlist_build_group_slots(playlist *list, int slot_count)
+{
+	int *slots = (int*)malloc(sizeof(int) * slot_count);
+	if (!slots) {
+		printf("Playlist: error allocating group table\n");
+		return -1;
+	}
+
+	memset(slots, 0xFF, sizeof(int) * slot_count);
+	for (int group = 0; group < list->group_count; group++) {
+		uint32_t slot = playlist_hash(list->groups[group], strlen(list->groups[group])) & (slot_count - 1);
+		while (slots[slot] >= 0) {
+			slot = (slot + 1) & (slot_count - 1);
+		}
+		slots[slot] = group;
+	}
+
+	free(list->group_slots);
+	list->group_slots = slots;
+	list->group_slot_count = slot_count;
+
+	return 0;
+}
+
+/**
+ * Rebuild the lookup table after groups have been filled directly
+ */
+int playlist_index_groups(playlist *list)
+{
+	int slot_count = 64;
+	while (slot_count < list->group_count * 2) {
+		slot_count *= 2;
+	}
+
+	return playlist_build_group_slots(list, slot_count);
+}
+
+/**
+ * Find or add a group name
+ *
+ * @param group does not need to be NUL terminated
+ * @return the group index, PLAYLIST_NO_GROUP for an empty name or on allocation error
+ */
+int playlist_intern_group(playlist *list, const char *group, size_t length)
+{
+	if (!group || length == 0) {
+		return PLAYLIST_NO_GROUP;
+	}
+
+	// Keep the table at most half full
+	if ((list->group_count + 1) * 2 > list->group_slot_count
+		&& playlist_build_group_slots(list, list->group_slot_count ? list->group_slot_count * 2 : 64)) {
+		return PLAYLIST_NO_GROUP;
+	}
+
+	uint32_t slot = playlist_hash(group, length) & (list->group_slot_count - 1);
+	while (list->group_slots[slot] >= 0) {
+		const char *name = list->groups[list->group_slots[slot]];
+		if (!strncmp(name, group, length) && name[length] == '\0') {
+			return list->group_slots[slot];
+		}
+		slot = (slot + 1) & (list->group_slot_count - 1);
+	}
+
+	if (list->group_count == list->group_capacity) {
+		int capacity = list->group_capacity ? list->group_capacity * 2 : 16;
+		const char **groups = (const char**)realloc(list->groups, sizeof(const char*) * capacity);
+		if (!groups) {
+			printf("Playlist: error allocating groups\n");
+			return PLAYLIST_NO_GROUP;
+		}
+		list->groups = groups;
+		list->group_capacity = capacity;
+	}
+
+	const char *name = playlist_copy_string(list, group, length);
+	if (!name) {
+		return PLAYLIST_NO_GROUP;
+	}
+
+	list->groups[list->group_count] = name;
+	list->group_slots[slot] = list->group_count;
+
+	return list->group_count++;
+}
+
+static int playlist_append(playlist *list, const char *url, size_t url_length, const char *title, size_t title_length,
+	const char *logo_url, size_t logo_url_length, const char *group, size_t group_length)
+{
+	if (!url || url_length == 0) {
+		return -1;
+	}
+
+	if (list->count == list->capacity) {
+		int capacity = list->capacity ? list->capacity * 2 : 64;
+		playlist_entry *entries = (playlist_entry*)realloc(list->entries, sizeof(playlist_entry) * capacity);
+		if (!entries) {
+			printf("Playlist: error allocating %i entries\n", capacity);
+			return -1;
+		}
+		list->entries = entries;
+		list->capacity = capacity;
+	}
+
+	playlist_entry *entry = &list->entries[list->count];
+	entry->url = playlist_copy_string(list, url, url_length);
+	if (!entry->url) {
+		return -1;
+	}
+
+	entry->title = playlist_copy_string(list, title, title_length);
+	entry->logo_url = playlist_copy_string(list, logo_url, logo_url_length);
+	entry->group = playlist_intern_group(list, group, group_length);
+	entry->tags = NULL;
+	entry->bitrate = 0;
+	entry->codec = AUDIO_FORMAT_UNKNOWN;
+
+	return list->count++;
+}
+
+/**
+ * Append a station, strings are copied
+ *
+ * @return the index of the new entry, -1 on error
+ */
+int playlist_add(playlist *list, const char *url, const char *title, const char *logo_url, const char *group)
+{
+	return playlist_append(list, url, url ? strlen(url) : 0, title, title ? strlen(title) : 0,
+		logo_url, logo_url ? strlen(logo_url) : 0, group, group ? strlen(group) : 0);
+}
+
+static bool playlist_span_starts_with(m3u_span span, const char *prefix)
+{
+	size_t length = strlen(prefix);
+	return span.length >= length && !strncasecmp(span.data, prefix, length);
+}
+
+/**
+ * Guess the audio format from a codec name given by a playlist
+ */
+static unsigned char playlist_codec(m3u_span codec)
+{
+	if (playlist_span_starts_with(codec, "MP3") || playlist_span_starts_with(codec, "MPEG")) {
+		return AUDIO_FORMAT_MP3;
+	} else if (playlist_span_starts_with(codec, "AAC")) {
+		// AAC+ and AACP included
+		return AUDIO_FORMAT_AAC;
+	} else if (playlist_span_starts_with(codec, "OGG") || playlist_span_starts_with(codec, "VORBIS")) {
+		return AUDIO_FORMAT_OGG;
+	}
+
+	return AUDIO_FORMAT_UNKNOWN;
+}
+
+static unsigned short playlist_bitrate(m3u_span bitrate)
+{
+	unsigned int kbps = 0;
+	for (size_t i = 0; i < bitrate.length && bitrate.data[i] >= '0' && bitrate.data[i] <= '9'; i++) {
+		kbps = kbps * 10 + (bitrate.data[i] - '0');
+		if (kbps > 0xFFFF) {
+			return 0;
+		}
+	}
+
+	return kbps;
+}
+
+static bool playlist_is_control(char c)
+{
+	return (unsigned char)c < 0x20 || c == 0x7F;
+}
+
+/**
+ * Replace control characters of an imported field by spaces, a CR or LF would split its m3u line
+ *
+ * Clean fields are returned as is, others are copied to the arena first.
+ */
+static m3u_span playlist_clean_span(playlist *list, m3u_span span)
+{
+	size_t i = 0;
+	while (i < span.length && !playlist_is_control(span.data[i])) {
+		i++;
+	}
+
+	if (i == span.length) {
+		return span;
+	}
+
+	char *copy = (char*)playlist_copy_string(list, span.data, span.length);
+	if (!copy) {
+		span.length = 0;
+		return span;
+	}
+
+	for (; i < span.length; i++) {
+		if (playlist_is_control(copy[i])) {
+			copy[i] = ' ';
+		}
+	}
+
+	span.data = copy;
+	return span;
+}
+
+/**
+ * Append a station parsed by one of the tokenizers, format hints included
+ *
+ * @return the index of the new entry, -1 on error
+ */
+int playlist_add_item(playlist *list, const m3u_item *item)
+{
+	m3u_span url = playlist_clean_span(list, item->url);
+	// tvg-name is the only name of some IPTV style entries
+	m3u_span title = playlist_clean_span(list, item->title.length ? item->title : item->tvg_name);
+	m3u_span logo_url = playlist_clean_span(list, item->tvg_logo);
+	m3u_span group = playlist_clean_span(list, item->group_title);
+	m3u_span tags = playlist_clean_span(list, item->tags);
+
+	int index = playlist_append(list, url.data, url.length, title.data, title.length,
+		logo_url.data, logo_url.length, group.data, group.length);
+	if (index < 0) {
+		return -1;
+	}
+
+	playlist_entry *entry = &list->entries[index];
+	entry->tags = playlist_copy_string(list, tags.data, tags.length);
+	entry->bitrate = playlist_bitrate(item->bitrate);
+	entry->codec = playlist_codec(item->codec);
+
+	return index;
+}
+
+/**
+ * Replace the fields of a station, previous strings stay in the arena until playlist_free
+ *
+ * Format hints are dropped when the URL changes, they described the previous stream.
+ */
+int playlist_set(playlist *list, int index, const char *url, const char *title, const char *logo_url, const char *group)
+{
+	if (index < 0 || index >= list->count || !url || !url[0]) {
+		return -1;
+	}
+
+	const char *url_copy = playlist_copy_string(list, url, strlen(url));
+	if (!url_copy) {
+		return -1;
+	}
+
+	playlist_entry *entry = &list->entries[index];
+	if (strcmp(entry->url, url_copy)) {
+		entry->bitrate = 0;
+		entry->codec = AUDIO_FORMAT_UNKNOWN;
+	}
+
+	entry->url = url_copy;
+	entry->title = title ? playlist_copy_string(list, title, strlen(title)) : NULL;
+	entry->logo_url = logo_url ? playlist_copy_string(list, logo_url, strlen(logo_url)) : NULL;
+	entry->group = group ? playlist_intern_group(list, group, strlen(group)) : PLAYLIST_NO_GROUP;
+	list->generation++;
+
+	return 0;
+}
+
+int playlist_remove(playlist *list, int index)
+{
+	if (index < 0 || index >= list->count) {
+		return -1;
+	}
+
+	memmove(&list->entries[index], &list->entries[index + 1], sizeof(playlist_entry) * (list->count - index - 1));
+	list->count--;
+	list->generation++;
+
+	return 0;
+}
+
+/**
+ * Move a station, the ones between both positions shift by one
+ */
+int playlist_move(playlist *list, int from, int to)
+{
+	if (from < 0 || from >= list->count || to < 0 || to >= list->count) {
+		return -1;
+	}
+
+	playlist_entry entry = list->entries[from];
+	if (from < to) {
+		memmove(&list->entries[from], &list->entries[from + 1], sizeof(playlist_entry) * (to - from));
+	} else {
+		memmove(&list->entries[to + 1], &list->entries[to], sizeof(playlist_entry) * (from - to));
+	}
+	list->entries[to] = entry;
+	list->generation++;
+
+	return 0;
+}
+
+/**
+ * Find a station by URL, searching from a likely index first
+ *
+ * @return the index of the station, -1 if not found
+ */
+int playlist_find(const playlist *list, const char *url, int hint)
+{
+	if (hint >= 0 && hint < list->count && !strcmp(list->entries[hint].url, url)) {
+		return hint;
+	}
+
+	for (int i = 0; i < list->count; i++) {
+		if (!strcmp(list->entries[i].url, url)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Bytes held by the playlist, arena blocks included
+ */
+size_t playlist_memory_used(const playlist *list)
+{
+	return list->arena_size
+		+ sizeof(playlist_entry) * list->capacity
+		+ sizeof(const char*) * list->group_capacity
+		+ sizeof(int) * list->group_slot_count;
+}
+
+static void playlist_on_item(void *user, const struct m3u_item *item)
+{
+	playlist_add_item((playlist*)user, item);
+}
+
+static void playlist_on_name(void *user, m3u_span name)
+{
+	playlist *list = (playlist*)user;
+	if (!list->name) {
+		list->name = (char*)playlist_copy_string(list, name.data, name.length);
+	}
+}
+
+static void playlist_on_directive(void *user, m3u_span line)
+{
+	playlist *list = (playlist*)user;
+	size_t prefix_length = sizeof(PLAYLIST_JOURNAL_DIRECTIVE) - 1;
+
+	if (line.length > prefix_length && line.length < prefix_length + 16 && !strncmp(line.data, PLAYLIST_JOURNAL_DIRECTIVE, prefix_length)) {
+		char sequence[16];
+		memcpy(sequence, line.data + prefix_length, line.length - prefix_length);
+		sequence[line.length - prefix_length] = '\0';
+		list->journal_sequence = strtoul(sequence, NULL, 10);
+	}
+}
+
+/**
+ * Replace the content of the list with a m3u file, read by chunks
+ */
+int playlist_load_m3u(playlist *list, const char *path)
+{
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+
+	SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+	if (fd < 0) {
+		printf("Playlist: cannot open %s (0x%X)\n", path, fd);
+		return -1;
+	}
+
+	char *chunk = (char*)malloc(PLAYLIST_READ_SIZE);
+	if (!chunk) {
+		printf("Playlist: error allocating read buffer\n");
+		sceIoClose(fd);
+		return -1;
+	}
+
+	playlist_free(list);
+
+	m3u_tokenizer_callbacks callbacks = { playlist_on_item, playlist_on_name, NULL, playlist_on_directive };
+	m3u_tokenizer tokenizer;
+	m3u_tokenizer_init(&tokenizer, &callbacks, list);
+
+	int ret = 0;
+	int size = 0;
+	while (!ret && (size = sceIoRead(fd, chunk, PLAYLIST_READ_SIZE)) > 0) {
+		ret = m3u_tokenizer_feed(&tokenizer, chunk, size);
+	}
+
+	if (size < 0) {
+		printf("Playlist: read error 0x%X\n", size);
+		ret = -1;
+	} else if (!ret) {
+		ret = m3u_tokenizer_finish(&tokenizer);
+	}
+
+	unsigned int elapsed = (unsigned int)(sceKernelGetProcessTimeWide() - start);
+	printf("Playlist: %i stations, %i groups, %i malformed lines in %u KB\n", list->count, list->group_count, tokenizer.errors, tokenizer.bytes / 1024);
+	printf("Playlist: parsed in %u ms (%u KB/s), %u KB in memory\n", elapsed / 1000,
+		elapsed ? (unsigned int)((unsigned long long)tokenizer.bytes * 1000000 / 1024 / elapsed) : 0, playlist_memory_used(list) / 1024);
+
+	m3u_tokenizer_free(&tokenizer);
+	free(chunk);
+	sceIoClose(fd);
+
+	return ret;
+}
+
+struct playlist_text {
+	char *data;
+	size_t size;
+	size_t capacity;
+};
+
+static int playlist_text_append(playlist_text *text, const char *str, size_t length)
+{
+	if (length == 0) {
+		return 0;
+	}
+
+	if (text->size + length > text->capacity) {
+		size_t capacity = text->capacity ? text->capacity : PLAYLIST_READ_SIZE;
+		while (capacity < text->size + length) {
+			capacity *= 2;
+		}
+
+		char *data = (char*)realloc(text->data, capacity);
+		if (!data) {
+			return -1;
+		}
+		text->data = data;
+		text->capacity = capacity;
+	}
+
+	memcpy(text->data + text->size, str, length);
+	text->size += length;
+
+	return 0;
+}
+
+static int playlist_text_print(playlist_text *text, const char *prefix, const char *str, const char *suffix)
+{
+	return playlist_text_append(text, prefix, strlen(prefix))
+		|| playlist_text_append(text, str, strlen(str))
+		|| playlist_text_append(text, suffix, strlen(suffix));
+}
+
+/**
+ * Write ` name="value"`, m3u has no escaping so double quotes of the value become single quotes
+ */
+static int playlist_text_print_attribute(playlist_text *text, const char *name, const char *value)
+{
+	int ret = playlist_text_print(text, " ", name, "=\"");
+	while (!ret && *value) {
+		size_t length = strcspn(value, "\"");
+		ret = playlist_text_append(text, value, length);
+		value += length;
+		if (!ret && *value) {
+			ret = playlist_text_append(text, "'", 1);
+			value++;
+		}
+	}
+
+	return ret || playlist_text_append(text, "\"", 1);
+}
+
+/**
+ * Write the list as m3u text in memory
+ *
+ * @return the text to free, NULL on error
+ */
+char *playlist_format_m3u(const playlist *list, size_t *size)
+{
+	playlist_text text = { NULL, 0, 0 };
+	int ret = playlist_text_print(&text, "", "#EXTM3U", "\n");
+
+	if (!ret && list->name) {
+		ret = playlist_text_print(&text, "#PLAYLIST:", list->name, "\n");
+	}
+
+	if (!ret && list->journal_sequence) {
+		// Journal records up to this one are already in the file
+		char sequence[16];
+		snprintf(sequence, sizeof(sequence), "%u", list->journal_sequence);
+		ret = playlist_text_print(&text, PLAYLIST_JOURNAL_DIRECTIVE, sequence, "\n");
+	}
+
+	for (int i = 0; i < list->count && !ret; i++) {
+		const playlist_entry *entry = &list->entries[i];
+
+		if (entry->title || entry->logo_url || entry->group != PLAYLIST_NO_GROUP || entry->tags || entry->bitrate || entry->codec) {
+			ret = playlist_text_print(&text, "", "#EXTINF:-1", "");
+			if (!ret && entry->logo_url) {
+				ret = playlist_text_print_attribute(&text, "tvg-logo", entry->logo_url);
+			}
+			if (!ret && entry->group != PLAYLIST_NO_GROUP) {
+				ret = playlist_text_print_attribute(&text, "group-title", list->groups[entry->group]);
+			}
+			if (!ret && entry->codec != AUDIO_FORMAT_UNKNOWN) {
+				ret = playlist_text_print_attribute(&text, M3U_ATTRIBUTE_CODEC, AudioFormatToString((audio_format)entry->codec));
+			}
+			if (!ret && entry->bitrate) {
+				char bitrate[8];
+				snprintf(bitrate, sizeof(bitrate), "%u", entry->bitrate);
+				ret = playlist_text_print_attribute(&text, M3U_ATTRIBUTE_BITRATE, bitrate);
+			}
+			if (!ret && entry->tags) {
+				ret = playlist_text_print_attribute(&text, M3U_ATTRIBUTE_TAGS, entry->tags);
+			}
+			if (!ret) {
+				ret = playlist_text_print(&text, ",", entry->title ? entry->title : "", "\n");
+			}
+		}
+
+		if (!ret) {
+			ret = playlist_text_print(&text, "", entry->url, "\n");
+		}
+	}
+
+	if (ret) {
+		printf("Playlist: error allocating m3u text\n");
+		free(text.data);
+		return NULL;
+	}
+
+	*size = text.size;
+	return text.data;
+}
+
+/**
+ * Replace a file through a temporary one, an interrupted write never leaves a truncated file
+ */
+int playlist_replace_file(const char *path, const void *data, size_t size)
+{
+	char temporary_path[PLAYLIST_PATH_MAX + 4];
+	snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+
+	SceUID fd = sceIoOpen(temporary_path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+	if (fd < 0) {
+		printf("Playlist: cannot create %s (0x%X)\n", temporary_path, fd);
+		return -1;
+	}
+
+	int ret = sceIoWrite(fd, data, size);
+	sceIoClose(fd);
+
+	if (ret != (int)size) {
+		printf("Playlist: write error 0x%X on %s\n", ret, temporary_path);
+		sceIoRemove(temporary_path);
+		return -1;
+	}
+
+	sceIoRemove(path);
+	ret = sceIoRename(temporary_path, path);
+	if (ret < 0) {
+		printf("Playlist: cannot rename %s (0x%X)\n", temporary_path, ret);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Finish a replacement interrupted between the removal of the file and the rename
+ */
+void playlist_recover_file(const char *path)
+{
+	char temporary_path[PLAYLIST_PATH_MAX + 4];
+	snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+
+	SceIoStat stat;
+	if (sceIoGetstat(path, &stat) < 0 && sceIoGetstat(temporary_path, &stat) >= 0) {
+		printf("Playlist: recovering %s\n", temporary_path);
+		sceIoRename(temporary_path, path);
+	}
+}
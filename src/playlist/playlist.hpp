@@ -0,0 +1,70 @@
+#ifndef __PLAYLIST_HPP__
+#define __PLAYLIST_HPP__
+
+#include <stddef.h>
+
+#define PLAYLIST_FILE "ux0:/data/webradio/playlist.m3u"
+#define PLAYLIST_READ_SIZE (64 * 1024)
+#define PLAYLIST_BLOCK_SIZE (64 * 1024) // arena grows by blocks, strings never move
+#define PLAYLIST_NO_GROUP -1
+#define PLAYLIST_PATH_MAX 256
+#define PLAYLIST_JOURNAL_DIRECTIVE "#WEBRADIO-JOURNAL:"
+
+struct playlist_entry {
+	const char *url;
+	const char *title; // NULL if the playlist gives none
+	const char *logo_url; // NULL if the playlist gives none
+	int group; // index in groups, PLAYLIST_NO_GROUP if none
+	const char *tags; // comma separated, NULL if the playlist gives none
+	unsigned short bitrate; // kbps announced by the playlist, 0 if unknown
+	unsigned char codec; // audio_format announced by the playlist, a hint until the stream answers
+};
+
+struct m3u_item;
+
+struct playlist_block;
+
+/**
+ * Stations in one contiguous array, their strings copied into an arena
+ *
+ * Entries are accessed by index. Group names are interned: each one is stored once
+ * and entries refer to it by index.
+ */
+struct playlist {
+	char *name; // from #PLAYLIST, in the arena, NULL if none
+	playlist_entry *entries;
+	int count;
+	int capacity;
+
+	const char **groups;
+	int group_count;
+	int group_capacity;
+	int *group_slots; // open addressing table of group indexes, -1 when free
+	int group_slot_count; // power of two
+
+	playlist_block *blocks;
+	size_t arena_size; // bytes reserved by all blocks
+
+	unsigned int journal_sequence; // last journal record applied to the list
+	unsigned int generation; // changes when entries are edited, moved or removed, or the list is freed, not when appending
+};
+
+void playlist_init(playlist *list);
+void playlist_free(playlist *list);
+int playlist_add(playlist *list, const char *url, const char *title, const char *logo_url, const char *group);
+int playlist_add_item(playlist *list, const m3u_item *item);
+int playlist_set(playlist *list, int index, const char *url, const char *title, const char *logo_url, const char *group);
+int playlist_remove(playlist *list, int index);
+int playlist_move(playlist *list, int from, int to);
+int playlist_find(const playlist *list, const char *url, int hint);
+int playlist_index_groups(playlist *list);
+int playlist_intern_group(playlist *list, const char *group, size_t length);
+const char *playlist_copy_string(playlist *list, const char *str, size_t length);
+size_t playlist_memory_used(const playlist *list);
+
+int playlist_load_m3u(playlist *list, const char *path);
+char *playlist_format_m3u(const playlist *list, size_t *size);
+int playlist_replace_file(const char *path, const void *data, size_t size);
+void playlist_recover_file(const char *path);
+
+#endif
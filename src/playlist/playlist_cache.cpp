@@ -0,0 +1,307 @@
+#include "playlist_cache.hpp"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#define printf sceClibPrintf
+
+#define PLAYLIST_CACHE_NONE 0xFFFFFFFF
+
+/**
+ * File layout: header, entry records, group name offsets, string table
+ *
+ * Strings are referenced by their offset in the string table.
+ */
+struct playlist_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t m3u_size; // the cache is stale when the m3u size or date differs
+	SceDateTime m3u_mtime;
+	uint32_t entry_count;
+	uint32_t group_count;
+	uint32_t strings_size;
+	uint32_t name;
+	uint32_t journal_sequence;
+	uint32_t reserved;
+};
+
+struct playlist_cache_entry {
+	uint32_t url;
+	uint32_t title;
+	uint32_t logo_url;
+	int32_t group;
+	uint32_t tags;
+	uint16_t bitrate;
+	uint8_t codec;
+	uint8_t reserved;
+};
+
+// Serialized cache handed to the writer thread
+static char *pending_data = NULL;
+static size_t pending_size = 0;
+static char pending_path[PLAYLIST_PATH_MAX];
+static SceUID writer_thread_id = -1;
+
+static size_t playlist_cache_data_size(const playlist_cache_header *header)
+{
+	return sizeof(playlist_cache_header)
+		+ sizeof(playlist_cache_entry) * header->entry_count
+		+ sizeof(uint32_t) * header->group_count
+		+ header->strings_size;
+}
+
+static const char *playlist_cache_string(const char *strings, uint32_t size, uint32_t offset)
+{
+	return offset < size ? strings + offset : NULL;
+}
+
+/**
+ * Replace the content of the list with the cache, if it matches the m3u file
+ *
+ * The whole cache is read at once, only the string table is kept.
+ * @return 0 on success, -1 if the cache is missing, stale or invalid
+ */
+int playlist_cache_load(playlist *list, const char *m3u_path, const char *cache_path)
+{
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+
+	SceIoStat m3u_stat;
+	SceIoStat cache_stat;
+	if (sceIoGetstat(m3u_path, &m3u_stat) < 0 || sceIoGetstat(cache_path, &cache_stat) < 0) {
+		return -1;
+	}
+
+	if (cache_stat.st_size < (SceOff)sizeof(playlist_cache_header)) {
+		printf("Playlist cache: %s is truncated\n", cache_path);
+		return -1;
+	}
+
+	SceUID fd = sceIoOpen(cache_path, SCE_O_RDONLY, 0);
+	if (fd < 0) {
+		printf("Playlist cache: cannot open %s (0x%X)\n", cache_path, fd);
+		return -1;
+	}
+
+	size_t size = (size_t)cache_stat.st_size;
+	char *data = (char*)malloc(size);
+	if (!data) {
+		printf("Playlist cache: error allocating %u bytes\n", size);
+		sceIoClose(fd);
+		return -1;
+	}
+
+	int read_size = sceIoRead(fd, data, size);
+	sceIoClose(fd);
+
+	playlist_cache_header *header = (playlist_cache_header*)data;
+	if (read_size != (int)size || header->magic != PLAYLIST_CACHE_MAGIC || header->version != PLAYLIST_CACHE_VERSION
+		|| playlist_cache_data_size(header) != size) {
+		printf("Playlist cache: %s is invalid\n", cache_path);
+		free(data);
+		return -1;
+	}
+
+	if (header->m3u_size != (uint64_t)m3u_stat.st_size || memcmp(&header->m3u_mtime, &m3u_stat.st_mtime, sizeof(SceDateTime))) {
+		printf("Playlist cache: %s changed, cache is stale\n", m3u_path);
+		free(data);
+		return -1;
+	}
+
+	playlist_free(list);
+
+	const playlist_cache_entry *records = (const playlist_cache_entry*)(header + 1);
+	const uint32_t *group_names = (const uint32_t*)(records + header->entry_count);
+	const char *strings = playlist_copy_string(list, (const char*)(group_names + header->group_count), header->strings_size);
+	uint32_t strings_size = strings ? header->strings_size : 0;
+
+	list->entries = (playlist_entry*)malloc(sizeof(playlist_entry) * (header->entry_count ? header->entry_count : 1));
+	list->groups = (const char**)malloc(sizeof(const char*) * (header->group_count ? header->group_count : 1));
+	if ((header->strings_size && !strings) || !list->entries || !list->groups) {
+		printf("Playlist cache: error allocating %u entries\n", header->entry_count);
+		playlist_free(list);
+		free(data);
+		return -1;
+	}
+
+	list->capacity = header->entry_count ? header->entry_count : 1;
+	list->group_capacity = header->group_count ? header->group_count : 1;
+	list->name = (char*)playlist_cache_string(strings, strings_size, header->name);
+	list->journal_sequence = header->journal_sequence;
+
+	for (uint32_t i = 0; i < header->group_count; i++) {
+		const char *name = playlist_cache_string(strings, strings_size, group_names[i]);
+		list->groups[list->group_count++] = name ? name : "";
+	}
+
+	for (uint32_t i = 0; i < header->entry_count; i++) {
+		const playlist_cache_entry *record = &records[i];
+		playlist_entry *entry = &list->entries[list->count];
+
+		entry->url = playlist_cache_string(strings, strings_size, record->url);
+		if (!entry->url) {
+			continue;
+		}
+
+		entry->title = playlist_cache_string(strings, strings_size, record->title);
+		entry->logo_url = playlist_cache_string(strings, strings_size, record->logo_url);
+		entry->group = record->group >= 0 && record->group < list->group_count ? record->group : PLAYLIST_NO_GROUP;
+		entry->tags = playlist_cache_string(strings, strings_size, record->tags);
+		entry->bitrate = record->bitrate;
+		entry->codec = record->codec;
+		list->count++;
+	}
+
+	free(data);
+
+	if (playlist_index_groups(list)) {
+		playlist_free(list);
+		return -1;
+	}
+
+	unsigned int elapsed = (unsigned int)(sceKernelGetProcessTimeWide() - start);
+	printf("Playlist cache: %i stations, %i groups loaded in %u ms from %u KB\n", list->count, list->group_count, elapsed / 1000, size / 1024);
+
+	return 0;
+}
+
+static uint32_t playlist_cache_add_string(char *strings, uint32_t *strings_size, const char *str)
+{
+	if (!str) {
+		return PLAYLIST_CACHE_NONE;
+	}
+
+	uint32_t offset = *strings_size;
+	size_t length = strlen(str) + 1;
+	memcpy(strings + offset, str, length);
+	*strings_size += length;
+
+	return offset;
+}
+
+static int playlist_cache_writer(SceSize args, void *argp)
+{
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+
+	if (!playlist_replace_file(pending_path, pending_data, pending_size)) {
+		unsigned int elapsed = (unsigned int)(sceKernelGetProcessTimeWide() - start);
+		printf("Playlist cache: %u KB written in %u ms\n", pending_size / 1024, elapsed / 1000);
+	}
+
+	free(pending_data);
+	pending_data = NULL;
+
+	return 0;
+}
+
+/**
+ * Serialize the list and write the cache from a background thread
+ *
+ * Call it after the m3u file has been written so its size and date are current.
+ */
+int playlist_cache_save(const playlist *list, const char *m3u_path, const char *cache_path)
+{
+	SceIoStat m3u_stat;
+	int ret = sceIoGetstat(m3u_path, &m3u_stat);
+	if (ret < 0) {
+		printf("Playlist cache: cannot stat %s (0x%X)\n", m3u_path, ret);
+		return -1;
+	}
+
+	// A previous write must be done before its buffer is replaced
+	playlist_cache_wait();
+
+	size_t strings_total = list->name ? strlen(list->name) + 1 : 0;
+	for (int i = 0; i < list->group_count; i++) {
+		strings_total += strlen(list->groups[i]) + 1;
+	}
+	for (int i = 0; i < list->count; i++) {
+		const playlist_entry *entry = &list->entries[i];
+		strings_total += strlen(entry->url) + 1;
+		strings_total += entry->title ? strlen(entry->title) + 1 : 0;
+		strings_total += entry->logo_url ? strlen(entry->logo_url) + 1 : 0;
+		strings_total += entry->tags ? strlen(entry->tags) + 1 : 0;
+	}
+
+	playlist_cache_header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = PLAYLIST_CACHE_MAGIC;
+	header.version = PLAYLIST_CACHE_VERSION;
+	header.m3u_size = m3u_stat.st_size;
+	header.m3u_mtime = m3u_stat.st_mtime;
+	header.entry_count = list->count;
+	header.group_count = list->group_count;
+	header.strings_size = strings_total;
+	header.journal_sequence = list->journal_sequence;
+
+	size_t size = playlist_cache_data_size(&header);
+	char *data = (char*)malloc(size);
+	if (!data) {
+		printf("Playlist cache: error allocating %u bytes\n", size);
+		return -1;
+	}
+
+	playlist_cache_entry *records = (playlist_cache_entry*)(data + sizeof(playlist_cache_header));
+	uint32_t *group_names = (uint32_t*)(records + list->count);
+	char *strings = (char*)(group_names + list->group_count);
+	uint32_t strings_size = 0;
+
+	header.name = playlist_cache_add_string(strings, &strings_size, list->name);
+
+	for (int i = 0; i < list->group_count; i++) {
+		group_names[i] = playlist_cache_add_string(strings, &strings_size, list->groups[i]);
+	}
+
+	for (int i = 0; i < list->count; i++) {
+		const playlist_entry *entry = &list->entries[i];
+		records[i].url = playlist_cache_add_string(strings, &strings_size, entry->url);
+		records[i].title = playlist_cache_add_string(strings, &strings_size, entry->title);
+		records[i].logo_url = playlist_cache_add_string(strings, &strings_size, entry->logo_url);
+		records[i].group = entry->group;
+		records[i].tags = playlist_cache_add_string(strings, &strings_size, entry->tags);
+		records[i].bitrate = entry->bitrate;
+		records[i].codec = entry->codec;
+		records[i].reserved = 0;
+	}
+
+	memcpy(data, &header, sizeof(header));
+
+	pending_data = data;
+	pending_size = size;
+	snprintf(pending_path, sizeof(pending_path), "%s", cache_path);
+
+	// Memory card writes can take a while on big playlists, keep them away from the UI thread
+	writer_thread_id = sceKernelCreateThread("playlistCacheThread", playlist_cache_writer, 0x10000100 + 10, 0x4000, 0, 0, NULL);
+	if (writer_thread_id < 0) {
+		printf("Playlist cache: error creating thread with id %i\n", writer_thread_id);
+		writer_thread_id = -1;
+		free(pending_data);
+		pending_data = NULL;
+		return -1;
+	}
+
+	sceKernelStartThread(writer_thread_id, 0, NULL);
+
+	return 0;
+}
+
+/**
+ * Wait for the background write to be done
+ */
+void playlist_cache_wait(void)
+{
+	if (writer_thread_id < 0) {
+		return;
+	}
+
+	sceKernelWaitThreadEnd(writer_thread_id, NULL, NULL);
+	sceKernelDeleteThread(writer_thread_id);
+	writer_thread_id = -1;
+}
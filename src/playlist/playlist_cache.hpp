@@ -0,0 +1,14 @@
+#ifndef __PLAYLIST_CACHE_HPP__
+#define __PLAYLIST_CACHE_HPP__
+
+#include "playlist.hpp"
+
+#define PLAYLIST_CACHE_FILE "ux0:/data/webradio/playlist.cache"
+#define PLAYLIST_CACHE_MAGIC 0x43505257 // "WRPC"
+#define PLAYLIST_CACHE_VERSION 3
+
+int playlist_cache_load(playlist *list, const char *m3u_path, const char *cache_path);
+int playlist_cache_save(const playlist *list, const char *m3u_path, const char *cache_path);
+void playlist_cache_wait(void);
+
+#endif
@@ -0,0 +1,245 @@
+#include "playlist_import.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/processmgr.h>
+
+extern "C" {
+	#include "../m3u_parser/m3u_tokenizer.h"
+	#include "../pls_parser/pls_tokenizer.h"
+	#include "../radio_browser_parser/radio_browser_tokenizer.h"
+	#include "../xspf_parser/xspf_tokenizer.h"
+}
+
+#define printf sceClibPrintf
+
+struct playlist_importer {
+	playlist_import_format format;
+	union {
+		m3u_tokenizer m3u;
+		pls_tokenizer pls;
+		xspf_tokenizer xspf;
+		radio_browser_tokenizer radio_browser;
+	};
+
+	playlist *list;
+	int added;
+};
+
+/**
+ * Guess the format from the file extension, or from the start of the file
+ */
+playlist_import_format playlist_import_detect(const char *path, const char *data, size_t size)
+{
+	const char *extension = strrchr(path, '.');
+	if (extension) {
+		if (!strcasecmp(extension, ".pls")) {
+			return PLAYLIST_IMPORT_PLS;
+		} else if (!strcasecmp(extension, ".xspf")) {
+			return PLAYLIST_IMPORT_XSPF;
+		} else if (!strcasecmp(extension, ".json")) {
+			return PLAYLIST_IMPORT_RADIO_BROWSER;
+		} else if (!strcasecmp(extension, ".m3u") || !strcasecmp(extension, ".m3u8")) {
+			return PLAYLIST_IMPORT_M3U;
+		}
+	}
+
+	size_t i = size >= 3 && !memcmp(data, "\xEF\xBB\xBF", 3) ? 3 : 0;
+	while (i < size && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n')) {
+		i++;
+	}
+
+	if (i == size) {
+		return PLAYLIST_IMPORT_UNKNOWN;
+	}
+
+	if (size - i >= 10 && !strncasecmp(data + i, "[playlist]", 10)) {
+		return PLAYLIST_IMPORT_PLS;
+	} else if (data[i] == '[' || data[i] == '{') {
+		return PLAYLIST_IMPORT_RADIO_BROWSER;
+	} else if (data[i] == '<') {
+		return PLAYLIST_IMPORT_XSPF;
+	}
+
+	// Plain lists of URLs are read as m3u
+	return PLAYLIST_IMPORT_M3U;
+}
+
+const char *playlist_import_format_name(playlist_import_format format)
+{
+	switch (format) {
+	case PLAYLIST_IMPORT_M3U:
+		return "M3U";
+	case PLAYLIST_IMPORT_PLS:
+		return "PLS";
+	case PLAYLIST_IMPORT_XSPF:
+		return "XSPF";
+	case PLAYLIST_IMPORT_RADIO_BROWSER:
+		return "Radio-Browser JSON";
+	default:
+		return "unknown";
+	}
+}
+
+static void playlist_import_on_item(void *user, const struct m3u_item *item)
+{
+	playlist_importer *importer = (playlist_importer*)user;
+	if (playlist_add_item(importer->list, item) >= 0) {
+		importer->added++;
+	}
+}
+
+static void playlist_importer_init(playlist_importer *importer, playlist_import_format format, playlist *list)
+{
+	// The name and journal position of the list stay those of the m3u
+	m3u_tokenizer_callbacks callbacks = { playlist_import_on_item, NULL, NULL, NULL };
+
+	importer->format = format;
+	importer->list = list;
+	importer->added = 0;
+
+	switch (format) {
+	case PLAYLIST_IMPORT_PLS:
+		pls_tokenizer_init(&importer->pls, &callbacks, importer);
+		break;
+	case PLAYLIST_IMPORT_XSPF:
+		xspf_tokenizer_init(&importer->xspf, &callbacks, importer);
+		break;
+	case PLAYLIST_IMPORT_RADIO_BROWSER:
+		radio_browser_tokenizer_init(&importer->radio_browser, &callbacks, importer);
+		break;
+	default:
+		m3u_tokenizer_init(&importer->m3u, &callbacks, importer);
+		break;
+	}
+}
+
+static int playlist_importer_feed(playlist_importer *importer, const char *data, size_t size)
+{
+	switch (importer->format) {
+	case PLAYLIST_IMPORT_PLS:
+		return pls_tokenizer_feed(&importer->pls, data, size);
+	case PLAYLIST_IMPORT_XSPF:
+		return xspf_tokenizer_feed(&importer->xspf, data, size);
+	case PLAYLIST_IMPORT_RADIO_BROWSER:
+		return radio_browser_tokenizer_feed(&importer->radio_browser, data, size);
+	default:
+		return m3u_tokenizer_feed(&importer->m3u, data, size);
+	}
+}
+
+static int playlist_importer_finish(playlist_importer *importer)
+{
+	switch (importer->format) {
+	case PLAYLIST_IMPORT_PLS:
+		return pls_tokenizer_finish(&importer->pls);
+	case PLAYLIST_IMPORT_XSPF:
+		return xspf_tokenizer_finish(&importer->xspf);
+	case PLAYLIST_IMPORT_RADIO_BROWSER:
+		return radio_browser_tokenizer_finish(&importer->radio_browser);
+	default:
+		return m3u_tokenizer_finish(&importer->m3u);
+	}
+}
+
+static int playlist_importer_errors(const playlist_importer *importer)
+{
+	switch (importer->format) {
+	case PLAYLIST_IMPORT_PLS:
+		return importer->pls.errors;
+	case PLAYLIST_IMPORT_XSPF:
+		return importer->xspf.errors;
+	case PLAYLIST_IMPORT_RADIO_BROWSER:
+		return importer->radio_browser.errors;
+	default:
+		return importer->m3u.errors;
+	}
+}
+
+static void playlist_importer_free(playlist_importer *importer)
+{
+	switch (importer->format) {
+	case PLAYLIST_IMPORT_PLS:
+		pls_tokenizer_free(&importer->pls);
+		break;
+	case PLAYLIST_IMPORT_XSPF:
+		xspf_tokenizer_free(&importer->xspf);
+		break;
+	case PLAYLIST_IMPORT_RADIO_BROWSER:
+		radio_browser_tokenizer_free(&importer->radio_browser);
+		break;
+	default:
+		m3u_tokenizer_free(&importer->m3u);
+		break;
+	}
+}
+
+/**
+ * Append the stations of a PLS, XSPF, Radio-Browser JSON or m3u file
+ *
+ * Only one chunk of the file is in memory at a time, stations are added as they are parsed.
+ * @return the number of stations added, -1 on error
+ */
+int playlist_import(playlist *list, const char *path)
+{
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+
+	SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+	if (fd < 0) {
+		printf("Import: cannot open %s (0x%X)\n", path, fd);
+		return -1;
+	}
+
+	char *chunk = (char*)malloc(PLAYLIST_READ_SIZE);
+	if (!chunk) {
+		printf("Import: error allocating read buffer\n");
+		sceIoClose(fd);
+		return -1;
+	}
+
+	int size = sceIoRead(fd, chunk, PLAYLIST_READ_SIZE);
+	playlist_import_format format = size > 0 ? playlist_import_detect(path, chunk, size) : PLAYLIST_IMPORT_UNKNOWN;
+	if (format == PLAYLIST_IMPORT_UNKNOWN) {
+		printf("Import: %s is empty or unreadable (0x%X)\n", path, size);
+		free(chunk);
+		sceIoClose(fd);
+		return -1;
+	}
+
+	playlist_importer importer;
+	playlist_importer_init(&importer, format, list);
+
+	size_t total = 0;
+	int ret = 0;
+	while (!ret && size > 0) {
+		total += size;
+		ret = playlist_importer_feed(&importer, chunk, size);
+		if (!ret) {
+			size = sceIoRead(fd, chunk, PLAYLIST_READ_SIZE);
+		}
+	}
+
+	if (size < 0) {
+		printf("Import: read error 0x%X\n", size);
+		ret = -1;
+	} else if (!ret) {
+		ret = playlist_importer_finish(&importer);
+	}
+
+	unsigned int elapsed = (unsigned int)(sceKernelGetProcessTimeWide() - start);
+	printf("Import: %i stations from %s (%s), %i malformed entries in %u KB\n", importer.added, path,
+		playlist_import_format_name(format), playlist_importer_errors(&importer), total / 1024);
+	printf("Import: parsed in %u ms (%u KB/s), %u KB in memory\n", elapsed / 1000,
+		elapsed ? (unsigned int)((unsigned long long)total * 1000000 / 1024 / elapsed) : 0, playlist_memory_used(list) / 1024);
+
+	playlist_importer_free(&importer);
+	free(chunk);
+	sceIoClose(fd);
+
+	// Stations parsed before an error are kept
+	return ret && !importer.added ? -1 : importer.added;
+}
@@ -0,0 +1,27 @@
+#ifndef __PLAYLIST_IMPORT_HPP__
+#define __PLAYLIST_IMPORT_HPP__
+
+#include <stddef.h>
+
+#include "playlist.hpp"
+
+#define PLAYLIST_IMPORT_DIRECTORY "ux0:/data/webradio/"
+
+enum playlist_import_format {
+	PLAYLIST_IMPORT_UNKNOWN,
+	PLAYLIST_IMPORT_M3U,
+	PLAYLIST_IMPORT_PLS,
+	PLAYLIST_IMPORT_XSPF,
+	PLAYLIST_IMPORT_RADIO_BROWSER, // JSON station list from the Radio-Browser API
+};
+
+/**
+ * Append the stations of a playlist file to the list, read and parsed by chunks
+ *
+ * Codec, bitrate and tags are kept when the format gives them.
+ */
+playlist_import_format playlist_import_detect(const char *path, const char *data, size_t size);
+const char *playlist_import_format_name(playlist_import_format format);
+int playlist_import(playlist *list, const char *path);
+
+#endif
@@ -0,0 +1,428 @@
+#include "playlist_journal.hpp"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#define printf sceClibPrintf
+
+#define PLAYLIST_JOURNAL_STRINGS 5 // key URL, URL, title, logo, group
+#define PLAYLIST_JOURNAL_STRING_MAX 0xFFFF
+
+struct playlist_journal_record {
+	uint32_t size; // whole record, strings included
+	uint32_t checksum; // FNV-1a of everything after this field
+	uint32_t sequence;
+	uint16_t type;
+	uint16_t reserved;
+	int32_t index; // station changed, found by its key URL if the index does not match
+	int32_t target; // new index for PLAYLIST_JOURNAL_MOVE
+	uint16_t lengths[PLAYLIST_JOURNAL_STRINGS]; // 0 if the string is NULL
+	uint16_t padding;
+	// strings follow, not NUL terminated
+};
+
+// Compacted m3u handed to the writer thread
+static char *pending_data = NULL;
+static size_t pending_size = 0;
+static char pending_m3u_path[PLAYLIST_PATH_MAX];
+static char pending_old_path[PLAYLIST_PATH_MAX + 4];
+static SceUID compact_thread_id = -1;
+
+static uint32_t playlist_journal_checksum(const playlist_journal_record *record)
+{
+	const unsigned char *data = (const unsigned char*)record + offsetof(playlist_journal_record, sequence);
+	size_t size = record->size - offsetof(playlist_journal_record, sequence);
+
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+static void playlist_journal_old_path(const playlist_journal *journal, char *path, size_t size)
+{
+	snprintf(path, size, "%s.old", journal->path);
+}
+
+/**
+ * @param path of the journal file
+ * @param m3u_path is the playlist the journal is merged into
+ */
+int playlist_journal_init(playlist_journal *journal, const char *path, const char *m3u_path)
+{
+	memset(journal, 0, sizeof(playlist_journal));
+	snprintf(journal->path, sizeof(journal->path), "%s", path);
+	snprintf(journal->m3u_path, sizeof(journal->m3u_path), "%s", m3u_path);
+
+	// A compaction may have been interrupted while replacing the m3u
+	playlist_recover_file(m3u_path);
+
+	return 0;
+}
+
+/**
+ * Apply one change, strings are NUL terminated or NULL
+ *
+ * @return the index of the station changed, -1 if it cannot be applied
+ */
+static int playlist_journal_apply(playlist *list, int type, int index, int target, const char **strings)
+{
+	if (type == PLAYLIST_JOURNAL_ADD) {
+		return playlist_add(list, strings[1], strings[2], strings[3], strings[4]);
+	}
+
+	if (!strings[0]) {
+		return -1;
+	}
+
+	index = playlist_find(list, strings[0], index);
+	if (index < 0) {
+		return -1;
+	}
+
+	switch (type) {
+	case PLAYLIST_JOURNAL_REMOVE:
+		return playlist_remove(list, index) ? -1 : index;
+	case PLAYLIST_JOURNAL_EDIT:
+		return playlist_set(list, index, strings[1], strings[2], strings[3], strings[4]) ? -1 : index;
+	case PLAYLIST_JOURNAL_MOVE:
+		return playlist_move(list, index, target) ? -1 : target;
+	default:
+		return -1;
+	}
+}
+
+/**
+ * Apply the records of one journal file newer than the list
+ *
+ * @return the number of valid records in the file, -1 if the file ends with a damaged record
+ */
+static int playlist_journal_replay_file(playlist *list, const char *path)
+{
+	SceIoStat stat;
+	if (sceIoGetstat(path, &stat) < 0 || stat.st_size == 0) {
+		return 0;
+	}
+
+	SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+	if (fd < 0) {
+		printf("Journal: cannot open %s (0x%X)\n", path, fd);
+		return 0;
+	}
+
+	size_t size = (size_t)stat.st_size;
+	char *data = (char*)malloc(size);
+	if (!data) {
+		printf("Journal: error allocating %u bytes\n", size);
+		sceIoClose(fd);
+		return 0;
+	}
+
+	int read_size = sceIoRead(fd, data, size);
+	sceIoClose(fd);
+	size = read_size > 0 ? read_size : 0;
+
+	int record_count = 0;
+	int applied = 0;
+	size_t offset = 0;
+	while (offset + sizeof(playlist_journal_record) <= size) {
+		playlist_journal_record *record = (playlist_journal_record*)(data + offset);
+
+		size_t strings_size = 0;
+		for (int i = 0; i < PLAYLIST_JOURNAL_STRINGS; i++) {
+			strings_size += record->lengths[i];
+		}
+
+		if (record->size != sizeof(playlist_journal_record) + strings_size || offset + record->size > size
+			|| record->checksum != playlist_journal_checksum(record)) {
+			break;
+		}
+
+		record_count++;
+
+		if (record->sequence > list->journal_sequence) {
+			// Copy strings to add their NUL
+			char *copy = (char*)malloc(strings_size + PLAYLIST_JOURNAL_STRINGS);
+			if (!copy) {
+				printf("Journal: error allocating record\n");
+				break;
+			}
+
+			const char *strings[PLAYLIST_JOURNAL_STRINGS];
+			const char *source = (const char*)(record + 1);
+			char *destination = copy;
+
+			for (int i = 0; i < PLAYLIST_JOURNAL_STRINGS; i++) {
+				strings[i] = record->lengths[i] ? destination : NULL;
+				memcpy(destination, source, record->lengths[i]);
+				destination[record->lengths[i]] = '\0';
+				source += record->lengths[i];
+				destination += record->lengths[i] + 1;
+			}
+
+			if (playlist_journal_apply(list, record->type, record->index, record->target, strings) < 0) {
+				printf("Journal: record %u does not apply, skipped\n", record->sequence);
+			} else {
+				applied++;
+			}
+			list->journal_sequence = record->sequence;
+
+			free(copy);
+		}
+
+		offset += record->size;
+	}
+
+	free(data);
+
+	printf("Journal: %i records applied out of %i from %s\n", applied, record_count, path);
+	if (offset < size) {
+		printf("Journal: damaged record at offset %u of %s, ignored\n", offset, path);
+		return -1;
+	}
+
+	return record_count;
+}
+
+/**
+ * Apply the changes not in the m3u (or its cache) yet, call it after loading the list
+ */
+int playlist_journal_replay(playlist_journal *journal, playlist *list)
+{
+	char old_path[PLAYLIST_PATH_MAX + 4];
+	playlist_journal_old_path(journal, old_path, sizeof(old_path));
+
+	// The old file is left by a compaction not finished, its records come first
+	int old_count = playlist_journal_replay_file(list, old_path);
+	int count = playlist_journal_replay_file(list, journal->path);
+
+	if (old_count < 0 || count < 0) {
+		// New records cannot follow a damaged one, start a clean journal
+		journal->record_count = PLAYLIST_JOURNAL_COMPACT_RECORDS;
+	} else {
+		journal->record_count = old_count + count;
+	}
+
+	if (journal->record_count >= PLAYLIST_JOURNAL_COMPACT_RECORDS) {
+		return playlist_journal_compact(journal, list);
+	}
+
+	return 0;
+}
+
+/**
+ * Append one record with a single write
+ */
+static int playlist_journal_write(playlist_journal *journal, playlist *list, int type, int index, int target, const char **strings)
+{
+	size_t size = sizeof(playlist_journal_record);
+	for (int i = 0; i < PLAYLIST_JOURNAL_STRINGS; i++) {
+		size_t length = strings[i] ? strlen(strings[i]) : 0;
+		if (length > PLAYLIST_JOURNAL_STRING_MAX) {
+			printf("Journal: string too long (%u bytes)\n", length);
+			return -1;
+		}
+		size += length;
+	}
+
+	playlist_journal_record *record = (playlist_journal_record*)malloc(size);
+	if (!record) {
+		printf("Journal: error allocating record\n");
+		return -1;
+	}
+
+	memset(record, 0, sizeof(playlist_journal_record));
+	record->size = size;
+	record->sequence = list->journal_sequence + 1;
+	record->type = type;
+	record->index = index;
+	record->target = target;
+
+	char *destination = (char*)(record + 1);
+	for (int i = 0; i < PLAYLIST_JOURNAL_STRINGS; i++) {
+		if (strings[i]) {
+			record->lengths[i] = strlen(strings[i]);
+			memcpy(destination, strings[i], record->lengths[i]);
+			destination += record->lengths[i];
+		}
+	}
+	record->checksum = playlist_journal_checksum(record);
+
+	int ret = -1;
+	SceUID fd = sceIoOpen(journal->path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_APPEND, 0777);
+	if (fd < 0) {
+		printf("Journal: cannot open %s (0x%X)\n", journal->path, fd);
+	} else {
+		ret = sceIoWrite(fd, record, size);
+		sceIoClose(fd);
+
+		if (ret != (int)size) {
+			printf("Journal: write error 0x%X\n", ret);
+			// Whatever was written is damaged, the next compaction starts a new file
+			journal->record_count = PLAYLIST_JOURNAL_COMPACT_RECORDS;
+			ret = -1;
+		} else {
+			list->journal_sequence = record->sequence;
+			journal->record_count++;
+			ret = 0;
+		}
+	}
+
+	free(record);
+
+	return ret;
+}
+
+/**
+ * Record a change then apply it to the list
+ *
+ * @return the index of the station changed, -1 on error
+ */
+static int playlist_journal_change(playlist_journal *journal, playlist *list, int type, int index, int target, const char **strings)
+{
+	if (playlist_journal_write(journal, list, type, index, target, strings)) {
+		return -1;
+	}
+
+	int ret = playlist_journal_apply(list, type, index, target, strings);
+
+	if (journal->record_count >= PLAYLIST_JOURNAL_COMPACT_RECORDS) {
+		playlist_journal_compact(journal, list);
+	}
+
+	return ret;
+}
+
+/**
+ * @return the index of the new station, -1 on error
+ */
+int playlist_journal_add(playlist_journal *journal, playlist *list, const char *url, const char *title, const char *logo_url, const char *group)
+{
+	if (!url || !url[0]) {
+		return -1;
+	}
+
+	const char *strings[PLAYLIST_JOURNAL_STRINGS] = { NULL, url, title, logo_url, group };
+	return playlist_journal_change(journal, list, PLAYLIST_JOURNAL_ADD, list->count, 0, strings);
+}
+
+int playlist_journal_edit(playlist_journal *journal, playlist *list, int index, const char *url, const char *title, const char *logo_url, const char *group)
+{
+	if (index < 0 || index >= list->count || !url || !url[0]) {
+		return -1;
+	}
+
+	const char *strings[PLAYLIST_JOURNAL_STRINGS] = { list->entries[index].url, url, title, logo_url, group };
+	return playlist_journal_change(journal, list, PLAYLIST_JOURNAL_EDIT, index, 0, strings);
+}
+
+int playlist_journal_remove(playlist_journal *journal, playlist *list, int index)
+{
+	if (index < 0 || index >= list->count) {
+		return -1;
+	}
+
+	const char *strings[PLAYLIST_JOURNAL_STRINGS] = { list->entries[index].url, NULL, NULL, NULL, NULL };
+	return playlist_journal_change(journal, list, PLAYLIST_JOURNAL_REMOVE, index, 0, strings);
+}
+
+int playlist_journal_move(playlist_journal *journal, playlist *list, int from, int to)
+{
+	if (from < 0 || from >= list->count || to < 0 || to >= list->count) {
+		return -1;
+	}
+
+	const char *strings[PLAYLIST_JOURNAL_STRINGS] = { list->entries[from].url, NULL, NULL, NULL, NULL };
+	return playlist_journal_change(journal, list, PLAYLIST_JOURNAL_MOVE, from, to, strings);
+}
+
+static int playlist_journal_compact_thread(SceSize args, void *argp)
+{
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+
+	if (!playlist_replace_file(pending_m3u_path, pending_data, pending_size)) {
+		// The m3u has every record of the old journal now
+		sceIoRemove(pending_old_path);
+
+		unsigned int elapsed = (unsigned int)(sceKernelGetProcessTimeWide() - start);
+		printf("Journal: compacted into %s (%u KB) in %u ms\n", pending_m3u_path, pending_size / 1024, elapsed / 1000);
+	}
+
+	free(pending_data);
+	pending_data = NULL;
+
+	return 0;
+}
+
+/**
+ * Merge the journal into the m3u from a background thread
+ *
+ * The journal file is set aside first so new records go to a fresh one. If the m3u
+ * cannot be written, both files are replayed on next startup.
+ */
+int playlist_journal_compact(playlist_journal *journal, const playlist *list)
+{
+	playlist_journal_wait();
+
+	size_t size = 0;
+	char *data = playlist_format_m3u(list, &size);
+	if (!data) {
+		return -1;
+	}
+
+	char old_path[PLAYLIST_PATH_MAX + 4];
+	playlist_journal_old_path(journal, old_path, sizeof(old_path));
+
+	SceIoStat stat;
+	if (sceIoGetstat(old_path, &stat) < 0) {
+		sceIoRename(journal->path, old_path);
+	} else {
+		// Previous compaction failed, records stay in both files and are skipped once merged
+		printf("Journal: %s still exists, keeping %s\n", old_path, journal->path);
+	}
+
+	pending_data = data;
+	pending_size = size;
+	snprintf(pending_m3u_path, sizeof(pending_m3u_path), "%s", journal->m3u_path);
+	snprintf(pending_old_path, sizeof(pending_old_path), "%s", old_path);
+
+	compact_thread_id = sceKernelCreateThread("journalThread", playlist_journal_compact_thread, 0x10000100 + 10, 0x4000, 0, 0, NULL);
+	if (compact_thread_id < 0) {
+		printf("Journal: error creating thread with id %i\n", compact_thread_id);
+		compact_thread_id = -1;
+		free(pending_data);
+		pending_data = NULL;
+		return -1;
+	}
+
+	sceKernelStartThread(compact_thread_id, 0, NULL);
+	journal->record_count = 0;
+
+	return 0;
+}
+
+/**
+ * Wait for the background compaction to be done
+ */
+void playlist_journal_wait(void)
+{
+	if (compact_thread_id < 0) {
+		return;
+	}
+
+	sceKernelWaitThreadEnd(compact_thread_id, NULL, NULL);
+	sceKernelDeleteThread(compact_thread_id);
+	compact_thread_id = -1;
+}
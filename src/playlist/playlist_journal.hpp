@@ -0,0 +1,38 @@
+#ifndef __PLAYLIST_JOURNAL_HPP__
+#define __PLAYLIST_JOURNAL_HPP__
+
+#include "playlist.hpp"
+
+#define PLAYLIST_JOURNAL_FILE "ux0:/data/webradio/playlist.journal"
+#define PLAYLIST_JOURNAL_COMPACT_RECORDS 32 // the m3u is rewritten once the journal has this many records
+
+enum playlist_journal_type {
+	PLAYLIST_JOURNAL_ADD = 1,
+	PLAYLIST_JOURNAL_REMOVE,
+	PLAYLIST_JOURNAL_EDIT,
+	PLAYLIST_JOURNAL_MOVE,
+};
+
+/**
+ * Changes to the playlist appended to a small file instead of rewriting the m3u
+ *
+ * Each change is one record written with a single write, a record cut by a crash is
+ * ignored. Records are replayed at startup over the m3u (or its cache), and merged
+ * into the m3u from time to time by a background thread.
+ */
+struct playlist_journal {
+	char path[PLAYLIST_PATH_MAX];
+	char m3u_path[PLAYLIST_PATH_MAX];
+	int record_count; // records not merged into the m3u yet
+};
+
+int playlist_journal_init(playlist_journal *journal, const char *path, const char *m3u_path);
+int playlist_journal_replay(playlist_journal *journal, playlist *list);
+int playlist_journal_add(playlist_journal *journal, playlist *list, const char *url, const char *title, const char *logo_url, const char *group);
+int playlist_journal_edit(playlist_journal *journal, playlist *list, int index, const char *url, const char *title, const char *logo_url, const char *group);
+int playlist_journal_remove(playlist_journal *journal, playlist *list, int index);
+int playlist_journal_move(playlist_journal *journal, playlist *list, int from, int to);
+int playlist_journal_compact(playlist_journal *journal, const playlist *list);
+void playlist_journal_wait(void);
+
+#endif
@@ -0,0 +1,307 @@
+#include "playlist_search.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/processmgr.h>
+
+#define printf sceClibPrintf
+
+struct playlist_search_field {
+	const char *data;
+	size_t length;
+};
+
+static inline unsigned char playlist_search_fold(unsigned char c)
+{
+	// ASCII only, UTF-8 sequences are kept as they are
+	return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+static inline uint32_t playlist_search_bucket_index(const char *text)
+{
+	uint32_t trigram = playlist_search_fold(text[0]) << 16 | playlist_search_fold(text[1]) << 8 | playlist_search_fold(text[2]);
+	return (trigram * 2654435761u) >> 18 & (PLAYLIST_SEARCH_BUCKETS - 1);
+}
+
+/**
+ * Searched parts of a station: title, URL host, group name and tags
+ *
+ * @return the number of fields
+ */
+static int playlist_search_fields(const playlist *list, const playlist_entry *entry, playlist_search_field *fields)
+{
+	int count = 0;
+
+	if (entry->title) {
+		fields[count].data = entry->title;
+		fields[count++].length = strlen(entry->title);
+	}
+
+	const char *host = strstr(entry->url, "://");
+	host = host ? host + 3 : entry->url;
+	fields[count].data = host;
+	fields[count++].length = strcspn(host, "/:?#");
+
+	if (entry->group != PLAYLIST_NO_GROUP) {
+		fields[count].data = list->groups[entry->group];
+		fields[count++].length = strlen(list->groups[entry->group]);
+	}
+
+	if (entry->tags) {
+		fields[count].data = entry->tags;
+		fields[count++].length = strlen(entry->tags);
+	}
+
+	return count;
+}
+
+void playlist_search_init(playlist_search *search)
+{
+	memset(search, 0, sizeof(playlist_search));
+}
+
+void playlist_search_free(playlist_search *search)
+{
+	if (search->buckets) {
+		for (int i = 0; i < PLAYLIST_SEARCH_BUCKETS; i++) {
+			free(search->buckets[i].entries);
+		}
+		free(search->buckets);
+	}
+
+	free(search->results);
+	free(search->candidates);
+	playlist_search_init(search);
+}
+
+static int playlist_search_bucket_add(playlist_search_bucket *bucket, int index)
+{
+	// Entries are indexed in order, a duplicate can only be the last one
+	if (bucket->count > 0 && bucket->entries[bucket->count - 1] == index) {
+		return 0;
+	}
+
+	if (bucket->count == bucket->capacity) {
+		int capacity = bucket->capacity ? bucket->capacity * 2 : 8;
+		int *entries = (int*)realloc(bucket->entries, sizeof(int) * capacity);
+		if (!entries) {
+			return -1;
+		}
+		bucket->entries = entries;
+		bucket->capacity = capacity;
+	}
+
+	bucket->entries[bucket->count++] = index;
+
+	return 0;
+}
+
+/**
+ * Index the stations added to the playlist since the last update
+ *
+ * Edited, moved or removed stations change the generation of the playlist, the index is rebuilt.
+ */
+int playlist_search_update(playlist_search *search, const playlist *list)
+{
+	if (search->indexed_count > list->count || search->indexed_generation != list->generation) {
+		// Postings point to indexes whose stations changed, start over
+		playlist_search_free(search);
+		search->indexed_generation = list->generation;
+	}
+
+	if (search->indexed_count == list->count) {
+		return 0;
+	}
+
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+	int first = search->indexed_count;
+
+	if (!search->buckets) {
+		search->buckets = (playlist_search_bucket*)calloc(PLAYLIST_SEARCH_BUCKETS, sizeof(playlist_search_bucket));
+		if (!search->buckets) {
+			printf("Search: error allocating buckets\n");
+			return -1;
+		}
+	}
+
+	if (search->result_capacity < list->count) {
+		int *results = (int*)realloc(search->results, sizeof(int) * list->count);
+		int *candidates = results ? (int*)realloc(search->candidates, sizeof(int) * list->count) : NULL;
+		if (results) {
+			search->results = results;
+		}
+		if (!results || !candidates) {
+			printf("Search: error allocating results\n");
+			return -1;
+		}
+		search->candidates = candidates;
+		search->result_capacity = list->count;
+	}
+
+	size_t postings = 0;
+	for (int i = first; i < list->count; i++) {
+		playlist_search_field fields[4];
+		int field_count = playlist_search_fields(list, &list->entries[i], fields);
+
+		for (int field = 0; field < field_count; field++) {
+			for (size_t c = 0; c + 3 <= fields[field].length; c++) {
+				if (playlist_search_bucket_add(&search->buckets[playlist_search_bucket_index(fields[field].data + c)], i)) {
+					printf("Search: error allocating index\n");
+					return -1;
+				}
+				postings++;
+			}
+		}
+
+		search->indexed_count = i + 1;
+	}
+
+	unsigned int elapsed = (unsigned int)(sceKernelGetProcessTimeWide() - start);
+	printf("Search: indexed %i stations (%u trigrams) in %u us\n", list->count - first, postings, elapsed);
+
+	return 0;
+}
+
+static bool playlist_search_contains(const playlist_search_field *field, const char *term, size_t term_length)
+{
+	if (term_length > field->length) {
+		return false;
+	}
+
+	for (size_t start = 0; start + term_length <= field->length; start++) {
+		size_t i = 0;
+		while (i < term_length && playlist_search_fold(field->data[start + i]) == (unsigned char)term[i]) {
+			i++;
+		}
+
+		if (i == term_length) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Keep the candidates which are also in the sorted bucket list
+ */
+static int playlist_search_intersect(int *candidates, int count, const playlist_search_bucket *bucket)
+{
+	int kept = 0;
+	int b = 0;
+
+	for (int i = 0; i < count && b < bucket->count; i++) {
+		while (b < bucket->count && bucket->entries[b] < candidates[i]) {
+			b++;
+		}
+
+		if (b < bucket->count && bucket->entries[b] == candidates[i]) {
+			candidates[kept++] = candidates[i];
+		}
+	}
+
+	return kept;
+}
+
+static int playlist_search_compare_buckets(const void *a, const void *b)
+{
+	return (*(const playlist_search_bucket* const*)a)->count - (*(const playlist_search_bucket* const*)b)->count;
+}
+
+/**
+ * Find the stations matching every word of the query, in title, URL host or group name
+ *
+ * Matching is case insensitive for ASCII letters. Words shorter than three characters
+ * are only checked on the candidates of the longer ones, or on every station.
+ * @return the number of results in search->results, -1 on error
+ */
+int playlist_search_query(playlist_search *search, const playlist *list, const char *query)
+{
+	if (playlist_search_update(search, list)) {
+		return -1;
+	}
+
+	search->result_count = 0;
+	if (!search->buckets) {
+		// Empty playlist
+		return 0;
+	}
+
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+
+	// Fold the query and split it in words
+	char folded[PLAYLIST_SEARCH_QUERY_MAX];
+	const char *terms[PLAYLIST_SEARCH_TERMS_MAX];
+	size_t term_lengths[PLAYLIST_SEARCH_TERMS_MAX];
+	int term_count = 0;
+
+	size_t length = 0;
+	for (const char *c = query; *c && length < sizeof(folded) - 1; c++) {
+		folded[length++] = *c == ' ' ? '\0' : playlist_search_fold(*c);
+	}
+	folded[length] = '\0';
+
+	for (size_t i = 0; i < length && term_count < PLAYLIST_SEARCH_TERMS_MAX; i++) {
+		if (folded[i] && (i == 0 || !folded[i - 1])) {
+			terms[term_count] = folded + i;
+			term_lengths[term_count++] = strlen(folded + i);
+		}
+	}
+
+	if (term_count == 0) {
+		return 0;
+	}
+
+	// Buckets of every trigram of the query, the smallest ones narrow the candidates most
+	const playlist_search_bucket *buckets[PLAYLIST_SEARCH_QUERY_MAX];
+	int bucket_count = 0;
+	for (int term = 0; term < term_count; term++) {
+		for (size_t c = 0; c + 3 <= term_lengths[term]; c++) {
+			buckets[bucket_count++] = &search->buckets[playlist_search_bucket_index(terms[term] + c)];
+		}
+	}
+
+	int candidate_count = 0;
+	if (bucket_count > 0) {
+		qsort(buckets, bucket_count, sizeof(const playlist_search_bucket*), playlist_search_compare_buckets);
+
+		candidate_count = buckets[0]->count;
+		memcpy(search->candidates, buckets[0]->entries, sizeof(int) * candidate_count);
+		for (int i = 1; i < bucket_count && candidate_count > 0; i++) {
+			if (buckets[i] != buckets[i - 1]) {
+				candidate_count = playlist_search_intersect(search->candidates, candidate_count, buckets[i]);
+			}
+		}
+	} else {
+		// Only short words, check every station
+		for (int i = 0; i < list->count; i++) {
+			search->candidates[i] = i;
+		}
+		candidate_count = list->count;
+	}
+
+	for (int i = 0; i < candidate_count; i++) {
+		playlist_search_field fields[4];
+		int field_count = playlist_search_fields(list, &list->entries[search->candidates[i]], fields);
+
+		bool match = true;
+		for (int term = 0; term < term_count && match; term++) {
+			match = false;
+			for (int field = 0; field < field_count && !match; field++) {
+				match = playlist_search_contains(&fields[field], terms[term], term_lengths[term]);
+			}
+		}
+
+		if (match) {
+			search->results[search->result_count++] = search->candidates[i];
+		}
+	}
+
+	search->query_time = (unsigned int)(sceKernelGetProcessTimeWide() - start);
+	printf("Search: \"%s\" %i results from %i candidates in %u us\n", query, search->result_count, candidate_count, search->query_time);
+
+	return search->result_count;
+}
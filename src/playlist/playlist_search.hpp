@@ -0,0 +1,39 @@
+#ifndef __PLAYLIST_SEARCH_HPP__
+#define __PLAYLIST_SEARCH_HPP__
+
+#include "playlist.hpp"
+
+#define PLAYLIST_SEARCH_BUCKETS 16384 // power of two, trigrams are hashed into buckets
+#define PLAYLIST_SEARCH_QUERY_MAX 128
+#define PLAYLIST_SEARCH_TERMS_MAX 8
+
+struct playlist_search_bucket {
+	int *entries; // sorted entry indexes having a trigram of this bucket
+	int count;
+	int capacity;
+};
+
+/**
+ * Trigram index over case folded station titles, URL hosts and group names
+ *
+ * Buckets only narrow the candidates, every result is checked against the query.
+ */
+struct playlist_search {
+	playlist_search_bucket *buckets;
+	int indexed_count; // stations of the playlist already in the index
+	unsigned int indexed_generation; // generation of the playlist when they were indexed
+
+	int *results;
+	int result_count;
+	int *candidates; // scratch list for intersections
+	int result_capacity;
+
+	unsigned int query_time; // microseconds taken by the last query
+};
+
+void playlist_search_init(playlist_search *search);
+void playlist_search_free(playlist_search *search);
+int playlist_search_update(playlist_search *search, const playlist *list);
+int playlist_search_query(playlist_search *search, const playlist *list, const char *query);
+
+#endif
@@ -0,0 +1,307 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <psp2/kernel/clib.h>
+
+#include "pls_tokenizer.h"
+
+#define printf sceClibPrintf
+
+static int pls_reserve(char **buffer, size_t *capacity, size_t size)
+{
+    if (size <= *capacity) {
+        return 0;
+    }
+
+    size_t new_capacity = *capacity ? *capacity * 2 : 256;
+    while (new_capacity < size) {
+        new_capacity *= 2;
+    }
+
+    char *new_buffer = realloc(*buffer, new_capacity);
+    if (!new_buffer) {
+        printf("PLS: cannot allocate a line of %i bytes\n", size);
+        return -1;
+    }
+
+    *buffer = new_buffer;
+    *capacity = new_capacity;
+    return 0;
+}
+
+static void pls_error(struct pls_tokenizer *tokenizer, const char *message)
+{
+    tokenizer->errors++;
+
+    if (tokenizer->callbacks.error) {
+        tokenizer->callbacks.error(tokenizer->user, tokenizer->line, message);
+    } else {
+        printf("PLS: line %i: %s\n", tokenizer->line, message);
+    }
+}
+
+static char *pls_strndup(const char *str, size_t length)
+{
+    char *copy = malloc(length + 1);
+    if (!copy) {
+        printf("PLS: cannot allocate %i bytes\n", length + 1);
+        return NULL;
+    }
+
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+/**
+ * Parse a "FileN=" / "TitleN=" key and return N, or -1 if the key does not match
+ */
+static int pls_key_index(const char *line, size_t length, const char *key, size_t *value)
+{
+    size_t key_length = strlen(key);
+    if (length <= key_length || strncasecmp(line, key, key_length)) {
+        return -1;
+    }
+
+    int index = 0;
+    size_t i = key_length;
+    while (i < length && line[i] >= '0' && line[i] <= '9') {
+        if (index <= PLS_TOKENIZER_MAX_INDEX) {
+            index = index * 10 + (line[i] - '0');
+        }
+        i++;
+    }
+
+    if (i == key_length || i >= length || line[i] != '=') {
+        return -1;
+    }
+
+    *value = i + 1;
+    return index;
+}
+
+/**
+ * Find the pending entry of an index, or insert it in index order
+ *
+ * @return NULL if every slot is taken
+ */
+static struct pls_pending *pls_pending_get(struct pls_tokenizer *tokenizer, int index)
+{
+    int i = tokenizer->pending_count;
+    while (i > 0 && tokenizer->pending[i - 1].index >= index) {
+        i--;
+    }
+
+    if (i < tokenizer->pending_count && tokenizer->pending[i].index == index) {
+        return &tokenizer->pending[i];
+    }
+
+    if (tokenizer->pending_count == PLS_TOKENIZER_MAX_PENDING) {
+        return NULL;
+    }
+
+    memmove(&tokenizer->pending[i + 1], &tokenizer->pending[i], sizeof(struct pls_pending) * (tokenizer->pending_count - i));
+    tokenizer->pending_count++;
+
+    struct pls_pending *pending = &tokenizer->pending[i];
+    pending->index = index;
+    pending->url = NULL;
+    pending->title = NULL;
+    return pending;
+}
+
+/**
+ * Emit the pending entry of the lowest index, or drop it if it has no URL
+ */
+static void pls_release(struct pls_tokenizer *tokenizer)
+{
+    struct pls_pending *pending = &tokenizer->pending[0];
+
+    if (pending->url) {
+        struct m3u_item item;
+        memset(&item, 0, sizeof(item));
+        item.duration = -1;
+        item.url.data = pending->url;
+        item.url.length = strlen(pending->url);
+        if (pending->title) {
+            item.title.data = pending->title;
+            item.title.length = strlen(pending->title);
+        }
+        item.line = tokenizer->line;
+
+        tokenizer->callbacks.item(tokenizer->user, &item);
+    } else {
+        pls_error(tokenizer, "TitleN without FileN");
+    }
+
+    tokenizer->released = pending->index;
+    free(pending->url);
+    free(pending->title);
+
+    tokenizer->pending_count--;
+    memmove(&tokenizer->pending[0], &tokenizer->pending[1], sizeof(struct pls_pending) * tokenizer->pending_count);
+}
+
+static int pls_process_line(struct pls_tokenizer *tokenizer, const char *line, size_t length)
+{
+    tokenizer->line++;
+
+    if (tokenizer->line == 1 && length >= 3 && !memcmp(line, "\xEF\xBB\xBF", 3)) {
+        // UTF-8 byte order mark
+        line += 3;
+        length -= 3;
+    }
+
+    while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == ' ' || line[length - 1] == '\t')) {
+        length--;
+    }
+    while (length > 0 && (*line == ' ' || *line == '\t')) {
+        line++;
+        length--;
+    }
+
+    if (length == 0 || line[0] == '[' || line[0] == ';' || line[0] == '#') {
+        return 0;
+    }
+
+    size_t value = 0;
+    int is_url = 1;
+    int index = pls_key_index(line, length, "File", &value);
+    if (index < 0) {
+        is_url = 0;
+        index = pls_key_index(line, length, "Title", &value);
+    }
+
+    if (index < 0) {
+        // NumberOfEntries, Version and LengthN are not needed
+        if (!memchr(line, '=', length)) {
+            pls_error(tokenizer, "line without key");
+        }
+        return 0;
+    }
+
+    if (index > PLS_TOKENIZER_MAX_INDEX) {
+        pls_error(tokenizer, "entry index too large");
+        return 0;
+    }
+
+    if (index <= tokenizer->released) {
+        pls_error(tokenizer, "entry after a later one");
+        return 0;
+    }
+
+    if (value == length) {
+        return 0;
+    }
+
+    struct pls_pending *pending = pls_pending_get(tokenizer, index);
+    if (!pending) {
+        // Indexes far out of order, the lowest one is given up on
+        pls_release(tokenizer);
+        pending = pls_pending_get(tokenizer, index);
+    }
+
+    char **field = is_url ? &pending->url : &pending->title;
+    if (*field) {
+        pls_error(tokenizer, is_url ? "FileN given twice" : "TitleN given twice");
+        return 0;
+    }
+
+    *field = pls_strndup(line + value, length - value);
+    return *field ? 0 : -1;
+}
+
+static int pls_carry_append(struct pls_tokenizer *tokenizer, const char *data, size_t size)
+{
+    if (pls_reserve(&tokenizer->carry, &tokenizer->carry_capacity, tokenizer->carry_length + size)) {
+        return -1;
+    }
+
+    memcpy(tokenizer->carry + tokenizer->carry_length, data, size);
+    tokenizer->carry_length += size;
+    return 0;
+}
+
+void pls_tokenizer_init(struct pls_tokenizer *tokenizer, const struct m3u_tokenizer_callbacks *callbacks, void *user)
+{
+    memset(tokenizer, 0, sizeof(struct pls_tokenizer));
+    tokenizer->callbacks = *callbacks;
+    tokenizer->user = user;
+    tokenizer->released = -1;
+}
+
+/**
+ * Parse the next part of the playlist, the input can be split anywhere
+ *
+ * @return 0 on success, -1 on allocation error. Malformed lines are reported and skipped.
+ */
+int pls_tokenizer_feed(struct pls_tokenizer *tokenizer, const char *data, size_t size)
+{
+    const char *p = data;
+    const char *end = data + size;
+    tokenizer->bytes += size;
+
+    if (tokenizer->carry_length > 0) {
+        // Complete the line started in the previous chunk
+        const char *newline = memchr(p, '\n', size);
+        if (!newline) {
+            return pls_carry_append(tokenizer, p, size);
+        }
+
+        if (pls_carry_append(tokenizer, p, newline - p)
+            || pls_process_line(tokenizer, tokenizer->carry, tokenizer->carry_length)) {
+            return -1;
+        }
+
+        tokenizer->carry_length = 0;
+        p = newline + 1;
+    }
+
+    while (p < end) {
+        const char *newline = memchr(p, '\n', end - p);
+        if (!newline) {
+            return pls_carry_append(tokenizer, p, end - p);
+        }
+
+        if (pls_process_line(tokenizer, p, newline - p)) {
+            return -1;
+        }
+
+        p = newline + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Parse the last line and emit the entries still in the window
+ */
+int pls_tokenizer_finish(struct pls_tokenizer *tokenizer)
+{
+    if (tokenizer->carry_length > 0) {
+        if (pls_process_line(tokenizer, tokenizer->carry, tokenizer->carry_length)) {
+            return -1;
+        }
+        tokenizer->carry_length = 0;
+    }
+
+    while (tokenizer->pending_count > 0) {
+        pls_release(tokenizer);
+    }
+
+    return 0;
+}
+
+void pls_tokenizer_free(struct pls_tokenizer *tokenizer)
+{
+    for (int i = 0; i < tokenizer->pending_count; i++) {
+        free(tokenizer->pending[i].url);
+        free(tokenizer->pending[i].title);
+    }
+
+    free(tokenizer->carry);
+    tokenizer->carry = NULL;
+    tokenizer->carry_capacity = 0;
+    tokenizer->pending_count = 0;
+}
@@ -0,0 +1,49 @@
+#ifndef __PLS_TOKENIZER_H__
+#define __PLS_TOKENIZER_H__
+
+#include <stddef.h>
+
+#include "../m3u_parser/m3u_tokenizer.h"
+
+#define PLS_TOKENIZER_MAX_INDEX 1000000 // larger FileN indexes are ignored
+#define PLS_TOKENIZER_MAX_PENDING 64 // entries kept to reorder the lines, the lowest index is released beyond
+
+/**
+ * FileN and TitleN of one entry, kept until it leaves the window
+ */
+struct pls_pending {
+    int index;
+    char *url;
+    char *title;
+};
+
+/**
+ * Incremental PLS parser, items are given to the callbacks of the m3u tokenizer
+ *
+ * Entries are emitted in index order, whatever the order of their lines: the lowest index is
+ * released when the window of PLS_TOKENIZER_MAX_PENDING entries is full, and all of them
+ * by pls_tokenizer_finish. Lines of an index lower than a released entry are reported and skipped.
+ */
+struct pls_tokenizer {
+    struct m3u_tokenizer_callbacks callbacks;
+    void *user;
+
+    char *carry; // start of a line cut by the end of a chunk
+    size_t carry_length;
+    size_t carry_capacity;
+
+    struct pls_pending pending[PLS_TOKENIZER_MAX_PENDING]; // by increasing index
+    int pending_count;
+    int released; // highest index emitted or dropped, -1 if none
+
+    int line;
+    int errors; // malformed lines
+    size_t bytes; // fed so far
+};
+
+void pls_tokenizer_init(struct pls_tokenizer *tokenizer, const struct m3u_tokenizer_callbacks *callbacks, void *user);
+int pls_tokenizer_feed(struct pls_tokenizer *tokenizer, const char *data, size_t size);
+int pls_tokenizer_finish(struct pls_tokenizer *tokenizer);
+void pls_tokenizer_free(struct pls_tokenizer *tokenizer);
+
+#endif
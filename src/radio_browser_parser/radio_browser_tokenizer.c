@@ -0,0 +1,454 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <psp2/kernel/clib.h>
+
+#include "radio_browser_tokenizer.h"
+
+#define printf sceClibPrintf
+
+enum radio_browser_state {
+    RADIO_BROWSER_STATE_VALUE, // between tokens
+    RADIO_BROWSER_STATE_STRING,
+    RADIO_BROWSER_STATE_ESCAPE, // after '\'
+    RADIO_BROWSER_STATE_UNICODE, // after "\u"
+    RADIO_BROWSER_STATE_LITERAL, // number, true, false or null
+};
+
+static const char *radio_browser_keys[RADIO_BROWSER_FIELD_COUNT] = {
+    "name",
+    "url",
+    "url_resolved",
+    "favicon",
+    "tags",
+    "codec",
+    "bitrate",
+    "country",
+};
+
+static void radio_browser_error(struct radio_browser_tokenizer *tokenizer, const char *message)
+{
+    tokenizer->errors++;
+
+    if (tokenizer->callbacks.error) {
+        tokenizer->callbacks.error(tokenizer->user, tokenizer->line, message);
+    } else {
+        printf("Radio-Browser: line %i: %s\n", tokenizer->line, message);
+    }
+}
+
+/**
+ * Add text to the key or the field being read, if any
+ */
+static int radio_browser_append(struct radio_browser_tokenizer *tokenizer, const char *data, size_t size)
+{
+    if (tokenizer->in_key) {
+        if (tokenizer->key_length + size > RADIO_BROWSER_KEY_MAX) {
+            // Too long to be one of ours
+            tokenizer->key_length = RADIO_BROWSER_KEY_MAX + 1;
+        } else {
+            memcpy(tokenizer->key + tokenizer->key_length, data, size);
+            tokenizer->key_length += size;
+        }
+        return 0;
+    }
+
+    if (tokenizer->field < 0) {
+        return 0;
+    }
+
+    struct radio_browser_buffer *buffer = &tokenizer->fields[tokenizer->field];
+    if (buffer->length + size > RADIO_BROWSER_FIELD_MAX) {
+        size = RADIO_BROWSER_FIELD_MAX - buffer->length;
+    }
+
+    if (size == 0) {
+        return 0;
+    }
+
+    if (buffer->length + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 64;
+        while (capacity < buffer->length + size) {
+            capacity *= 2;
+        }
+
+        char *new_data = realloc(buffer->data, capacity);
+        if (!new_data) {
+            printf("Radio-Browser: cannot allocate a field of %i bytes\n", capacity);
+            return -1;
+        }
+        buffer->data = new_data;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->length, data, size);
+    buffer->length += size;
+    return 0;
+}
+
+static struct m3u_span radio_browser_span(const struct radio_browser_tokenizer *tokenizer, int field)
+{
+    const struct radio_browser_buffer *buffer = &tokenizer->fields[field];
+    struct m3u_span span = { buffer->data, buffer->length };
+
+    // Station names are typed by hand, often with stray spaces
+    while (span.length > 0 && (*span.data == ' ' || *span.data == '\t')) {
+        span.data++;
+        span.length--;
+    }
+    while (span.length > 0 && (span.data[span.length - 1] == ' ' || span.data[span.length - 1] == '\t')) {
+        span.length--;
+    }
+
+    return span;
+}
+
+static void radio_browser_clear_fields(struct radio_browser_tokenizer *tokenizer)
+{
+    for (int i = 0; i < RADIO_BROWSER_FIELD_COUNT; i++) {
+        tokenizer->fields[i].length = 0;
+    }
+    tokenizer->station_depth = 0;
+}
+
+static void radio_browser_emit_station(struct radio_browser_tokenizer *tokenizer)
+{
+    // url_resolved skips the playlist wrapper some stations give as url
+    struct m3u_span url = radio_browser_span(tokenizer, RADIO_BROWSER_FIELD_URL_RESOLVED);
+    if (url.length == 0) {
+        url = radio_browser_span(tokenizer, RADIO_BROWSER_FIELD_URL);
+    }
+
+    if (url.length == 0) {
+        radio_browser_error(tokenizer, "station without url");
+        return;
+    }
+
+    struct m3u_item item;
+    memset(&item, 0, sizeof(item));
+    item.duration = -1;
+    item.url = url;
+    item.title = radio_browser_span(tokenizer, RADIO_BROWSER_FIELD_NAME);
+    item.tvg_logo = radio_browser_span(tokenizer, RADIO_BROWSER_FIELD_FAVICON);
+    item.group_title = radio_browser_span(tokenizer, RADIO_BROWSER_FIELD_COUNTRY);
+    item.codec = radio_browser_span(tokenizer, RADIO_BROWSER_FIELD_CODEC);
+    item.bitrate = radio_browser_span(tokenizer, RADIO_BROWSER_FIELD_BITRATE);
+    item.tags = radio_browser_span(tokenizer, RADIO_BROWSER_FIELD_TAGS);
+    item.line = tokenizer->line;
+
+    tokenizer->callbacks.item(tokenizer->user, &item);
+}
+
+static int radio_browser_in_object(const struct radio_browser_tokenizer *tokenizer)
+{
+    return tokenizer->depth > 0 && tokenizer->depth <= RADIO_BROWSER_DEPTH_MAX
+        && (tokenizer->objects & (1u << (tokenizer->depth - 1)));
+}
+
+static void radio_browser_open(struct radio_browser_tokenizer *tokenizer, int object)
+{
+    // Stations are the objects of an array, objects nested in a station are skipped
+    if (object && !tokenizer->station_depth && tokenizer->depth > 0 && !radio_browser_in_object(tokenizer)) {
+        tokenizer->station_depth = tokenizer->depth + 1;
+    }
+
+    tokenizer->depth++;
+    if (tokenizer->depth <= RADIO_BROWSER_DEPTH_MAX) {
+        if (object) {
+            tokenizer->objects |= 1u << (tokenizer->depth - 1);
+        } else {
+            tokenizer->objects &= ~(1u << (tokenizer->depth - 1));
+        }
+    }
+
+    tokenizer->expect_key = object;
+}
+
+static void radio_browser_close(struct radio_browser_tokenizer *tokenizer, int object)
+{
+    if (tokenizer->depth == 0) {
+        radio_browser_error(tokenizer, "closing bracket without opening one");
+        return;
+    }
+
+    if (object != radio_browser_in_object(tokenizer) && tokenizer->depth <= RADIO_BROWSER_DEPTH_MAX) {
+        radio_browser_error(tokenizer, "mismatched closing bracket");
+    }
+
+    if (tokenizer->station_depth == tokenizer->depth) {
+        radio_browser_emit_station(tokenizer);
+        radio_browser_clear_fields(tokenizer);
+    }
+
+    tokenizer->depth--;
+    tokenizer->expect_key = 0;
+}
+
+static void radio_browser_end_key(struct radio_browser_tokenizer *tokenizer)
+{
+    tokenizer->value_field = -1;
+
+    for (int i = 0; i < RADIO_BROWSER_FIELD_COUNT; i++) {
+        if ((size_t)tokenizer->key_length == strlen(radio_browser_keys[i])
+            && !memcmp(tokenizer->key, radio_browser_keys[i], tokenizer->key_length)) {
+            tokenizer->value_field = i;
+            break;
+        }
+    }
+}
+
+/**
+ * Select the field receiving the value that starts, if its key is one we keep
+ */
+static void radio_browser_start_value(struct radio_browser_tokenizer *tokenizer)
+{
+    tokenizer->field = -1;
+
+    if (tokenizer->value_field < 0 || tokenizer->station_depth != tokenizer->depth) {
+        return;
+    }
+
+    tokenizer->field = tokenizer->value_field;
+    tokenizer->fields[tokenizer->field].length = 0;
+    tokenizer->value_field = -1;
+}
+
+static int radio_browser_end_unicode(struct radio_browser_tokenizer *tokenizer)
+{
+    unsigned long code = tokenizer->code;
+
+    if (code >= 0xD800 && code <= 0xDBFF) {
+        // First half of a character outside the basic plane, the second one follows
+        tokenizer->high_surrogate = code;
+        return 0;
+    }
+
+    if (code >= 0xDC00 && code <= 0xDFFF) {
+        if (!tokenizer->high_surrogate) {
+            radio_browser_error(tokenizer, "unpaired surrogate");
+            return 0;
+        }
+        code = 0x10000 + ((tokenizer->high_surrogate - 0xD800) << 10) + (code - 0xDC00);
+    } else if (tokenizer->high_surrogate) {
+        radio_browser_error(tokenizer, "unpaired surrogate");
+    }
+
+    tokenizer->high_surrogate = 0;
+    if (!code) {
+        return 0;
+    }
+
+    char out[4];
+    return radio_browser_append(tokenizer, out, m3u_encode_utf8(code, out));
+}
+
+void radio_browser_tokenizer_init(struct radio_browser_tokenizer *tokenizer, const struct m3u_tokenizer_callbacks *callbacks, void *user)
+{
+    memset(tokenizer, 0, sizeof(struct radio_browser_tokenizer));
+    tokenizer->callbacks = *callbacks;
+    tokenizer->user = user;
+    tokenizer->state = RADIO_BROWSER_STATE_VALUE;
+    tokenizer->value_field = -1;
+    tokenizer->field = -1;
+    tokenizer->line = 1;
+}
+
+/**
+ * Parse the next part of the document, the input can be split anywhere
+ *
+ * @return 0 on success, -1 on allocation error. Malformed JSON is reported and skipped.
+ */
+int radio_browser_tokenizer_feed(struct radio_browser_tokenizer *tokenizer, const char *data, size_t size)
+{
+    const char *p = data;
+    const char *end = data + size;
+    tokenizer->bytes += size;
+
+    if (tokenizer->bytes == size && size >= 3 && !memcmp(p, "\xEF\xBB\xBF", 3)) {
+        // UTF-8 byte order mark
+        p += 3;
+    }
+
+    while (p < end) {
+        char c = *p;
+
+        switch (tokenizer->state) {
+        case RADIO_BROWSER_STATE_VALUE:
+            switch (c) {
+            case '\n':
+                tokenizer->line++;
+                break;
+            case ' ':
+            case '\t':
+            case '\r':
+                break;
+            case '{':
+            case '[':
+                radio_browser_open(tokenizer, c == '{');
+                break;
+            case '}':
+            case ']':
+                radio_browser_close(tokenizer, c == '}');
+                break;
+            case ':':
+                tokenizer->expect_key = 0;
+                break;
+            case ',':
+                tokenizer->expect_key = radio_browser_in_object(tokenizer);
+                tokenizer->value_field = -1;
+                break;
+            case '"':
+                tokenizer->in_key = tokenizer->expect_key;
+                if (tokenizer->in_key) {
+                    tokenizer->key_length = 0;
+                    tokenizer->field = -1;
+                } else {
+                    radio_browser_start_value(tokenizer);
+                }
+                tokenizer->high_surrogate = 0;
+                tokenizer->state = RADIO_BROWSER_STATE_STRING;
+                break;
+            default:
+                tokenizer->in_key = 0;
+                radio_browser_start_value(tokenizer);
+                tokenizer->state = RADIO_BROWSER_STATE_LITERAL;
+                continue;
+            }
+            break;
+
+        case RADIO_BROWSER_STATE_STRING: {
+            // Copy runs of plain characters at once
+            const char *run = p;
+            while (p < end && *p != '"' && *p != '\\') {
+                p++;
+            }
+
+            if (radio_browser_append(tokenizer, run, p - run)) {
+                return -1;
+            }
+
+            if (p == end) {
+                continue;
+            }
+
+            if (*p == '\\') {
+                tokenizer->state = RADIO_BROWSER_STATE_ESCAPE;
+            } else {
+                if (tokenizer->in_key) {
+                    radio_browser_end_key(tokenizer);
+                    tokenizer->in_key = 0;
+                }
+                tokenizer->field = -1;
+                tokenizer->state = RADIO_BROWSER_STATE_VALUE;
+            }
+            break;
+        }
+
+        case RADIO_BROWSER_STATE_ESCAPE: {
+            char unescaped = c;
+            switch (c) {
+            case 'b': unescaped = '\b'; break;
+            case 'f': unescaped = '\f'; break;
+            case 'n': unescaped = '\n'; break;
+            case 'r': unescaped = '\r'; break;
+            case 't': unescaped = '\t'; break;
+            case 'u':
+                tokenizer->code = 0;
+                tokenizer->code_digits = 0;
+                tokenizer->state = RADIO_BROWSER_STATE_UNICODE;
+                break;
+            case '"':
+            case '\\':
+            case '/':
+                break;
+            default:
+                radio_browser_error(tokenizer, "unknown escape sequence");
+                break;
+            }
+
+            if (c != 'u') {
+                if (radio_browser_append(tokenizer, &unescaped, 1)) {
+                    return -1;
+                }
+                tokenizer->state = RADIO_BROWSER_STATE_STRING;
+            }
+            break;
+        }
+
+        case RADIO_BROWSER_STATE_UNICODE: {
+            int digit = -1;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                digit = c - 'A' + 10;
+            }
+
+            if (digit < 0) {
+                // Read the character again as part of the string
+                radio_browser_error(tokenizer, "invalid \\u escape");
+                tokenizer->state = RADIO_BROWSER_STATE_STRING;
+                continue;
+            }
+
+            tokenizer->code = (tokenizer->code << 4) | digit;
+            if (++tokenizer->code_digits == 4) {
+                if (radio_browser_end_unicode(tokenizer)) {
+                    return -1;
+                }
+                tokenizer->state = RADIO_BROWSER_STATE_STRING;
+            }
+            break;
+        }
+
+        case RADIO_BROWSER_STATE_LITERAL:
+            if (c == ',' || c == '}' || c == ']' || c == ':' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                tokenizer->field = -1;
+                tokenizer->state = RADIO_BROWSER_STATE_VALUE;
+                continue;
+            }
+
+            // Numbers are kept as text, true, false and null are dropped
+            if (((c >= '0' && c <= '9') || c == '-' || c == '.') && radio_browser_append(tokenizer, &c, 1)) {
+                return -1;
+            }
+            break;
+        }
+
+        p++;
+    }
+
+    return 0;
+}
+
+/**
+ * Report a document cut before its end, a station cut with it is dropped
+ */
+int radio_browser_tokenizer_finish(struct radio_browser_tokenizer *tokenizer)
+{
+    if (tokenizer->state == RADIO_BROWSER_STATE_LITERAL) {
+        tokenizer->state = RADIO_BROWSER_STATE_VALUE;
+    }
+
+    if (tokenizer->state != RADIO_BROWSER_STATE_VALUE || tokenizer->depth > 0) {
+        radio_browser_error(tokenizer, "document ends before its last bracket");
+    }
+
+    tokenizer->state = RADIO_BROWSER_STATE_VALUE;
+    tokenizer->depth = 0;
+    tokenizer->field = -1;
+    radio_browser_clear_fields(tokenizer);
+
+    return 0;
+}
+
+void radio_browser_tokenizer_free(struct radio_browser_tokenizer *tokenizer)
+{
+    for (int i = 0; i < RADIO_BROWSER_FIELD_COUNT; i++) {
+        free(tokenizer->fields[i].data);
+        tokenizer->fields[i].data = NULL;
+        tokenizer->fields[i].length = 0;
+        tokenizer->fields[i].capacity = 0;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef __RADIO_BROWSER_TOKENIZER_H__
+#define __RADIO_BROWSER_TOKENIZER_H__
+
+#include <stddef.h>
+
+#include "../m3u_parser/m3u_tokenizer.h"
+
+#define RADIO_BROWSER_KEY_MAX 16 // longer keys are never ones we look for
+#define RADIO_BROWSER_FIELD_MAX 4096 // longer values are cut
+#define RADIO_BROWSER_DEPTH_MAX 32 // containers nested deeper are skipped
+
+enum radio_browser_field {
+    RADIO_BROWSER_FIELD_NAME,
+    RADIO_BROWSER_FIELD_URL,
+    RADIO_BROWSER_FIELD_URL_RESOLVED,
+    RADIO_BROWSER_FIELD_FAVICON,
+    RADIO_BROWSER_FIELD_TAGS,
+    RADIO_BROWSER_FIELD_CODEC,
+    RADIO_BROWSER_FIELD_BITRATE,
+    RADIO_BROWSER_FIELD_COUNTRY,
+    RADIO_BROWSER_FIELD_COUNT,
+};
+
+struct radio_browser_buffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+
+/**
+ * Incremental parser of Radio-Browser station lists, items are given to the callbacks of the m3u tokenizer
+ *
+ * The input is JSON: an array of station objects, as returned by the Radio-Browser API.
+ * Only the members we use of the current object are kept, it is emitted when the object
+ * closes if it has a URL. Values of other members are scanned without being copied.
+ */
+struct radio_browser_tokenizer {
+    struct m3u_tokenizer_callbacks callbacks;
+    void *user;
+
+    int state;
+    int depth; // open containers
+    unsigned int objects; // bit per depth, set for objects and clear for arrays
+    int expect_key; // next string of the current object is a key
+
+    char key[RADIO_BROWSER_KEY_MAX];
+    int key_length;
+    int in_key;
+    int value_field; // enum radio_browser_field of the value after the key, -1 if not kept
+    int field; // enum radio_browser_field being read, -1 if none
+    unsigned long code; // \uXXXX being read
+    int code_digits;
+    unsigned long high_surrogate;
+
+    int station_depth; // depth of the station object being read, 0 if none
+    struct radio_browser_buffer fields[RADIO_BROWSER_FIELD_COUNT];
+
+    int line;
+    int errors; // malformed JSON and stations without URL
+    size_t bytes; // fed so far
+};
+
+void radio_browser_tokenizer_init(struct radio_browser_tokenizer *tokenizer, const struct m3u_tokenizer_callbacks *callbacks, void *user);
+int radio_browser_tokenizer_feed(struct radio_browser_tokenizer *tokenizer, const char *data, size_t size);
+int radio_browser_tokenizer_finish(struct radio_browser_tokenizer *tokenizer);
+void radio_browser_tokenizer_free(struct radio_browser_tokenizer *tokenizer);
+
+#endif
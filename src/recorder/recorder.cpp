@@ -0,0 +1,347 @@
+#include "recorder.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/threadmgr.h>
+
+#include "../ring_buffer.hpp"
+#include "../trace/trace.hpp"
+
+#define printf sceClibPrintf
+
+#define RECORDER_COMMAND_MAX 8
+#define RECORDER_NAME_MAX 256
+
+enum recorder_command_type {
+	RECORDER_COMMAND_START,
+	RECORDER_COMMAND_SPLIT,
+	RECORDER_COMMAND_STOP,
+};
+
+struct recorder_command {
+	recorder_command_type type;
+	size_t position; // stream position (ring head) where the command applies
+	char name[RECORDER_NAME_MAX]; // file to open for START and SPLIT
+};
+
+// Compressed audio copied by the network callback, drained by the writer thread
+static ring_buffer recorder_ring;
+static unsigned char *recorder_block = NULL;
+static volatile bool recording = false;
+static volatile bool recorder_running = false;
+static volatile unsigned int dropped_bytes = 0;
+
+// Commands from the main thread to the writer thread
+static int recorder_mutex = -1;
+static recorder_command commands[RECORDER_COMMAND_MAX];
+static int command_count = 0;
+static int recorder_thread_id = -1;
+
+// Only used by the main thread
+static char station_name[RECORDER_TITLE_MAX];
+static char current_title[RECORDER_TITLE_MAX];
+static char file_extension[8];
+
+/**
+ * Write up to `size` bytes from the ring to the file, by blocks of RECORDER_WRITE_SIZE
+ *
+ * @param flush also writes the last incomplete block
+ * @return 0 on success, -1 on a write error
+ */
+static int recorder_write(SceUID fd, size_t size, bool flush)
+{
+	if (fd < 0) {
+		// Nothing is being recorded, drop remaining bytes
+		ring_buffer_skip(&recorder_ring, size);
+		return 0;
+	}
+
+	while (size >= RECORDER_WRITE_SIZE || (flush && size > 0)) {
+		size_t block_size = size < RECORDER_WRITE_SIZE ? size : RECORDER_WRITE_SIZE;
+		ring_buffer_read(&recorder_ring, recorder_block, block_size);
+
+		TRACE_BEGIN("recorder write");
+		int ret = sceIoWrite(fd, recorder_block, block_size);
+		TRACE_END("recorder write");
+		if (ret != (int)block_size) {
+			printf("Recorder: write error 0x%X\n", ret);
+			return -1;
+		}
+
+		size -= block_size;
+	}
+
+	return 0;
+}
+
+static int recorder_thread(SceSize args, void *argp)
+{
+	SceUID fd = -1;
+
+	TRACE_THREAD("recorderThread");
+
+	while (recorder_running) {
+		recorder_command command;
+		bool has_command = false;
+
+		TRACE_LOCK(recorder_mutex, "recorder_mutex");
+		if (command_count > 0) {
+			command = commands[0];
+			command_count--;
+			memmove(commands, commands + 1, command_count * sizeof(recorder_command));
+			has_command = true;
+		}
+		sceKernelUnlockMutex(recorder_mutex, 1);
+
+		size_t available = ring_buffer_used(&recorder_ring);
+		size_t size = available;
+		if (has_command) {
+			// Everything before the command belongs to the current file
+			size = command.position - recorder_ring.tail;
+			if (size > available) {
+				size = 0;
+			}
+		}
+
+		if (recorder_write(fd, size, has_command)) {
+			sceIoClose(fd);
+			fd = -1;
+
+			if (!has_command) {
+				recording = false;
+				continue;
+			}
+
+			// The rest of the failed file is dropped, the command still applies
+			size = command.position - recorder_ring.tail;
+			recorder_write(fd, size <= ring_buffer_used(&recorder_ring) ? size : 0, true);
+			if (command.type == RECORDER_COMMAND_STOP) {
+				recording = false;
+			}
+		}
+
+		if (!has_command) {
+			sceKernelDelayThread(50000);
+			continue;
+		}
+
+		if (fd >= 0) {
+			sceIoClose(fd);
+			fd = -1;
+		}
+
+		if (command.type == RECORDER_COMMAND_START || command.type == RECORDER_COMMAND_SPLIT) {
+			char path[RECORDER_NAME_MAX + sizeof(RECORDER_DIRECTORY) + 1];
+			snprintf(path, sizeof(path), "%s/%s", RECORDER_DIRECTORY, command.name);
+
+			fd = sceIoOpen(path, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+			if (fd < 0) {
+				printf("Recorder: cannot create %s (0x%X)\n", path, fd);
+				recording = false;
+			} else {
+				printf("Recorder: recording to %s\n", path);
+			}
+		}
+	}
+
+	if (fd >= 0) {
+		recorder_write(fd, ring_buffer_used(&recorder_ring), true);
+		sceIoClose(fd);
+	}
+
+	return 0;
+}
+
+static void recorder_push_command(recorder_command_type type, size_t position, const char *name)
+{
+	TRACE_LOCK(recorder_mutex, "recorder_mutex");
+
+	if (command_count < RECORDER_COMMAND_MAX) {
+		recorder_command *command = &commands[command_count++];
+		command->type = type;
+		command->position = position;
+		snprintf(command->name, sizeof(command->name), "%s", name ? name : "");
+	} else {
+		printf("Recorder: too many pending commands\n");
+	}
+
+	sceKernelUnlockMutex(recorder_mutex, 1);
+}
+
+static void recorder_file_name(char *name, size_t size, const char *song_title)
+{
+	char date[32];
+	time_t now = time(NULL);
+	strftime(date, sizeof(date), "%Y%m%d-%H%M%S", localtime(&now));
+
+	bool has_title = song_title && song_title[0];
+	snprintf(name, size, "%s - %.64s%s%.96s%s", date, station_name, has_title ? " - " : "", has_title ? song_title : "", file_extension);
+
+	// Remove characters not allowed in file names
+	for (char *c = name; *c; c++) {
+		if (strchr("/\\:*?\"<>|", *c) || (unsigned char)*c < 0x20) {
+			*c = '_';
+		}
+	}
+}
+
+int recorder_init(void)
+{
+	if (ring_buffer_init(&recorder_ring, RECORDER_RING_SIZE)) {
+		printf("Recorder: error allocating ring\n");
+		return -1;
+	}
+
+	recorder_block = (unsigned char*)memalign(64, RECORDER_WRITE_SIZE);
+	if (!recorder_block) {
+		printf("Recorder: error allocating write block\n");
+		ring_buffer_free(&recorder_ring);
+		return -1;
+	}
+
+	recorder_mutex = sceKernelCreateMutex("recorder_mutex", 0, 0, NULL);
+	if (recorder_mutex < 0) {
+		printf("Recorder: error creating mutex\n");
+		free(recorder_block);
+		ring_buffer_free(&recorder_ring);
+		return -1;
+	}
+
+	sceIoMkdir(RECORDER_DIRECTORY, 0777);
+
+	// Lower priority than network and audio threads, memory card I/O can wait
+	recorder_running = true;
+	recorder_thread_id = sceKernelCreateThread("recorderThread", recorder_thread, 0x10000100 + 10, 0x4000, 0, 0, NULL);
+	if (recorder_thread_id < 0) {
+		printf("Recorder: error creating thread with id %i\n", recorder_thread_id);
+		recorder_running = false;
+		sceKernelDeleteMutex(recorder_mutex);
+		free(recorder_block);
+		ring_buffer_free(&recorder_ring);
+		return -1;
+	}
+
+	sceKernelStartThread(recorder_thread_id, 0, NULL);
+
+	return 0;
+}
+
+void recorder_term(void)
+{
+	if (recorder_thread_id < 0) {
+		return;
+	}
+
+	recorder_stop();
+	recorder_running = false;
+
+	SceUInt timeout = 5000000;
+	sceKernelWaitThreadEnd(recorder_thread_id, NULL, &timeout);
+	sceKernelDeleteThread(recorder_thread_id);
+	recorder_thread_id = -1;
+
+	sceKernelDeleteMutex(recorder_mutex);
+	free(recorder_block);
+	ring_buffer_free(&recorder_ring);
+}
+
+/**
+ * Start copying the compressed stream to a new file
+ *
+ * @param extension is the file extension matching the stream format, e.g. ".mp3"
+ */
+int recorder_start(const char *station, const char *song_title, const char *extension)
+{
+	if (recording || recorder_thread_id < 0) {
+		return -1;
+	}
+
+	snprintf(station_name, sizeof(station_name), "%s", station ? station : "Webradio");
+	snprintf(current_title, sizeof(current_title), "%s", song_title ? song_title : "");
+	snprintf(file_extension, sizeof(file_extension), "%s", extension);
+
+	char name[RECORDER_NAME_MAX];
+	recorder_file_name(name, sizeof(name), song_title);
+
+	size_t position = recorder_ring.head;
+	dropped_bytes = 0;
+	recorder_push_command(RECORDER_COMMAND_START, position, name);
+	recording = true;
+
+	return 0;
+}
+
+void recorder_stop(void)
+{
+	if (!recording) {
+		return;
+	}
+
+	recording = false;
+	recorder_push_command(RECORDER_COMMAND_STOP, recorder_ring.head, NULL);
+
+	if (dropped_bytes) {
+		printf("Recorder: %u bytes dropped, memory card too slow\n", dropped_bytes);
+	}
+}
+
+/**
+ * Continue the recording in a new file when the song changes
+ *
+ * @param position is the recorder_position() taken with the ICY metadata block which announced
+ * the new title, the split happens there
+ */
+void recorder_split(const char *song_title, size_t position)
+{
+	if (!recording || !song_title || !strncmp(current_title, song_title, sizeof(current_title) - 1)) {
+		return;
+	}
+
+	snprintf(current_title, sizeof(current_title), "%s", song_title);
+
+	char name[RECORDER_NAME_MAX];
+	recorder_file_name(name, sizeof(name), song_title);
+	recorder_push_command(RECORDER_COMMAND_SPLIT, position, name);
+}
+
+bool recorder_is_recording(void)
+{
+	return recording;
+}
+
+unsigned int recorder_dropped_bytes(void)
+{
+	return dropped_bytes;
+}
+
+/**
+ * Copy compressed audio bytes to the recording, called from the network callback
+ *
+ * Never blocks: bytes are dropped if the writer thread is too late.
+ */
+void recorder_tee(const void *data, size_t size)
+{
+	if (!recording || size == 0) {
+		return;
+	}
+
+	size_t written = ring_buffer_write(&recorder_ring, data, size);
+	if (written < size) {
+		dropped_bytes += size - written;
+	}
+}
+
+/**
+ * Stream position of the next byte given to recorder_tee, called from the network callback
+ */
+size_t recorder_position(void)
+{
+	return recorder_ring.head;
+}
@@ -0,0 +1,23 @@
+#ifndef __RECORDER_HPP__
+#define __RECORDER_HPP__
+
+#include <stddef.h>
+
+#define RECORDER_DIRECTORY "ux0:/data/webradio/recordings"
+#define RECORDER_RING_SIZE (1024 * 1024) // ~25s of a 320 kbps stream
+#define RECORDER_WRITE_SIZE (64 * 1024) // memory card writes are done by blocks of this size
+#define RECORDER_TITLE_MAX 128
+
+int recorder_init(void);
+void recorder_term(void);
+
+int recorder_start(const char *station, const char *song_title, const char *extension);
+void recorder_stop(void);
+void recorder_split(const char *song_title, size_t position);
+bool recorder_is_recording(void);
+unsigned int recorder_dropped_bytes(void);
+
+void recorder_tee(const void *data, size_t size);
+size_t recorder_position(void);
+
+#endif
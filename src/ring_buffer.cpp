@@ -0,0 +1,110 @@
+#include "ring_buffer.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+int ring_buffer_init(ring_buffer *ring, size_t size)
+{
+	if (size & (size - 1)) {
+		return -1;
+	}
+
+	ring->data = (unsigned char*)memalign(64, size);
+	if (!ring->data) {
+		return -1;
+	}
+
+	ring->size = size;
+	ring->head = 0;
+	ring->tail = 0;
+
+	return 0;
+}
+
+void ring_buffer_free(ring_buffer *ring)
+{
+	if (ring->data) {
+		free(ring->data);
+		ring->data = NULL;
+	}
+}
+
+size_t ring_buffer_used(const ring_buffer *ring)
+{
+	return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Producer side, never blocks
+ *
+ * @return the number of bytes written, less than size if the ring is full
+ */
+size_t ring_buffer_write(ring_buffer *ring, const void *data, size_t size)
+{
+	size_t head = ring->head;
+	size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	size_t free_size = ring->size - (head - tail);
+
+	if (size > free_size) {
+		size = free_size;
+	}
+
+	size_t offset = head & (ring->size - 1);
+	size_t first = ring->size - offset;
+	if (first > size) {
+		first = size;
+	}
+
+	memcpy(ring->data + offset, data, first);
+	memcpy(ring->data, (const unsigned char*)data + first, size - first);
+
+	__atomic_store_n(&ring->head, head + size, __ATOMIC_RELEASE);
+
+	return size;
+}
+
+/**
+ * Consumer side, never blocks
+ *
+ * @return the number of bytes read, less than size if the ring is empty
+ */
+size_t ring_buffer_read(ring_buffer *ring, void *data, size_t size)
+{
+	size_t tail = ring->tail;
+	size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+	if (size > head - tail) {
+		size = head - tail;
+	}
+
+	size_t offset = tail & (ring->size - 1);
+	size_t first = ring->size - offset;
+	if (first > size) {
+		first = size;
+	}
+
+	memcpy(data, ring->data + offset, first);
+	memcpy((unsigned char*)data + first, ring->data, size - first);
+
+	__atomic_store_n(&ring->tail, tail + size, __ATOMIC_RELEASE);
+
+	return size;
+}
+
+/**
+ * Consumer side, drop up to size bytes without copying them
+ */
+size_t ring_buffer_skip(ring_buffer *ring, size_t size)
+{
+	size_t tail = ring->tail;
+	size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+	if (size > head - tail) {
+		size = head - tail;
+	}
+
+	__atomic_store_n(&ring->tail, tail + size, __ATOMIC_RELEASE);
+
+	return size;
+}
@@ -0,0 +1,26 @@
+#ifndef __RING_BUFFER_HPP__
+#define __RING_BUFFER_HPP__
+
+#include <stddef.h>
+
+/**
+ * Lock-free byte ring with a single producer and a single consumer
+ *
+ * head and tail count every byte ever written and read, so their
+ * difference is the fill level and they can be used as stream positions.
+ */
+struct ring_buffer {
+	unsigned char *data;
+	size_t size; // power of two
+	volatile size_t head; // only written by the producer
+	volatile size_t tail; // only written by the consumer
+};
+
+int ring_buffer_init(ring_buffer *ring, size_t size);
+void ring_buffer_free(ring_buffer *ring);
+size_t ring_buffer_used(const ring_buffer *ring);
+size_t ring_buffer_write(ring_buffer *ring, const void *data, size_t size);
+size_t ring_buffer_read(ring_buffer *ring, void *data, size_t size);
+size_t ring_buffer_skip(ring_buffer *ring, size_t size);
+
+#endif
@@ -0,0 +1,123 @@
+#include "scheduler.hpp"
+
+#include <stdlib.h>
+
+#include <psp2/ctrl.h>
+#include <psp2/touch.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#include "../metrics/metrics.hpp"
+
+// Only used by the main thread
+static SceUInt64 animated_interval = 1000000 / 60;
+static SceUInt64 last_frame = 0;
+static unsigned int last_signature = 0;
+static scheduler_mode last_mode = SCHEDULER_MODE_STATIC;
+static unsigned int last_buttons = 0;
+static int input_frames = 0;
+
+/**
+ * @param touch also counts touch screen and analog stick activity
+ */
+static bool scheduler_has_input(bool touch)
+{
+	SceCtrlData ctrl;
+	sceCtrlPeekBufferPositive(0, &ctrl, 1);
+
+	bool changed = ctrl.buttons != last_buttons;
+	last_buttons = ctrl.buttons;
+
+	if (changed || !touch) {
+		return changed;
+	}
+
+	if (abs(ctrl.lx - 128) > SCHEDULER_STICK_DEADZONE || abs(ctrl.ly - 128) > SCHEDULER_STICK_DEADZONE) {
+		return true;
+	}
+
+	SceTouchData touch_data;
+	return sceTouchPeek(SCE_TOUCH_PORT_FRONT, &touch_data, 1) >= 0 && touch_data.reportNum > 0;
+}
+
+/**
+ * Limit the visualizer frame rate, 60 or more follows vsync
+ */
+void scheduler_set_rate(int fps)
+{
+	animated_interval = fps > 0 ? 1000000 / fps : 1000000 / 60;
+}
+
+/**
+ * Sleep until the next frame has to be drawn, the time slept goes to the decoder threads
+ *
+ * @param signature changes when something shown on screen changed, e.g. player state or metadata,
+ *   it is checked while waiting
+ * @return false when woken up by a change in SCHEDULER_MODE_IDLE: the caller handles it without drawing
+ */
+bool scheduler_wait_frame(scheduler_mode mode, unsigned int (*signature)(void))
+{
+	SceUInt64 start = sceKernelGetProcessTimeWide();
+	SceUInt64 interval = 0;
+
+	if (mode == SCHEDULER_MODE_ANIMATED) {
+		interval = animated_interval;
+	} else if (mode == SCHEDULER_MODE_STATIC) {
+		interval = 1000000 / SCHEDULER_STATIC_FPS;
+	}
+
+	if (mode != last_mode) {
+		// The screen switched to or from the black view, show it once
+		last_mode = mode;
+		last_signature = signature();
+		input_frames = input_frames > 0 ? input_frames : 1;
+	}
+
+	bool draw = true;
+	SceUInt64 now = start;
+	while (true) {
+		unsigned int current_signature = signature();
+		if (current_signature != last_signature) {
+			last_signature = current_signature;
+			if (mode == SCHEDULER_MODE_IDLE) {
+				draw = false;
+				break;
+			}
+			input_frames = SCHEDULER_INPUT_FRAMES;
+		}
+
+		if (scheduler_has_input(mode != SCHEDULER_MODE_IDLE)) {
+			input_frames = mode == SCHEDULER_MODE_IDLE ? 1 : SCHEDULER_INPUT_FRAMES;
+		}
+
+		if (input_frames > 0) {
+			input_frames--;
+			break;
+		}
+
+		// At 60 frames per second vsync already paces the loop
+		if (mode == SCHEDULER_MODE_ANIMATED && animated_interval <= 1000000 / 60) {
+			break;
+		}
+
+		SceUInt64 since_frame = now - last_frame;
+		if (interval && since_frame >= interval) {
+			break;
+		}
+
+		SceUInt64 delay = SCHEDULER_POLL;
+		if (interval && interval - since_frame < delay) {
+			delay = interval - since_frame;
+		}
+
+		sceKernelDelayThread(delay);
+		now = sceKernelGetProcessTimeWide();
+	}
+
+	metrics_add_idle(now - start);
+	if (draw) {
+		last_frame = now;
+	}
+
+	return draw;
+}
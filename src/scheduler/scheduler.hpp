@@ -0,0 +1,18 @@
+#ifndef __SCHEDULER_HPP__
+#define __SCHEDULER_HPP__
+
+#define SCHEDULER_STATIC_FPS 4 // menus still follow the stream status without input
+#define SCHEDULER_INPUT_FRAMES 30 // full rate frames after an input, for ImGui hover and scrolling
+#define SCHEDULER_POLL 8000 // microseconds between input checks while waiting
+#define SCHEDULER_STICK_DEADZONE 40
+
+enum scheduler_mode {
+	SCHEDULER_MODE_IDLE, // nothing on screen, a frame only when a button changes, wakes up without frame on other changes
+	SCHEDULER_MODE_STATIC, // menus, on input and changes or at SCHEDULER_STATIC_FPS
+	SCHEDULER_MODE_ANIMATED, // visualizers, capped to the configured rate
+};
+
+void scheduler_set_rate(int fps);
+bool scheduler_wait_frame(scheduler_mode mode, unsigned int (*signature)(void));
+
+#endif
@@ -0,0 +1,598 @@
+#include "timeshift.hpp"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/threadmgr.h>
+
+#include "../ring_buffer.hpp"
+#include "../trace/trace.hpp"
+
+extern "C" {
+	#include "../audio/aac.h"
+}
+
+#define printf sceClibPrintf
+
+#define TIMESHIFT_FILE_SIZE ((uint64_t)TIMESHIFT_MINUTES * TIMESHIFT_BYTES_PER_MINUTE)
+#define TIMESHIFT_INDEX_SPACING ((int64_t)TIMESHIFT_MINUTES * 60 * 1000000 / TIMESHIFT_INDEX_SIZE)
+
+struct timeshift_index_entry {
+	uint64_t offset; // stream position of a frame header
+	int64_t time; // media time of the frame in microseconds
+};
+
+static ring_buffer staging;
+static unsigned char *block = NULL;
+static SceUID fd = -1;
+static SceUID timeshift_thread_id = -1;
+static timeshift_sink sink = NULL;
+static int timeshift_mutex = -1;
+
+static volatile bool running = false;
+static volatile bool active = false; // network bytes are copied to the file
+static volatile bool live = true; // network bytes go straight to the decoder
+static volatile bool paused = false;
+
+// Protected by timeshift_mutex
+static bool pending_start = false;
+static bool pending_stop = false;
+static size_t start_head = 0;
+static bool start_adts = false;
+static uint64_t write_pos = 0; // stream bytes written to the file
+static uint64_t play_pos = 0; // next stream byte given to the decoder when behind live
+static size_t in_flight = 0; // bytes taken from staging but not yet written
+static timeshift_index_entry index_entries[TIMESHIFT_INDEX_SIZE];
+static int index_first = 0;
+static int index_count = 0;
+
+// Frame scanner, only used by the timeshift thread
+static struct {
+	bool adts;
+	size_t skip; // bytes left in the current frame
+	unsigned char header[8];
+	int header_length;
+	int64_t time;
+	int64_t last_index_time;
+} scanner;
+
+static const int mp3_bitrates[2][3][16] = {
+	{ // MPEG 1, layers I, II, III
+		{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0},
+		{0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},
+		{0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},
+	},
+	{ // MPEG 2 and 2.5, layers I, II, III
+		{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0},
+		{0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},
+		{0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},
+	},
+};
+
+static const int mp3_samplerates[3] = {44100, 48000, 32000};
+
+static int parse_mp3_header(const unsigned char *data, int *frame_length, int *samples, int *samplerate)
+{
+	if (data[0] != 0xFF || (data[1] & 0xE0) != 0xE0) {
+		return -1;
+	}
+
+	int version = (data[1] >> 3) & 0x03; // 0: MPEG 2.5, 2: MPEG 2, 3: MPEG 1
+	int layer = 4 - ((data[1] >> 1) & 0x03);
+	int bitrate_index = data[2] >> 4;
+	int samplerate_index = (data[2] >> 2) & 0x03;
+	int padding = (data[2] >> 1) & 0x01;
+
+	if (version == 1 || layer == 4 || samplerate_index == 3) {
+		return -1;
+	}
+
+	int lsf = version != 3;
+	int bitrate = mp3_bitrates[lsf][layer - 1][bitrate_index];
+	if (!bitrate) {
+		// Free format or invalid
+		return -1;
+	}
+
+	*samplerate = mp3_samplerates[samplerate_index] >> (version == 3 ? 0 : version == 2 ? 1 : 2);
+
+	if (layer == 1) {
+		*frame_length = (12000 * bitrate / *samplerate + padding) * 4;
+		*samples = 384;
+	} else if (layer == 2 || !lsf) {
+		*frame_length = 144000 * bitrate / *samplerate + padding;
+		*samples = 1152;
+	} else {
+		*frame_length = 72000 * bitrate / *samplerate + padding;
+		*samples = 576;
+	}
+
+	return 0;
+}
+
+/**
+ * Find the index entry with the biggest offset lower or equal to position
+ *
+ * @return the logical entry number, -1 if position is before the first entry
+ */
+static int timeshift_index_find(uint64_t position)
+{
+	int low = 0;
+	int high = index_count - 1;
+	int found = -1;
+
+	while (low <= high) {
+		int middle = (low + high) / 2;
+		if (index_entries[(index_first + middle) % TIMESHIFT_INDEX_SIZE].offset <= position) {
+			found = middle;
+			low = middle + 1;
+		} else {
+			high = middle - 1;
+		}
+	}
+
+	return found;
+}
+
+static timeshift_index_entry *timeshift_index_get(int entry)
+{
+	return &index_entries[(index_first + entry) % TIMESHIFT_INDEX_SIZE];
+}
+
+static int64_t timeshift_time_at(uint64_t position)
+{
+	if (!index_count) {
+		return 0;
+	}
+
+	int entry = timeshift_index_find(position);
+	return timeshift_index_get(entry < 0 ? 0 : entry)->time;
+}
+
+static void timeshift_index_add(uint64_t offset, int64_t time)
+{
+	TRACE_LOCK(timeshift_mutex, "timeshift_mutex");
+
+	if (index_count == TIMESHIFT_INDEX_SIZE) {
+		index_first = (index_first + 1) % TIMESHIFT_INDEX_SIZE;
+		index_count--;
+	}
+
+	timeshift_index_entry *entry = &index_entries[(index_first + index_count) % TIMESHIFT_INDEX_SIZE];
+	entry->offset = offset;
+	entry->time = time;
+	index_count++;
+
+	sceKernelUnlockMutex(timeshift_mutex, 1);
+}
+
+/**
+ * Find MP3 or ADTS frames in bytes written at `position` and index them
+ */
+static void timeshift_scan(const unsigned char *data, size_t size, uint64_t position)
+{
+	int header_size = scanner.adts ? 7 : 4;
+	size_t i = 0;
+
+	while (i < size) {
+		if (scanner.skip > 0) {
+			size_t skip = size - i < scanner.skip ? size - i : scanner.skip;
+			scanner.skip -= skip;
+			i += skip;
+			continue;
+		}
+
+		scanner.header[scanner.header_length++] = data[i++];
+		if (scanner.header_length < header_size) {
+			continue;
+		}
+
+		int frame_length = 0;
+		int samples = 0;
+		int samplerate = 0;
+		int ret = 0;
+		if (scanner.adts) {
+			adts_header_t adts_header;
+			ret = parse_adts_header(scanner.header, scanner.header_length, &adts_header);
+			frame_length = adts_header.frame_length;
+			samples = 1024 * ((scanner.header[6] & 0x03) + 1);
+			samplerate = adts_header.sample_rate;
+		} else {
+			ret = parse_mp3_header(scanner.header, &frame_length, &samples, &samplerate);
+		}
+
+		if (ret || frame_length < header_size) {
+			// Not a frame header, resync one byte further
+			scanner.header_length--;
+			memmove(scanner.header, scanner.header + 1, scanner.header_length);
+			continue;
+		}
+
+		if (!index_count || scanner.time - scanner.last_index_time >= TIMESHIFT_INDEX_SPACING) {
+			timeshift_index_add(position + i - scanner.header_length, scanner.time);
+			scanner.last_index_time = scanner.time;
+		}
+
+		scanner.time += (int64_t)samples * 1000000 / samplerate;
+		scanner.skip = frame_length - scanner.header_length;
+		scanner.header_length = 0;
+	}
+}
+
+/**
+ * Give bytes read back from the file to the decoder
+ */
+static void timeshift_feed(void)
+{
+	if (live || paused || !active) {
+		return;
+	}
+
+	TRACE_LOCK(timeshift_mutex, "timeshift_mutex");
+	uint64_t position = play_pos;
+	uint64_t available = write_pos > play_pos ? write_pos - play_pos : 0;
+	sceKernelUnlockMutex(timeshift_mutex, 1);
+
+	uint64_t file_offset = position % TIMESHIFT_FILE_SIZE;
+	size_t size = TIMESHIFT_BLOCK_SIZE;
+	if (size > available) {
+		size = available;
+	}
+	if (size > TIMESHIFT_FILE_SIZE - file_offset) {
+		size = TIMESHIFT_FILE_SIZE - file_offset;
+	}
+
+	if (!size) {
+		return;
+	}
+
+	TRACE_BEGIN("timeshift read");
+	int ret = sceIoPread(fd, block, size, file_offset);
+	TRACE_END("timeshift read");
+	if (ret <= 0) {
+		printf("Timeshift: read error 0x%X\n", ret);
+		return;
+	}
+
+	size_t accepted = sink(block, ret);
+
+	TRACE_LOCK(timeshift_mutex, "timeshift_mutex");
+	if (play_pos == position) {
+		play_pos += accepted;
+	}
+	sceKernelUnlockMutex(timeshift_mutex, 1);
+}
+
+static int timeshift_thread(SceSize args, void *argp)
+{
+	TRACE_THREAD("timeshiftThread");
+
+	while (running) {
+		TRACE_LOCK(timeshift_mutex, "timeshift_mutex");
+
+		if (pending_stop) {
+			ring_buffer_skip(&staging, ring_buffer_used(&staging));
+			pending_stop = false;
+		}
+
+		if (pending_start) {
+			// Bytes teed before the start belong to the previous stream
+			size_t old_bytes = start_head - staging.tail;
+			if (old_bytes <= ring_buffer_used(&staging)) {
+				ring_buffer_skip(&staging, old_bytes);
+			}
+
+			write_pos = 0;
+			play_pos = 0;
+			index_first = 0;
+			index_count = 0;
+			memset(&scanner, 0, sizeof(scanner));
+			scanner.adts = start_adts;
+			pending_start = false;
+		}
+
+		size_t used = ring_buffer_used(&staging);
+		bool waiting_data = !live && !paused && play_pos >= write_pos;
+
+		sceKernelUnlockMutex(timeshift_mutex, 1);
+
+		if (!active) {
+			ring_buffer_skip(&staging, used);
+			sceKernelDelayThread(50000);
+			continue;
+		}
+
+		// Batch small writes unless the decoder is waiting for them
+		if (used >= TIMESHIFT_BLOCK_SIZE || (used > 0 && waiting_data)) {
+			uint64_t file_offset = write_pos % TIMESHIFT_FILE_SIZE;
+			size_t size = used < TIMESHIFT_BLOCK_SIZE ? used : TIMESHIFT_BLOCK_SIZE;
+			if (size > TIMESHIFT_FILE_SIZE - file_offset) {
+				size = TIMESHIFT_FILE_SIZE - file_offset;
+			}
+
+			TRACE_LOCK(timeshift_mutex, "timeshift_mutex");
+
+			if (write_pos + size > TIMESHIFT_FILE_SIZE) {
+				// The oldest data is about to be overwritten
+				uint64_t oldest = write_pos + size - TIMESHIFT_FILE_SIZE;
+				while (index_count > 0 && timeshift_index_get(0)->offset < oldest) {
+					index_first = (index_first + 1) % TIMESHIFT_INDEX_SIZE;
+					index_count--;
+				}
+
+				if (!live && play_pos < oldest) {
+					play_pos = index_count > 0 ? timeshift_index_get(0)->offset : oldest;
+					printf("Timeshift: paused for too long, moving to the oldest data\n");
+				}
+			}
+
+			in_flight = size;
+			ring_buffer_read(&staging, block, size);
+
+			sceKernelUnlockMutex(timeshift_mutex, 1);
+
+			TRACE_BEGIN("timeshift write");
+			int ret = sceIoPwrite(fd, block, size, file_offset);
+			TRACE_END("timeshift write");
+			if (ret != (int)size) {
+				printf("Timeshift: write error 0x%X\n", ret);
+			}
+
+			timeshift_scan(block, size, write_pos);
+
+			TRACE_LOCK(timeshift_mutex, "timeshift_mutex");
+			write_pos += size;
+			in_flight = 0;
+			sceKernelUnlockMutex(timeshift_mutex, 1);
+		}
+
+		timeshift_feed();
+
+		if (ring_buffer_used(&staging) < TIMESHIFT_BLOCK_SIZE) {
+			sceKernelDelayThread(20000);
+		}
+	}
+
+	return 0;
+}
+
+int timeshift_init(timeshift_sink feed_sink)
+{
+	sink = feed_sink;
+
+	if (ring_buffer_init(&staging, TIMESHIFT_STAGING_SIZE)) {
+		printf("Timeshift: error allocating staging buffer\n");
+		return -1;
+	}
+
+	block = (unsigned char*)memalign(64, TIMESHIFT_BLOCK_SIZE);
+	if (!block) {
+		printf("Timeshift: error allocating block\n");
+		ring_buffer_free(&staging);
+		return -1;
+	}
+
+	fd = sceIoOpen(TIMESHIFT_FILE, SCE_O_RDWR | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+	if (fd < 0) {
+		printf("Timeshift: cannot create %s (0x%X)\n", TIMESHIFT_FILE, fd);
+		free(block);
+		ring_buffer_free(&staging);
+		return -1;
+	}
+
+	timeshift_mutex = sceKernelCreateMutex("timeshift_mutex", 0, 0, NULL);
+	if (timeshift_mutex < 0) {
+		printf("Timeshift: error creating mutex\n");
+		sceIoClose(fd);
+		free(block);
+		ring_buffer_free(&staging);
+		return -1;
+	}
+
+	running = true;
+	timeshift_thread_id = sceKernelCreateThread("timeshiftThread", timeshift_thread, 0x10000100 + 5, 0x4000, 0, 0, NULL);
+	if (timeshift_thread_id < 0) {
+		printf("Timeshift: error creating thread with id %i\n", timeshift_thread_id);
+		running = false;
+		sceKernelDeleteMutex(timeshift_mutex);
+		sceIoClose(fd);
+		free(block);
+		ring_buffer_free(&staging);
+		return -1;
+	}
+
+	sceKernelStartThread(timeshift_thread_id, 0, NULL);
+
+	return 0;
+}
+
+void timeshift_term(void)
+{
+	if (timeshift_thread_id < 0) {
+		return;
+	}
+
+	timeshift_stop();
+	running = false;
+
+	SceUInt timeout = 5000000;
+	sceKernelWaitThreadEnd(timeshift_thread_id, NULL, &timeout);
+	sceKernelDeleteThread(timeshift_thread_id);
+	timeshift_thread_id = -1;
+
+	sceKernelDeleteMutex(timeshift_mutex);
+	sceIoClose(fd);
+	sceIoRemove(TIMESHIFT_FILE);
+	free(block);
+	ring_buffer_free(&staging);
+}
+
+/**
+ * Start keeping a new stream
+ *
+ * @param adts is true for AAC streams, false for MPEG audio
+ */
+void timeshift_start(bool adts)
+{
+	if (timeshift_thread_id < 0) {
+		return;
+	}
+
+	TRACE_LOCK(timeshift_mutex, "timeshift_mutex");
+	start_head = staging.head;
+	start_adts = adts;
+	pending_start = true;
+	live = true;
+	paused = false;
+	active = true;
+	sceKernelUnlockMutex(timeshift_mutex, 1);
+}
+
+void timeshift_stop(void)
+{
+	if (timeshift_thread_id < 0) {
+		return;
+	}
+
+	TRACE_LOCK(timeshift_mutex, "timeshift_mutex");
+	active = false;
+	live = true;
+	paused = false;
+	pending_stop = true;
+	sceKernelUnlockMutex(timeshift_mutex, 1);
+}
+
+/**
+ * Copy stream bytes to the timeshift file, called from the network callback
+ */
+void timeshift_tee(const void *data, size_t size)
+{
+	if (!active || size == 0) {
+		return;
+	}
+
+	if (ring_buffer_write(&staging, data, size) < size) {
+		printf("Timeshift: staging buffer full, memory card too slow\n");
+	}
+}
+
+bool timeshift_is_active(void)
+{
+	return active;
+}
+
+bool timeshift_is_live(void)
+{
+	return live;
+}
+
+bool timeshift_is_paused(void)
+{
+	return paused;
+}
+
+/**
+ * @return the number of seconds between playback and the live stream
+ */
+int timeshift_delay(void)
+{
+	if (live || !active) {
+		return 0;
+	}
+
+	TRACE_LOCK(timeshift_mutex, "timeshift_mutex");
+	int64_t delay = index_count ? timeshift_index_get(index_count - 1)->time - timeshift_time_at(play_pos) : 0;
+	sceKernelUnlockMutex(timeshift_mutex, 1);
+
+	return delay / 1000000;
+}
+
+/**
+ * Stop playback while the stream keeps being downloaded to the file
+ *
+ * Must be called with the decoder buffer locked, which is then flushed by the caller.
+ *
+ * @param buffered is the number of bytes given to the decoder but not yet played
+ */
+void timeshift_pause(size_t buffered)
+{
+	if (!active) {
+		return;
+	}
+
+	TRACE_LOCK(timeshift_mutex, "timeshift_mutex");
+
+	if (live) {
+		play_pos = write_pos + in_flight + ring_buffer_used(&staging);
+		live = false;
+	}
+
+	// Bytes already given to the decoder will be played again on resume
+	play_pos = play_pos > buffered ? play_pos - buffered : 0;
+
+	paused = true;
+
+	sceKernelUnlockMutex(timeshift_mutex, 1);
+}
+
+void timeshift_resume(void)
+{
+	paused = false;
+}
+
+/**
+ * Move playback in the kept stream, through the frame index
+ *
+ * Seeking past the live stream goes back to live, and resumes playback if it was paused.
+ *
+ * @return true if the decoder buffer must be flushed
+ */
+bool timeshift_seek(int seconds)
+{
+	if (!active) {
+		return false;
+	}
+
+	TRACE_LOCK(timeshift_mutex, "timeshift_mutex");
+
+	if (!index_count || (live && seconds >= 0)) {
+		sceKernelUnlockMutex(timeshift_mutex, 1);
+		return false;
+	}
+
+	int64_t live_time = timeshift_index_get(index_count - 1)->time;
+	int64_t current_time = live ? live_time : timeshift_time_at(play_pos);
+	int64_t target = current_time + (int64_t)seconds * 1000000;
+
+	if (target >= live_time) {
+		// Live data does not wait, the pause ends here
+		live = true;
+		paused = false;
+		printf("Timeshift: back to live\n");
+	} else {
+		// Last entry at or before the target time, or the oldest one
+		int entry = 0;
+		for (int low = 0, high = index_count - 1; low <= high;) {
+			int middle = (low + high) / 2;
+			if (timeshift_index_get(middle)->time <= target) {
+				entry = middle;
+				low = middle + 1;
+			} else {
+				high = middle - 1;
+			}
+		}
+
+		play_pos = timeshift_index_get(entry)->offset;
+		live = false;
+		printf("Timeshift: %i seconds behind live\n", (int)((live_time - timeshift_index_get(entry)->time) / 1000000));
+	}
+
+	sceKernelUnlockMutex(timeshift_mutex, 1);
+
+	return true;
+}
@@ -0,0 +1,37 @@
+#ifndef __TIMESHIFT_HPP__
+#define __TIMESHIFT_HPP__
+
+#include <stddef.h>
+
+#define TIMESHIFT_FILE "ux0:/data/webradio/timeshift.bin"
+#define TIMESHIFT_MINUTES 30
+#define TIMESHIFT_BYTES_PER_MINUTE (320 / 8 * 1000 * 60) // file sized for 320 kbps streams
+#define TIMESHIFT_STAGING_SIZE (512 * 1024) // network bytes waiting to be written to the file
+#define TIMESHIFT_BLOCK_SIZE (32 * 1024) // file reads and writes are done by blocks of this size
+#define TIMESHIFT_INDEX_SIZE 4096 // frame index entries, whatever the timeshift length
+#define TIMESHIFT_FEED_AHEAD (64 * 1024) // bytes given in advance to the decoder when behind live
+
+/**
+ * Receives stream bytes read back from the file
+ *
+ * @return the number of bytes accepted
+ */
+typedef size_t (*timeshift_sink)(const unsigned char *data, size_t size);
+
+int timeshift_init(timeshift_sink sink);
+void timeshift_term(void);
+
+void timeshift_start(bool adts);
+void timeshift_stop(void);
+void timeshift_tee(const void *data, size_t size);
+
+bool timeshift_is_active(void);
+bool timeshift_is_live(void);
+bool timeshift_is_paused(void);
+int timeshift_delay(void);
+
+void timeshift_pause(size_t buffered);
+void timeshift_resume(void);
+bool timeshift_seek(int seconds);
+
+#endif
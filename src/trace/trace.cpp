@@ -0,0 +1,166 @@
+#include "trace.hpp"
+
+#ifdef WEBRADIO_TRACE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/processmgr.h>
+
+#define printf sceClibPrintf
+
+struct trace_record {
+	uint64_t timestamp; // microseconds, monotonic
+	const char *name; // must be a string literal
+	char phase; // 'B' or 'E'
+};
+
+// One ring per thread, so recording an event never takes a lock
+struct trace_thread {
+	volatile SceUID thread_id;
+	char name[32];
+	volatile unsigned int head;
+	trace_record records[TRACE_EVENTS_PER_THREAD];
+};
+
+static trace_thread threads[TRACE_MAX_THREADS];
+static volatile int thread_count = 0;
+static volatile bool recording = true;
+
+static trace_thread *trace_find_thread(SceUID thread_id)
+{
+	int count = __atomic_load_n(&thread_count, __ATOMIC_ACQUIRE);
+	for (int i = 0; i < count; i++) {
+		if (threads[i].thread_id == thread_id) {
+			return &threads[i];
+		}
+	}
+
+	return NULL;
+}
+
+static trace_thread *trace_add_thread(SceUID thread_id, const char *name)
+{
+	int slot = __atomic_fetch_add(&thread_count, 1, __ATOMIC_ACQ_REL);
+	if (slot >= TRACE_MAX_THREADS) {
+		__atomic_fetch_sub(&thread_count, 1, __ATOMIC_ACQ_REL);
+		return NULL;
+	}
+
+	trace_thread *thread = &threads[slot];
+	if (name) {
+		snprintf(thread->name, sizeof(thread->name), "%s", name);
+	} else {
+		snprintf(thread->name, sizeof(thread->name), "thread 0x%X", thread_id);
+	}
+	thread->head = 0;
+	__atomic_store_n(&thread->thread_id, thread_id, __ATOMIC_RELEASE);
+
+	return thread;
+}
+
+static trace_thread *trace_find_name(const char *name)
+{
+	int count = __atomic_load_n(&thread_count, __ATOMIC_ACQUIRE);
+	for (int i = 0; i < count; i++) {
+		if (!strcmp(threads[i].name, name)) {
+			return &threads[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Give a name to the calling thread in the trace
+ *
+ * Threads started again for each job, like the prober, reuse the ring of the previous one
+ * so they keep being traced. Events of the previous thread stay, shown under the new ID.
+ */
+void trace_register_thread(const char *name)
+{
+	SceUID thread_id = sceKernelGetThreadId();
+	trace_thread *thread = trace_find_thread(thread_id);
+
+	char short_name[sizeof(thread->name)];
+	snprintf(short_name, sizeof(short_name), "%s", name);
+
+	if (thread) {
+		snprintf(thread->name, sizeof(thread->name), "%s", short_name);
+	} else if ((thread = trace_find_name(short_name))) {
+		__atomic_store_n(&thread->thread_id, thread_id, __ATOMIC_RELEASE);
+	} else {
+		trace_add_thread(thread_id, short_name);
+	}
+}
+
+void trace_event(const char *name, char phase)
+{
+	if (!recording) {
+		return;
+	}
+
+	SceUID thread_id = sceKernelGetThreadId();
+	trace_thread *thread = trace_find_thread(thread_id);
+	if (!thread) {
+		thread = trace_add_thread(thread_id, NULL);
+		if (!thread) {
+			return;
+		}
+	}
+
+	trace_record *record = &thread->records[thread->head & (TRACE_EVENTS_PER_THREAD - 1)];
+	record->timestamp = sceKernelGetProcessTimeWide();
+	record->name = name;
+	record->phase = phase;
+	__atomic_store_n(&thread->head, thread->head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Write every recorded event as Chrome trace_event JSON
+ */
+int trace_dump(const char *filepath)
+{
+	FILE *fp = fopen(filepath, "w");
+	if (!fp) {
+		printf("Trace: could not open file %s\n", filepath);
+		return -1;
+	}
+
+	// Stop recording while the rings are read
+	recording = false;
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	bool first = true;
+	int count = __atomic_load_n(&thread_count, __ATOMIC_ACQUIRE);
+	int nb_events = 0;
+	for (int i = 0; i < count && i < TRACE_MAX_THREADS; i++) {
+		trace_thread *thread = &threads[i];
+
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}",
+			first ? "" : ",\n", thread->thread_id, thread->name);
+		first = false;
+
+		unsigned int head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+		unsigned int tail = head > TRACE_EVENTS_PER_THREAD ? head - TRACE_EVENTS_PER_THREAD : 0;
+		for (unsigned int j = tail; j != head; j++) {
+			trace_record *record = &thread->records[j & (TRACE_EVENTS_PER_THREAD - 1)];
+			fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%i}",
+				record->name, record->phase, (unsigned long long)record->timestamp, thread->thread_id);
+			nb_events++;
+		}
+	}
+
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+
+	recording = true;
+
+	printf("Trace: %i events written to %s\n", nb_events, filepath);
+	return 0;
+}
+
+#endif
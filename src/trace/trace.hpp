@@ -0,0 +1,64 @@
+#ifndef __TRACE_HPP__
+#define __TRACE_HPP__
+
+/**
+ * Pipeline tracing, dumped in Chrome trace_event JSON format (chrome://tracing)
+ *
+ * Only compiled in when WEBRADIO_TRACE is defined (cmake -DWEBRADIO_TRACE=ON),
+ * otherwise every macro expands to nothing and TRACE_LOCK to a plain lock.
+ */
+
+#include <psp2/kernel/threadmgr.h>
+
+#define TRACE_FILE "ux0:/data/webradio/trace.json"
+#define TRACE_MAX_THREADS 16 // named threads take the slot of an ended one of the same name
+#define TRACE_EVENTS_PER_THREAD 8192 // power of two, oldest events are overwritten
+
+#ifdef WEBRADIO_TRACE
+
+void trace_register_thread(const char *name);
+void trace_event(const char *name, char phase);
+int trace_dump(const char *filepath);
+
+struct trace_scope {
+	const char *name;
+
+	trace_scope(const char *scope_name) : name(scope_name) {
+		trace_event(name, 'B');
+	}
+
+	~trace_scope() {
+		trace_event(name, 'E');
+	}
+};
+
+static inline int trace_lock(int mutex, const char *name)
+{
+	trace_event(name, 'B');
+	int ret = sceKernelLockMutex(mutex, 1, NULL);
+	trace_event(name, 'E');
+	return ret;
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#define TRACE_THREAD(name) trace_register_thread(name)
+#define TRACE_BEGIN(name) trace_event(name, 'B')
+#define TRACE_END(name) trace_event(name, 'E')
+#define TRACE_SCOPE(name) trace_scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_LOCK(mutex, name) trace_lock(mutex, "lock " name)
+#define TRACE_DUMP() trace_dump(TRACE_FILE)
+
+#else
+
+#define TRACE_THREAD(name) ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_LOCK(mutex, name) sceKernelLockMutex(mutex, 1, NULL)
+#define TRACE_DUMP() (-1)
+
+#endif
+
+#endif
@@ -75,3 +75,18 @@ void Utils_UnlockPower(void) {
 	if (lock_power < 0)
 		lock_power = 0;
 }
+
+/**
+ * 64-bit FNV-1a hash of a string, e.g. to key caches by station URL
+ */
+uint64_t Utils_Hash(const char *str)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (const char *c = str; *c; c++) {
+		hash ^= (unsigned char)*c;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
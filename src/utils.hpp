@@ -1,9 +1,12 @@
 #ifndef __UTILS_HPP__
 #define __UTILS_HPP__
 
+#include <stdint.h>
+
 int copyfile(const char *destfile, const char *srcfile);
 void Utils_InitPowerTick(void);
 void Utils_LockPower(void);
 void Utils_UnlockPower(void);
+uint64_t Utils_Hash(const char *str);
 
 #endif
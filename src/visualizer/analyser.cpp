@@ -0,0 +1,356 @@
+#include "analyser.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <psp2/kernel/clib.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+
+#include "../metrics/metrics.hpp"
+#include "../ring_buffer.hpp"
+#include "../trace/trace.hpp"
+
+#define printf sceClibPrintf
+
+#define ANALYSER_CHUNK_SIZE 4096 // bytes moved from the ring to the FFT history at once
+
+struct analyser_stamp {
+    size_t position; // pcm_ring head after the block
+    SceUInt64 play_time; // when the last sample of the block is heard
+};
+
+// Interleaved PCM from the audio thread, dropped when the ring is full
+static ring_buffer pcm_ring;
+static ring_buffer stamp_ring;
+static volatile bool enabled = false;
+static volatile neon_fft_mode analysis_mode = NEON_FFT_MODE_MONO;
+static volatile bool running = false;
+static SceUID analyser_thread_id = -1;
+
+// Stream format, written by the audio thread with a sequence counter
+static volatile unsigned int format_sequence = 0;
+static volatile int format_samplerate = 44100;
+static volatile int format_channels = 2;
+static volatile size_t format_position = 0; // ring head when the format changed
+
+// Settings from the UI, applied by the analyser thread
+static volatile unsigned int config_sequence = 0;
+static volatile int config_fft_size = 2048;
+static volatile int config_hop_size = 512;
+static volatile int config_bar_count = 16;
+static const fft_backend *volatile config_backend = FFT_BACKEND_DEFAULT;
+
+// Analyses queued until they are heard, the UI copies the one due into shown
+static analyser_frame frames[ANALYSER_FRAME_QUEUE];
+static volatile unsigned int frame_head = 0; // only written by the analyser thread
+static volatile unsigned int frame_tail = 0; // only written by the UI thread
+static analyser_frame shown;
+static unsigned int published = 0;
+
+// Only used by the analyser thread
+static beat_detector beat;
+
+static void analyser_publish(const neon_fft_config *cfg, SceUInt64 play_time)
+{
+    unsigned int head = frame_head;
+    if (head - __atomic_load_n(&frame_tail, __ATOMIC_ACQUIRE) == ANALYSER_FRAME_QUEUE) {
+        // The UI is not drawing, nobody waits for this analysis
+        return;
+    }
+
+    analyser_frame *frame = &frames[head % ANALYSER_FRAME_QUEUE];
+    frame->sequence = ++published;
+    frame->play_time = play_time;
+    frame->bar_count = cfg->bar_count < ANALYSER_MAX_BARS ? cfg->bar_count : ANALYSER_MAX_BARS;
+    frame->mode = cfg->mode;
+    frame->correlation = cfg->correlation;
+    frame->beat_count = beat.beat_count;
+    frame->bpm = beat.bpm;
+    memcpy(frame->bands, cfg->visualizer_data, sizeof(float) * frame->bar_count);
+    if (cfg->mode != NEON_FFT_MODE_MONO) {
+        memcpy(frame->secondary, cfg->secondary_data, sizeof(float) * frame->bar_count);
+    }
+
+    __atomic_store_n(&frame_head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Find when the newest sample read from the PCM ring is heard
+ *
+ * @param next keeps a stamp popped for samples still in the ring
+ */
+static SceUInt64 analyser_play_time(analyser_stamp *next, bool *has_next, SceUInt64 play_time)
+{
+    while (*has_next || ring_buffer_read(&stamp_ring, next, sizeof(analyser_stamp)) == sizeof(analyser_stamp)) {
+        if ((ptrdiff_t)(next->position - pcm_ring.tail) > 0) {
+            *has_next = true;
+            break;
+        }
+
+        play_time = next->play_time;
+        *has_next = false;
+    }
+
+    return play_time;
+}
+
+/**
+ * Rebuild the FFT when the UI changed the settings
+ */
+static neon_fft_config *analyser_apply_config(neon_fft_config *cfg, unsigned int *seen_sequence, int samplerate, int channels)
+{
+    unsigned int sequence = __atomic_load_n(&config_sequence, __ATOMIC_ACQUIRE);
+    if (cfg && sequence == *seen_sequence) {
+        return cfg;
+    }
+
+    *seen_sequence = sequence;
+    neon_fft_free(cfg);
+
+    cfg = neon_fft_init(config_fft_size, config_hop_size, samplerate, channels, config_bar_count, config_backend);
+    if (!cfg) {
+        printf("Analyser: error creating %s FFT of size %i\n", config_backend->name, config_fft_size);
+    }
+
+    return cfg;
+}
+
+static int analyser_thread(SceSize args, void *argp)
+{
+    neon_fft_config *cfg = NULL;
+    unsigned int seen_config = 0;
+    unsigned int seen_format = 0;
+    int samplerate = format_samplerate;
+    int channels = format_channels;
+    static int16_t chunk[ANALYSER_CHUNK_SIZE / sizeof(int16_t)];
+    analyser_stamp next_stamp;
+    bool has_next_stamp = false;
+    SceUInt64 play_time = 0;
+
+    TRACE_THREAD("analyserThread");
+
+    beat_init(&beat);
+
+    while (running) {
+        SceUInt64 start = sceKernelGetProcessTimeWide();
+
+        if (!enabled) {
+            ring_buffer_skip(&pcm_ring, ring_buffer_used(&pcm_ring));
+            play_time = analyser_play_time(&next_stamp, &has_next_stamp, play_time);
+            beat_reset(&beat);
+            sceKernelDelayThread(ANALYSER_PERIOD);
+            continue;
+        }
+
+        unsigned int sequence = __atomic_load_n(&format_sequence, __ATOMIC_ACQUIRE);
+        if (sequence != seen_format && !(sequence & 1)) {
+            // Samples queued before the change belong to the previous format
+            size_t old_bytes = format_position - pcm_ring.tail;
+            if (old_bytes <= ring_buffer_used(&pcm_ring)) {
+                ring_buffer_skip(&pcm_ring, old_bytes);
+            }
+
+            samplerate = format_samplerate;
+            channels = format_channels;
+            if (__atomic_load_n(&format_sequence, __ATOMIC_ACQUIRE) == sequence) {
+                seen_format = sequence;
+                neon_fft_set_format(cfg, samplerate, channels);
+                beat_reset(&beat);
+            }
+        }
+
+        cfg = analyser_apply_config(cfg, &seen_config, samplerate, channels);
+        if (!cfg) {
+            sceKernelDelayThread(ANALYSER_PERIOD);
+            continue;
+        }
+
+        // Whole sample frames only, the producer never writes partial ones
+        size_t frame_size = sizeof(int16_t) * cfg->channel_mode;
+        size_t used = ring_buffer_used(&pcm_ring);
+        while (used >= frame_size) {
+            size_t size = used < ANALYSER_CHUNK_SIZE ? used : ANALYSER_CHUNK_SIZE;
+            size -= size % frame_size;
+
+            ring_buffer_read(&pcm_ring, chunk, size);
+            neon_fft_fill_buffer(cfg, chunk, size / frame_size);
+            used -= size;
+        }
+
+        play_time = analyser_play_time(&next_stamp, &has_next_stamp, play_time);
+
+        cfg->mode = analysis_mode;
+
+        // pending stops at the FFT size, the tempo needs the real spacing of the analyses
+        int analysed_samples = cfg->fed;
+        unsigned int fft_start = metrics_now();
+        TRACE_BEGIN("spectrum_analyser");
+        int ret = spectrum_analyser(cfg);
+        TRACE_END("spectrum_analyser");
+
+        if (ret == 0) {
+            metrics_add_timing(METRICS_TIMING_FFT, metrics_now() - fft_start);
+
+            TRACE_BEGIN("beat_process");
+            beat_process(&beat, cfg->visualizer_data, cfg->bar_count, analysed_samples, samplerate);
+            TRACE_END("beat_process");
+
+            analyser_publish(cfg, play_time);
+        }
+
+        SceUInt64 elapsed = sceKernelGetProcessTimeWide() - start;
+        sceKernelDelayThread(elapsed < ANALYSER_PERIOD ? ANALYSER_PERIOD - elapsed : 1000);
+    }
+
+    neon_fft_free(cfg);
+
+    return 0;
+}
+
+int analyser_init(void)
+{
+    if (ring_buffer_init(&pcm_ring, ANALYSER_RING_SIZE)) {
+        printf("Analyser: error allocating ring\n");
+        return -1;
+    }
+
+    if (ring_buffer_init(&stamp_ring, ANALYSER_STAMP_RING_SIZE)) {
+        printf("Analyser: error allocating stamp ring\n");
+        ring_buffer_free(&pcm_ring);
+        return -1;
+    }
+
+    // Below audio and network, above recorder and metrics
+    running = true;
+    analyser_thread_id = sceKernelCreateThread("analyserThread", analyser_thread, 0x10000100 + 8, 0x4000, 0, 0, NULL);
+    if (analyser_thread_id < 0) {
+        printf("Analyser: error creating thread with id %i\n", analyser_thread_id);
+        running = false;
+        ring_buffer_free(&stamp_ring);
+        ring_buffer_free(&pcm_ring);
+        return -1;
+    }
+
+    sceKernelStartThread(analyser_thread_id, 0, NULL);
+
+    return 0;
+}
+
+void analyser_term(void)
+{
+    if (analyser_thread_id < 0) {
+        return;
+    }
+
+    running = false;
+
+    SceUInt timeout = 1000000;
+    sceKernelWaitThreadEnd(analyser_thread_id, NULL, &timeout);
+    sceKernelDeleteThread(analyser_thread_id);
+    analyser_thread_id = -1;
+
+    ring_buffer_free(&stamp_ring);
+    ring_buffer_free(&pcm_ring);
+}
+
+/**
+ * Change FFT settings, the analyser thread rebuilds the FFT on its next pass
+ */
+void analyser_configure(int fft_size, int hop_size, int bar_count, const fft_backend *backend)
+{
+    config_backend = backend;
+    config_fft_size = fft_size;
+    config_hop_size = hop_size;
+    config_bar_count = bar_count < ANALYSER_MAX_BARS ? bar_count : ANALYSER_MAX_BARS;
+    __atomic_add_fetch(&config_sequence, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Only analyse while a visualizer is displayed
+ */
+void analyser_set_enabled(bool value)
+{
+    enabled = value;
+}
+
+/**
+ * Choose which spectra are computed, two FFTs per analysis except in mono mode
+ */
+void analyser_set_mode(neon_fft_mode mode)
+{
+    analysis_mode = mode;
+}
+
+/**
+ * Called by the audio thread when the decoder output format changes
+ */
+void analyser_set_format(int samplerate, int channels)
+{
+    // Odd while the fields are being written
+    __atomic_add_fetch(&format_sequence, 1, __ATOMIC_RELEASE);
+    format_samplerate = samplerate;
+    format_channels = channels;
+    format_position = pcm_ring.head;
+    __atomic_add_fetch(&format_sequence, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Queue decoded PCM for analysis, called by the audio thread
+ *
+ * Never blocks: the samples are dropped if the analyser is late.
+ *
+ * @param pcm is interleaved 16bit PCM in the format given to analyser_set_format
+ * @param nbsamples is the number of samples per channel
+ * @param play_time is the predicted process time when the last sample is heard
+ */
+void analyser_push(const int16_t *pcm, int nbsamples, SceUInt64 play_time)
+{
+    if (!enabled || nbsamples <= 0 || !pcm_ring.data) {
+        return;
+    }
+
+    size_t size = sizeof(int16_t) * nbsamples * format_channels;
+    if (size > ANALYSER_RING_SIZE - ring_buffer_used(&pcm_ring)
+        || sizeof(analyser_stamp) > ANALYSER_STAMP_RING_SIZE - ring_buffer_used(&stamp_ring)) {
+        return;
+    }
+
+    // The stamp goes first so the analyser never reads samples without their time
+    analyser_stamp stamp;
+    stamp.position = pcm_ring.head + size;
+    stamp.play_time = play_time;
+    ring_buffer_write(&stamp_ring, &stamp, sizeof(stamp));
+    ring_buffer_write(&pcm_ring, pcm, size);
+}
+
+/**
+ * Analysis of what is being heard now, called by the UI thread only
+ *
+ * Analyses are computed ahead of the audio output, the newest one whose samples
+ * have started playing is shown. The frame stays valid until the next call.
+ */
+const analyser_frame *analyser_get_frame(void)
+{
+    SceUInt64 now = sceKernelGetProcessTimeWide();
+    unsigned int tail = frame_tail;
+    const analyser_frame *due = NULL;
+
+    while (tail != __atomic_load_n(&frame_head, __ATOMIC_ACQUIRE)) {
+        const analyser_frame *frame = &frames[tail % ANALYSER_FRAME_QUEUE];
+        if (frame->play_time > now && frame->play_time - now < ANALYSER_MAX_LEAD) {
+            break;
+        }
+
+        due = frame;
+        tail++;
+    }
+
+    // Slots are only given back to the analyser once copied
+    if (due) {
+        memcpy(&shown, due, sizeof(analyser_frame));
+        __atomic_store_n(&frame_tail, tail, __ATOMIC_RELEASE);
+    }
+
+    return &shown;
+}
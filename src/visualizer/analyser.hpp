@@ -0,0 +1,42 @@
+#ifndef __ANALYSER_HPP__
+#define __ANALYSER_HPP__
+
+#include <stdint.h>
+
+#include <psp2/types.h>
+
+#include "beat.hpp"
+#include "neon_fft.hpp"
+
+#define ANALYSER_MAX_BARS 256
+#define ANALYSER_PERIOD 16666 // microseconds, 60 analyses per second at most
+#define ANALYSER_RING_SIZE (64 * 1024) // bytes of interleaved PCM, power of two
+#define ANALYSER_STAMP_RING_SIZE 1024 // bytes of playout stamps, power of two
+#define ANALYSER_FRAME_QUEUE 32 // analyses waiting for their playout time, about half a second
+#define ANALYSER_MAX_LEAD 1000000 // microseconds, frames further ahead are shown immediately
+
+/**
+ * Result of one analysis, owned by the analyser thread until published
+ */
+struct analyser_frame {
+    unsigned int sequence; // incremented for each published frame
+    SceUInt64 play_time; // process time when the newest analysed sample is heard
+    int bar_count; // 0 until the first analysis
+    neon_fft_mode mode;
+    float bands[ANALYSER_MAX_BARS]; // dB, left or mid
+    float secondary[ANALYSER_MAX_BARS]; // dB, right or side, unused in mono mode
+    float correlation; // -1 (out of phase) to 1 (mono)
+    unsigned int beat_count; // incremented on each onset, compare with the previous frame
+    float bpm; // 0 while the tempo is unknown
+};
+
+int analyser_init(void);
+void analyser_term(void);
+void analyser_configure(int fft_size, int hop_size, int bar_count, const fft_backend *backend = FFT_BACKEND_DEFAULT);
+void analyser_set_enabled(bool enabled);
+void analyser_set_mode(neon_fft_mode mode);
+void analyser_set_format(int samplerate, int channels);
+void analyser_push(const int16_t *pcm, int nbsamples, SceUInt64 play_time);
+const analyser_frame *analyser_get_frame(void);
+
+#endif
@@ -0,0 +1,218 @@
+#include "beat.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BEAT_USE_NEON
+#endif
+
+#define BEAT_THRESHOLD_DEVIATIONS 1.5f // onset when the flux exceeds the mean by this many deviations
+#define BEAT_MIN_FLUX 1.0f // dB, ignores onsets in near silence
+#define BEAT_MIN_INTERVAL 10 // envelope steps, 100 ms between onsets at least
+#define BEAT_DECAY 0.997f // per envelope step, the autocorrelation forgets in a few seconds
+#define BEAT_CONFIDENCE 0.1f // periodicity needed to report a tempo, relative to the envelope energy
+#define BEAT_LAG_SPREAD 3 // envelope steps a beat period is spread over on each side, analyses are up to 35 ms apart
+#define BEAT_OCTAVE_RATIO 0.5f // periodicity at half the lag needed to prefer the faster tempo
+
+/**
+ * Mean dB increase across bands since the last analysis, 4 bands at a time
+ */
+static float beat_spectral_flux(const float *bands, const float *previous, int count)
+{
+    float flux = 0.0f;
+    int i = 0;
+
+#ifdef BEAT_USE_NEON
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    float32x4_t acc = zero;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t rise = vsubq_f32(vld1q_f32(bands + i), vld1q_f32(previous + i));
+        acc = vaddq_f32(acc, vmaxq_f32(rise, zero));
+    }
+
+    float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    flux = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+
+    for (; i < count; i++) {
+        float rise = bands[i] - previous[i];
+        flux += rise > 0.0f ? rise : 0.0f;
+    }
+
+    return flux / count;
+}
+
+static void beat_push_envelope(beat_detector *detector, float value)
+{
+    detector->envelope_pos = (detector->envelope_pos + 1) % BEAT_MAX_LAG;
+    detector->envelope[detector->envelope_pos] = value;
+
+    for (int lag = 0; lag < BEAT_MAX_LAG; lag++) {
+        float delayed = detector->envelope[(detector->envelope_pos - lag + BEAT_MAX_LAG) % BEAT_MAX_LAG];
+        detector->autocorrelation[lag] = detector->autocorrelation[lag] * BEAT_DECAY + value * delayed;
+    }
+}
+
+/**
+ * Autocorrelation around a lag: analyses land on whole envelope steps, so one beat period
+ * is spread over the neighbouring lags, often alternating between both sides of it
+ */
+static float beat_lag_energy(const float *ac, int lag, float *centroid)
+{
+    float sum = 0.0f;
+    float moment = 0.0f;
+    for (int i = lag - BEAT_LAG_SPREAD; i <= lag + BEAT_LAG_SPREAD; i++) {
+        sum += ac[i];
+        moment += ac[i] * i;
+    }
+
+    if (centroid) {
+        *centroid = sum > 0.0f ? moment / sum : lag;
+    }
+    return sum;
+}
+
+/**
+ * Pick the strongest periodicity between BEAT_MIN_BPM and BEAT_MAX_BPM
+ */
+static float beat_estimate_tempo(const beat_detector *detector)
+{
+    const float *ac = detector->autocorrelation;
+    int best = 0;
+    float best_score = 0.0f;
+
+    for (int lag = BEAT_LAG_SPREAD + 1; lag < BEAT_MAX_LAG - BEAT_LAG_SPREAD; lag++) {
+        float score = detector->tempo_weight[lag] > 0.0f ? beat_lag_energy(ac, lag, NULL) * detector->tempo_weight[lag] : 0.0f;
+        if (score > best_score) {
+            best_score = score;
+            best = lag;
+        }
+    }
+
+    float period;
+    float energy = best ? beat_lag_energy(ac, best, &period) : 0.0f;
+    if (!best || energy < BEAT_CONFIDENCE * ac[0]) {
+        return 0.0f;
+    }
+
+    // Twice the period repeats as well as the period itself, keep the shorter one when it is present
+    int half = (int)(period * 0.5f + 0.5f);
+    if (detector->tempo_weight[half] > 0.0f && beat_lag_energy(ac, half, NULL) >= BEAT_OCTAVE_RATIO * energy) {
+        energy = beat_lag_energy(ac, half, &period);
+    }
+
+    // The peak at twice the period has half the relative spread, use it to refine the period
+    int twice = (int)(period * 2.0f + 0.5f);
+    float twice_period;
+    float twice_energy = twice + BEAT_LAG_SPREAD < BEAT_MAX_LAG ? beat_lag_energy(ac, twice, &twice_period) : 0.0f;
+    if (twice_energy > 0.0f) {
+        period = (period * energy + 0.5f * twice_period * twice_energy) / (energy + twice_energy);
+    }
+
+    return 60.0f * BEAT_ENVELOPE_RATE / period;
+}
+
+void beat_init(beat_detector *detector)
+{
+    // Favor tempos around 120 BPM to choose between multiples of the beat period
+    for (int lag = 0; lag < BEAT_MAX_LAG; lag++) {
+        float bpm = lag ? 60.0f * BEAT_ENVELOPE_RATE / lag : 0.0f;
+        if (bpm < BEAT_MIN_BPM || bpm > BEAT_MAX_BPM) {
+            detector->tempo_weight[lag] = 0.0f;
+        } else {
+            float octaves = log2f(bpm / 120.0f);
+            detector->tempo_weight[lag] = expf(-0.5f * octaves * octaves);
+        }
+    }
+
+    detector->beat_count = 0;
+    beat_reset(detector);
+}
+
+/**
+ * Forget the stream, e.g. when the format or the bands change
+ *
+ * beat_count keeps increasing so readers never miss a beat.
+ */
+void beat_reset(beat_detector *detector)
+{
+    detector->band_count = 0;
+    memset(detector->flux_history, 0, sizeof(detector->flux_history));
+    detector->flux_pos = 0;
+    detector->flux_sum = 0.0f;
+    memset(detector->envelope, 0, sizeof(detector->envelope));
+    detector->envelope_pos = 0;
+    memset(detector->autocorrelation, 0, sizeof(detector->autocorrelation));
+    detector->clock = 0;
+    // No onset during the first half second, the threshold has no history yet
+    detector->since_onset = BEAT_MIN_INTERVAL - BEAT_ENVELOPE_RATE / 2;
+    detector->bpm = 0.0f;
+}
+
+/**
+ * Update onsets and tempo with a new analysis
+ *
+ * @param bands are the dB levels of the analysis
+ * @param elapsed is the number of samples per channel since the previous analysis
+ * @return true if an onset was detected
+ */
+bool beat_process(beat_detector *detector, const float *bands, int count, int elapsed, int samplerate)
+{
+    if (count > BEAT_MAX_BANDS) {
+        count = BEAT_MAX_BANDS;
+    }
+
+    if (count <= 0 || samplerate <= 0) {
+        return false;
+    }
+
+    if (count != detector->band_count) {
+        beat_reset(detector);
+        detector->band_count = count;
+        memcpy(detector->previous, bands, sizeof(float) * count);
+        return false;
+    }
+
+    float flux = beat_spectral_flux(bands, detector->previous, count);
+    memcpy(detector->previous, bands, sizeof(float) * count);
+
+    // Adaptive threshold from the recent flux
+    float mean = detector->flux_sum / BEAT_FLUX_HISTORY;
+    float deviation = 0.0f;
+    for (int i = 0; i < BEAT_FLUX_HISTORY; i++) {
+        deviation += fabsf(detector->flux_history[i] - mean);
+    }
+    float threshold = mean + BEAT_THRESHOLD_DEVIATIONS * deviation / BEAT_FLUX_HISTORY + BEAT_MIN_FLUX;
+
+    detector->flux_sum += flux - detector->flux_history[detector->flux_pos];
+    detector->flux_history[detector->flux_pos] = flux;
+    detector->flux_pos = (detector->flux_pos + 1) % BEAT_FLUX_HISTORY;
+
+    // Analyses are not evenly spaced, the envelope is: the flux lands on the last step covered
+    detector->clock += elapsed * BEAT_ENVELOPE_RATE;
+    int steps = detector->clock / samplerate;
+    detector->clock %= samplerate;
+    if (steps > BEAT_MAX_LAG) {
+        steps = BEAT_MAX_LAG;
+    }
+
+    for (int i = 1; i <= steps; i++) {
+        float strength = flux - mean;
+        beat_push_envelope(detector, i == steps && strength > 0.0f ? strength : 0.0f);
+    }
+
+    if (steps > 0) {
+        detector->bpm = beat_estimate_tempo(detector);
+        detector->since_onset += steps;
+    }
+
+    if (flux > threshold && detector->since_onset >= BEAT_MIN_INTERVAL) {
+        detector->since_onset = 0;
+        detector->beat_count++;
+        return true;
+    }
+
+    return false;
+}
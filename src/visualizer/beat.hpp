@@ -0,0 +1,39 @@
+#ifndef __BEAT_HPP__
+#define __BEAT_HPP__
+
+#define BEAT_MAX_BANDS 256
+#define BEAT_FLUX_HISTORY 64 // analyses used for the adaptive threshold, about one second
+#define BEAT_ENVELOPE_RATE 100 // Hz, onset envelope resampled for the tempo estimation
+#define BEAT_MAX_LAG 128 // envelope steps, longer than the slowest tempo
+#define BEAT_MIN_BPM 60
+#define BEAT_MAX_BPM 200
+
+/**
+ * Onset and tempo tracking state, updated once per analysis
+ */
+struct beat_detector {
+    float previous[BEAT_MAX_BANDS]; // dB of the last analysis
+    int band_count; // 0 until the first analysis
+
+    // Spectral flux of the last analyses for the onset threshold
+    float flux_history[BEAT_FLUX_HISTORY];
+    int flux_pos;
+    float flux_sum;
+
+    // Onset envelope at BEAT_ENVELOPE_RATE and its decaying autocorrelation
+    float envelope[BEAT_MAX_LAG];
+    int envelope_pos;
+    float autocorrelation[BEAT_MAX_LAG];
+    float tempo_weight[BEAT_MAX_LAG];
+    unsigned int clock; // samples analysed times BEAT_ENVELOPE_RATE, modulo the samplerate
+
+    int since_onset; // envelope steps since the last onset
+    unsigned int beat_count; // incremented on each onset
+    float bpm; // 0 while the tempo is unknown
+};
+
+void beat_init(beat_detector *detector);
+void beat_reset(beat_detector *detector);
+bool beat_process(beat_detector *detector, const float *bands, int count, int elapsed, int samplerate);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef __FFT_BACKEND_HPP__
+#define __FFT_BACKEND_HPP__
+
+/**
+ * Real to complex forward FFT implementations
+ *
+ * Every backend returns the same unnormalized spectrum, nbsamples / 2 + 1 bins.
+ */
+
+struct fft_complex {
+    float r;
+    float i;
+};
+
+struct fft_backend {
+    const char *name;
+    void *(*create)(int nbsamples); // nbsamples is a power of two, NULL on error
+    void (*destroy)(void *plan);
+    void (*forward)(void *plan, fft_complex *out, float *in); // in may be used as scratch
+};
+
+extern const fft_backend fft_backend_ne10;
+extern const fft_backend fft_backend_scalar;
+
+// NE10 needs the Vita toolchain, the scalar backend builds anywhere
+#ifdef __vita__
+#define FFT_BACKEND_DEFAULT (&fft_backend_ne10)
+#else
+#define FFT_BACKEND_DEFAULT (&fft_backend_scalar)
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <NE10.h>
+
+#ifdef __vita__
+#include <psp2/kernel/clib.h>
+#endif
+
+#include "fft_backend.hpp"
+
+#ifdef __vita__
+#define printf sceClibPrintf
+#endif
+
+static bool ne10_initialized = false;
+
+static void *fft_ne10_create(int nbsamples)
+{
+    // Initialise Ne10, using hardware auto-detection to set library function pointers
+    if (!ne10_initialized) {
+        if (ne10_init() != NE10_OK) {
+            printf("Failed to initialise Ne10.\n");
+            return NULL;
+        }
+
+        ne10_initialized = true;
+    }
+
+    // Prepare the real-to-complex single precision floating point FFT configuration
+    // structure for inputs of length `nbsamples`. (You need only generate this once for a
+    // particular input size.)
+    return ne10_fft_alloc_r2c_float32(nbsamples);
+}
+
+static void fft_ne10_destroy(void *plan)
+{
+    ne10_fft_destroy_r2c_float32((ne10_fft_r2c_cfg_float32_t)plan);
+}
+
+static void fft_ne10_forward(void *plan, fft_complex *out, float *in)
+{
+    // fft_complex has the layout of ne10_fft_cpx_float32_t
+    ne10_fft_r2c_1d_float32_neon((ne10_fft_cpx_float32_t*)out, in, (ne10_fft_r2c_cfg_float32_t)plan);
+}
+
+const fft_backend fft_backend_ne10 = {
+    "NE10",
+    fft_ne10_create,
+    fft_ne10_destroy,
+    fft_ne10_forward,
+};
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#ifdef __vita__
+#include <psp2/kernel/clib.h>
+#endif
+
+#include "fft_backend.hpp"
+
+#ifdef __vita__
+#define printf sceClibPrintf
+#endif
+#ifndef M_PI
+#define M_PI		3.14159265358979323846
+#endif
+
+/**
+ * Portable real FFT: the nbsamples real inputs are packed as nbsamples / 2 complex
+ * values, transformed by an iterative radix-2 FFT, then split into the real spectrum.
+ */
+struct fft_scalar_plan {
+    int nbsamples;
+    int half; // size of the complex FFT
+    int *bit_reverse; // half values
+    fft_complex *twiddles; // half / 2 values, exp(-2i pi k / half)
+    fft_complex *split_twiddles; // half values, exp(-2i pi k / nbsamples)
+    fft_complex *work; // half values
+};
+
+static void fft_scalar_destroy(void *data)
+{
+    fft_scalar_plan *plan = (fft_scalar_plan*)data;
+    if (!plan) {
+        return;
+    }
+
+    free(plan->bit_reverse);
+    free(plan->twiddles);
+    free(plan->split_twiddles);
+    free(plan->work);
+    free(plan);
+}
+
+static void *fft_scalar_create(int nbsamples)
+{
+    if (nbsamples < 4 || (nbsamples & (nbsamples - 1))) {
+        printf("Scalar FFT: unsupported size %i\n", nbsamples);
+        return NULL;
+    }
+
+    fft_scalar_plan *plan = (fft_scalar_plan*)calloc(1, sizeof(fft_scalar_plan));
+    if (!plan) {
+        return NULL;
+    }
+
+    int half = nbsamples / 2;
+    plan->nbsamples = nbsamples;
+    plan->half = half;
+    plan->bit_reverse = (int*)malloc(sizeof(int) * half);
+    plan->twiddles = (fft_complex*)malloc(sizeof(fft_complex) * (half / 2 + 1));
+    plan->split_twiddles = (fft_complex*)malloc(sizeof(fft_complex) * half);
+    plan->work = (fft_complex*)malloc(sizeof(fft_complex) * half);
+
+    if (!plan->bit_reverse || !plan->twiddles || !plan->split_twiddles || !plan->work) {
+        printf("Scalar FFT: error allocating plan\n");
+        fft_scalar_destroy(plan);
+        return NULL;
+    }
+
+    int bits = 0;
+    while ((1 << bits) < half) {
+        bits++;
+    }
+
+    for (int i = 0; i < half; i++) {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        plan->bit_reverse[i] = reversed;
+    }
+
+    for (int k = 0; k <= half / 2; k++) {
+        plan->twiddles[k].r = cos(-2 * M_PI * k / half);
+        plan->twiddles[k].i = sin(-2 * M_PI * k / half);
+    }
+
+    for (int k = 0; k < half; k++) {
+        plan->split_twiddles[k].r = cos(-2 * M_PI * k / nbsamples);
+        plan->split_twiddles[k].i = sin(-2 * M_PI * k / nbsamples);
+    }
+
+    return plan;
+}
+
+static void fft_scalar_forward(void *data, fft_complex *out, float *in)
+{
+    fft_scalar_plan *plan = (fft_scalar_plan*)data;
+    fft_complex *z = plan->work;
+    int half = plan->half;
+
+    // Even samples as real part, odd samples as imaginary part, in bit reversed order
+    for (int i = 0; i < half; i++) {
+        int j = plan->bit_reverse[i];
+        z[j].r = in[2 * i];
+        z[j].i = in[2 * i + 1];
+    }
+
+    for (int size = 2; size <= half; size *= 2) {
+        int step = half / size;
+        for (int start = 0; start < half; start += size) {
+            for (int k = 0; k < size / 2; k++) {
+                fft_complex w = plan->twiddles[k * step];
+                fft_complex *a = &z[start + k];
+                fft_complex *b = &z[start + k + size / 2];
+
+                float tr = b->r * w.r - b->i * w.i;
+                float ti = b->r * w.i + b->i * w.r;
+                b->r = a->r - tr;
+                b->i = a->i - ti;
+                a->r += tr;
+                a->i += ti;
+            }
+        }
+    }
+
+    // Split the packed spectrum into the spectrum of the real input
+    out[0].r = z[0].r + z[0].i;
+    out[0].i = 0.0f;
+    out[half].r = z[0].r - z[0].i;
+    out[half].i = 0.0f;
+
+    for (int k = 1; k < half; k++) {
+        fft_complex a = z[k];
+        fft_complex b = z[half - k];
+
+        // even = (a + conj(b)) / 2, odd = (a - conj(b)) / 2i
+        float even_r = 0.5f * (a.r + b.r);
+        float even_i = 0.5f * (a.i - b.i);
+        float odd_r = 0.5f * (a.i + b.i);
+        float odd_i = -0.5f * (a.r - b.r);
+
+        fft_complex w = plan->split_twiddles[k];
+        out[k].r = even_r + odd_r * w.r - odd_i * w.i;
+        out[k].i = even_i + odd_r * w.i + odd_i * w.r;
+    }
+}
+
+const fft_backend fft_backend_scalar = {
+    "Scalar",
+    fft_scalar_create,
+    fft_scalar_destroy,
+    fft_scalar_forward,
+};
@@ -0,0 +1,172 @@
+#include "geometry.hpp"
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI		3.14159265358979323846
+#endif
+
+static float circle_cos[GEOMETRY_CIRCLE_SEGMENTS];
+static float circle_sin[GEOMETRY_CIRCLE_SEGMENTS];
+static bool circle_ready = false;
+
+static inline void geometry_vertex_set(geometry_vertex *vertex, const geometry_target *target, float x, float y, uint32_t color)
+{
+    vertex->x = x;
+    vertex->y = y;
+    vertex->u = target->u;
+    vertex->v = target->v;
+    vertex->color = color;
+}
+
+static inline void geometry_quad_indices(uint16_t *index, unsigned int base)
+{
+    index[0] = base;
+    index[1] = base + 1;
+    index[2] = base + 2;
+    index[3] = base;
+    index[4] = base + 2;
+    index[5] = base + 3;
+}
+
+/**
+ * Move the target past geometry already built, to build more in the same reservation
+ */
+void geometry_advance(geometry_target *target, int vertices, int indices)
+{
+    target->vertices += vertices;
+    target->indices += indices;
+    target->base_index += vertices;
+}
+
+/**
+ * One gradient quad per band, from the base up to the band level
+ *
+ * Writes count * GEOMETRY_BAR_VERTICES vertices and count * GEOMETRY_BAR_INDICES indices.
+ */
+void geometry_build_bars(geometry_target *target, const float *levels, int count, const geometry_bars_style *style)
+{
+    geometry_vertex *vertex = target->vertices;
+    uint16_t *index = target->indices;
+    unsigned int base = target->base_index;
+    uint32_t bottom_color = GEOMETRY_COLOR(0, 200, 0, 255);
+    float width = fabsf(style->step) - 1.0f;
+    float direction = style->step < 0.0f ? -1.0f : 1.0f;
+
+    for (int i = 0; i < count; i++) {
+        float y_upper = style->bottom - levels[i] * style->height;
+        float x0 = style->origin + i * style->step;
+        float x1 = x0 + direction * width;
+
+        if (y_upper >= style->bottom) {
+            // Empty band, collapse the quad
+            x1 = x0;
+            y_upper = style->bottom;
+        } else if (y_upper < 0.0f) {
+            y_upper = 0.0f;
+        }
+
+        int fade = 255 - (int)(y_upper / 3.0f);
+        uint32_t top_color = style->fade_channel == 2 ? GEOMETRY_COLOR(0, 200, fade, 255) : GEOMETRY_COLOR(fade, 200, 0, 255);
+
+        geometry_vertex_set(&vertex[0], target, x0, y_upper, top_color);
+        geometry_vertex_set(&vertex[1], target, x1, y_upper, top_color);
+        geometry_vertex_set(&vertex[2], target, x1, style->bottom, bottom_color);
+        geometry_vertex_set(&vertex[3], target, x0, style->bottom, bottom_color);
+        geometry_quad_indices(index, base);
+
+        vertex += GEOMETRY_BAR_VERTICES;
+        index += GEOMETRY_BAR_INDICES;
+        base += GEOMETRY_BAR_VERTICES;
+    }
+}
+
+/**
+ * One thin marker per band at its peak level, placed like the bars
+ *
+ * Writes count * GEOMETRY_BAR_VERTICES vertices and count * GEOMETRY_BAR_INDICES indices.
+ */
+void geometry_build_peaks(geometry_target *target, const float *peaks, int count, const geometry_bars_style *style)
+{
+    geometry_vertex *vertex = target->vertices;
+    uint16_t *index = target->indices;
+    unsigned int base = target->base_index;
+    uint32_t color = GEOMETRY_COLOR(255, 255, 255, 255);
+    float width = fabsf(style->step) - 1.0f;
+    float direction = style->step < 0.0f ? -1.0f : 1.0f;
+
+    for (int i = 0; i < count; i++) {
+        float y = style->bottom - peaks[i] * style->height;
+        float x0 = style->origin + i * style->step;
+        float x1 = x0 + direction * width;
+
+        if (y >= style->bottom) {
+            x1 = x0;
+            y = style->bottom;
+        } else if (y < 3.0f) {
+            y = 3.0f;
+        }
+
+        geometry_vertex_set(&vertex[0], target, x0, y - 3.0f, color);
+        geometry_vertex_set(&vertex[1], target, x1, y - 3.0f, color);
+        geometry_vertex_set(&vertex[2], target, x1, y, color);
+        geometry_vertex_set(&vertex[3], target, x0, y, color);
+        geometry_quad_indices(index, base);
+
+        vertex += GEOMETRY_BAR_VERTICES;
+        index += GEOMETRY_BAR_INDICES;
+        base += GEOMETRY_BAR_VERTICES;
+    }
+}
+
+/**
+ * One ring per pair of bands, the radius follows their average level
+ *
+ * Writes count / 2 * GEOMETRY_RING_VERTICES vertices and count / 2 * GEOMETRY_RING_INDICES indices.
+ *
+ * @param radius is the radius of a full band
+ */
+void geometry_build_rings(geometry_target *target, const float *levels, int count, float center_x, float center_y,
+    float radius, float thickness)
+{
+    if (!circle_ready) {
+        for (int s = 0; s < GEOMETRY_CIRCLE_SEGMENTS; s++) {
+            circle_cos[s] = cosf(2 * M_PI * s / GEOMETRY_CIRCLE_SEGMENTS);
+            circle_sin[s] = sinf(2 * M_PI * s / GEOMETRY_CIRCLE_SEGMENTS);
+        }
+        circle_ready = true;
+    }
+
+    geometry_vertex *vertex = target->vertices;
+    uint16_t *index = target->indices;
+    unsigned int base = target->base_index;
+
+    for (int i = 0; i < count / 2; i++) {
+        float value = (levels[i*2] + levels[i*2+1]) / 2.0f;
+        if (value < 0.0f) {
+            value = 0.0f;
+        }
+
+        float ring_radius = value * radius;
+        float inner = ring_radius > thickness / 2.0f ? ring_radius - thickness / 2.0f : 0.0f;
+        float outer = ring_radius > 0.0f ? ring_radius + thickness / 2.0f : 0.0f;
+        uint32_t color = GEOMETRY_COLOR(255 - i * 2 * 255 / count, 200, 0, 255);
+
+        for (int s = 0; s < GEOMETRY_CIRCLE_SEGMENTS; s++) {
+            geometry_vertex_set(&vertex[s * 2], target, center_x + circle_cos[s] * inner, center_y + circle_sin[s] * inner, color);
+            geometry_vertex_set(&vertex[s * 2 + 1], target, center_x + circle_cos[s] * outer, center_y + circle_sin[s] * outer, color);
+
+            unsigned int next = (s + 1) % GEOMETRY_CIRCLE_SEGMENTS;
+            index[s * 6 + 0] = base + s * 2;
+            index[s * 6 + 1] = base + s * 2 + 1;
+            index[s * 6 + 2] = base + next * 2 + 1;
+            index[s * 6 + 3] = base + s * 2;
+            index[s * 6 + 4] = base + next * 2 + 1;
+            index[s * 6 + 5] = base + next * 2;
+        }
+
+        vertex += GEOMETRY_RING_VERTICES;
+        index += GEOMETRY_RING_INDICES;
+        base += GEOMETRY_RING_VERTICES;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef __GEOMETRY_HPP__
+#define __GEOMETRY_HPP__
+
+#include <stdint.h>
+
+/**
+ * Visualizer geometry written straight into a vertex/index buffer
+ *
+ * Independent from ImGui and vitaGL, the vertex layout matches ImDrawVert so the
+ * caller can build into space reserved with ImDrawList::PrimReserve.
+ */
+
+#define GEOMETRY_COLOR(R, G, B, A) (((uint32_t)(A) << 24) | ((uint32_t)(B) << 16) | ((uint32_t)(G) << 8) | ((uint32_t)(R)))
+#define GEOMETRY_CIRCLE_SEGMENTS 24
+
+// Each bar or ring has a fixed size, hidden ones are degenerate, so counts only depend on the number of bands
+#define GEOMETRY_BAR_VERTICES 4
+#define GEOMETRY_BAR_INDICES 6
+#define GEOMETRY_RING_VERTICES (GEOMETRY_CIRCLE_SEGMENTS * 2)
+#define GEOMETRY_RING_INDICES (GEOMETRY_CIRCLE_SEGMENTS * 6)
+
+struct geometry_vertex {
+    float x, y;
+    float u, v;
+    uint32_t color;
+};
+
+struct geometry_target {
+    geometry_vertex *vertices;
+    uint16_t *indices;
+    unsigned int base_index; // index of vertices[0] in the whole buffer
+    float u, v; // texture coordinates of a white pixel
+};
+
+struct geometry_bars_style {
+    float origin; // x of the first bar edge
+    float step; // signed distance between bars, negative to grow to the left
+    float bottom; // y of the bar base
+    float height; // pixels of a full band, levels go from 0 to 1
+    int fade_channel; // 0 red or 2 blue, fades with the bar height like the original bars
+};
+
+void geometry_advance(geometry_target *target, int vertices, int indices);
+void geometry_build_bars(geometry_target *target, const float *levels, int count, const geometry_bars_style *style);
+void geometry_build_peaks(geometry_target *target, const float *peaks, int count, const geometry_bars_style *style);
+void geometry_build_rings(geometry_target *target, const float *levels, int count, float center_x, float center_y,
+    float radius, float thickness);
+
+#endif
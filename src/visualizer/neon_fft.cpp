@@ -1,84 +1,129 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <arm_neon.h>
 #include <math.h>
 #include <cstring>
 
+// Without NEON (e.g. on a development host) the scalar loops handle every sample
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NEON_FFT_USE_NEON
+#endif
+
+#ifdef __vita__
 #include <psp2/kernel/clib.h>
+#endif
 
 #include "neon_fft.hpp"
 
+#ifdef __vita__
 #define printf sceClibPrintf
+#endif
+#ifndef M_PI
 #define M_PI		3.14159265358979323846
+#endif
+
+// Convert a frequency into an FFT indices
+static inline int f_to_bin(neon_fft_config *cfg, float f) {
+    int idx = (int)roundf(f * cfg->nbsamples / cfg->samplerate);
+    if (idx < 0) idx = 0;
+    if (idx > cfg->nbsamples/2) idx = cfg->nbsamples/2;
+    return idx;
+}
 
 /**
- * Init fft structures
- * 
- * @param nbsamples corresponds to the number of samples that will be analyzed by the fft
- * @param samplerate corresponds to the sample rate of audio data
- * @param channel_mode equals 1 if mono or 2 if stereo
- * 
+ * Compute the FFT bins of each bar (log spaced from 20Hz to Nyquist)
  */
-neon_fft_config *neon_fft_init(int nbsamples, int samplerate, int channel_mode, int bar_count)
+static void neon_fft_build_bands(neon_fft_config *cfg)
 {
-    neon_fft_config *cfg = (neon_fft_config*)malloc(sizeof(neon_fft_config));
+    int nbands = cfg->bar_count;
+    float fmin = 20.0f;
+    float fmax = cfg->samplerate / 2.0f;
+    float log_min = log10f(fmin);
+    float log_max = log10f(fmax);
 
-    if (!cfg) {
-        printf("Error allocating neon_fft_config\n");
-        return nullptr;
-    }
+    float edge_lo = fmin;
+    for (int b = 0; b < nbands; b++) {
+        float frac = (float)(b + 1) / (float)nbands;
+        float edge_hi = powf(10.0f, log_min + frac * (log_max - log_min));
 
-    cfg->nbsamples = nbsamples;
-    cfg->samplerate = samplerate;
-    cfg->bar_count = bar_count;
+        // Compute lower and upper FFT indices of current band
+        int i_lo = f_to_bin(cfg, edge_lo);
+        int i_hi = f_to_bin(cfg, edge_hi);
+        if (i_hi <= i_lo)
+            i_hi = i_lo + 1;
 
+        cfg->band_start[b] = i_lo;
+        cfg->band_end[b] = i_hi;
+        edge_lo = edge_hi;
+    }
+}
+
+/**
+ * Init fft structures
+ *
+ * @param nbsamples corresponds to the number of samples that will be analyzed by the fft,
+ *        a power of two between NEON_FFT_MIN_SIZE and NEON_FFT_MAX_SIZE
+ * @param hop_size is the number of new samples between two analyses, windows overlap if smaller than nbsamples
+ * @param samplerate corresponds to the sample rate of audio data
+ * @param channel_mode equals 1 if mono or 2 if stereo
+ * @param backend computes the FFT, NE10 on the Vita
+ *
+ */
+neon_fft_config *neon_fft_init(int nbsamples, int hop_size, int samplerate, int channel_mode, int bar_count, const fft_backend *backend)
+{
     if (channel_mode != 1 && channel_mode != 2) {
         printf("Channel mode unsupported\n");
         return nullptr;
     }
 
-    cfg->channel_mode = channel_mode;
-
-    // Initialise Ne10, using hardware auto-detection to set library function pointers
-    if (ne10_init() != NE10_OK)
-    {
-        printf("Failed to initialise Ne10.\n");
-        free(cfg);
+    if (nbsamples < NEON_FFT_MIN_SIZE || nbsamples > NEON_FFT_MAX_SIZE || (nbsamples & (nbsamples - 1))) {
+        printf("FFT size %i unsupported\n", nbsamples);
         return nullptr;
     }
 
-    // Prepare the real-to-complex single precision floating point FFT configuration
-    // structure for inputs of length `nbsamples`. (You need only generate this once for a
-    // particular input size.)
-    cfg->cfg = ne10_fft_alloc_r2c_float32(nbsamples);
+    neon_fft_config *cfg = (neon_fft_config*)calloc(1, sizeof(neon_fft_config));
 
-    cfg->src_buffer = (ne10_int16_t*)malloc(sizeof(ne10_int16_t) * nbsamples);
-    if (!cfg->src_buffer) {
-        printf("Error allocating ne10 src_buffer\n");
-        ne10_fft_destroy_r2c_float32(cfg->cfg);
-        free(cfg);
+    if (!cfg) {
+        printf("Error allocating neon_fft_config\n");
         return nullptr;
     }
 
-    cfg->dst_buffer = (ne10_fft_cpx_float32_t*)malloc(sizeof(ne10_fft_cpx_float32_t) * ((nbsamples / 2) + 1));
-    if (!cfg->dst_buffer) {
-        printf("Error allocating ne10 dst_buffer\n");
-        free(cfg->src_buffer);
-        ne10_fft_destroy_r2c_float32(cfg->cfg);
-        free(cfg);
+    cfg->nbsamples = nbsamples;
+    cfg->hop_size = hop_size > 0 && hop_size < nbsamples ? hop_size : nbsamples;
+    cfg->samplerate = samplerate > 0 ? samplerate : 44100; // until neon_fft_set_format gives the stream one
+    cfg->bar_count = bar_count;
+    cfg->channel_mode = channel_mode;
+
+    cfg->backend = backend;
+    cfg->plan = backend->create(nbsamples);
+
+    // src_buffer is zeroed, silence is analysed until the first samples arrive
+    cfg->src_buffer = (int16_t*)calloc(nbsamples, sizeof(int16_t));
+    cfg->src_buffer_right = (int16_t*)calloc(nbsamples, sizeof(int16_t));
+    cfg->dst_buffer = (fft_complex*)malloc(sizeof(fft_complex) * ((nbsamples / 2) + 1));
+    cfg->visualizer_data = (float*)calloc(cfg->bar_count, sizeof(float));
+    cfg->secondary_data = (float*)calloc(cfg->bar_count, sizeof(float));
+    cfg->window = (float*)malloc(sizeof(float) * nbsamples);
+    cfg->windowed = (float*)malloc(sizeof(float) * nbsamples);
+    cfg->windowed_secondary = (float*)malloc(sizeof(float) * nbsamples);
+    cfg->power = (float*)malloc(sizeof(float) * ((nbsamples / 2) + 1));
+    cfg->band_start = (int*)malloc(sizeof(int) * cfg->bar_count);
+    cfg->band_end = (int*)malloc(sizeof(int) * cfg->bar_count);
+
+    if (!cfg->plan || !cfg->src_buffer || !cfg->src_buffer_right || !cfg->dst_buffer || !cfg->visualizer_data
+        || !cfg->secondary_data || !cfg->window || !cfg->windowed || !cfg->windowed_secondary || !cfg->power
+        || !cfg->band_start || !cfg->band_end) {
+        printf("Error allocating FFT buffers\n");
+        neon_fft_free(cfg);
         return nullptr;
     }
 
-    cfg->visualizer_data = (float*)malloc(sizeof(float) * cfg->bar_count);
-    if (!cfg->visualizer_data) {
-        printf("Error allocating visualizer_data\n");
-        free(cfg->dst_buffer);
-        free(cfg->src_buffer);
-        ne10_fft_destroy_r2c_float32(cfg->cfg);
-        free(cfg);
-        return nullptr;
+    for (int i = 0; i < cfg->nbsamples; i++) {
+        cfg->window[i] = 0.5f * (1 - cosf(2*M_PI*i/(cfg->nbsamples - 1)));
     }
 
+    neon_fft_build_bands(cfg);
+
     return cfg;
 }
 
@@ -88,28 +133,55 @@ void neon_fft_free(neon_fft_config *cfg)
         return;
     }
 
-    // Free the allocated configuration structure
-    ne10_fft_destroy_r2c_float32(cfg->cfg);
-
-    if (cfg->src_buffer) {
-        free(cfg->src_buffer);
+    if (cfg->plan) {
+        cfg->backend->destroy(cfg->plan);
     }
 
-    if (cfg->dst_buffer) {
-        free(cfg->dst_buffer);
-    }
+    // free(NULL) does nothing, buffers may be missing after a failed init
+    free(cfg->src_buffer);
+    free(cfg->src_buffer_right);
+    free(cfg->dst_buffer);
+    free(cfg->visualizer_data);
+    free(cfg->secondary_data);
+    free(cfg->window);
+    free(cfg->windowed);
+    free(cfg->windowed_secondary);
+    free(cfg->power);
+    free(cfg->band_start);
+    free(cfg->band_end);
+
+    free(cfg);
+}
 
-    if (cfg->visualizer_data) {
-        free(cfg->visualizer_data);
+/**
+ * Follow a new stream format without reallocating the FFT
+ *
+ * The history is cleared since old samples do not match the new format.
+ */
+void neon_fft_set_format(neon_fft_config *cfg, int samplerate, int channel_mode)
+{
+    if (!cfg || samplerate <= 0 || (channel_mode != 1 && channel_mode != 2)) {
+        return;
     }
 
-    free(cfg);
+    cfg->channel_mode = channel_mode;
+    memset(cfg->src_buffer, 0, sizeof(int16_t) * cfg->nbsamples);
+    memset(cfg->src_buffer_right, 0, sizeof(int16_t) * cfg->nbsamples);
+    cfg->src_pos = 0;
+    cfg->pending = 0;
+    cfg->fed = 0;
+
+    if (samplerate != cfg->samplerate) {
+        cfg->samplerate = samplerate;
+        neon_fft_build_bands(cfg);
+    }
 }
 
 /**
- * Add samples to the end of src_buffer
- * 
- * @param raw_data is PCM 16bit little-endian (2 bytes / sample in mono, 4 bytes / sample in stereo) and must be of size nbsamples
+ * Add samples to the end of the history ring, the oldest ones are overwritten
+ *
+ * @param raw_data is PCM 16bit little-endian (2 bytes / sample in mono, 4 bytes / sample in stereo)
+ * @param nbsamples is the number of samples per channel, any size
  */
 void neon_fft_fill_buffer(neon_fft_config *cfg, int16_t *raw_data, int nbsamples)
 {
@@ -118,107 +190,229 @@ void neon_fft_fill_buffer(neon_fft_config *cfg, int16_t *raw_data, int nbsamples
         return;
     }
 
-    if (nbsamples == 0) {
+    if (nbsamples <= 0) {
         printf("neon_fft_fill_src_buffer: nbsamples equals to zero\n");
         return;
     }
 
+    // Saturated, it only has to reach hop_size
+    cfg->pending = cfg->pending + nbsamples < cfg->nbsamples ? cfg->pending + nbsamples : cfg->nbsamples;
+    cfg->fed += nbsamples;
+
     if (nbsamples > cfg->nbsamples) {
-        printf("neon_fft_fill_src_buffer: too much samples nbsamples=%i cfg->nbsamples=%i\n", nbsamples, cfg->nbsamples);
-        return;
+        // Only the most recent samples can fit
+        raw_data += (nbsamples - cfg->nbsamples) * cfg->channel_mode;
+        nbsamples = cfg->nbsamples;
     }
- 
-    if (cfg->channel_mode == 1) {
-        memcpy(cfg->src_buffer, raw_data, nbsamples * sizeof(int16_t));
-    } else if (cfg->channel_mode == 2) {
-        // Only keep left channel for analysis
-        for (int i = 0; i < nbsamples; i++) {
-            cfg->src_buffer[i] = raw_data[i * 2];
+
+    while (nbsamples > 0) {
+        int count = cfg->nbsamples - cfg->src_pos;
+        if (count > nbsamples) {
+            count = nbsamples;
+        }
+
+        int16_t *left = cfg->src_buffer + cfg->src_pos;
+        int16_t *right = cfg->src_buffer_right + cfg->src_pos;
+        if (cfg->channel_mode == 1) {
+            memcpy(left, raw_data, count * sizeof(int16_t));
+        } else if (cfg->channel_mode == 2) {
+            // Deinterleave 8 stereo samples at a time
+            int i = 0;
+#ifdef NEON_FFT_USE_NEON
+            for (; i + 8 <= count; i += 8) {
+                int16x8x2_t samples = vld2q_s16(raw_data + i * 2);
+                vst1q_s16(left + i, samples.val[0]);
+                vst1q_s16(right + i, samples.val[1]);
+            }
+#endif
+
+            for (; i < count; i++) {
+                left[i] = raw_data[i * 2];
+                right[i] = raw_data[i * 2 + 1];
+            }
         }
+
+        raw_data += count * cfg->channel_mode;
+        nbsamples -= count;
+        cfg->src_pos = (cfg->src_pos + count) & (cfg->nbsamples - 1);
     }
 }
 
-// Convert a frequency into an FFT indices
-static inline int f_to_bin(neon_fft_config *cfg, float f) {
-    int idx = (int)roundf(f * cfg->nbsamples / cfg->samplerate);
-    if (idx < 0) idx = 0;
-    if (idx > cfg->nbsamples/2) idx = cfg->nbsamples/2;
-    return idx;
+// FFT inputs as a mix of both channels: a = left * a_left + right * a_right
+struct channel_mix {
+    float a_left, a_right;
+    float b_left, b_right;
+};
+
+static const channel_mix channel_mixes[] = {
+    { 0.5f, 0.5f, 0.0f, 0.0f }, // NEON_FFT_MODE_MONO
+    { 1.0f, 0.0f, 0.0f, 1.0f }, // NEON_FFT_MODE_STEREO
+    { 0.5f, 0.5f, 0.5f, -0.5f }, // NEON_FFT_MODE_MID_SIDE
+};
+
+struct correlation_sums {
+#ifdef NEON_FFT_USE_NEON
+    float32x4_t vec_lr, vec_ll, vec_rr;
+#endif
+    float lr, ll, rr;
+};
+
+#ifdef NEON_FFT_USE_NEON
+static float horizontal_sum(float32x4_t values)
+{
+    float32x2_t pair = vadd_f32(vget_low_f32(values), vget_high_f32(values));
+    return vget_lane_f32(vpadd_f32(pair, pair), 0);
 }
+#endif
 
 /**
- * Apply FFT on the last 1 second of data and create visualization inside visualizer_data
+ * Window both FFT inputs and accumulate the correlation sums in one pass, 4 samples at a time
+ *
+ * @param windowed_b is NULL when only one FFT is needed
  */
-int spectrum_analyser(neon_fft_config *cfg)
+static void apply_window(float *windowed_a, float *windowed_b, const int16_t *left, const int16_t *right,
+    const float *window, int nbsamples, const channel_mix *mix, correlation_sums *sums)
 {
-    // Apply Hann window on src_buffer
-    float *buffer = (float*)malloc(sizeof(float) * cfg->nbsamples);
-    if (!buffer) {
-        printf("spectrum_analyser: error allocating buffer");
-        return -1;
-    }
+    int i = 0;
 
-    for (int i = 0; i < cfg->nbsamples; i++) {
-        float hann_value = 0.5f * (1 - cosf(2*M_PI*i/(cfg->nbsamples - 1)));
-        buffer[i] = hann_value * (float)cfg->src_buffer[i];
+#ifdef NEON_FFT_USE_NEON
+    for (; i + 4 <= nbsamples; i += 4) {
+        float32x4_t l = vcvtq_f32_s32(vmovl_s16(vld1_s16(left + i)));
+        float32x4_t r = vcvtq_f32_s32(vmovl_s16(vld1_s16(right + i)));
+        float32x4_t w = vld1q_f32(window + i);
+
+        sums->vec_lr = vmlaq_f32(sums->vec_lr, l, r);
+        sums->vec_ll = vmlaq_f32(sums->vec_ll, l, l);
+        sums->vec_rr = vmlaq_f32(sums->vec_rr, r, r);
+
+        float32x4_t a = vaddq_f32(vmulq_n_f32(l, mix->a_left), vmulq_n_f32(r, mix->a_right));
+        vst1q_f32(windowed_a + i, vmulq_f32(a, w));
+
+        if (windowed_b) {
+            float32x4_t b = vaddq_f32(vmulq_n_f32(l, mix->b_left), vmulq_n_f32(r, mix->b_right));
+            vst1q_f32(windowed_b + i, vmulq_f32(b, w));
+        }
     }
+#endif
 
-    // Perform the FFT
-    ne10_fft_r2c_1d_float32_neon(cfg->dst_buffer, buffer, cfg->cfg);
+    for (; i < nbsamples; i++) {
+        float l = (float)left[i];
+        float r = (float)right[i];
 
-    // Compute power
-    float *power = (float*)malloc(sizeof(float) * (cfg->nbsamples / 2 + 1));
-    if (!power) {
-        printf("spectrum_analyser: error allocating power");
-        return -1;
+        sums->lr += l * r;
+        sums->ll += l * l;
+        sums->rr += r * r;
+
+        windowed_a[i] = window[i] * (l * mix->a_left + r * mix->a_right);
+        if (windowed_b) {
+            windowed_b[i] = window[i] * (l * mix->b_left + r * mix->b_right);
+        }
     }
+}
 
-    for (int i = 0; i <= cfg->nbsamples / 2; i++)
-    {
-        // Compute magnitude by doing (cfg->dst_buffer[i].r)^2 + (cfg->dst_buffer[i].i)^2
-        // We devide by 64 to reduce maximum value from 32768 down to 512 (the height of the screen)
-        float re = cfg->dst_buffer[i].r;
-        float im = cfg->dst_buffer[i].i;
-        power[i] = re*re + im*im;
+// power[i] = re^2 + im^2, the complex bins are deinterleaved by vld2q
+static void compute_power(float *power, const fft_complex *bins, int nbins)
+{
+    int i = 0;
+
+#ifdef NEON_FFT_USE_NEON
+    const float *data = (const float*)bins;
+    for (; i + 4 <= nbins; i += 4) {
+        float32x4x2_t cpx = vld2q_f32(data + 2 * i);
+        float32x4_t p = vmulq_f32(cpx.val[0], cpx.val[0]);
+        vst1q_f32(power + i, vmlaq_f32(p, cpx.val[1], cpx.val[1]));
     }
+#endif
 
-    // Create groups for visualizer
-    int nbands = cfg->bar_count;
-    float *edges = (float*)malloc(sizeof(float) * (nbands+1));
-    if (!edges) {
-        printf("spectrum_analyser: error allocating edges");
-        return -1;
+    for (; i < nbins; i++) {
+        power[i] = bins[i].r * bins[i].r + bins[i].i * bins[i].i;
     }
+}
 
-    float fmin = 20.0f;
-    float fmax = cfg->samplerate / 2.0f;
-    float log_min = log10f(fmin);
-    float log_max = log10f(fmax);
-    for (int i = 0; i <= nbands; i++) {
-        float frac = (float)i / (float)nbands;
-        edges[i] = powf(10.0f, log_min + frac * (log_max - log_min));
+static float sum_range(const float *values, int start, int end)
+{
+    int i = start;
+    float sum = 0.0f;
+
+#ifdef NEON_FFT_USE_NEON
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= end; i += 4) {
+        acc = vaddq_f32(acc, vld1q_f32(values + i));
     }
 
-    for (int b = 0; b < nbands; b++) {
-        // Compute lower and upper FFT indices of current band
-        int i_lo = f_to_bin(cfg, edges[b]);
-        int i_hi = f_to_bin(cfg, edges[b+1]);
-        cfg->visualizer_data[b] = 0;
+    sum = horizontal_sum(acc);
+#endif
 
-        if (i_hi <= i_lo)
-            i_hi = i_lo + 1;
+    for (; i < end; i++) {
+        sum += values[i];
+    }
 
-        for (int k = i_lo; k < i_hi; k++) {
-            cfg->visualizer_data[b] += power[k];
-        }
+    return sum;
+}
+
+// FFT of one windowed input, then power summed per bar in dB
+static void analyse_bands(neon_fft_config *cfg, float *windowed, float *bands)
+{
+    // Perform the FFT
+    cfg->backend->forward(cfg->plan, cfg->dst_buffer, windowed);
+
+    // Compute power
+    compute_power(cfg->power, cfg->dst_buffer, cfg->nbsamples / 2 + 1);
+
+    // Create groups for visualizer
+    for (int b = 0; b < cfg->bar_count; b++) {
+        float band_power = sum_range(cfg->power, cfg->band_start[b], cfg->band_end[b]);
 
         // Convert to dB
-        cfg->visualizer_data[b] = 10.0f * log10f(cfg->visualizer_data[b] + 1e-12f);
+        bands[b] = 10.0f * log10f(band_power + 1e-12f);
+    }
+}
+
+/**
+ * Apply FFT on the last nbsamples of history and create visualization inside visualizer_data,
+ * and secondary_data depending on the mode
+ *
+ * @return 1 if less than hop_size samples arrived since the last analysis, visualizer_data is unchanged
+ */
+int spectrum_analyser(neon_fft_config *cfg)
+{
+    if (cfg->pending < cfg->hop_size) {
+        return 1;
     }
 
-    free(edges);
-    free(power);
-    free(buffer);
+    cfg->pending = 0;
+    cfg->fed = 0;
+
+    // Mono streams only fill the left history
+    const int16_t *left = cfg->src_buffer;
+    const int16_t *right = cfg->channel_mode == 2 ? cfg->src_buffer_right : cfg->src_buffer;
+    const channel_mix *mix = &channel_mixes[cfg->mode];
+    float *secondary = cfg->mode != NEON_FFT_MODE_MONO ? cfg->windowed_secondary : NULL;
+
+    correlation_sums sums;
+#ifdef NEON_FFT_USE_NEON
+    sums.vec_lr = sums.vec_ll = sums.vec_rr = vdupq_n_f32(0.0f);
+#endif
+    sums.lr = sums.ll = sums.rr = 0.0f;
+
+    // Apply Hann window on the history, oldest sample first
+    int older = cfg->nbsamples - cfg->src_pos;
+    apply_window(cfg->windowed, secondary, left + cfg->src_pos, right + cfg->src_pos, cfg->window, older, mix, &sums);
+    apply_window(cfg->windowed + older, secondary ? secondary + older : NULL, left, right, cfg->window + older, cfg->src_pos, mix, &sums);
+
+#ifdef NEON_FFT_USE_NEON
+    sums.lr += horizontal_sum(sums.vec_lr);
+    sums.ll += horizontal_sum(sums.vec_ll);
+    sums.rr += horizontal_sum(sums.vec_rr);
+#endif
+
+    float energy = sqrtf(sums.ll * sums.rr);
+    cfg->correlation = energy > 0.0f ? sums.lr / energy : 0.0f;
+
+    analyse_bands(cfg, cfg->windowed, cfg->visualizer_data);
+    if (secondary) {
+        analyse_bands(cfg, secondary, cfg->secondary_data);
+    }
 
     return 0;
 }
@@ -1,18 +1,52 @@
+#ifndef __NEON_FFT_HPP__
+#define __NEON_FFT_HPP__
 
-#include <NE10.h>
+#include <stdint.h>
+
+#include "fft_backend.hpp"
+
+#define NEON_FFT_MIN_SIZE 512
+#define NEON_FFT_MAX_SIZE 8192
+
+enum neon_fft_mode {
+    NEON_FFT_MODE_MONO, // visualizer_data from the mid (L+R)/2 signal, one FFT
+    NEON_FFT_MODE_STEREO, // visualizer_data from left, secondary_data from right
+    NEON_FFT_MODE_MID_SIDE, // visualizer_data from mid, secondary_data from side (L-R)/2
+};
 
 struct neon_fft_config {
-    ne10_fft_r2c_cfg_float32_t cfg;
-    ne10_int16_t *src_buffer;
-    ne10_fft_cpx_float32_t *dst_buffer;
-    int nbsamples; // number of samples that will be analyzed for graph generation
+    const fft_backend *backend;
+    void *plan; // created by the backend for nbsamples
+    int16_t *src_buffer; // history ring of the last nbsamples samples, left channel
+    int16_t *src_buffer_right; // right channel history, unused in mono
+    int src_pos; // next sample to write in src_buffer, i.e. the oldest one
+    int pending; // samples added since the last analysis, capped at nbsamples
+    int fed; // samples added since the last analysis, not capped, for the beat timing
+    fft_complex *dst_buffer;
+    int nbsamples; // FFT size, power of two
+    int hop_size; // new samples needed before the next analysis
     int samplerate; // 44100 for example
     int channel_mode; // 1 if mono, 2 if stereo
     int bar_count; // number of bars to generate for visualization
+    neon_fft_mode mode;
     float *visualizer_data; // bar_count values values
+    float *secondary_data; // bar_count values, only with two FFTs
+    float correlation; // between left and right over the history, 1 for mono, 0 for silence
+
+    // Precomputed by neon_fft_init, spectrum_analyser does not allocate
+    float *window; // Hann coefficients, nbsamples values
+    float *windowed; // FFT input, nbsamples values
+    float *windowed_secondary; // second FFT input, nbsamples values
+    float *power; // nbsamples / 2 + 1 values
+    int *band_start; // first FFT bin of each bar
+    int *band_end; // last FFT bin (excluded) of each bar
 };
 
-neon_fft_config *neon_fft_init(int nbsamples, int samplerate, int channel_mode, int bar_count = 8);
+neon_fft_config *neon_fft_init(int nbsamples, int hop_size, int samplerate, int channel_mode, int bar_count = 8,
+    const fft_backend *backend = FFT_BACKEND_DEFAULT);
 void neon_fft_free(neon_fft_config *cfg);
+void neon_fft_set_format(neon_fft_config *cfg, int samplerate, int channel_mode);
 int spectrum_analyser(neon_fft_config *cfg);
 void neon_fft_fill_buffer(neon_fft_config *cfg, int16_t *raw_data, int nbsamples);
+
+#endif
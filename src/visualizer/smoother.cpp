@@ -0,0 +1,116 @@
+#include "smoother.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SMOOTHER_USE_NEON
+#endif
+
+static void smoother_reset(band_smoother *smoother, int count)
+{
+    memset(smoother->level, 0, sizeof(smoother->level));
+    memset(smoother->peak, 0, sizeof(smoother->peak));
+    memset(smoother->peak_speed, 0, sizeof(smoother->peak_speed));
+    memset(smoother->peak_hold, 0, sizeof(smoother->peak_hold));
+    smoother->count = count;
+}
+
+void smoother_init(band_smoother *smoother, float floor_db, float ceiling_db)
+{
+    smoother_reset(smoother, 0);
+    smoother_set_range(smoother, floor_db, ceiling_db);
+}
+
+/**
+ * Set the dB values shown as an empty and a full band
+ */
+void smoother_set_range(band_smoother *smoother, float floor_db, float ceiling_db)
+{
+    smoother->floor_db = floor_db;
+    smoother->ceiling_db = ceiling_db > floor_db + 1.0f ? ceiling_db : floor_db + 1.0f;
+}
+
+/**
+ * Move levels towards the new bands and let peak markers fall
+ *
+ * Call once per drawn frame, even without a new analysis, so decays keep running.
+ *
+ * @param bands are the dB levels of the latest analysis
+ * @param elapsed is the time since the previous call, in seconds
+ */
+void smoother_update(band_smoother *smoother, const float *bands, int count, float elapsed)
+{
+    if (count > SMOOTHER_MAX_BANDS) {
+        count = SMOOTHER_MAX_BANDS;
+    }
+
+    if (count != smoother->count) {
+        smoother_reset(smoother, count);
+    }
+
+    // One pole filters, the coefficient depends on the elapsed time instead of the frame count
+    float attack = 1.0f - expf(-elapsed / SMOOTHER_ATTACK);
+    float release = 1.0f - expf(-elapsed / SMOOTHER_RELEASE);
+    float scale = 1.0f / (smoother->ceiling_db - smoother->floor_db);
+    float fall = SMOOTHER_GRAVITY * elapsed;
+
+    float *level = smoother->level;
+    float *peak = smoother->peak;
+    float *speed = smoother->peak_speed;
+    float *hold = smoother->peak_hold;
+    int i = 0;
+
+#ifdef SMOOTHER_USE_NEON
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    float32x4_t one = vdupq_n_f32(1.0f);
+    float32x4_t floor_db = vdupq_n_f32(smoother->floor_db);
+    float32x4_t attack_4 = vdupq_n_f32(attack);
+    float32x4_t release_4 = vdupq_n_f32(release);
+    float32x4_t hold_time = vdupq_n_f32(SMOOTHER_PEAK_HOLD);
+
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t target = vmulq_n_f32(vsubq_f32(vld1q_f32(bands + i), floor_db), scale);
+        target = vminq_f32(vmaxq_f32(target, zero), one);
+
+        float32x4_t current = vld1q_f32(level + i);
+        float32x4_t coefficient = vbslq_f32(vcgtq_f32(target, current), attack_4, release_4);
+        current = vmlaq_f32(current, vsubq_f32(target, current), coefficient);
+        vst1q_f32(level + i, current);
+
+        // Held peaks wait, the others accelerate down until they meet the level
+        float32x4_t peak_4 = vld1q_f32(peak + i);
+        float32x4_t speed_4 = vld1q_f32(speed + i);
+        float32x4_t hold_4 = vld1q_f32(hold + i);
+        uint32x4_t holding = vcgtq_f32(hold_4, zero);
+
+        speed_4 = vbslq_f32(holding, speed_4, vaddq_f32(speed_4, vdupq_n_f32(fall)));
+        peak_4 = vbslq_f32(holding, peak_4, vmlsq_f32(peak_4, speed_4, vdupq_n_f32(elapsed)));
+        hold_4 = vsubq_f32(hold_4, vdupq_n_f32(elapsed));
+
+        uint32x4_t rising = vcgeq_f32(current, peak_4);
+        vst1q_f32(peak + i, vmaxq_f32(peak_4, current));
+        vst1q_f32(speed + i, vbslq_f32(rising, zero, speed_4));
+        vst1q_f32(hold + i, vbslq_f32(rising, hold_time, hold_4));
+    }
+#endif
+
+    for (; i < count; i++) {
+        float target = (bands[i] - smoother->floor_db) * scale;
+        target = target < 0.0f ? 0.0f : target > 1.0f ? 1.0f : target;
+        level[i] += (target - level[i]) * (target > level[i] ? attack : release);
+
+        if (hold[i] <= 0.0f) {
+            speed[i] += fall;
+            peak[i] -= speed[i] * elapsed;
+        }
+        hold[i] -= elapsed;
+
+        if (level[i] >= peak[i]) {
+            peak[i] = level[i];
+            speed[i] = 0.0f;
+            hold[i] = SMOOTHER_PEAK_HOLD;
+        }
+    }
+}
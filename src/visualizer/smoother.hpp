@@ -0,0 +1,29 @@
+#ifndef __SMOOTHER_HPP__
+#define __SMOOTHER_HPP__
+
+#define SMOOTHER_MAX_BANDS 256
+#define SMOOTHER_ATTACK 0.015f // seconds, time constant when a band rises
+#define SMOOTHER_RELEASE 0.12f // seconds, time constant when a band falls
+#define SMOOTHER_PEAK_HOLD 0.4f // seconds before a peak marker starts falling
+#define SMOOTHER_GRAVITY 2.5f // full scales per second squared
+
+/**
+ * Band levels for drawing, smoothed with the real elapsed time so they behave the same at any frame rate
+ *
+ * Levels and peaks are normalized: 0 at floor_db, 1 at ceiling_db.
+ */
+struct band_smoother {
+    float level[SMOOTHER_MAX_BANDS];
+    float peak[SMOOTHER_MAX_BANDS];
+    float peak_speed[SMOOTHER_MAX_BANDS]; // full scales per second
+    float peak_hold[SMOOTHER_MAX_BANDS]; // seconds left before falling
+    int count;
+    float floor_db;
+    float ceiling_db;
+};
+
+void smoother_init(band_smoother *smoother, float floor_db, float ceiling_db);
+void smoother_set_range(band_smoother *smoother, float floor_db, float ceiling_db);
+void smoother_update(band_smoother *smoother, const float *bands, int count, float elapsed);
+
+#endif
@@ -0,0 +1,176 @@
+#include "spectrogram.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SPECTROGRAM_USE_NEON
+#endif
+
+#include <vitaGL.h>
+#include <psp2/kernel/clib.h>
+
+#define printf sceClibPrintf
+
+// Circular texture, the newest column is at write_column
+static GLuint texture = 0;
+static int write_column = 0;
+static int row_count = 0; // bands in each column
+
+static uint32_t color_lut[256];
+static uint32_t column[SPECTROGRAM_HEIGHT];
+
+struct color_stop {
+    int index;
+    int r, g, b;
+};
+
+// Black, blue, magenta, orange, yellow, white
+static const color_stop color_stops[] = {
+    { 0, 0, 0, 0 },
+    { 64, 20, 10, 120 },
+    { 128, 170, 30, 130 },
+    { 192, 250, 130, 20 },
+    { 240, 250, 240, 60 },
+    { 255, 255, 255, 255 },
+};
+
+static void spectrogram_build_lut(void)
+{
+    for (unsigned int s = 0; s + 1 < sizeof(color_stops) / sizeof(color_stops[0]); s++) {
+        const color_stop *from = &color_stops[s];
+        const color_stop *to = &color_stops[s + 1];
+
+        for (int i = from->index; i <= to->index; i++) {
+            int t = i - from->index;
+            int length = to->index - from->index;
+            int r = from->r + (to->r - from->r) * t / length;
+            int g = from->g + (to->g - from->g) * t / length;
+            int b = from->b + (to->b - from->b) * t / length;
+            color_lut[i] = 0xFF000000 | (b << 16) | (g << 8) | r;
+        }
+    }
+}
+
+int spectrogram_init(void)
+{
+    spectrogram_build_lut();
+
+    glGenTextures(1, &texture);
+    if (!texture) {
+        printf("Spectrogram: error creating texture\n");
+        return -1;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Scrolling is done with texture coordinates past 1.0
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    spectrogram_clear();
+
+    return 0;
+}
+
+void spectrogram_term(void)
+{
+    if (texture) {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+}
+
+void spectrogram_clear(void)
+{
+    if (!texture) {
+        return;
+    }
+
+    uint32_t *pixels = (uint32_t*)malloc(sizeof(uint32_t) * SPECTROGRAM_WIDTH * SPECTROGRAM_HEIGHT);
+    if (!pixels) {
+        printf("Spectrogram: error allocating pixels\n");
+        return;
+    }
+
+    for (int i = 0; i < SPECTROGRAM_WIDTH * SPECTROGRAM_HEIGHT; i++) {
+        pixels[i] = color_lut[0];
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SPECTROGRAM_WIDTH, SPECTROGRAM_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    free(pixels);
+
+    write_column = 0;
+}
+
+/**
+ * Add the bands of one analysis as the newest column
+ *
+ * Only one column is uploaded, the cost does not depend on the FFT size.
+ */
+void spectrogram_push(const float *bands, int count)
+{
+    if (!texture || count <= 0) {
+        return;
+    }
+
+    if (count > SPECTROGRAM_HEIGHT) {
+        count = SPECTROGRAM_HEIGHT;
+    }
+
+    if (count != row_count) {
+        // Old columns do not have the same frequency scale
+        row_count = count;
+        spectrogram_clear();
+    }
+
+    // dB to LUT index, 4 bands at a time
+    int32_t indices[SPECTROGRAM_HEIGHT];
+    const float scale = 255.0f / SPECTROGRAM_DB_RANGE;
+    int i = 0;
+
+#ifdef SPECTROGRAM_USE_NEON
+    float32x4_t db_floor = vdupq_n_f32(SPECTROGRAM_DB_FLOOR);
+    float32x4_t low = vdupq_n_f32(0.0f);
+    float32x4_t high = vdupq_n_f32(255.0f);
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t index = vmulq_n_f32(vsubq_f32(vld1q_f32(bands + i), db_floor), scale);
+        index = vminq_f32(vmaxq_f32(index, low), high);
+        vst1q_s32(indices + i, vcvtq_s32_f32(index));
+    }
+#endif
+
+    for (; i < count; i++) {
+        float index = (bands[i] - SPECTROGRAM_DB_FLOOR) * scale;
+        indices[i] = index < 0.0f ? 0 : index > 255.0f ? 255 : (int32_t)index;
+    }
+
+    for (i = 0; i < count; i++) {
+        column[i] = color_lut[indices[i]];
+    }
+
+    write_column = (write_column + 1) % SPECTROGRAM_WIDTH;
+
+    // A one pixel wide sub-image is stored as one pixel per row
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, write_column, 0, 1, count, GL_RGBA, GL_UNSIGNED_BYTE, column);
+}
+
+/**
+ * Oldest column on the left, low frequencies at the bottom
+ */
+void spectrogram_draw(ImDrawList *draw_list, const ImVec2 &min, const ImVec2 &max)
+{
+    if (!texture || !row_count) {
+        return;
+    }
+
+    float start = (float)(write_column + 1) / SPECTROGRAM_WIDTH;
+    float rows = (float)row_count / SPECTROGRAM_HEIGHT;
+
+    draw_list->AddImage((ImTextureID)(uintptr_t)texture, min, max, ImVec2(start, rows), ImVec2(start + 1.0f, 0.0f));
+}
@@ -0,0 +1,17 @@
+#ifndef __SPECTROGRAM_HPP__
+#define __SPECTROGRAM_HPP__
+
+#include <imgui_vita.h>
+
+#define SPECTROGRAM_WIDTH 512 // columns kept, one per analysis
+#define SPECTROGRAM_HEIGHT 256 // at least ANALYSER_MAX_BARS
+#define SPECTROGRAM_DB_FLOOR 60.0f // black
+#define SPECTROGRAM_DB_RANGE 100.0f // from black to white
+
+int spectrogram_init(void);
+void spectrogram_term(void);
+void spectrogram_clear(void);
+void spectrogram_push(const float *bands, int count);
+void spectrogram_draw(ImDrawList *draw_list, const ImVec2 &min, const ImVec2 &max);
+
+#endif
@@ -0,0 +1,505 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <psp2/kernel/clib.h>
+
+#include "xspf_tokenizer.h"
+
+#define printf sceClibPrintf
+
+enum xspf_state {
+    XSPF_STATE_TEXT,
+    XSPF_STATE_TAG_START, // after '<'
+    XSPF_STATE_TAG_NAME,
+    XSPF_STATE_TAG_BODY, // attributes, skipped
+    XSPF_STATE_TAG_QUOTE,
+    XSPF_STATE_ENTITY, // after '&'
+    XSPF_STATE_MARKUP, // after "<!"
+    XSPF_STATE_COMMENT,
+    XSPF_STATE_CDATA,
+    XSPF_STATE_DECLARATION, // <!DOCTYPE ...>
+    XSPF_STATE_PROCESSING, // <?xml ...?>
+};
+
+static void xspf_error(struct xspf_tokenizer *tokenizer, const char *message)
+{
+    tokenizer->errors++;
+
+    if (tokenizer->callbacks.error) {
+        tokenizer->callbacks.error(tokenizer->user, tokenizer->line, message);
+    } else {
+        printf("XSPF: line %i: %s\n", tokenizer->line, message);
+    }
+}
+
+/**
+ * Add text to the field being read, if any
+ */
+static int xspf_append(struct xspf_tokenizer *tokenizer, const char *data, size_t size)
+{
+    if (tokenizer->field < 0 || tokenizer->depth != tokenizer->field_depth || size == 0) {
+        return 0;
+    }
+
+    struct xspf_buffer *buffer = &tokenizer->fields[tokenizer->field];
+    if (buffer->length + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+        while (capacity < buffer->length + size) {
+            capacity *= 2;
+        }
+
+        char *new_data = realloc(buffer->data, capacity);
+        if (!new_data) {
+            printf("XSPF: cannot allocate a field of %i bytes\n", capacity);
+            return -1;
+        }
+        buffer->data = new_data;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->length, data, size);
+    buffer->length += size;
+    return 0;
+}
+
+static struct m3u_span xspf_trim(const struct xspf_buffer *buffer)
+{
+    struct m3u_span span = { buffer->data, buffer->length };
+
+    while (span.length > 0 && (*span.data == ' ' || *span.data == '\t' || *span.data == '\r' || *span.data == '\n')) {
+        span.data++;
+        span.length--;
+    }
+
+    while (span.length > 0) {
+        char c = span.data[span.length - 1];
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            break;
+        }
+        span.length--;
+    }
+
+    return span;
+}
+
+/**
+ * Compare the element name without its namespace prefix
+ */
+static int xspf_name_equals(const struct xspf_tokenizer *tokenizer, const char *str)
+{
+    if (tokenizer->name_length > XSPF_NAME_MAX) {
+        return 0;
+    }
+
+    const char *name = tokenizer->name;
+    int length = tokenizer->name_length;
+    const char *colon = memchr(name, ':', length);
+    if (colon) {
+        length -= colon + 1 - name;
+        name = colon + 1;
+    }
+
+    return (size_t)length == strlen(str) && !memcmp(name, str, length);
+}
+
+static void xspf_name_push(struct xspf_tokenizer *tokenizer, char c)
+{
+    if (tokenizer->name_length < XSPF_NAME_MAX) {
+        tokenizer->name[tokenizer->name_length++] = c;
+    } else {
+        // Too long to be one of ours
+        tokenizer->name_length = XSPF_NAME_MAX + 1;
+    }
+}
+
+static int xspf_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void xspf_emit_track(struct xspf_tokenizer *tokenizer)
+{
+    struct m3u_span url = xspf_trim(&tokenizer->fields[XSPF_FIELD_LOCATION]);
+    if (url.length == 0) {
+        xspf_error(tokenizer, "track without location");
+        return;
+    }
+
+    struct m3u_item item;
+    memset(&item, 0, sizeof(item));
+    item.duration = -1;
+    item.url = url;
+    item.title = xspf_trim(&tokenizer->fields[XSPF_FIELD_TITLE]);
+    item.tvg_logo = xspf_trim(&tokenizer->fields[XSPF_FIELD_IMAGE]);
+    item.line = tokenizer->line;
+
+    tokenizer->callbacks.item(tokenizer->user, &item);
+}
+
+static void xspf_start_field(struct xspf_tokenizer *tokenizer, int field)
+{
+    if (tokenizer->fields[field].length > 0) {
+        // Only the first location is played, the other fields are not repeated
+        return;
+    }
+
+    tokenizer->field = field;
+    tokenizer->field_depth = tokenizer->depth;
+}
+
+static void xspf_open_element(struct xspf_tokenizer *tokenizer)
+{
+    tokenizer->depth++;
+
+    if (!tokenizer->track_depth) {
+        if (xspf_name_equals(tokenizer, "track")) {
+            tokenizer->track_depth = tokenizer->depth;
+            tokenizer->fields[XSPF_FIELD_LOCATION].length = 0;
+            tokenizer->fields[XSPF_FIELD_TITLE].length = 0;
+            tokenizer->fields[XSPF_FIELD_IMAGE].length = 0;
+        } else if (tokenizer->depth == 2 && xspf_name_equals(tokenizer, "title")) {
+            xspf_start_field(tokenizer, XSPF_FIELD_PLAYLIST_TITLE);
+        }
+        return;
+    }
+
+    if (tokenizer->depth != tokenizer->track_depth + 1) {
+        // Inside <extension> or another nested element
+        return;
+    }
+
+    if (xspf_name_equals(tokenizer, "location")) {
+        xspf_start_field(tokenizer, XSPF_FIELD_LOCATION);
+    } else if (xspf_name_equals(tokenizer, "title")) {
+        xspf_start_field(tokenizer, XSPF_FIELD_TITLE);
+    } else if (xspf_name_equals(tokenizer, "image")) {
+        xspf_start_field(tokenizer, XSPF_FIELD_IMAGE);
+    }
+}
+
+static void xspf_close_element(struct xspf_tokenizer *tokenizer)
+{
+    if (tokenizer->depth == 0) {
+        xspf_error(tokenizer, "closing tag without opening tag");
+        return;
+    }
+
+    if (tokenizer->field >= 0 && tokenizer->depth <= tokenizer->field_depth) {
+        if (tokenizer->field == XSPF_FIELD_PLAYLIST_TITLE && tokenizer->callbacks.playlist_name) {
+            struct m3u_span name = xspf_trim(&tokenizer->fields[XSPF_FIELD_PLAYLIST_TITLE]);
+            if (name.length) {
+                tokenizer->callbacks.playlist_name(tokenizer->user, name);
+            }
+        }
+        tokenizer->field = -1;
+    }
+
+    if (tokenizer->track_depth && tokenizer->depth <= tokenizer->track_depth) {
+        xspf_emit_track(tokenizer);
+        tokenizer->track_depth = 0;
+    }
+
+    tokenizer->depth--;
+}
+
+static void xspf_end_tag(struct xspf_tokenizer *tokenizer)
+{
+    if (tokenizer->closing) {
+        xspf_close_element(tokenizer);
+    } else if (!tokenizer->self_closing) {
+        xspf_open_element(tokenizer);
+    }
+
+    tokenizer->state = XSPF_STATE_TEXT;
+}
+
+/**
+ * Decode the entity between '&' and ';'
+ *
+ * @return the number of bytes written to out, -1 if unknown
+ */
+static int xspf_decode_entity(const char *entity, int length, char *out)
+{
+    static const struct {
+        const char *name;
+        char c;
+    } named[] = { { "amp", '&' }, { "lt", '<' }, { "gt", '>' }, { "quot", '"' }, { "apos", '\'' } };
+
+    for (size_t i = 0; i < sizeof(named) / sizeof(named[0]); i++) {
+        if ((size_t)length == strlen(named[i].name) && !memcmp(entity, named[i].name, length)) {
+            out[0] = named[i].c;
+            return 1;
+        }
+    }
+
+    if (length < 2 || entity[0] != '#') {
+        return -1;
+    }
+
+    int hexadecimal = entity[1] == 'x' || entity[1] == 'X';
+    int i = hexadecimal ? 2 : 1;
+    if (i == length) {
+        return -1;
+    }
+
+    unsigned long code = 0;
+    for (; i < length; i++) {
+        char c = entity[i];
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (hexadecimal && c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (hexadecimal && c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return -1;
+        }
+        code = code * (hexadecimal ? 16 : 10) + digit;
+        if (code > 0x10FFFF) {
+            return -1;
+        }
+    }
+
+    if (code == 0 || (code >= 0xD800 && code <= 0xDFFF)) {
+        return -1;
+    }
+
+    return m3u_encode_utf8(code, out);
+}
+
+static int xspf_flush_entity(struct xspf_tokenizer *tokenizer)
+{
+    // Keep the text of an entity we cannot decode
+    return xspf_append(tokenizer, "&", 1) || xspf_append(tokenizer, tokenizer->entity, tokenizer->entity_length);
+}
+
+static int xspf_is_prefix(const struct xspf_tokenizer *tokenizer, const char *str)
+{
+    return (size_t)tokenizer->name_length <= strlen(str) && !memcmp(tokenizer->name, str, tokenizer->name_length);
+}
+
+void xspf_tokenizer_init(struct xspf_tokenizer *tokenizer, const struct m3u_tokenizer_callbacks *callbacks, void *user)
+{
+    memset(tokenizer, 0, sizeof(struct xspf_tokenizer));
+    tokenizer->callbacks = *callbacks;
+    tokenizer->user = user;
+    tokenizer->state = XSPF_STATE_TEXT;
+    tokenizer->field = -1;
+    tokenizer->line = 1;
+}
+
+/**
+ * Parse the next part of the document, the input can be split anywhere
+ *
+ * @return 0 on success, -1 on allocation error. Malformed markup is reported and skipped.
+ */
+int xspf_tokenizer_feed(struct xspf_tokenizer *tokenizer, const char *data, size_t size)
+{
+    const char *p = data;
+    const char *end = data + size;
+    tokenizer->bytes += size;
+
+    while (p < end) {
+        char c = *p;
+
+        switch (tokenizer->state) {
+        case XSPF_STATE_TEXT: {
+            // Most of the document, copy runs of text at once
+            const char *run = p;
+            while (p < end && *p != '<' && *p != '&') {
+                if (*p == '\n') {
+                    tokenizer->line++;
+                }
+                p++;
+            }
+
+            if (xspf_append(tokenizer, run, p - run)) {
+                return -1;
+            }
+
+            if (p < end) {
+                tokenizer->state = *p == '<' ? XSPF_STATE_TAG_START : XSPF_STATE_ENTITY;
+                tokenizer->entity_length = 0;
+                p++;
+            }
+            continue;
+        }
+
+        case XSPF_STATE_TAG_START:
+            tokenizer->name_length = 0;
+            tokenizer->closing = 0;
+            tokenizer->self_closing = 0;
+            if (c == '/') {
+                tokenizer->closing = 1;
+                tokenizer->state = XSPF_STATE_TAG_NAME;
+            } else if (c == '!') {
+                tokenizer->state = XSPF_STATE_MARKUP;
+            } else if (c == '?') {
+                tokenizer->match = 0;
+                tokenizer->state = XSPF_STATE_PROCESSING;
+            } else if (xspf_is_space(c) || c == '<' || c == '>') {
+                xspf_error(tokenizer, "'<' without element name");
+                tokenizer->state = XSPF_STATE_TEXT;
+                continue;
+            } else {
+                xspf_name_push(tokenizer, c);
+                tokenizer->state = XSPF_STATE_TAG_NAME;
+            }
+            break;
+
+        case XSPF_STATE_TAG_NAME:
+            if (c == '>') {
+                xspf_end_tag(tokenizer);
+            } else if (c == '/') {
+                tokenizer->self_closing = 1;
+                tokenizer->state = XSPF_STATE_TAG_BODY;
+            } else if (xspf_is_space(c)) {
+                tokenizer->state = XSPF_STATE_TAG_BODY;
+            } else {
+                xspf_name_push(tokenizer, c);
+            }
+            break;
+
+        case XSPF_STATE_TAG_BODY:
+            if (c == '>') {
+                xspf_end_tag(tokenizer);
+            } else if (c == '"' || c == '\'') {
+                tokenizer->quote = c;
+                tokenizer->self_closing = 0;
+                tokenizer->state = XSPF_STATE_TAG_QUOTE;
+            } else if (!xspf_is_space(c)) {
+                tokenizer->self_closing = c == '/';
+            }
+            break;
+
+        case XSPF_STATE_TAG_QUOTE:
+            if (c == tokenizer->quote) {
+                tokenizer->state = XSPF_STATE_TAG_BODY;
+            }
+            break;
+
+        case XSPF_STATE_ENTITY:
+            if (c == ';') {
+                char decoded[4];
+                int length = xspf_decode_entity(tokenizer->entity, tokenizer->entity_length, decoded);
+                if (length < 0) {
+                    xspf_error(tokenizer, "unknown entity");
+                    if (xspf_flush_entity(tokenizer) || xspf_append(tokenizer, ";", 1)) {
+                        return -1;
+                    }
+                } else if (xspf_append(tokenizer, decoded, length)) {
+                    return -1;
+                }
+                tokenizer->state = XSPF_STATE_TEXT;
+            } else if (tokenizer->entity_length < XSPF_ENTITY_MAX && c != '<' && c != '&' && !xspf_is_space(c)) {
+                tokenizer->entity[tokenizer->entity_length++] = c;
+            } else {
+                // A bare '&', read the character again as text
+                xspf_error(tokenizer, "'&' without entity");
+                if (xspf_flush_entity(tokenizer)) {
+                    return -1;
+                }
+                tokenizer->state = XSPF_STATE_TEXT;
+                continue;
+            }
+            break;
+
+        case XSPF_STATE_MARKUP:
+            xspf_name_push(tokenizer, c);
+            tokenizer->match = 0;
+            if (tokenizer->name_length == 2 && xspf_is_prefix(tokenizer, "--")) {
+                tokenizer->state = XSPF_STATE_COMMENT;
+            } else if (tokenizer->name_length == 7 && xspf_is_prefix(tokenizer, "[CDATA[")) {
+                tokenizer->state = XSPF_STATE_CDATA;
+            } else if (!xspf_is_prefix(tokenizer, "--") && !xspf_is_prefix(tokenizer, "[CDATA[")) {
+                tokenizer->state = c == '>' ? XSPF_STATE_TEXT : XSPF_STATE_DECLARATION;
+                tokenizer->match = c == '[';
+            }
+            break;
+
+        case XSPF_STATE_COMMENT:
+            if (c == '>' && tokenizer->match >= 2) {
+                tokenizer->state = XSPF_STATE_TEXT;
+            } else {
+                tokenizer->match = c == '-' ? tokenizer->match + 1 : 0;
+            }
+            break;
+
+        case XSPF_STATE_CDATA:
+            if (c == ']' && tokenizer->match < 2) {
+                tokenizer->match++;
+            } else if (c == ']') {
+                // "]]]": the first one is text
+                if (xspf_append(tokenizer, "]", 1)) {
+                    return -1;
+                }
+            } else if (c == '>' && tokenizer->match == 2) {
+                tokenizer->state = XSPF_STATE_TEXT;
+            } else {
+                if (xspf_append(tokenizer, "]]", tokenizer->match) || xspf_append(tokenizer, &c, 1)) {
+                    return -1;
+                }
+                tokenizer->match = 0;
+            }
+            break;
+
+        case XSPF_STATE_DECLARATION:
+            // match counts the brackets of an internal subset
+            if (c == '[') {
+                tokenizer->match++;
+            } else if (c == ']') {
+                tokenizer->match--;
+            } else if (c == '>' && tokenizer->match <= 0) {
+                tokenizer->state = XSPF_STATE_TEXT;
+            }
+            break;
+
+        case XSPF_STATE_PROCESSING:
+            if (c == '>' && tokenizer->match) {
+                tokenizer->state = XSPF_STATE_TEXT;
+            }
+            tokenizer->match = c == '?';
+            break;
+        }
+
+        if (c == '\n') {
+            tokenizer->line++;
+        }
+        p++;
+    }
+
+    return 0;
+}
+
+/**
+ * Emit a track cut by the end of the document
+ */
+int xspf_tokenizer_finish(struct xspf_tokenizer *tokenizer)
+{
+    if (tokenizer->state != XSPF_STATE_TEXT) {
+        xspf_error(tokenizer, "document ends inside markup");
+        tokenizer->state = XSPF_STATE_TEXT;
+    }
+
+    if (tokenizer->track_depth) {
+        xspf_error(tokenizer, "track not closed at the end of the document");
+        xspf_emit_track(tokenizer);
+        tokenizer->track_depth = 0;
+    }
+
+    tokenizer->field = -1;
+    tokenizer->depth = 0;
+
+    return 0;
+}
+
+void xspf_tokenizer_free(struct xspf_tokenizer *tokenizer)
+{
+    for (int i = 0; i < XSPF_FIELD_COUNT; i++) {
+        free(tokenizer->fields[i].data);
+        tokenizer->fields[i].data = NULL;
+        tokenizer->fields[i].length = 0;
+        tokenizer->fields[i].capacity = 0;
+    }
+}
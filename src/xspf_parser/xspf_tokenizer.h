@@ -0,0 +1,62 @@
+#ifndef __XSPF_TOKENIZER_H__
+#define __XSPF_TOKENIZER_H__
+
+#include <stddef.h>
+
+#include "../m3u_parser/m3u_tokenizer.h"
+
+#define XSPF_NAME_MAX 32 // longer element names are never ones we look for
+#define XSPF_ENTITY_MAX 12
+
+enum xspf_field {
+    XSPF_FIELD_LOCATION,
+    XSPF_FIELD_TITLE,
+    XSPF_FIELD_IMAGE,
+    XSPF_FIELD_PLAYLIST_TITLE,
+    XSPF_FIELD_COUNT,
+};
+
+struct xspf_buffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+
+/**
+ * Incremental XSPF parser, items are given to the callbacks of the m3u tokenizer
+ *
+ * Only the text of the fields of the current track is kept, a track is emitted at its
+ * closing tag. This is not a validating parser: unknown elements, attributes and
+ * mismatched tags are skipped.
+ */
+struct xspf_tokenizer {
+    struct m3u_tokenizer_callbacks callbacks;
+    void *user;
+
+    int state;
+    char name[XSPF_NAME_MAX]; // element or markup name being read
+    int name_length;
+    int closing; // reading </name>
+    int self_closing; // last character of the tag was '/'
+    char quote; // attribute value delimiter
+    int match; // characters matched at the end of a comment, CDATA section or declaration
+    char entity[XSPF_ENTITY_MAX];
+    int entity_length;
+
+    int depth; // open elements
+    int track_depth; // depth of the open <track>, 0 if none
+    int field; // enum xspf_field being read, -1 if none
+    int field_depth;
+    struct xspf_buffer fields[XSPF_FIELD_COUNT];
+
+    int line;
+    int errors; // malformed markup and tracks without location
+    size_t bytes; // fed so far
+};
+
+void xspf_tokenizer_init(struct xspf_tokenizer *tokenizer, const struct m3u_tokenizer_callbacks *callbacks, void *user);
+int xspf_tokenizer_feed(struct xspf_tokenizer *tokenizer, const char *data, size_t size);
+int xspf_tokenizer_finish(struct xspf_tokenizer *tokenizer);
+void xspf_tokenizer_free(struct xspf_tokenizer *tokenizer);
+
+#endif
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "beat.hpp"
+#include "neon_fft.hpp"
+
+#ifndef M_PI
+#define M_PI		3.14159265358979323846
+#endif
+
+#define BEAT_TEST_SAMPLERATE 44100
+#define BEAT_TEST_FRAME 1024 // samples per decoded AAC frame
+#define BEAT_TEST_SECONDS 20
+#define BEAT_TEST_TOLERANCE 0.03f // relative tempo error
+
+// Decaying 1 kHz click on each beat, silence in between
+static int16_t click_sample(long position, float bpm)
+{
+    long beat_length = (long)(BEAT_TEST_SAMPLERATE * 60.0f / bpm);
+    long offset = position % beat_length;
+    float t = (float)offset / BEAT_TEST_SAMPLERATE;
+    if (t > 0.05f) {
+        return 0;
+    }
+
+    return (int16_t)(20000.0f * expf(-t * 60.0f) * sinf(2 * M_PI * 1000.0f * t));
+}
+
+/**
+ * Run the analyser loop on a click track: whole frames arrive as they are decoded,
+ * the analyser wakes up at its own pace and analyses everything that arrived.
+ * The pending count saturates at the FFT size when more samples arrive, the beat timing must not.
+ */
+static int check_tempo(int nbsamples, int hop_size, int period, float bpm)
+{
+    neon_fft_config *cfg = neon_fft_init(nbsamples, hop_size, BEAT_TEST_SAMPLERATE, 1, 32, &fft_backend_scalar);
+    int16_t *frame = (int16_t*)malloc(sizeof(int16_t) * BEAT_TEST_FRAME);
+    if (!cfg || !frame) {
+        printf("%i/%i every %i at %.0f BPM: setup failed\n", nbsamples, hop_size, period, bpm);
+        return -1;
+    }
+
+    beat_detector beat;
+    beat_init(&beat);
+
+    long decoded = 0;
+    unsigned int onsets = 0;
+    for (long now = 0; now < (long)BEAT_TEST_SECONDS * BEAT_TEST_SAMPLERATE; now += period) {
+        while (decoded + BEAT_TEST_FRAME <= now) {
+            for (int i = 0; i < BEAT_TEST_FRAME; i++) {
+                frame[i] = click_sample(decoded + i, bpm);
+            }
+            neon_fft_fill_buffer(cfg, frame, BEAT_TEST_FRAME);
+            decoded += BEAT_TEST_FRAME;
+        }
+
+        int elapsed = cfg->fed;
+        if (spectrum_analyser(cfg) == 0 && beat_process(&beat, cfg->visualizer_data, cfg->bar_count, elapsed, BEAT_TEST_SAMPLERATE)) {
+            onsets++;
+        }
+    }
+
+    float expected_onsets = BEAT_TEST_SECONDS * bpm / 60.0f;
+    float error = fabsf(beat.bpm - bpm) / bpm;
+    int ret = error <= BEAT_TEST_TOLERANCE && onsets >= expected_onsets * 0.8f && onsets <= expected_onsets * 1.1f ? 0 : -1;
+    printf("%i/%i every %i at %.0f BPM: measured %.1f BPM, %u onsets of %.0f %s\n", nbsamples, hop_size, period, bpm, beat.bpm,
+        onsets, expected_onsets, ret ? "FAILED" : "ok");
+
+    free(frame);
+    neon_fft_free(cfg);
+    return ret;
+}
+
+int main()
+{
+    // Around and above the 120 BPM prior, where the period is most easily confused with twice the period
+    static const float tempos[] = { 70.0f, 80.0f, 90.0f, 100.0f, 120.0f, 128.0f, 140.0f, 160.0f, 174.0f };
+
+    // FFT size, hop size and samples between two wake ups: frames larger than the FFT,
+    // two frames per wake up, and an FFT larger than the frames
+    static const int setups[][3] = { { 512, 512, 735 }, { 1024, 256, 1470 }, { 2048, 512, 735 } };
+    int failures = 0;
+
+    for (int s = 0; s < (int)(sizeof(setups) / sizeof(setups[0])); s++) {
+        for (int t = 0; t < (int)(sizeof(tempos) / sizeof(tempos[0])); t++) {
+            failures += check_tempo(setups[s][0], setups[s][1], setups[s][2], tempos[t]) ? 1 : 0;
+        }
+    }
+
+    printf("%i failures\n", failures);
+    return failures ? 1 : 0;
+}
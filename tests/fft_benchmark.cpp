@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "fft_backend.hpp"
+#include "neon_fft.hpp"
+
+#define FFT_BENCHMARK_TIME 0.1 // seconds per backend and size
+#define FFT_BENCHMARK_SIZE 2048 // analyser defaults for the full analysis
+#define FFT_BENCHMARK_HOP 512
+#define FFT_BENCHMARK_SAMPLERATE 44100
+
+static const fft_backend *backends[] = {
+    &fft_backend_scalar,
+#ifdef WEBRADIO_HAVE_NE10
+    &fft_backend_ne10,
+#endif
+};
+
+#define BACKEND_COUNT (int)(sizeof(backends) / sizeof(backends[0]))
+
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Time per analysis of a hop of stereo noise, as the analyser thread runs it:
+ * history update, window, FFT, band power and dB conversion, once in mono mode
+ * and twice in stereo and mid-side modes
+ *
+ * @return microseconds per analysis, negative on error
+ */
+static double time_analysis(const fft_backend *backend, int bar_count, neon_fft_mode mode)
+{
+    neon_fft_config *cfg = neon_fft_init(FFT_BENCHMARK_SIZE, FFT_BENCHMARK_HOP, FFT_BENCHMARK_SAMPLERATE, 2, bar_count, backend);
+    int16_t *pcm = (int16_t*)malloc(sizeof(int16_t) * FFT_BENCHMARK_HOP * 2);
+    if (!cfg || !pcm) {
+        neon_fft_free(cfg);
+        free(pcm);
+        return -1.0;
+    }
+
+    for (int i = 0; i < FFT_BENCHMARK_HOP * 2; i++) {
+        pcm[i] = (int16_t)(rand() % 20000 - 10000);
+    }
+    cfg->mode = mode;
+
+    int runs = 0;
+    double start = now(), elapsed;
+    do {
+        neon_fft_fill_buffer(cfg, pcm, FFT_BENCHMARK_HOP);
+        if (spectrum_analyser(cfg) == 0) {
+            runs++;
+        }
+        elapsed = now() - start;
+    } while (elapsed < FFT_BENCHMARK_TIME);
+
+    neon_fft_free(cfg);
+    free(pcm);
+    return runs ? elapsed * 1e6 / runs : -1.0;
+}
+
+/**
+ * Time per forward transform of each backend and FFT size, then per full analysis
+ * by bar count and by analysis mode
+ */
+int main()
+{
+    printf("%-8s %6s %12s\n", "backend", "size", "us/fft");
+
+    for (int b = 0; b < BACKEND_COUNT; b++) {
+        const fft_backend *backend = backends[b];
+        for (int nbsamples = NEON_FFT_MIN_SIZE; nbsamples <= NEON_FFT_MAX_SIZE; nbsamples *= 2) {
+            float *samples = (float*)malloc(sizeof(float) * nbsamples);
+            float *in = (float*)malloc(sizeof(float) * nbsamples);
+            fft_complex *out = (fft_complex*)malloc(sizeof(fft_complex) * (nbsamples / 2 + 1));
+            void *plan = backend->create(nbsamples);
+            if (!samples || !in || !out || !plan) {
+                printf("%s %i: setup failed\n", backend->name, nbsamples);
+                return 1;
+            }
+
+            for (int i = 0; i < nbsamples; i++) {
+                samples[i] = (float)rand() / RAND_MAX - 0.5f;
+            }
+
+            // The input is scratch for some backends, it is copied back each run like the analyser does
+            int runs = 0;
+            double start = now(), elapsed;
+            do {
+                for (int i = 0; i < nbsamples; i++) {
+                    in[i] = samples[i];
+                }
+                backend->forward(plan, out, in);
+                runs++;
+                elapsed = now() - start;
+            } while (elapsed < FFT_BENCHMARK_TIME);
+
+            printf("%-8s %6i %12.2f\n", backend->name, nbsamples, elapsed * 1e6 / runs);
+
+            backend->destroy(plan);
+            free(samples);
+            free(in);
+            free(out);
+        }
+    }
+
+    printf("\n%-8s %6s %12s (%i/%i stereo)\n", "backend", "bars", "us/analysis", FFT_BENCHMARK_SIZE, FFT_BENCHMARK_HOP);
+
+    for (int b = 0; b < BACKEND_COUNT; b++) {
+        for (int bar_count = 16; bar_count <= 256; bar_count *= 2) {
+            double us = time_analysis(backends[b], bar_count, NEON_FFT_MODE_MONO);
+            if (us < 0.0) {
+                printf("%s %i bars: setup failed\n", backends[b]->name, bar_count);
+                return 1;
+            }
+            printf("%-8s %6i %12.2f\n", backends[b]->name, bar_count, us);
+        }
+    }
+
+    static const neon_fft_mode modes[] = { NEON_FFT_MODE_MONO, NEON_FFT_MODE_STEREO, NEON_FFT_MODE_MID_SIDE };
+    static const char *mode_names[] = { "mono", "stereo", "mid-side" };
+    printf("\n%-8s %9s %12s %8s (%i/%i stereo, 16 bars)\n", "backend", "mode", "us/analysis", "vs mono", FFT_BENCHMARK_SIZE, FFT_BENCHMARK_HOP);
+
+    for (int b = 0; b < BACKEND_COUNT; b++) {
+        double mono = 0.0;
+        for (int m = 0; m < (int)(sizeof(modes) / sizeof(modes[0])); m++) {
+            double us = time_analysis(backends[b], 16, modes[m]);
+            if (us < 0.0) {
+                printf("%s %s: setup failed\n", backends[b]->name, mode_names[m]);
+                return 1;
+            }
+            if (modes[m] == NEON_FFT_MODE_MONO) {
+                mono = us;
+            }
+            printf("%-8s %9s %12.2f %7.2fx\n", backends[b]->name, mode_names[m], us, us / mono);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "fft_backend.hpp"
+#include "neon_fft.hpp"
+
+#ifndef M_PI
+#define M_PI		3.14159265358979323846
+#endif
+
+#define FFT_TEST_TOLERANCE 1e-4 // of the largest magnitude, float against double
+
+static const fft_backend *backends[] = {
+    &fft_backend_scalar,
+#ifdef WEBRADIO_HAVE_NE10
+    &fft_backend_ne10,
+#endif
+};
+
+#define BACKEND_COUNT (int)(sizeof(backends) / sizeof(backends[0]))
+
+// Two tones on a bin, one between bins, and a DC offset
+static void make_tones(float *samples, int nbsamples)
+{
+    for (int i = 0; i < nbsamples; i++) {
+        samples[i] = 0.1f
+            + 0.5f * sin(2 * M_PI * 7 * i / nbsamples)
+            + 0.25f * cos(2 * M_PI * (nbsamples / 8) * i / nbsamples)
+            + 0.125f * sin(2 * M_PI * 100.5 * i / nbsamples + 0.3);
+    }
+}
+
+// Direct O(n²) transform in double precision
+static void reference_dft(const float *samples, double *re, double *im, int nbsamples)
+{
+    for (int k = 0; k <= nbsamples / 2; k++) {
+        double sum_r = 0.0, sum_i = 0.0;
+        for (int n = 0; n < nbsamples; n++) {
+            // Exact angle modulo 2 pi, the product would lose precision
+            double angle = -2 * M_PI * (double)(((long long)k * n) % nbsamples) / nbsamples;
+            sum_r += samples[n] * cos(angle);
+            sum_i += samples[n] * sin(angle);
+        }
+        re[k] = sum_r;
+        im[k] = sum_i;
+    }
+}
+
+static int check_backend(const fft_backend *backend, int nbsamples)
+{
+    int nbins = nbsamples / 2 + 1;
+    float *samples = (float*)malloc(sizeof(float) * nbsamples);
+    float *in = (float*)malloc(sizeof(float) * nbsamples);
+    fft_complex *out = (fft_complex*)malloc(sizeof(fft_complex) * nbins);
+    double *re = (double*)malloc(sizeof(double) * nbins);
+    double *im = (double*)malloc(sizeof(double) * nbins);
+    void *plan = backend->create(nbsamples);
+
+    if (!samples || !in || !out || !re || !im || !plan) {
+        printf("%s %i: setup failed\n", backend->name, nbsamples);
+        return -1;
+    }
+
+    make_tones(samples, nbsamples);
+    for (int i = 0; i < nbsamples; i++) {
+        in[i] = samples[i];
+    }
+
+    backend->forward(plan, out, in);
+    reference_dft(samples, re, im, nbsamples);
+
+    double largest = 0.0, error = 0.0;
+    int worst = 0;
+    for (int k = 0; k < nbins; k++) {
+        double magnitude = sqrt(re[k] * re[k] + im[k] * im[k]);
+        double difference = hypot(out[k].r - re[k], out[k].i - im[k]);
+        if (magnitude > largest) {
+            largest = magnitude;
+        }
+        if (difference > error) {
+            error = difference;
+            worst = k;
+        }
+    }
+
+    int ret = error <= FFT_TEST_TOLERANCE * largest ? 0 : -1;
+    printf("%s %i: max error %.3g of %.3g at bin %i %s\n", backend->name, nbsamples, error, largest, worst,
+        ret ? "FAILED" : "ok");
+
+    backend->destroy(plan);
+    free(samples);
+    free(in);
+    free(out);
+    free(re);
+    free(im);
+    return ret;
+}
+
+// A tone through the whole analyser must light the bar of its bin
+static int check_analyser(const fft_backend *backend, int nbsamples)
+{
+    int samplerate = 44100, bar_count = 32;
+    neon_fft_config *cfg = neon_fft_init(nbsamples, nbsamples, samplerate, 1, bar_count, backend);
+    int16_t *pcm = (int16_t*)malloc(sizeof(int16_t) * nbsamples);
+    if (!cfg || !pcm) {
+        printf("%s %i analyser: setup failed\n", backend->name, nbsamples);
+        return -1;
+    }
+
+    int ret = 0;
+    for (int b = 0; b < bar_count; b++) {
+        // Tone in the middle of the bar, away from its neighbours
+        int bin = (cfg->band_start[b] + cfg->band_end[b]) / 2;
+        if (cfg->band_end[b] - cfg->band_start[b] < 3) {
+            continue;
+        }
+
+        for (int i = 0; i < nbsamples; i++) {
+            pcm[i] = (int16_t)(16000 * sin(2 * M_PI * bin * i / nbsamples));
+        }
+
+        neon_fft_fill_buffer(cfg, pcm, nbsamples);
+        if (spectrum_analyser(cfg)) {
+            printf("%s %i analyser: no analysis after a full buffer\n", backend->name, nbsamples);
+            ret = -1;
+            break;
+        }
+
+        int loudest = 0;
+        for (int i = 1; i < bar_count; i++) {
+            if (cfg->visualizer_data[i] > cfg->visualizer_data[loudest]) {
+                loudest = i;
+            }
+        }
+
+        if (loudest != b) {
+            printf("%s %i analyser: tone at bin %i lit bar %i instead of %i\n", backend->name, nbsamples, bin, loudest, b);
+            ret = -1;
+        }
+    }
+
+    if (!ret) {
+        printf("%s %i analyser: ok\n", backend->name, nbsamples);
+    }
+
+    free(pcm);
+    neon_fft_free(cfg);
+    return ret;
+}
+
+int main()
+{
+    int failures = 0;
+    for (int b = 0; b < BACKEND_COUNT; b++) {
+        for (int nbsamples = NEON_FFT_MIN_SIZE; nbsamples <= NEON_FFT_MAX_SIZE; nbsamples *= 2) {
+            failures += check_backend(backends[b], nbsamples) ? 1 : 0;
+            failures += check_analyser(backends[b], nbsamples) ? 1 : 0;
+        }
+    }
+
+    printf("%i failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "geometry.hpp"
+
+#define GEOMETRY_TEST_GUARD 64 // vertices and indices past the reservation that must stay untouched
+#define GEOMETRY_TEST_BASE 1000 // vertices already in the draw list before the visualizer
+
+static const int bar_counts[] = { 16, 32, 64, 128, 256 };
+
+enum geometry_test_view {
+    GEOMETRY_TEST_BARS,
+    GEOMETRY_TEST_MIRRORED,
+    GEOMETRY_TEST_RINGS,
+};
+
+static const char *view_names[] = { "bars", "mirrored", "rings" };
+
+/**
+ * Reservation sizes, as the visualizer window asks them from the draw list
+ */
+static void reserved_counts(geometry_test_view view, int bar_count, bool peaks, int *vertices, int *indices)
+{
+    int bar_sets = peaks ? 2 : 1;
+
+    switch (view) {
+    case GEOMETRY_TEST_BARS:
+        *vertices = bar_sets * bar_count * GEOMETRY_BAR_VERTICES;
+        *indices = bar_sets * bar_count * GEOMETRY_BAR_INDICES;
+        break;
+    case GEOMETRY_TEST_MIRRORED:
+        *vertices = 2 * bar_sets * bar_count * GEOMETRY_BAR_VERTICES;
+        *indices = 2 * bar_sets * bar_count * GEOMETRY_BAR_INDICES;
+        break;
+    default:
+        *vertices = bar_count / 2 * GEOMETRY_RING_VERTICES;
+        *indices = bar_count / 2 * GEOMETRY_RING_INDICES;
+        break;
+    }
+}
+
+/**
+ * Same build calls as the visualizer window
+ */
+static void build(geometry_test_view view, geometry_target target, const float *levels, int bar_count, bool peaks)
+{
+    geometry_bars_style style;
+    style.bottom = 540.0f;
+    style.height = 500.0f;
+    style.fade_channel = 0;
+
+    switch (view) {
+    case GEOMETRY_TEST_BARS:
+        style.origin = 0.0f;
+        style.step = 960 / bar_count;
+        geometry_build_bars(&target, levels, bar_count, &style);
+        if (peaks) {
+            geometry_advance(&target, bar_count * GEOMETRY_BAR_VERTICES, bar_count * GEOMETRY_BAR_INDICES);
+            geometry_build_peaks(&target, levels, bar_count, &style);
+        }
+        break;
+    case GEOMETRY_TEST_MIRRORED:
+        for (int side = 0; side < 2; side++) {
+            style.origin = 480.0f;
+            style.step = (side ? 480.0f : -480.0f) / bar_count;
+            style.fade_channel = side ? 2 : 0;
+            geometry_build_bars(&target, levels, bar_count, &style);
+            geometry_advance(&target, bar_count * GEOMETRY_BAR_VERTICES, bar_count * GEOMETRY_BAR_INDICES);
+
+            if (peaks) {
+                geometry_build_peaks(&target, levels, bar_count, &style);
+                geometry_advance(&target, bar_count * GEOMETRY_BAR_VERTICES, bar_count * GEOMETRY_BAR_INDICES);
+            }
+        }
+        break;
+    default:
+        geometry_build_rings(&target, levels, bar_count, 960.0f / 2.0f, 544.0f / 2.0f, 260.0f, 4.0f);
+        break;
+    }
+}
+
+/**
+ * Every reserved vertex and index is written, nothing past the reservation,
+ * and the indices only point to the vertices built
+ */
+static int check_counts(geometry_test_view view, int bar_count, bool peaks)
+{
+    int vertex_count, index_count;
+    reserved_counts(view, bar_count, peaks, &vertex_count, &index_count);
+
+    // Empty, partial, full and clipped bands
+    std::vector<float> levels(bar_count);
+    for (int i = 0; i < bar_count; i++) {
+        levels[i] = (i % 5) * 0.3f - 0.1f;
+    }
+
+    geometry_vertex unset;
+    memset(&unset, 0xA5, sizeof(unset));
+    std::vector<geometry_vertex> vertices(vertex_count + GEOMETRY_TEST_GUARD, unset);
+    std::vector<uint16_t> indices(index_count + GEOMETRY_TEST_GUARD, 0xA5A5);
+
+    geometry_target target;
+    target.vertices = vertices.data();
+    target.indices = indices.data();
+    target.base_index = GEOMETRY_TEST_BASE;
+    target.u = 0.5f;
+    target.v = 0.5f;
+    build(view, target, levels.data(), bar_count, peaks);
+
+    int written_vertices = 0;
+    int guard_vertices = 0;
+    for (int i = 0; i < (int)vertices.size(); i++) {
+        bool written = memcmp(&vertices[i], &unset, sizeof(unset)) != 0;
+        if (i < vertex_count) {
+            written_vertices += written;
+        } else {
+            guard_vertices += written;
+        }
+    }
+
+    int bad_indices = 0;
+    int guard_indices = 0;
+    for (int i = 0; i < (int)indices.size(); i++) {
+        if (i >= index_count) {
+            guard_indices += indices[i] != 0xA5A5;
+        } else if (indices[i] < GEOMETRY_TEST_BASE || indices[i] >= GEOMETRY_TEST_BASE + vertex_count) {
+            bad_indices++;
+        }
+    }
+
+    int ret = written_vertices != vertex_count || guard_vertices || guard_indices || bad_indices || index_count % 3 ? 1 : 0;
+    printf("%-8s %3i bars%s: %i/%i vertices, %i indices, %i out of range, %i past the end %s\n", view_names[view], bar_count,
+        peaks ? " + peaks" : "", written_vertices, vertex_count, index_count, bad_indices, guard_vertices + guard_indices,
+        ret ? "FAILED" : "ok");
+    return ret;
+}
+
+int main()
+{
+    int failures = 0;
+
+    for (int b = 0; b < (int)(sizeof(bar_counts) / sizeof(bar_counts[0])); b++) {
+        for (int peaks = 0; peaks < 2; peaks++) {
+            failures += check_counts(GEOMETRY_TEST_BARS, bar_counts[b], peaks);
+            failures += check_counts(GEOMETRY_TEST_MIRRORED, bar_counts[b], peaks);
+        }
+        failures += check_counts(GEOMETRY_TEST_RINGS, bar_counts[b], false);
+    }
+
+    printf("%i failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,40 @@
+#ifndef __HOST_PSP2_AUDIOOUT_H__
+#define __HOST_PSP2_AUDIOOUT_H__
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCE_AUDIO_VOLUME_0DB 32768
+
+typedef enum SceAudioOutChannelFlag {
+    SCE_AUDIO_VOLUME_FLAG_L_CH = 0x1,
+    SCE_AUDIO_VOLUME_FLAG_R_CH = 0x2,
+} SceAudioOutChannelFlag;
+
+typedef enum SceAudioOutMode {
+    SCE_AUDIO_OUT_MODE_MONO = 0,
+    SCE_AUDIO_OUT_MODE_STEREO = 1,
+} SceAudioOutMode;
+
+typedef enum SceAudioOutPortType {
+    SCE_AUDIO_OUT_PORT_TYPE_MAIN = 0,
+    SCE_AUDIO_OUT_PORT_TYPE_BGM = 1,
+    SCE_AUDIO_OUT_PORT_TYPE_VOICE = 2,
+} SceAudioOutPortType;
+
+// There is no audio output on the host, every call fails
+int sceAudioOutOpenPort(SceAudioOutPortType type, int len, int freq, SceAudioOutMode mode);
+int sceAudioOutReleasePort(int port);
+int sceAudioOutOutput(int port, const void *buf);
+int sceAudioOutSetVolume(int port, SceAudioOutChannelFlag flag, int *vol);
+int sceAudioOutSetConfig(int port, SceSize len, int freq, SceAudioOutMode mode);
+int sceAudioOutGetRestSample(int port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef __HOST_PSP2_IO_FCNTL_H__
+#define __HOST_PSP2_IO_FCNTL_H__
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCE_O_RDONLY 0x0001
+#define SCE_O_WRONLY 0x0002
+#define SCE_O_RDWR 0x0003
+#define SCE_O_APPEND 0x0100
+#define SCE_O_CREAT 0x0200
+#define SCE_O_TRUNC 0x0400
+
+SceUID sceIoOpen(const char *file, int flags, SceMode mode);
+int sceIoClose(SceUID fd);
+int sceIoRead(SceUID fd, void *data, SceSize size);
+int sceIoWrite(SceUID fd, const void *data, SceSize size);
+int sceIoRemove(const char *file);
+int sceIoRename(const char *oldname, const char *newname);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
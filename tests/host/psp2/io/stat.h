@@ -0,0 +1,37 @@
+#ifndef __HOST_PSP2_IO_STAT_H__
+#define __HOST_PSP2_IO_STAT_H__
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SceDateTime {
+    unsigned short year;
+    unsigned short month;
+    unsigned short day;
+    unsigned short hour;
+    unsigned short minute;
+    unsigned short second;
+    unsigned int microsecond;
+} SceDateTime;
+
+typedef struct SceIoStat {
+    SceMode st_mode;
+    unsigned int st_attr;
+    SceOff st_size;
+    SceDateTime st_ctime;
+    SceDateTime st_atime;
+    SceDateTime st_mtime;
+    unsigned int st_private[6];
+} SceIoStat;
+
+int sceIoMkdir(const char *dir, SceMode mode);
+int sceIoGetstat(const char *file, SceIoStat *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef __HOST_PSP2_KERNEL_CLIB_H__
+#define __HOST_PSP2_KERNEL_CLIB_H__
+
+// Host stand-in for the SceLibKernel calls of the tested sources
+#include <stdio.h>
+
+#define sceClibPrintf printf
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef __HOST_PSP2_KERNEL_PROCESSMGR_H__
+#define __HOST_PSP2_KERNEL_PROCESSMGR_H__
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCE_KERNEL_POWER_TICK_DISABLE_AUTO_SUSPEND 1
+#define SCE_KERNEL_POWER_TICK_DISABLE_OLED_OFF 4
+
+SceUInt64 sceKernelGetProcessTimeWide(void);
+int sceKernelPowerTick(int type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef __HOST_PSP2_KERNEL_THREADMGR_H__
+#define __HOST_PSP2_KERNEL_THREADMGR_H__
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int (*SceKernelThreadEntry)(SceSize args, void *argp);
+
+// Threads and mutexes are pthreads, priorities and affinities are ignored
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority, int stackSize, SceUInt attr,
+    int cpuAffinityMask, const void *option);
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp);
+int sceKernelWaitThreadEnd(SceUID thid, int *stat, SceUInt *timeout);
+int sceKernelDeleteThread(SceUID thid);
+int sceKernelDelayThread(SceUInt delay);
+SceUID sceKernelGetThreadId(void);
+
+SceUID sceKernelCreateMutex(const char *name, SceUInt attr, int initCount, void *option);
+int sceKernelLockMutex(SceUID mutexid, int lockCount, unsigned int *timeout);
+int sceKernelUnlockMutex(SceUID mutexid, int unlockCount);
+int sceKernelDeleteMutex(SceUID mutexid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
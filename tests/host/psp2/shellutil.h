@@ -0,0 +1,20 @@
+#ifndef __HOST_PSP2_SHELLUTIL_H__
+#define __HOST_PSP2_SHELLUTIL_H__
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCE_SHELL_UTIL_LOCK_TYPE_PS_BTN 0x1
+
+// No system buttons nor power saving on the host, the calls do nothing
+int sceShellUtilLock(int type);
+int sceShellUtilUnlock(int type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef __HOST_PSP2_TYPES_H__
+#define __HOST_PSP2_TYPES_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int SceUID;
+typedef unsigned int SceSize;
+typedef unsigned int SceUInt;
+typedef int SceBool;
+typedef int32_t SceInt32;
+typedef uint32_t SceUInt32;
+typedef int64_t SceInt64;
+typedef uint64_t SceUInt64;
+typedef int64_t SceOff;
+typedef int SceMode;
+
+#endif
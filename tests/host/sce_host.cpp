@@ -0,0 +1,334 @@
+// POSIX versions of the Vita system calls used by the tested sources
+//
+// Vita devices are directories of the current directory: ux0:/data is ./ux0/data.
+
+#include "sce_host.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// glibc names the timespec members of struct stat like the SceIoStat dates
+#undef st_atime
+#undef st_ctime
+#undef st_mtime
+
+#include <psp2/audioout.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/io/stat.h>
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/shellutil.h>
+
+// SCE_ERROR_ERRNO_*: the errno in the low bits of a negative code
+#define SCE_HOST_ERROR(err) ((int)(0x80010000 | (err)))
+#define SCE_HOST_THREADS 32
+#define SCE_HOST_MUTEXES 64
+
+unsigned int sce_host_write_delay = 0;
+
+struct sce_host_thread {
+    bool used;
+    bool started;
+    pthread_t thread;
+    SceKernelThreadEntry entry;
+    SceSize arglen;
+    void *argp; // copy of the arguments, like the Vita kernel does
+    int status;
+};
+
+static pthread_mutex_t sce_host_lock = PTHREAD_MUTEX_INITIALIZER;
+static sce_host_thread threads[SCE_HOST_THREADS];
+static pthread_mutex_t mutexes[SCE_HOST_MUTEXES];
+static bool mutex_used[SCE_HOST_MUTEXES];
+static __thread SceUID current_thread = 0;
+
+static const char *sce_host_path(const char *file, char *path, size_t size)
+{
+    if (!strncmp(file, "ux0:", 4)) {
+        snprintf(path, size, "ux0%s", file + 4);
+        return path;
+    }
+
+    return file;
+}
+
+SceUInt64 sceKernelGetProcessTimeWide(void)
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (SceUInt64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int sceKernelPowerTick(int type)
+{
+    return 0;
+}
+
+SceUID sceIoOpen(const char *file, int flags, SceMode mode)
+{
+    int host_flags = (flags & SCE_O_RDWR) == SCE_O_RDWR ? O_RDWR : flags & SCE_O_WRONLY ? O_WRONLY : O_RDONLY;
+    host_flags |= flags & SCE_O_APPEND ? O_APPEND : 0;
+    host_flags |= flags & SCE_O_CREAT ? O_CREAT : 0;
+    host_flags |= flags & SCE_O_TRUNC ? O_TRUNC : 0;
+
+    char path[512];
+    int fd = open(sce_host_path(file, path, sizeof(path)), host_flags, mode ? mode : 0644);
+    return fd < 0 ? SCE_HOST_ERROR(errno) : fd;
+}
+
+int sceIoClose(SceUID fd)
+{
+    return close(fd) ? SCE_HOST_ERROR(errno) : 0;
+}
+
+int sceIoRead(SceUID fd, void *data, SceSize size)
+{
+    ssize_t ret = read(fd, data, size);
+    return ret < 0 ? SCE_HOST_ERROR(errno) : (int)ret;
+}
+
+int sceIoWrite(SceUID fd, const void *data, SceSize size)
+{
+    if (sce_host_write_delay) {
+        usleep(sce_host_write_delay);
+    }
+
+    ssize_t ret = write(fd, data, size);
+    return ret < 0 ? SCE_HOST_ERROR(errno) : (int)ret;
+}
+
+int sceIoRemove(const char *file)
+{
+    char path[512];
+    return unlink(sce_host_path(file, path, sizeof(path))) ? SCE_HOST_ERROR(errno) : 0;
+}
+
+int sceIoRename(const char *oldname, const char *newname)
+{
+    char old_path[512];
+    char new_path[512];
+    return rename(sce_host_path(oldname, old_path, sizeof(old_path)), sce_host_path(newname, new_path, sizeof(new_path)))
+        ? SCE_HOST_ERROR(errno) : 0;
+}
+
+int sceIoMkdir(const char *dir, SceMode mode)
+{
+    char path[512];
+    return mkdir(sce_host_path(dir, path, sizeof(path)), 0755) ? SCE_HOST_ERROR(errno) : 0;
+}
+
+int sceIoGetstat(const char *file, SceIoStat *stat)
+{
+    char path[512];
+    struct stat st;
+    if (::stat(sce_host_path(file, path, sizeof(path)), &st)) {
+        return SCE_HOST_ERROR(errno);
+    }
+
+    // Only the size and the modification time are used
+    memset(stat, 0, sizeof(SceIoStat));
+    stat->st_size = st.st_size;
+    struct tm date;
+    gmtime_r(&st.st_mtim.tv_sec, &date);
+    stat->st_mtime.year = date.tm_year + 1900;
+    stat->st_mtime.month = date.tm_mon + 1;
+    stat->st_mtime.day = date.tm_mday;
+    stat->st_mtime.hour = date.tm_hour;
+    stat->st_mtime.minute = date.tm_min;
+    stat->st_mtime.second = date.tm_sec;
+    stat->st_mtime.microsecond = st.st_mtim.tv_nsec / 1000;
+    return 0;
+}
+
+int sceShellUtilLock(int type)
+{
+    return 0;
+}
+
+int sceShellUtilUnlock(int type)
+{
+    return 0;
+}
+
+int sceAudioOutOpenPort(SceAudioOutPortType type, int len, int freq, SceAudioOutMode mode)
+{
+    return SCE_HOST_ERROR(ENODEV);
+}
+
+int sceAudioOutReleasePort(int port)
+{
+    return SCE_HOST_ERROR(ENODEV);
+}
+
+int sceAudioOutOutput(int port, const void *buf)
+{
+    return SCE_HOST_ERROR(ENODEV);
+}
+
+int sceAudioOutSetVolume(int port, SceAudioOutChannelFlag flag, int *vol)
+{
+    return SCE_HOST_ERROR(ENODEV);
+}
+
+int sceAudioOutSetConfig(int port, SceSize len, int freq, SceAudioOutMode mode)
+{
+    return SCE_HOST_ERROR(ENODEV);
+}
+
+int sceAudioOutGetRestSample(int port)
+{
+    return SCE_HOST_ERROR(ENODEV);
+}
+
+static void *sce_host_thread_main(void *arg)
+{
+    sce_host_thread *thread = (sce_host_thread*)arg;
+    current_thread = (SceUID)(thread - threads) + 1;
+    thread->status = thread->entry(thread->arglen, thread->argp);
+    return NULL;
+}
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority, int stackSize, SceUInt attr,
+    int cpuAffinityMask, const void *option)
+{
+    pthread_mutex_lock(&sce_host_lock);
+    for (int i = 0; i < SCE_HOST_THREADS; i++) {
+        if (!threads[i].used) {
+            memset(&threads[i], 0, sizeof(sce_host_thread));
+            threads[i].used = true;
+            threads[i].entry = entry;
+            pthread_mutex_unlock(&sce_host_lock);
+            return i + 1;
+        }
+    }
+    pthread_mutex_unlock(&sce_host_lock);
+
+    return SCE_HOST_ERROR(EAGAIN);
+}
+
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp)
+{
+    if (thid < 1 || thid > SCE_HOST_THREADS || !threads[thid - 1].used || threads[thid - 1].started) {
+        return SCE_HOST_ERROR(ESRCH);
+    }
+
+    sce_host_thread *thread = &threads[thid - 1];
+    thread->arglen = arglen;
+    if (arglen) {
+        thread->argp = malloc(arglen);
+        memcpy(thread->argp, argp, arglen);
+    }
+
+    if (pthread_create(&thread->thread, NULL, sce_host_thread_main, thread)) {
+        free(thread->argp);
+        thread->argp = NULL;
+        return SCE_HOST_ERROR(EAGAIN);
+    }
+
+    thread->started = true;
+    return 0;
+}
+
+int sceKernelWaitThreadEnd(SceUID thid, int *stat, SceUInt *timeout)
+{
+    if (thid < 1 || thid > SCE_HOST_THREADS || !threads[thid - 1].started) {
+        return SCE_HOST_ERROR(ESRCH);
+    }
+
+    // The timeout is ignored, a thread which does not end hangs the test instead
+    sce_host_thread *thread = &threads[thid - 1];
+    pthread_join(thread->thread, NULL);
+    thread->started = false;
+    if (stat) {
+        *stat = thread->status;
+    }
+
+    return 0;
+}
+
+int sceKernelDeleteThread(SceUID thid)
+{
+    if (thid < 1 || thid > SCE_HOST_THREADS || !threads[thid - 1].used) {
+        return SCE_HOST_ERROR(ESRCH);
+    }
+
+    sce_host_thread *thread = &threads[thid - 1];
+    if (thread->started) {
+        pthread_detach(thread->thread);
+    }
+    free(thread->argp);
+
+    pthread_mutex_lock(&sce_host_lock);
+    thread->used = false;
+    pthread_mutex_unlock(&sce_host_lock);
+    return 0;
+}
+
+int sceKernelDelayThread(SceUInt delay)
+{
+    usleep(delay);
+    return 0;
+}
+
+SceUID sceKernelGetThreadId(void)
+{
+    // The main thread has no slot, it gets an id past them
+    return current_thread ? current_thread : SCE_HOST_THREADS + 1;
+}
+
+SceUID sceKernelCreateMutex(const char *name, SceUInt attr, int initCount, void *option)
+{
+    pthread_mutex_lock(&sce_host_lock);
+    for (int i = 0; i < SCE_HOST_MUTEXES; i++) {
+        if (!mutex_used[i]) {
+            mutex_used[i] = true;
+            pthread_mutex_init(&mutexes[i], NULL);
+            if (initCount > 0) {
+                pthread_mutex_lock(&mutexes[i]);
+            }
+            pthread_mutex_unlock(&sce_host_lock);
+            return i + 1;
+        }
+    }
+    pthread_mutex_unlock(&sce_host_lock);
+
+    return SCE_HOST_ERROR(EAGAIN);
+}
+
+int sceKernelLockMutex(SceUID mutexid, int lockCount, unsigned int *timeout)
+{
+    if (mutexid < 1 || mutexid > SCE_HOST_MUTEXES || !mutex_used[mutexid - 1]) {
+        return SCE_HOST_ERROR(EINVAL);
+    }
+
+    return pthread_mutex_lock(&mutexes[mutexid - 1]) ? SCE_HOST_ERROR(EINVAL) : 0;
+}
+
+int sceKernelUnlockMutex(SceUID mutexid, int unlockCount)
+{
+    if (mutexid < 1 || mutexid > SCE_HOST_MUTEXES || !mutex_used[mutexid - 1]) {
+        return SCE_HOST_ERROR(EINVAL);
+    }
+
+    return pthread_mutex_unlock(&mutexes[mutexid - 1]) ? SCE_HOST_ERROR(EPERM) : 0;
+}
+
+int sceKernelDeleteMutex(SceUID mutexid)
+{
+    if (mutexid < 1 || mutexid > SCE_HOST_MUTEXES || !mutex_used[mutexid - 1]) {
+        return SCE_HOST_ERROR(EINVAL);
+    }
+
+    pthread_mutex_destroy(&mutexes[mutexid - 1]);
+    pthread_mutex_lock(&sce_host_lock);
+    mutex_used[mutexid - 1] = false;
+    pthread_mutex_unlock(&sce_host_lock);
+    return 0;
+}
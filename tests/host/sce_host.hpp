@@ -0,0 +1,8 @@
+#ifndef __SCE_HOST_HPP__
+#define __SCE_HOST_HPP__
+
+// Settings of the host versions of the Vita system calls, for the tests
+
+extern unsigned int sce_host_write_delay; // microseconds slept by each sceIoWrite, a slow memory card
+
+#endif
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string>
+
+#include "playlist/playlist.hpp"
+#include "playlist_samples.hpp"
+
+#define PLAYLIST_BENCHMARK_ENTRIES 100000
+#define PLAYLIST_BENCHMARK_RUNS 5
+#define PLAYLIST_BENCHMARK_FILE "playlist_benchmark.m3u"
+
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Load a generated playlist from a file like at startup, and write it back
+ */
+int main()
+{
+    std::string data;
+    playlist_sample_find("M3U")->generate(data, PLAYLIST_BENCHMARK_ENTRIES, false);
+
+    FILE *file = fopen(PLAYLIST_BENCHMARK_FILE, "wb");
+    if (!file || fwrite(data.data(), 1, data.size(), file) != data.size() || fclose(file)) {
+        printf("cannot write %s\n", PLAYLIST_BENCHMARK_FILE);
+        return 1;
+    }
+
+    playlist list;
+    playlist_init(&list);
+
+    double best = 0.0;
+    for (int run = 0; run < PLAYLIST_BENCHMARK_RUNS; run++) {
+        double start = now();
+        if (playlist_load_m3u(&list, PLAYLIST_BENCHMARK_FILE) || list.count != PLAYLIST_BENCHMARK_ENTRIES) {
+            printf("loaded %i stations of %i FAILED\n", list.count, PLAYLIST_BENCHMARK_ENTRIES);
+            return 1;
+        }
+
+        double elapsed = now() - start;
+        if (!run || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    double start = now();
+    size_t size = 0;
+    char *text = playlist_format_m3u(&list, &size);
+    double format = now() - start;
+    if (!text) {
+        printf("formatting FAILED\n");
+        return 1;
+    }
+
+    size_t memory = playlist_memory_used(&list);
+    printf("%i stations, %zu KB of m3u\n", list.count, data.size() / 1024);
+    printf("load:   %8.1f ms %8.1f MB/s %10.0f stations/s\n", best * 1e3, data.size() / best / (1024 * 1024), list.count / best);
+    printf("memory: %8zu KB %8.1f bytes/station\n", memory / 1024, (double)memory / list.count);
+    printf("format: %8.1f ms %8zu KB\n", format * 1e3, size / 1024);
+
+    free(text);
+    playlist_free(&list);
+    remove(PLAYLIST_BENCHMARK_FILE);
+    return 0;
+}
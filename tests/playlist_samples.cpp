@@ -0,0 +1,263 @@
+#include "playlist_samples.hpp"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+extern "C" {
+    #include "pls_parser/pls_tokenizer.h"
+    #include "radio_browser_parser/radio_browser_tokenizer.h"
+    #include "xspf_parser/xspf_tokenizer.h"
+}
+
+#define PLAYLIST_SAMPLE_LONG_EVERY 50 // one URL in this many is longer than a read chunk
+#define PLAYLIST_SAMPLE_LONG_LENGTH 70000
+#define PLAYLIST_SAMPLE_PLS_BLOCK 8 // PLS entries written in the same layout, less than the reorder window
+
+static void append(std::string &out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void append(std::string &out, const char *format, ...)
+{
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    out += line;
+}
+
+static void append_url(std::string &out, int i, bool long_lines)
+{
+    append(out, "http://s%i.example.com:8000/stream%i.mp3", i % 97, i);
+    if (long_lines && i % PLAYLIST_SAMPLE_LONG_EVERY == 7) {
+        out += "?token=";
+        out.append(PLAYLIST_SAMPLE_LONG_LENGTH, 'a' + i % 26);
+    }
+}
+
+static void generate_m3u(std::string &out, int count, bool long_lines)
+{
+    out += "\xEF\xBB\xBF#EXTM3U x-tvg-url=\"http://epg.example.com/guide.xml\"\r\n#PLAYLIST:Generated & sample\r\n";
+
+    for (int i = 0; i < count; i++) {
+        switch (i % 5) {
+        case 0:
+            append(out, "#EXTINF:-1 tvg-id=\"id%i\" tvg-name=\"Name %i\" tvg-logo=\"http://img.example.com/%i.png\" group-title=\"Group %i\""
+                " radio-codec=\"MP3\" radio-bitrate=\"128\" radio-tags=\"jazz,news\",Radio %i Jazz & Blues\r\n", i, i, i, i % 7, i);
+            break;
+        case 1:
+            append(out, "#EXTINF:0,Caf\xC3\xA9 Soci\xC3\xA9t\xC3\xA9 %i\n#EXTGRP:News\n", i);
+            break;
+        case 2:
+            out += "#EXTVLCOPT:network-caching=1000\n";
+            break;
+        case 3:
+            append(out, "# comment\n\n#EXTINF:-1 tvg-name=\"\xE6\x97\xA5\xE6\x9C\xAC FM\" group-title=\"\",Artist, Title %i\n", i);
+            break;
+        default:
+            append(out, "#EXTINF:-1 tvg-logo=\"http://img.example.com/%i.png\",\xF0\x9F\x98\x80 Emoji %i\r\n", i, i);
+            break;
+        }
+
+        append_url(out, i, long_lines);
+        out += i % 2 ? "\r\n" : "\n";
+    }
+}
+
+// IPTV provider dump: every entry has tvg attributes, some more than the tokenizer keeps
+static void generate_iptv(std::string &out, int count, bool long_lines)
+{
+    static const char *groups[] = { "FR | General", "FR | News", "UK | Sports", "VOD | Movies 2023", "Radio | Music" };
+
+    out += "#EXTM3U url-tvg=\"http://epg.example.com/guide.xml.gz\" tvg-shift=\"0\"\n";
+
+    for (int i = 0; i < count; i++) {
+        const char *group = groups[i % 5];
+
+        if (i % 7 == 3) {
+            // Group given by #EXTGRP, the attribute is left empty
+            append(out, "#EXTGRP:%s\n", group);
+            group = "";
+        }
+
+        append(out, "#EXTINF:-1 tvg-id=\"ch%i.example\" tvg-name=\"Channel %i HD\" tvg-logo=\"http://logo.example.com/picons/%i.png\""
+            " tvg-country=\"FR\" tvg-language=\"French\" tvg-chno=\"%i\" catchup=\"default\" catchup-days=\"7\" group-title=\"%s\"",
+            i, i, i, i + 1, group);
+        if (i % 100 == 50) {
+            for (int a = 0; a < M3U_MAX_ATTRIBUTES; a++) {
+                append(out, " x-extra-%i=\"%i\"", a, a);
+            }
+        }
+        append(out, ",Channel %i HD\n", i);
+
+        if (i % 3 == 0) {
+            out += "#EXTVLCOPT:http-user-agent=Mozilla/5.0\n";
+        }
+        append(out, "http://provider.example.com:8080/live/user/pass/%i.ts", 10000 + i);
+        if (long_lines && i % PLAYLIST_SAMPLE_LONG_EVERY == 7) {
+            out += "?token=";
+            out.append(PLAYLIST_SAMPLE_LONG_LENGTH, 'a' + i % 26);
+        }
+        out += "\n";
+    }
+}
+
+static void append_pls_entry(std::string &out, int index, bool url, const char *newline, bool long_lines)
+{
+    if (url) {
+        append(out, "File%i=", index);
+        append_url(out, index, long_lines);
+        out += newline;
+    } else if (index % 10) {
+        // Every tenth entry has no title
+        append(out, "Title%i=Radio %i Caf\xC3\xA9 \t%s", index, index, newline);
+    }
+}
+
+static void generate_pls(std::string &out, int count, bool long_lines)
+{
+    append(out, "[playlist]\r\nNumberOfEntries=%i\r\n", count);
+
+    for (int block = 1; block <= count; block += PLAYLIST_SAMPLE_PLS_BLOCK) {
+        int last = block + PLAYLIST_SAMPLE_PLS_BLOCK - 1 < count ? block + PLAYLIST_SAMPLE_PLS_BLOCK - 1 : count;
+
+        switch (block / PLAYLIST_SAMPLE_PLS_BLOCK % 3) {
+        case 0:
+            // Grouped by entry
+            for (int i = block; i <= last; i++) {
+                append_pls_entry(out, i, true, "\r\n", long_lines);
+                append_pls_entry(out, i, false, "\r\n", long_lines);
+                append(out, "Length%i=-1\r\n", i);
+            }
+            break;
+        case 1:
+            // Titles first
+            for (int i = block; i <= last; i++) {
+                append_pls_entry(out, i, false, "\n", long_lines);
+            }
+            out += "; files\n";
+            for (int i = block; i <= last; i++) {
+                append_pls_entry(out, i, true, "\n", long_lines);
+            }
+            break;
+        default:
+            // Decreasing indexes
+            for (int i = last; i >= block; i--) {
+                append_pls_entry(out, i, false, "\n", long_lines);
+                append_pls_entry(out, i, true, "\n", long_lines);
+            }
+            break;
+        }
+    }
+
+    out += "Version=2\r\n";
+}
+
+static void generate_xspf(std::string &out, int count, bool long_lines)
+{
+    out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<!DOCTYPE playlist [ <!ENTITY x \"y\"> ]>\n"
+        "<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">\n  <title>Generated &amp; sample</title>\n"
+        "  <!-- a comment with <track> inside -->\n  <trackList>\n";
+
+    for (int i = 0; i < count; i++) {
+        out += "    <track>\n      <location>\n        ";
+        append_url(out, i, long_lines);
+        out += "\n      </location>\n      <location>http://second/</location>\n";
+
+        switch (i % 4) {
+        case 0:
+            append(out, "      <title>Radio %i Jazz &amp; Blues &lt;live&gt;</title>\n", i);
+            break;
+        case 1:
+            append(out, "      <title><![CDATA[Rock \"Live\" & <more> %i]]></title>\n", i);
+            break;
+        case 2:
+            append(out, "      <title>Caf&#233; Soci&#xE9;t&#xe9; &#128512; %i</title>\n", i);
+            break;
+        default:
+            append(out, "      <title>  \xE6\x97\xA5\xE6\x9C\xAC FM %i\t</title>\n", i);
+            break;
+        }
+
+        if (i % 3) {
+            append(out, "      <image>http://img.example.com/%i.png</image>\n", i);
+        }
+        out += "      <extension application=\"x\"><title>no</title><location>no</location></extension>\n"
+            "      <meta rel=\"x\" />\n    </track>\n";
+    }
+
+    out += "  </trackList>\n</playlist>\n";
+}
+
+static void generate_radio_browser(std::string &out, int count, bool long_lines)
+{
+    out += "[\n";
+
+    for (int i = 0; i < count; i++) {
+        // Escaped and raw UTF-8 names, surrogate pairs included
+        const char *name = i % 2 ? "Caf\xC3\xA9 \\\"Live\\\" \xF0\x9F\x98\x80" : "Caf\\u00e9 \\\"Live\\\" \\ud83d\\ude00 \\/ \\\\";
+
+        append(out, "{\"changeuuid\":\"x\",\"stationuuid\":\"y-%i\",\"name\":\"%s %i\",\"url\":\"", i, name, i);
+        append_url(out, i, long_lines);
+        out += i % 5 ? "\",\"url_resolved\":\"" : ".pls\",\"url_resolved\":\"";
+        if (i % 5 == 0 || i % 2) {
+            append_url(out, i, long_lines);
+        }
+        append(out, "\",\"homepage\":\"http://h/\",\"favicon\":\"%s%i\",\"tags\":\"jazz,news\",\"country\":\"C\\u00f4te d'Ivoire\","
+            "\"votes\":%i,\"codec\":\"%s\",\"bitrate\":%i,\"hls\":0,\"geo_lat\":48.85,\"geo_long\":-2.35e-1,\"has_extended_info\":false,"
+            "\"state\":null,\"extra\":{\"name\":\"nested\",\"url\":\"http://nested/\"},\"list\":[\"url\",{\"a\":[1,2]}]}%s\n",
+            i % 3 ? "http://img.example.com/" : "", i, i * 7, i % 2 ? "AAC+" : "MP3", i % 4 * 64, i + 1 < count ? "," : "");
+    }
+
+    out += "]\n";
+}
+
+template <typename T,
+    void (*init)(T*, const m3u_tokenizer_callbacks*, void*),
+    int (*feed)(T*, const char*, size_t),
+    int (*finish)(T*),
+    void (*release)(T*)>
+static int tokenize(const char *data, size_t size, size_t chunk, const m3u_tokenizer_callbacks *callbacks, void *user)
+{
+    T tokenizer;
+    init(&tokenizer, callbacks, user);
+
+    int ret = 0;
+    for (size_t offset = 0; offset < size && !ret; offset += chunk) {
+        ret = feed(&tokenizer, data + offset, size - offset < chunk ? size - offset : chunk);
+    }
+    if (!ret) {
+        ret = finish(&tokenizer);
+    }
+
+    int errors = tokenizer.errors;
+    release(&tokenizer);
+    return ret ? -1 : errors;
+}
+
+const playlist_sample_format playlist_sample_formats[] = {
+    { "M3U", generate_m3u,
+        tokenize<m3u_tokenizer, m3u_tokenizer_init, m3u_tokenizer_feed, m3u_tokenizer_finish, m3u_tokenizer_free> },
+    { "IPTV", generate_iptv,
+        tokenize<m3u_tokenizer, m3u_tokenizer_init, m3u_tokenizer_feed, m3u_tokenizer_finish, m3u_tokenizer_free> },
+    { "PLS", generate_pls,
+        tokenize<pls_tokenizer, pls_tokenizer_init, pls_tokenizer_feed, pls_tokenizer_finish, pls_tokenizer_free> },
+    { "XSPF", generate_xspf,
+        tokenize<xspf_tokenizer, xspf_tokenizer_init, xspf_tokenizer_feed, xspf_tokenizer_finish, xspf_tokenizer_free> },
+    { "JSON", generate_radio_browser,
+        tokenize<radio_browser_tokenizer, radio_browser_tokenizer_init, radio_browser_tokenizer_feed,
+            radio_browser_tokenizer_finish, radio_browser_tokenizer_free> },
+};
+
+const int playlist_sample_format_count = (int)(sizeof(playlist_sample_formats) / sizeof(playlist_sample_formats[0]));
+
+const playlist_sample_format *playlist_sample_find(const char *name)
+{
+    for (int i = 0; i < playlist_sample_format_count; i++) {
+        if (!strcmp(playlist_sample_formats[i].name, name)) {
+            return &playlist_sample_formats[i];
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,29 @@
+#ifndef __PLAYLIST_SAMPLES_HPP__
+#define __PLAYLIST_SAMPLES_HPP__
+
+#include <stddef.h>
+#include <string>
+
+extern "C" {
+    #include "m3u_parser/m3u_tokenizer.h"
+}
+
+/**
+ * Generated playlist of one import format, and the tokenizer reading it
+ *
+ * The playlists mix the layouts found in the wild: attributes, escapes, comments and
+ * entries out of order. With long_lines, a few URLs are longer than a read chunk.
+ */
+struct playlist_sample_format {
+    const char *name;
+    void (*generate)(std::string &out, int count, bool long_lines);
+    // Feed the data by chunks of the given size, return the malformed parts or -1 on error
+    int (*tokenize)(const char *data, size_t size, size_t chunk, const m3u_tokenizer_callbacks *callbacks, void *user);
+};
+
+extern const playlist_sample_format playlist_sample_formats[];
+extern const int playlist_sample_format_count;
+
+const playlist_sample_format *playlist_sample_find(const char *name);
+
+#endif
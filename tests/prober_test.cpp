@@ -0,0 +1,283 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "network/prober.hpp"
+
+extern "C" {
+    #include "audio/audio.h"
+}
+
+#define PROBER_TEST_SLOW_MS 400 // delay of the slow station before its headers
+#define PROBER_TEST_COPIES 16 // more stations than jobs, so jobs are reused
+#define PROBER_TEST_TIMEOUT 30 // seconds for the whole check
+
+static int server_port = 0;
+
+static void send_all(int fd, const void *data, size_t size)
+{
+    const char *p = (const char*)data;
+    while (size > 0) {
+        ssize_t sent = send(fd, p, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return;
+        }
+        p += sent;
+        size -= sent;
+    }
+}
+
+static void send_audio(int fd, const char *bitrate)
+{
+    char headers[256];
+    snprintf(headers, sizeof(headers), "HTTP/1.0 200 OK\r\nContent-Type: audio/mpeg\r\nicy-br: %s\r\n\r\n", bitrate);
+    send_all(fd, headers, strlen(headers));
+
+    // More than the prober wants, it hangs up before the end like on a live stream
+    char audio[1024];
+    memset(audio, 0x55, sizeof(audio));
+    for (int i = 0; i < PROBER_AUDIO_BYTES * 4 / (int)sizeof(audio); i++) {
+        send_all(fd, audio, sizeof(audio));
+    }
+}
+
+static void send_body(int fd, const char *status, const char *content_type, const char *body)
+{
+    char response[512];
+    snprintf(response, sizeof(response), "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n\r\n%s", status, content_type,
+        strlen(body), body);
+    send_all(fd, response, strlen(response));
+}
+
+/**
+ * One request: a station up, slow, replaced by a web page, missing, or behind a playlist wrapper
+ */
+static void *serve(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    char request[2048];
+    size_t length = 0;
+
+    while (length < sizeof(request) - 1) {
+        ssize_t received = recv(fd, request + length, sizeof(request) - 1 - length, 0);
+        if (received <= 0) {
+            break;
+        }
+        length += received;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n")) {
+            break;
+        }
+    }
+    request[length] = '\0';
+
+    char path[256] = "";
+    sscanf(request, "GET %255s", path);
+    char body[256];
+
+    if (!strncmp(path, "/up.mp3", 7)) {
+        send_audio(fd, "128");
+    } else if (!strcmp(path, "/slow.mp3")) {
+        usleep(PROBER_TEST_SLOW_MS * 1000);
+        send_audio(fd, "64,64");
+    } else if (!strcmp(path, "/gone")) {
+        send_body(fd, "200 OK", "text/html; charset=utf-8", "<html><body>This station is offline</body></html>");
+    } else if (!strcmp(path, "/wrapper.pls")) {
+        snprintf(body, sizeof(body), "[playlist]\nNumberOfEntries=1\nFile1=http://127.0.0.1:%i/up.mp3?wrapped\n", server_port);
+        send_body(fd, "200 OK", "audio/x-scpls", body);
+    } else if (!strcmp(path, "/dead.m3u")) {
+        snprintf(body, sizeof(body), "#EXTM3U\nhttp://127.0.0.1:%i/missing\n", server_port);
+        send_body(fd, "200 OK", "audio/x-mpegurl", body);
+    } else {
+        send_body(fd, "404 Not Found", "text/plain", "not found");
+    }
+
+    close(fd);
+    return NULL;
+}
+
+static void *server_thread(void *arg)
+{
+    int listener = (int)(intptr_t)arg;
+
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+
+        // The slow station must not hold the others
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serve, (void*)(intptr_t)fd)) {
+            close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+/**
+ * Loopback socket, on a free port
+ *
+ * @return the port, or -1 on error
+ */
+static int open_socket(int *fd)
+{
+    sockaddr_in address;
+    socklen_t address_size = sizeof(address);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    *fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (*fd < 0 || bind(*fd, (sockaddr*)&address, sizeof(address)) || getsockname(*fd, (sockaddr*)&address, &address_size)) {
+        return -1;
+    }
+
+    return ntohs(address.sin_port);
+}
+
+static int check_result(const char *url, uint8_t status, uint16_t bitrate, uint32_t min_first_byte_ms)
+{
+    prober_result result;
+    if (!prober_lookup(url, &result)) {
+        printf("%s: not checked FAILED\n", url);
+        return 1;
+    }
+
+    int ret = result.status != status || (status == PROBER_STATUS_UP && (result.bitrate != bitrate ||
+        result.first_byte_ms < min_first_byte_ms || result.audio_type != AUDIO_FORMAT_MP3)) ? 1 : 0;
+    printf("%s: %s, %u kbps, %u ms to connect, %u ms to first audio byte %s\n", url, result.status == PROBER_STATUS_UP ? "up" : "down",
+        result.bitrate, result.connect_ms, result.first_byte_ms, ret ? "FAILED" : "ok");
+    return ret;
+}
+
+/**
+ * Ranked stations: up ones by time to first byte, then unchecked ones, then down ones, in playlist order between equals
+ */
+static int check_rank(const playlist *list, bool hide_down)
+{
+    int *ranked = new int[list->count];
+    int kept = prober_rank(list, NULL, list->count, hide_down, true, ranked);
+
+    int failures = 0;
+    int expected = 0;
+    uint64_t previous = 0;
+    for (int i = 0; i < kept; i++) {
+        prober_result result;
+        uint64_t key = 0xFFFFFFFE;
+        if (prober_lookup(list->entries[ranked[i]].url, &result)) {
+            key = result.status == PROBER_STATUS_DOWN ? 0xFFFFFFFF : result.first_byte_ms;
+        }
+
+        if (key < previous || (hide_down && key == 0xFFFFFFFF)) {
+            printf("rank %i: %s out of order\n", i, list->entries[ranked[i]].url);
+            failures++;
+        }
+        previous = key;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        prober_result result;
+        expected += !hide_down || !prober_lookup(list->entries[i].url, &result) || result.status != PROBER_STATUS_DOWN;
+    }
+
+    int ret = failures || kept != expected ? 1 : 0;
+    printf("rank%s: %i of %i stations %s\n", hide_down ? " without the down ones" : "", kept, list->count, ret ? "FAILED" : "ok");
+    delete[] ranked;
+    return ret;
+}
+
+/**
+ * Check stations served on the loopback with the prober thread, as the station menu does
+ */
+int main()
+{
+    int listener;
+    server_port = open_socket(&listener);
+    if (server_port < 0 || listen(listener, 64)) {
+        printf("cannot listen on the loopback\n");
+        return 1;
+    }
+
+    // Nothing listens on this one, connections are refused
+    int closed;
+    int closed_port = open_socket(&closed);
+    close(closed);
+
+    pthread_t server;
+    pthread_create(&server, NULL, server_thread, (void*)(intptr_t)listener);
+
+    mkdir("ux0", 0755);
+    mkdir("ux0/data", 0755);
+    mkdir("ux0/data/webradio", 0755);
+    remove("ux0/data/webradio/probe.dat");
+
+    char up[128], slow[128], gone[128], wrapper[128], dead[128], missing[128], refused[128];
+    snprintf(up, sizeof(up), "http://127.0.0.1:%i/up.mp3", server_port);
+    snprintf(slow, sizeof(slow), "http://127.0.0.1:%i/slow.mp3", server_port);
+    snprintf(gone, sizeof(gone), "http://127.0.0.1:%i/gone", server_port);
+    snprintf(wrapper, sizeof(wrapper), "http://127.0.0.1:%i/wrapper.pls", server_port);
+    snprintf(dead, sizeof(dead), "http://127.0.0.1:%i/dead.m3u", server_port);
+    snprintf(missing, sizeof(missing), "http://127.0.0.1:%i/missing", server_port);
+    snprintf(refused, sizeof(refused), "http://127.0.0.1:%i/stream.mp3", closed_port);
+
+    playlist list;
+    playlist_init(&list);
+    const char *urls[] = { gone, slow, refused, up, wrapper, missing, dead };
+    for (int i = 0; i < (int)(sizeof(urls) / sizeof(urls[0])); i++) {
+        playlist_add(&list, urls[i], NULL, NULL, NULL);
+    }
+    for (int i = 0; i < PROBER_TEST_COPIES; i++) {
+        char url[128];
+        snprintf(url, sizeof(url), "http://127.0.0.1:%i/up.mp3?copy=%i", server_port, i);
+        playlist_add(&list, url, NULL, NULL, NULL);
+    }
+
+    if (prober_init() || prober_start(&list)) {
+        printf("prober start FAILED\n");
+        return 1;
+    }
+
+    for (int waited = 0; prober_is_running() && waited < PROBER_TEST_TIMEOUT * 10; waited++) {
+        usleep(100000);
+    }
+
+    int checked, total;
+    prober_progress(&checked, &total);
+    int failures = checked != list.count || total != list.count || prober_is_running() ? 1 : 0;
+    printf("%i of %i stations checked %s\n", checked, total, failures ? "FAILED" : "ok");
+
+    failures += check_result(up, PROBER_STATUS_UP, 128, 0);
+    failures += check_result(slow, PROBER_STATUS_UP, 64, PROBER_TEST_SLOW_MS);
+    failures += check_result(wrapper, PROBER_STATUS_UP, 128, 0);
+    failures += check_result(gone, PROBER_STATUS_DOWN, 0, 0);
+    failures += check_result(dead, PROBER_STATUS_DOWN, 0, 0);
+    failures += check_result(missing, PROBER_STATUS_DOWN, 0, 0);
+    failures += check_result(refused, PROBER_STATUS_DOWN, 0, 0);
+
+    // A station added after the check is unchecked, ranked between the up and the down ones
+    playlist_add(&list, "http://127.0.0.1:1/new.mp3", NULL, NULL, NULL);
+    failures += check_rank(&list, false);
+    failures += check_rank(&list, true);
+
+    // The results are saved when the check ends and loaded back at startup
+    prober_term();
+    prober_init();
+    failures += check_result(slow, PROBER_STATUS_UP, 64, PROBER_TEST_SLOW_MS);
+    prober_term();
+
+    playlist_free(&list);
+    shutdown(listener, SHUT_RDWR);
+    close(listener);
+    pthread_join(server, NULL);
+
+    printf("%i failures\n", failures);
+    return failures ? 1 : 0;
+}
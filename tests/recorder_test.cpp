@@ -0,0 +1,136 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "recorder/recorder.hpp"
+#include "sce_host.hpp"
+
+#define RECORDER_TEST_RATE (320000 / 8) // bytes per second of a 320 kbps stream
+#define RECORDER_TEST_SPEED 20 // the stream and the memory card run this much faster than real time
+#define RECORDER_TEST_CALLBACK 50000 // microseconds of stream per network callback
+#define RECORDER_TEST_HOST_DIRECTORY "ux0/data/webradio/recordings"
+
+static unsigned char stream_byte(size_t position)
+{
+    return (unsigned char)(position * 7 + position / 251);
+}
+
+/**
+ * Check then delete the recording ending with a suffix, it must hold the stream bytes from a position
+ *
+ * @return the size of the file, 0 if it is not found or differs
+ */
+static size_t check_file(const char *suffix, size_t start, bool compare)
+{
+    DIR *dir = opendir(RECORDER_TEST_HOST_DIRECTORY);
+    struct dirent *file;
+    while (dir && (file = readdir(dir))) {
+        size_t length = strlen(file->d_name);
+        if (length < strlen(suffix) || strcmp(file->d_name + length - strlen(suffix), suffix)) {
+            continue;
+        }
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", RECORDER_TEST_HOST_DIRECTORY, file->d_name);
+        closedir(dir);
+
+        FILE *f = fopen(path, "rb");
+        size_t size = 0;
+        int c;
+        while (f && (c = fgetc(f)) != EOF) {
+            if (compare && (unsigned char)c != stream_byte(start + size)) {
+                printf("%s: byte %zu differs\n", file->d_name, size);
+                compare = false;
+                start = (size_t)-1;
+            }
+            size++;
+        }
+
+        if (f) {
+            fclose(f);
+        }
+        remove(path);
+        return start == (size_t)-1 ? 0 : size;
+    }
+
+    if (dir) {
+        closedir(dir);
+    }
+    printf("no recording ending with \"%s\"\n", suffix);
+    return 0;
+}
+
+/**
+ * Feed a 320 kbps stream to the recorder, with a song change in the middle
+ *
+ * @param seconds of stream, more than RECORDER_RING_SIZE holds
+ * @param card_rate is the speed of the memory card in bytes per second
+ * @param dropped is set to the bytes the writer thread was too late for
+ * @return 0 if both files hold every byte which was not dropped
+ */
+static int record(int seconds, int card_rate, unsigned int *dropped)
+{
+    sce_host_write_delay = (unsigned long long)RECORDER_WRITE_SIZE * 1000000 / card_rate / RECORDER_TEST_SPEED;
+
+    if (recorder_init() || recorder_start("Test station", "First song", ".mp3")) {
+        printf("recorder setup FAILED\n");
+        return -1;
+    }
+
+    static unsigned char chunk[RECORDER_TEST_RATE * RECORDER_TEST_CALLBACK / 1000000];
+    int callbacks = seconds * 1000000 / RECORDER_TEST_CALLBACK;
+    size_t position = 0;
+    size_t split = 0;
+    for (int i = 0; i < callbacks; i++) {
+        if (i == callbacks / 2) {
+            split = position;
+            recorder_split("Second song", recorder_position());
+        }
+
+        for (size_t b = 0; b < sizeof(chunk); b++) {
+            chunk[b] = stream_byte(position + b);
+        }
+        recorder_tee(chunk, sizeof(chunk));
+        position += sizeof(chunk);
+        usleep(RECORDER_TEST_CALLBACK / RECORDER_TEST_SPEED);
+    }
+
+    recorder_stop();
+    *dropped = recorder_dropped_bytes();
+    recorder_term();
+
+    // Dropped bytes leave holes, the content is only compared without them
+    size_t first = check_file(" - First song.mp3", 0, !*dropped);
+    size_t second = check_file(" - Second song.mp3", split, !*dropped);
+    int ret = (*dropped || first == split) && first + second + *dropped == position ? 0 : -1;
+    printf("card at %i KB/s: %zu bytes streamed, %zu + %zu recorded, %u dropped\n", card_rate / 1024, position, first, second, *dropped);
+
+    return ret;
+}
+
+int main()
+{
+    mkdir("ux0", 0755);
+    mkdir("ux0/data", 0755);
+    mkdir("ux0/data/webradio", 0755);
+    int failures = 0;
+
+    // A card faster than the stream keeps up with one block at a time
+    unsigned int dropped = 0;
+    if (record(40, 64 * 1024, &dropped) || dropped) {
+        printf("bytes lost with a card faster than the stream FAILED\n");
+        failures++;
+    }
+
+    // A card slower than the stream fills the ring, the loss must be counted and the rest still recorded
+    if (record(60, 16 * 1024, &dropped) || !dropped) {
+        printf("loss not reported with a card slower than the stream FAILED\n");
+        failures++;
+    }
+
+    printf("%i failures\n", failures);
+    return failures ? 1 : 0;
+}
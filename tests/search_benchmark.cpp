@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "playlist/playlist.hpp"
+#include "playlist/playlist_search.hpp"
+
+#define SEARCH_BENCHMARK_RUNS 3 // best of, every query is printed by the search
+
+static const int sizes[] = { 1000, 10000, 100000 };
+static const char *queries[] = { "jazz", "radio 12", "example", "fm", "jazz news", "zzz" };
+
+static const char *genres[] = { "Jazz", "Rock", "News", "Classical", "Pop", "Talk", "Electronic" };
+
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill(playlist *list, int count)
+{
+    char url[128];
+    char title[64];
+
+    for (int i = 0; i < count; i++) {
+        snprintf(url, sizeof(url), "http://s%i.example.com:8000/stream%i.mp3", i % 97, i);
+        snprintf(title, sizeof(title), "%s Radio %i %s", genres[i % 7], i, i % 3 ? "FM" : "Live");
+        playlist_add(list, url, title, NULL, genres[i * 5 % 7]);
+    }
+}
+
+/**
+ * Index build time and query latency by playlist size
+ */
+int main()
+{
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        playlist list;
+        playlist_init(&list);
+        fill(&list, sizes[s]);
+
+        playlist_search search;
+        playlist_search_init(&search);
+        double start = now();
+        if (playlist_search_update(&search, &list)) {
+            printf("%i stations: index FAILED\n", sizes[s]);
+            return 1;
+        }
+        double build = now() - start;
+
+        // Rebuild after an edit, as the index is thrown away
+        playlist_set(&list, 0, list.entries[0].url, "Edited", NULL, NULL);
+        start = now();
+        playlist_search_update(&search, &list);
+        double rebuild = now() - start;
+
+        printf("%i stations: index built in %.2f ms, rebuilt after an edit in %.2f ms\n", sizes[s], build * 1e3, rebuild * 1e3);
+
+        for (int q = 0; q < (int)(sizeof(queries) / sizeof(queries[0])); q++) {
+            unsigned int best = 0;
+            int results = 0;
+            for (int run = 0; run < SEARCH_BENCHMARK_RUNS; run++) {
+                results = playlist_search_query(&search, &list, queries[q]);
+                if (!run || search.query_time < best) {
+                    best = search.query_time;
+                }
+            }
+            printf("%i stations: \"%s\" %i results in %u us\n", sizes[s], queries[q], results, best);
+        }
+
+        playlist_search_free(&search);
+        playlist_free(&list);
+    }
+
+    return 0;
+}
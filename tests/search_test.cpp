@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "playlist/playlist.hpp"
+#include "playlist/playlist_search.hpp"
+
+/**
+ * Titles of the results of a query, in order, separated by semicolons
+ */
+static int check_query(playlist_search *search, const playlist *list, const char *step, const char *query, const char *expected)
+{
+    std::string titles;
+    int count = playlist_search_query(search, list, query);
+    for (int i = 0; i < count; i++) {
+        const char *title = list->entries[search->results[i]].title;
+        titles += title ? title : "(none)";
+        titles += ";";
+    }
+
+    int ret = count >= 0 && titles == expected ? 0 : 1;
+    printf("%s: \"%s\" gives %s %s\n", step, query, titles.c_str(), ret ? "FAILED" : "ok");
+    return ret;
+}
+
+/**
+ * Results must follow the stations after every kind of change, not only appends
+ */
+int main()
+{
+    playlist list;
+    playlist_search search;
+    playlist_init(&list);
+    playlist_search_init(&search);
+    int failures = 0;
+
+    playlist_add(&list, "http://jazz.example.com/live", "Jazz FM", NULL, "Music");
+    playlist_add(&list, "http://rock.example.com/live", "Rock Radio", NULL, "Music");
+    playlist_add(&list, "http://news.example.com/live", "World News", NULL, "Talk");
+    failures += check_query(&search, &list, "loaded", "radio", "Rock Radio;");
+    failures += check_query(&search, &list, "loaded", "music", "Jazz FM;Rock Radio;");
+
+    playlist_add(&list, "http://blues.example.com/live", "Blues Radio", NULL, NULL);
+    failures += check_query(&search, &list, "appended", "radio", "Rock Radio;Blues Radio;");
+
+    playlist_set(&list, 0, "http://classic.example.com/live", "Classic Radio", NULL, "Music");
+    failures += check_query(&search, &list, "edited", "jazz", "");
+    failures += check_query(&search, &list, "edited", "radio", "Classic Radio;Rock Radio;Blues Radio;");
+
+    playlist_move(&list, 3, 0);
+    failures += check_query(&search, &list, "moved", "blues", "Blues Radio;");
+    failures += check_query(&search, &list, "moved", "radio", "Blues Radio;Classic Radio;Rock Radio;");
+
+    // Same count as before, only the generation tells the index is stale
+    playlist_remove(&list, 2);
+    playlist_add(&list, "http://folk.example.com/live", "Folk Songs", NULL, "Music");
+    failures += check_query(&search, &list, "replaced", "rock", "");
+    failures += check_query(&search, &list, "replaced", "music", "Classic Radio;Folk Songs;");
+
+    playlist_free(&list);
+    playlist_add(&list, "http://other.example.com/live", "Other Radio", NULL, NULL);
+    failures += check_query(&search, &list, "reloaded", "radio", "Other Radio;");
+
+    playlist_search_free(&search);
+    playlist_free(&list);
+
+    printf("%i failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+
+#include "gui/station_list.hpp"
+#include "playlist_samples.hpp"
+
+#define STATION_LIST_BENCHMARK_ENTRIES 10000
+#define STATION_LIST_BENCHMARK_RUNS 20 // best of
+#define STATION_LIST_BENCHMARK_FILE "station_list_benchmark.m3u"
+#define STATION_LIST_BENCHMARK_ROW_HEIGHT (STATION_LIST_ROW_HEIGHT + 4.0f) // row and default item spacing
+#define STATION_LIST_BENCHMARK_WINDOW_HEIGHT 450.0f // station menu below the buttons
+
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Rows of one frame as ImGuiListClipper gives them for fixed height rows, resolved to the text drawn
+ *
+ * @return the number of rows drawn
+ */
+static int draw_frame(const station_list *sl, const playlist *list, float scroll_y, size_t *text_length)
+{
+    int start = (int)floorf(scroll_y / STATION_LIST_BENCHMARK_ROW_HEIGHT);
+    int end = (int)ceilf((scroll_y + STATION_LIST_BENCHMARK_WINDOW_HEIGHT) / STATION_LIST_BENCHMARK_ROW_HEIGHT);
+    start = start < 0 ? 0 : start;
+    end = end > sl->row_count ? sl->row_count : end;
+
+    for (int row = start; row < end; row++) {
+        int index = sl->rows[row];
+        const char *text = index < 0 ? list->groups[-index - 2] : list->entries[index].title ? list->entries[index].title : list->entries[index].url;
+        *text_length += text[0] != '\0';
+    }
+
+    return end > start ? end - start : 0;
+}
+
+/**
+ * Row build and per frame row math on a generated playlist, as the station menu runs them
+ */
+int main()
+{
+    std::string data;
+    playlist_sample_find("M3U")->generate(data, STATION_LIST_BENCHMARK_ENTRIES, false);
+
+    FILE *file = fopen(STATION_LIST_BENCHMARK_FILE, "wb");
+    if (!file || fwrite(data.data(), 1, data.size(), file) != data.size() || fclose(file)) {
+        printf("cannot write %s\n", STATION_LIST_BENCHMARK_FILE);
+        return 1;
+    }
+
+    playlist list;
+    playlist_init(&list);
+    if (playlist_load_m3u(&list, STATION_LIST_BENCHMARK_FILE) || list.count != STATION_LIST_BENCHMARK_ENTRIES) {
+        printf("loaded %i stations of %i FAILED\n", list.count, STATION_LIST_BENCHMARK_ENTRIES);
+        return 1;
+    }
+    remove(STATION_LIST_BENCHMARK_FILE);
+
+    // Every third station, like search results
+    int filter_count = 0;
+    int *filter = new int[list.count];
+    for (int i = 0; i < list.count; i += 3) {
+        filter[filter_count++] = i;
+    }
+
+    station_list sl;
+    station_list_init(&sl);
+
+    for (int filtered = 0; filtered < 2; filtered++) {
+        station_list_set_filter(&sl, filtered ? filter : NULL, filter_count);
+
+        double best = 0.0;
+        for (int run = 0; run < STATION_LIST_BENCHMARK_RUNS; run++) {
+            double start = now();
+            if (station_list_build(&sl, &list)) {
+                printf("building FAILED\n");
+                return 1;
+            }
+            double elapsed = now() - start;
+            if (!run || elapsed < best) {
+                best = elapsed;
+            }
+        }
+
+        printf("%i stations%s: %i rows with %i headers built in %.3f ms\n", list.count, filtered ? ", filtered" : "",
+            sl.row_count, sl.row_count - (filtered ? filter_count : list.count), best * 1e3);
+    }
+
+    // Scroll through the whole list a row at a time, then jump to every station
+    station_list_set_filter(&sl, NULL, 0);
+    station_list_update(&sl, &list);
+
+    size_t text_length = 0;
+    long drawn = 0;
+    int most = 0;
+    double start = now();
+    for (int row = 0; row < sl.row_count; row++) {
+        int rows = draw_frame(&sl, &list, row * STATION_LIST_BENCHMARK_ROW_HEIGHT, &text_length);
+        drawn += rows;
+        most = rows > most ? rows : most;
+    }
+    double scroll = now() - start;
+
+    int misplaced = 0;
+    start = now();
+    for (int i = 0; i < list.count; i++) {
+        station_list_show(&sl, &list, i);
+        float scroll_y = station_list_scroll_y(sl.scroll_row, STATION_LIST_BENCHMARK_ROW_HEIGHT, STATION_LIST_BENCHMARK_WINDOW_HEIGHT);
+        float scroll_max = sl.row_count * STATION_LIST_BENCHMARK_ROW_HEIGHT - STATION_LIST_BENCHMARK_WINDOW_HEIGHT;
+        scroll_y = scroll_y < 0.0f ? 0.0f : scroll_y > scroll_max ? scroll_max : scroll_y;
+
+        // The focused row must be among the rows the clipper submits
+        int first = (int)floorf(scroll_y / STATION_LIST_BENCHMARK_ROW_HEIGHT);
+        drawn += draw_frame(&sl, &list, scroll_y, &text_length);
+        misplaced += sl.focus_row < first || sl.focus_row >= first + most;
+    }
+    double show = now() - start;
+
+    printf("%i rows: %.3f us per scrolled frame, %i rows drawn at most, %.3f us per jump to a station, %i jumps off screen %s\n",
+        sl.row_count, scroll * 1e6 / sl.row_count, most, show * 1e6 / list.count, misplaced, misplaced || !text_length ? "FAILED" : "ok");
+
+    station_list_free(&sl);
+    delete[] filter;
+    playlist_free(&list);
+
+    return misplaced ? 1 : 0;
+}
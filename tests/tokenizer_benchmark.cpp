@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+#include "playlist_samples.hpp"
+
+#define TOKENIZER_BENCHMARK_ENTRIES 100000 // tens of MB, like the dumps of IPTV providers
+#define TOKENIZER_BENCHMARK_TIME 0.2 // seconds per format
+#define TOKENIZER_BENCHMARK_CHUNK (64 * 1024) // PLAYLIST_READ_SIZE, what the importer reads at once
+
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void count_item(void *user, const m3u_item *item)
+{
+    (*(int*)user)++;
+}
+
+static void ignore_error(void *user, int line, const char *message)
+{
+}
+
+/**
+ * Throughput of the tokenizer of each import format, fed by read chunks
+ */
+int main()
+{
+    const m3u_tokenizer_callbacks callbacks = { count_item, NULL, ignore_error, NULL };
+    printf("%-6s %10s %10s %10s %12s\n", "format", "entries", "KB", "MB/s", "entries/s");
+
+    for (int f = 0; f < playlist_sample_format_count; f++) {
+        const playlist_sample_format *format = &playlist_sample_formats[f];
+        std::string data;
+        format->generate(data, TOKENIZER_BENCHMARK_ENTRIES, false);
+
+        int runs = 0;
+        int items = 0;
+        double start = now(), elapsed;
+        do {
+            if (format->tokenize(data.data(), data.size(), TOKENIZER_BENCHMARK_CHUNK, &callbacks, &items) < 0) {
+                printf("%s: tokenizer failed\n", format->name);
+                return 1;
+            }
+            runs++;
+            elapsed = now() - start;
+        } while (elapsed < TOKENIZER_BENCHMARK_TIME);
+
+        printf("%-6s %10i %10zu %10.1f %12.0f\n", format->name, items / runs, data.size() / 1024,
+            data.size() * runs / elapsed / (1024 * 1024), items / elapsed);
+    }
+
+    return 0;
+}
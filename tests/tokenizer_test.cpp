@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "playlist_samples.hpp"
+
+extern "C" {
+    #include "pls_parser/pls_tokenizer.h"
+}
+
+#define TOKENIZER_TEST_ENTRIES 500
+
+// Chunk sizes fed to the tokenizers, 0 for the whole file at once
+static const size_t chunks[] = { 1, 2, 3, 7, 64, 4096, 65536, 0 };
+
+static void record_span(std::string *record, const char *name, m3u_span span)
+{
+    if (span.length) {
+        *record += name;
+        *record += '=';
+        record->append(span.data, span.length);
+        *record += '|';
+    }
+}
+
+// Every field and callback in one line each, compared between chunk sizes
+static void record_item(void *user, const m3u_item *item)
+{
+    std::string *record = (std::string*)user;
+    char line[64];
+    snprintf(line, sizeof(line), "item %i %i|", item->line, item->duration);
+    *record += line;
+
+    record_span(record, "url", item->url);
+    record_span(record, "title", item->title);
+    record_span(record, "tvg-id", item->tvg_id);
+    record_span(record, "tvg-name", item->tvg_name);
+    record_span(record, "tvg-logo", item->tvg_logo);
+    record_span(record, "group", item->group_title);
+    record_span(record, "codec", item->codec);
+    record_span(record, "bitrate", item->bitrate);
+    record_span(record, "tags", item->tags);
+    for (int i = 0; i < item->attribute_count; i++) {
+        record_span(record, "name", item->attributes[i].name);
+        record_span(record, "value", item->attributes[i].value);
+    }
+    *record += '\n';
+}
+
+static void record_playlist_name(void *user, m3u_span name)
+{
+    std::string *record = (std::string*)user;
+    record_span(record, "playlist", name);
+    *record += '\n';
+}
+
+static void record_error(void *user, int line, const char *message)
+{
+    std::string *record = (std::string*)user;
+    char text[128];
+    snprintf(text, sizeof(text), "error %i %s\n", line, message);
+    *record += text;
+}
+
+static void record_directive(void *user, m3u_span line)
+{
+    std::string *record = (std::string*)user;
+    record_span(record, "directive", line);
+    *record += '\n';
+}
+
+static const m3u_tokenizer_callbacks record_callbacks = { record_item, record_playlist_name, record_error, record_directive };
+
+/**
+ * Every chunk size must give the same items, errors and line numbers as the whole file
+ */
+static int check_chunks(const playlist_sample_format *format)
+{
+    std::string data;
+    format->generate(data, TOKENIZER_TEST_ENTRIES, true);
+
+    std::string expected;
+    int expected_errors = format->tokenize(data.data(), data.size(), data.size(), &record_callbacks, &expected);
+    size_t items = 0;
+    for (size_t i = expected.find("item "); i != std::string::npos; i = expected.find("\nitem ", i + 1)) {
+        items++;
+    }
+
+    if (expected_errors < 0 || items != TOKENIZER_TEST_ENTRIES) {
+        printf("%s: %zu items of %i, %i errors, FAILED\n", format->name, items, TOKENIZER_TEST_ENTRIES, expected_errors);
+        return 1;
+    }
+
+    int failures = 0;
+    for (int c = 0; c < (int)(sizeof(chunks) / sizeof(chunks[0])); c++) {
+        size_t chunk = chunks[c] ? chunks[c] : data.size();
+        std::string record;
+        int errors = format->tokenize(data.data(), data.size(), chunk, &record_callbacks, &record);
+
+        int ret = errors == expected_errors && record == expected ? 0 : 1;
+        printf("%s: %zu bytes by %zu: %i errors, %s\n", format->name, data.size(), chunk, errors, ret ? "FAILED" : "ok");
+        failures += ret;
+    }
+
+    return failures;
+}
+
+static void keep_item(void *user, const m3u_item *item)
+{
+    *(m3u_item*)user = *item;
+}
+
+/**
+ * Group and attributes of the single entry of a m3u playlist
+ */
+static int check_m3u_item(const char *name, const char *data, const char *group, int attribute_count, int errors)
+{
+    m3u_item item = m3u_item();
+    const m3u_tokenizer_callbacks callbacks = { keep_item, NULL, NULL, NULL };
+    std::string copy;
+
+    // The spans point into the tokenizer, they are copied before it is freed
+    m3u_tokenizer tokenizer;
+    m3u_tokenizer_init(&tokenizer, &callbacks, &item);
+    int ret = m3u_tokenizer_feed(&tokenizer, data, strlen(data)) || m3u_tokenizer_finish(&tokenizer) ? 1 : 0;
+    copy.assign(item.group_title.data ? item.group_title.data : "", item.group_title.length);
+    ret |= copy != group || item.attribute_count != attribute_count || tokenizer.errors != errors;
+    printf("M3U %s: group \"%s\", %i attributes, %i errors %s\n", name, copy.c_str(), item.attribute_count, tokenizer.errors,
+        ret ? "FAILED" : "ok");
+    m3u_tokenizer_free(&tokenizer);
+
+    return ret;
+}
+
+/**
+ * PLS entries are emitted in index order whatever the order of their lines
+ */
+static int check_pls_order(const char *name, const char *data, const char *expected)
+{
+    int failures = 0;
+
+    for (size_t chunk = 1; chunk <= strlen(data); chunk++) {
+        std::string record;
+        const m3u_tokenizer_callbacks callbacks = { record_item, NULL, record_error, NULL };
+        if (playlist_sample_find("PLS")->tokenize(data, strlen(data), chunk, &callbacks, &record) < 0) {
+            failures++;
+            continue;
+        }
+
+        // Only the URL and title are compared
+        std::string entries;
+        for (size_t start = 0; start < record.size();) {
+            size_t end = record.find('\n', start);
+            std::string line = record.substr(start, end - start);
+            start = end + 1;
+
+            size_t url = line.find("|url=");
+            if (url == std::string::npos) {
+                entries += line.substr(0, line.find(' ', line.find(' ') + 1)) + ";";
+                continue;
+            }
+            size_t title = line.find("|title=");
+            entries += line.substr(url + 5, line.find('|', url + 1) - url - 5);
+            if (title != std::string::npos) {
+                entries += "," + line.substr(title + 7, line.find('|', title + 1) - title - 7);
+            }
+            entries += ";";
+        }
+
+        if (entries != expected) {
+            printf("PLS %s by %zu: %s instead of %s FAILED\n", name, chunk, entries.c_str(), expected);
+            failures++;
+        }
+    }
+
+    if (!failures) {
+        printf("PLS %s: ok\n", name);
+    }
+    return failures ? 1 : 0;
+}
+
+int main()
+{
+    int failures = 0;
+
+    for (int f = 0; f < playlist_sample_format_count; f++) {
+        failures += check_chunks(&playlist_sample_formats[f]);
+    }
+
+    failures += check_m3u_item("group", "#EXTGRP:News\n#EXTINF:-1 group-title=\"Talk\",A\nhttp://a/\n", "Talk", 1, 0);
+    failures += check_m3u_item("empty group", "#EXTGRP:News\n#EXTINF:-1 group-title=\"\",A\nhttp://a/\n", "News", 1, 0);
+    std::string attributes = "#EXTINF:-1";
+    for (int i = 0; i < M3U_MAX_ATTRIBUTES + 4; i++) {
+        attributes += " a" + std::to_string(i) + "=" + std::to_string(i);
+    }
+    attributes += " group-title=Last,A\nhttp://a/\n";
+    failures += check_m3u_item("attributes", attributes.c_str(), "Last", M3U_MAX_ATTRIBUTES, 1);
+
+    failures += check_pls_order("reversed", "[playlist]\nFile2=b\nTitle2=B\nFile1=a\nTitle1=A\n", "a,A;b,B;");
+    failures += check_pls_order("gap", "File1=a\nFile3=c\nTitle3=C\nTitle1=A\nFile2=b\n", "a,A;b;c,C;");
+    failures += check_pls_order("titles last", "File1=a\nFile2=b\nFile3=c\nTitle1=A\nTitle2=B\nTitle3=C\n", "a,A;b,B;c,C;");
+    failures += check_pls_order("title alone", "Title1=A\nFile2=b\n", "error 2;b;");
+
+    // Beyond the window the lowest entries are released untitled, their titles come too late
+    std::string window;
+    std::string window_expected;
+    for (int i = 1; i <= PLS_TOKENIZER_MAX_PENDING + 2; i++) {
+        window += "File" + std::to_string(i) + "=u" + std::to_string(i) + "\n";
+    }
+    for (int i = 1; i <= PLS_TOKENIZER_MAX_PENDING + 2; i++) {
+        window += "Title" + std::to_string(i) + "=T" + std::to_string(i) + "\n";
+    }
+    for (int i = 1; i <= 2; i++) {
+        window_expected += "u" + std::to_string(i) + ";";
+    }
+    for (int i = 1; i <= 2; i++) {
+        window_expected += "error " + std::to_string(PLS_TOKENIZER_MAX_PENDING + 2 + i) + ";";
+    }
+    for (int i = 3; i <= PLS_TOKENIZER_MAX_PENDING + 2; i++) {
+        window_expected += "u" + std::to_string(i) + ",T" + std::to_string(i) + ";";
+    }
+    failures += check_pls_order("window", window.c_str(), window_expected.c_str());
+
+    printf("%i failures\n", failures);
+    return failures ? 1 : 0;
+}